@@ -130,6 +130,11 @@ void cl_global_init(struct cl_init_data *data)
     init_data = *data;
 }
 
+void cl_global_get_init_data(struct cl_init_data *data)
+{
+    *data = init_data;
+}
+
 void cl_global_init_defaults(const char *name, int debug_level)
 {
     if (app_name_allocated)
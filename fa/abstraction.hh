@@ -36,7 +36,7 @@ public:
 		Index<size_t> stateIndex;
 		this->fae.roots[root]->buildStateIndex(stateIndex);
 //		std::cerr << stateIndex << std::endl;
-		std::vector<std::vector<bool> > rel(stateIndex.size(), std::vector<bool>(stateIndex.size(), true));
+		BitRelation rel(stateIndex.size(), true);
 		this->fae.roots[root]->heightAbstraction(rel, height, f, stateIndex);
 //		utils::relPrint(std::cerr, rel);
 		ConnectionGraph::StateToCutpointSignatureMap stateMap;
@@ -52,7 +52,7 @@ public:
 					continue;
 
 //				std::cerr << j->first << " != " << k->first << " because " << stateMap[j->first] << " !=  " << stateMap[k->first] << std::endl;
-				rel[j->second][k->second] = false;
+				rel.reset(j->second, k->second);
 
 			}
 
@@ -29,6 +29,8 @@
 
 #include <boost/unordered_map.hpp>
 
+#include "bitrelation.hh"
+#include "bitset.hh"
 #include "cache.hh"
 
 using std::vector;
@@ -45,105 +47,79 @@ class Antichain {
 
 protected:
 
-	typedef Cache<set<size_t> > state_cache_type;
+	// macrostates are interned, so that equal ones are represented only once
+	typedef Cache<BitSet> state_cache_type;
 
 	state_cache_type stateCache;
 
-	CachedBinaryOp<state_cache_type::value_type*, bool> cachedLte;
-	
-/*
-	typedef unordered_map<pair<state_cache_type::value_type*, state_cache_type::value_type*>, bool> lte_cache_type;
-	typedef unordered_map<state_cache_type::value_type*, set<lte_cache_type::value_type*> > lte_cache_map_type;
-*/
-//	typedef multimap<size_t, state_cache_type::value_type*> antichain_type;
-	typedef list<state_cache_type::value_type*> antichain_item_type;
+	// elements of the antichain sharing the same state, ordered by the size of
+	// their macrostates; with the identity relation, x <= y implies that x is
+	// not larger than y, so only a part of a bucket needs to be searched for
+	// the elements covering (covered by) a given one
+	typedef multimap<size_t, state_cache_type::value_type*> antichain_item_type;
 	typedef unordered_map<size_t, antichain_item_type> antichain_type;
 
-	const vector<vector<bool> >& rel; 
+	const BitRelation& rel; 
+	BitRelation invRel;
+	bool identity;
 	
 	vector<vector<size_t> > relIndex;
 	vector<vector<size_t> > invRelIndex;
 
-	struct Lte {
-		
-		Antichain& ac;
-		
-		Lte(Antichain& ac) : ac(ac) {}
-		
-		bool operator()(state_cache_type::value_type* x, state_cache_type::value_type* y) {
-			for (set<size_t>::const_iterator i = x->first.begin(); i != x->first.end(); ++i) {
-				if (!utils::checkIntersection(y->first, this->ac.relIndex[*i]))
-					return false;
-			}
-			return true;
-		}
-/*
-		bool operator()(Cache<set<size_t> >::value_type* x, Cache<set<size_t> >::value_type* y) {
-			return utils::checkInclusion(x->first, y->first));
-		}
-*/
-	};
+	struct RelatedF {
 
-	bool lte(state_cache_type::value_type* x, state_cache_type::value_type* y) {
-		return (x == y)?(true):(this->cachedLte.lookup(x, y, Lte(*this)));
-	}
+		const BitSet& y;
+		const BitRelation& rel;
+		bool& result;
 
-	bool check(const multimap<size_t, state_cache_type::value_type*>& ac, const pair<size_t, state_cache_type::value_type*>& el) {
-		for (vector<size_t>::const_iterator i = this->relIndex[el.first].begin(); i != this->relIndex[el.first].end(); ++i) {
-			for (pair<multimap<size_t, state_cache_type::value_type*>::const_iterator, multimap<size_t, state_cache_type::value_type*>::const_iterator> p = ac.equal_range(*i); p.first != p.second; ++p.first) {
-				if (this->lte(p.first->second, el.second))
-					return true;
-			}
-				
+		RelatedF(const BitSet& y, const BitRelation& rel, bool& result) : y(y), rel(rel), result(result) {}
+
+		void operator()(size_t i) {
+			if (!this->y.intersects(this->rel, i))
+				this->result = false;
 		}
-		return false;
+
+	};
+
+	// x <= y iff each state of x is related to some state of y
+	bool lte(state_cache_type::value_type* x, state_cache_type::value_type* y) const {
+		if (x == y)
+			return true;
+		if (this->identity)
+			return x->first.subseteq(y->first);
+		bool result = true;
+		x->first.forEach(RelatedF(y->first, this->rel, result));
+		return result;
 	}
 
-	bool check(const antichain_type& ac, const pair<size_t, state_cache_type::value_type*>& el) {
+	template <class M>
+	bool check(const M& ac, const pair<size_t, state_cache_type::value_type*>& el) const {
+		const size_t cnt = el.second->first.count();
 		for (vector<size_t>::const_iterator i = this->relIndex[el.first].begin(); i != this->relIndex[el.first].end(); ++i) {
-			antichain_type::const_iterator j = ac.find(*i);
+			typename M::const_iterator j = ac.find(*i);
 			if (j == ac.end())
 				continue;
-			for (antichain_item_type::const_iterator k = j->second.begin(); k != j->second.end(); ++k) {
-				if (this->lte(*k, el.second))
+			antichain_item_type::const_iterator end = (this->identity)?(j->second.upper_bound(cnt)):(j->second.end());
+			for (antichain_item_type::const_iterator k = j->second.begin(); k != end; ++k) {
+				if (this->lte(k->second, el.second))
 					return true;
 			}
-				
 		}
 		return false;
 	}
 
-	bool check(const list<pair<size_t, state_cache_type::value_type*> >& ac, const pair<size_t, state_cache_type::value_type*>& el) {
-		for (list<pair<size_t, state_cache_type::value_type*> >::const_iterator i = ac.begin(); i != ac.end(); ++i) {
-			if (rel[el.first][i->first] && this->lte(i->second, el.second))
-				return true;
-		}
-		return false;
-	}
-
-	void refine(multimap<size_t, state_cache_type::value_type*>& ac, const pair<const size_t, state_cache_type::value_type*>& el) {
+	template <class M>
+	void refine(M& ac, const pair<size_t, state_cache_type::value_type*>& el) {
+		const size_t cnt = el.second->first.count();
 		for (vector<size_t>::iterator i = this->invRelIndex[el.first].begin(); i != this->invRelIndex[el.first].end(); ++i) {
-			for (pair<multimap<size_t, state_cache_type::value_type*>::iterator, multimap<size_t, state_cache_type::value_type*>::iterator> p = ac.equal_range(*i); p.first != p.second; ) {
-				if (this->lte(el.second, p.first->second)) {
-					this->stateCache.release(p.first->second);
-					multimap<size_t, state_cache_type::value_type*>::iterator j = p.first++;
-					ac.erase(j);
-				} else {
-					++p.first;
-				}
-			}
-		}
-	}
-
-	void refine(antichain_type& ac, const pair<const size_t, state_cache_type::value_type*>& el) {
-		for (vector<size_t>::iterator i = this->invRelIndex[el.first].begin(); i != this->invRelIndex[el.first].end(); ++i) {
-			antichain_type::iterator j = ac.find(*i);
+			typename M::iterator j = ac.find(*i);
 			if (j == ac.end())
 				continue;
-			for (antichain_item_type::iterator k = j->second.begin(); k != j->second.end(); ) {
-				if (this->lte(el.second, *k)) {
-					this->stateCache.release(*k);
-					k = j->second.erase(k);
+			antichain_item_type::iterator k = (this->identity)?(j->second.lower_bound(cnt)):(j->second.begin());
+			while (k != j->second.end()) {
+				if (this->lte(el.second, k->second)) {
+					this->stateCache.release(k->second);
+					j->second.erase(k++);
 				} else ++k;
 			}
 			if (j->second.empty())
@@ -151,50 +127,30 @@ protected:
 		}
 	}
 
-	void refine(list<pair<size_t, state_cache_type::value_type*> >& ac, const pair<size_t, state_cache_type::value_type*>& el) {
-		for (list<pair<size_t, state_cache_type::value_type*> >::iterator i = ac.begin(); i != ac.end(); ) {
-			if (rel[i->first][el.first] && this->lte(el.second, i->second)) {
-				this->stateCache.release(i->second);
-				i = ac.erase(i);
-			} else ++i;
-		}
+	template <class M>
+	static void insert(M& ac, const pair<size_t, state_cache_type::value_type*>& el) {
+		ac[el.first].insert(std::make_pair(el.second->first.count(), el.second));
 	}
 
 protected:
 
-	struct StateCacheListener : public state_cache_type::Listener {
-		
-		struct NoOp { void operator()(bool) {} };
-		
-		Antichain& antichain;
-		
-		StateCacheListener(Antichain& antichain) : antichain(antichain) {
-			this->antichain.stateCache.addListener(this);
-		}
-		
-		virtual void drop(state_cache_type::value_type* x) {
-			this->antichain.cachedLte.invalidateKey(x, NoOp());
-		}
-		
-	};
-	
-	StateCacheListener stateCacheListener;
-	
 	antichain_type processed;
-//	list<pair<size_t, state_cache_type::value_type*> > next;
-	multimap<size_t, state_cache_type::value_type*> next;
+	// ordered by the states, so that they are processed in a fixed order
+	map<size_t, antichain_item_type> next;
 
 public:
 
-	Antichain(const vector<vector<bool> >& rel) : rel(rel), stateCacheListener(*this) {
+	Antichain(const BitRelation& rel) : rel(rel), invRel(), identity(false) {
 		utils::relIndex(this->relIndex, rel);
-		vector<vector<bool> > invRel;
-		utils::relInv(invRel, rel);
-		utils::relIndex(this->invRelIndex, invRel);
+		utils::relInv(this->invRel, rel);
+		utils::relIndex(this->invRelIndex, this->invRel);
+		BitRelation ident;
+		ident.identity(rel.size());
+		this->identity = (rel == ident);
 	}
 	
-	void initialize(const vector<pair<size_t, set<size_t> > >& post) {
-		for (vector<pair<size_t, set<size_t> > >::const_iterator i = post.begin(); i != post.end(); ++i) {
+	void initialize(const vector<pair<size_t, BitSet> >& post) {
+		for (vector<pair<size_t, BitSet> >::const_iterator i = post.begin(); i != post.end(); ++i) {
 			pair<size_t, state_cache_type::value_type*> p = make_pair(i->first, this->stateCache.lookup(i->second));
 			// antichain acceleration
 			if (this->check(this->next, p)) {
@@ -202,13 +158,12 @@ public:
 				continue;
 			}
 			this->refine(this->next, p);
-//			this->next.push_back(p);
-			this->next.insert(p);
+			Antichain::insert(this->next, p);
 		}
 	}
 
-	void update(const vector<pair<size_t, set<size_t> > >& post) {
-		for (vector<pair<size_t, set<size_t> > >::const_iterator i = post.begin(); i != post.end(); ++i) {
+	void update(const vector<pair<size_t, BitSet> >& post) {
+		for (vector<pair<size_t, BitSet> >::const_iterator i = post.begin(); i != post.end(); ++i) {
 			pair<size_t, state_cache_type::value_type*> p = make_pair(i->first, this->stateCache.lookup(i->second));
 			// antichain acceleration
 			if (this->check(this->processed, p) || this->check(this->next, p)) {
@@ -217,34 +172,19 @@ public:
 			}
 			this->refine(this->processed, p);
 			this->refine(this->next, p);
-//			this->next.push_back(p);
-			this->next.insert(p);
+			Antichain::insert(this->next, p);
 		}
 	}
-/*
-	bool nextElement(antichain_type::iterator& el) {
-		if (this->next.empty())
-			return false;
-		el = this->processed.insert(this->next.front());
-		this->next.pop_front();
-		return true;
-	}
-*//*
-	bool nextElement(pair<size_t, state_cache_type::value_type*>& el) {
-		if (this->next.empty())
-			return false;
-		el = this->next.front();
-		this->next.pop_front();
-		this->processed.insert(make_pair(el.first, antichain_item_type())).first->second.push_back(el.second);
-		return true;
-	}
-*/
+
 	bool nextElement(pair<size_t, state_cache_type::value_type*>& el) {
 		if (this->next.empty())
 			return false;
-		el = *this->next.begin();
-		this->next.erase(this->next.begin());
-		this->processed.insert(make_pair(el.first, antichain_item_type())).first->second.push_back(el.second);
+		map<size_t, antichain_item_type>::iterator i = this->next.begin();
+		el = make_pair(i->first, i->second.begin()->second);
+		i->second.erase(i->second.begin());
+		if (i->second.empty())
+			this->next.erase(i);
+		Antichain::insert(this->processed, el);
 		return true;
 	}
 
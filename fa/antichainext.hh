@@ -43,15 +43,12 @@ private:
 
 	vector<vector<trans_list_type> > aTransIndex;
 
-	void simInsert(pair<size_t, set<size_t> >& el, bool& isAccepting, size_t rhs, const TA<T>& aut) {
+	void simInsert(pair<size_t, BitSet>& el, bool& isAccepting, size_t rhs, const TA<T>& aut) {
 		// minimization
-		for (vector<size_t>::const_iterator i = this->relIndex[rhs].begin(); i != this->relIndex[rhs].end(); ++i) {
-			if (el.second.find(*i) != el.second.end())
-				return;
-		}
-		for (vector<size_t>::const_iterator i = this->invRelIndex[rhs].begin(); i != this->invRelIndex[rhs].end(); ++i)
-			el.second.erase(*i);
-		el.second.insert(rhs);
+		if (el.second.intersects(this->rel, rhs))
+			return;
+		el.second.subtract(this->invRel, rhs);
+		el.second.set(rhs);
 		isAccepting = isAccepting && !aut.isFinalState(rhs);
 	}
 
@@ -77,7 +74,7 @@ public:
 
 public:
 
-	AntichainExt(const vector<vector<bool> >& rel)
+	AntichainExt(const BitRelation& rel)
 		: Antichain(rel) {}
 	
 	void initIndex(size_t aSize, size_t /* bSize */) {
@@ -110,11 +107,12 @@ public:
 			
 		public:
 
-			ResponseExt(AntichainExt& ac) : ac(ac), state(), fixed(1) {}
+			ResponseExt(AntichainExt& ac) : ac(ac), state(), fixed() {}
 		
 			bool get(const pair<size_t, state_cache_type::value_type*>& el, const typename TA<T>::trans_cache_type::value_type* t, size_t index) {
 				this->state.clear();
-				this->fixed.front() = el.second;
+				this->fixed.clear();
+				this->fixed.insert(std::make_pair(0, el.second));
 				for (size_t i = 0; i < t->first._lhs->first.size(); ++i) {
 					State state;
 					if (i == index) {
@@ -141,7 +139,7 @@ public:
 			
 			bool match(const typename TA<T>::trans_cache_type::value_type* t) {
 				for (size_t i = 0; i < t->first._lhs->first.size(); ++i) {
-					if ((*this->state[i].current)->first.count(t->first._lhs->first[i]) == 0)
+					if (!this->state[i].current->second->first.get(t->first._lhs->first[i]))
 						return false;
 				}
 				return true;
@@ -165,13 +163,10 @@ public:
 		for (size_t i = 0; i < cSize; ++i)
 			stateIndex.add(i);
 		// compute simulation
-		vector<vector<bool> > upsim, dwnsim, ident(cSize, vector<bool>(cSize, false));
-		for (size_t i = 0; i < cSize; ++i)
-			ident[i][i] = true;		
+		BitRelation upsim, dwnsim, ident;
+		ident.identity(cSize);
 //		computeUp(upsim, c, slIndex, ident);
 		upsim = ident;
-		vector<vector<size_t> > upsimIndex;
-		utils::relIndex(upsimIndex, upsim);
 		AntichainExt<T> antichain(upsim);
 		typename AntichainExt<T>::ResponseExt response(antichain);
 		antichain.initIndex(cSize - countB, countB);
@@ -196,20 +191,20 @@ public:
 		antichain.finalizeTransitions();
 		// initialization
 		// Post(\emptyset)
-		vector<pair<size_t, set<size_t> > > post;
+		vector<pair<size_t, BitSet> > post;
 		for (typename vector<typename TA<T>::trans_cache_type::value_type*>::iterator i = aLeaves.begin(); i != aLeaves.end(); ++i) {
 			typename unordered_map<T, vector<typename TA<T>::trans_cache_type::value_type*> >::iterator range = bLeaves.find((*i)->first._label);
 			// careful
 			if (range == bLeaves.end())
 				return false;
-			pair<size_t, set<size_t> > newEl((*i)->first._rhs, set<size_t>());
+			pair<size_t, BitSet> newEl((*i)->first._rhs, BitSet(cSize));
 			bool isAccepting = c.isFinalState(newEl.first);
 			for (typename vector<typename TA<T>::trans_cache_type::value_type*>::iterator j = range->second.begin(); j != range->second.end(); ++j)
 				antichain.simInsert(newEl, isAccepting, (*j)->first._rhs, c);
 			if (isAccepting)
 				return false;
 			// cross-automata check
-			if (!utils::checkIntersection(newEl.second, upsimIndex[newEl.first]))
+			if (!newEl.second.intersects(upsim, newEl.first))
 				post.push_back(newEl);
 		}
 		antichain.initialize(post);
@@ -235,7 +230,7 @@ public:
 					if (range == bTrans.end())
 						return false;
 					do {
-						pair<size_t, set<size_t> > newEl((*j)->first._rhs, set<size_t>());
+						pair<size_t, BitSet> newEl((*j)->first._rhs, BitSet(cSize));
 						bool isAccepting = c.isFinalState(newEl.first);
 						for (typename vector<typename TA<T>::trans_cache_type::value_type*>::iterator k = range->second.begin(); k != range->second.end(); ++k) {
 							if (response.match(*k))
@@ -250,7 +245,7 @@ public:
 							return false;
 						}
 						// cross-automata check
-						if (!utils::checkIntersection(newEl.second, upsimIndex[newEl.first]))
+						if (!newEl.second.intersects(upsim, newEl.first))
 							post.push_back(newEl);
 					} while (response.next());
 				}			
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// benchmark of the simulations over tree automata
+//
+// usage: bench_simulation [DUMP...]
+//
+// each DUMP is a file written by forester built with FA_SIM_DUMP_FILE set in
+// config.h, i.e. a sequence of automata in the Timbuk format, each of them
+// with an alphabet of its own; the simulations and the minimization of every
+// automaton are timed without the memos of the backend
+//
+// without arguments, 300 random automata with 150-200 states, and 3000 random
+// LTSs with 200-300 states are used instead
+
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// the template bodies of TA<T> are not in the header
+#include "treeaut.cc"
+#include "tatimint.hh"
+
+static unsigned long long seed = 4242;
+
+static size_t rnd() {
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed >> 33;
+}
+
+struct Timer {
+
+	clock_t start;
+
+	Timer() : start(clock()) {}
+
+	double elapsed() const {
+		return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+	}
+
+};
+
+struct Times {
+
+	double dwn, up, combo, min;
+
+	Times() : dwn(0), up(0), combo(0), min(0) {}
+
+	void print() const {
+		std::cout << "downward simulation: " << this->dwn << " s" << std::endl;
+		std::cout << "upward simulation: " << this->up << " s" << std::endl;
+		std::cout << "combined simulation: " << this->combo << " s" << std::endl;
+		std::cout << "minimizedCombo(): " << this->min << " s" << std::endl;
+	}
+
+};
+
+template <class T>
+static void measure(Times& times, const TA<T>& ta) {
+	Index<size_t> stateIndex;
+	ta.buildSortedStateIndex(stateIndex);
+	BitRelation dwn, up, rel;
+	Timer t;
+	ta.downwardSimulation(dwn, stateIndex);
+	times.dwn += t.elapsed();
+	t = Timer();
+	ta.upwardSimulation(up, stateIndex, dwn);
+	times.up += t.elapsed();
+	t = Timer();
+	TA<T>::combinedSimulation(rel, dwn, up);
+	times.combo += t.elapsed();
+	TA<T> dst(*ta.backend);
+	t = Timer();
+	ta.minimizedCombo(dst);
+	times.min += t.elapsed();
+}
+
+// every dumped automaton starts with the 'Ops' line of its own alphabet, which
+// the reader does not accept in the middle of a model list
+static void load(TAMultiReader& reader, const char* fileName) {
+	std::ifstream input(fileName);
+	if (!input)
+		throw std::runtime_error(std::string("unable to open ") + fileName);
+	std::string line, chunk;
+	while (true) {
+		const bool eof = !std::getline(input, line);
+		if ((eof || line.compare(0, 3, "Ops") == 0) && !chunk.empty()) {
+			std::istringstream s(chunk);
+			reader.resetInput(s, fileName);
+			reader.read();
+			chunk.clear();
+		}
+		if (eof)
+			break;
+		chunk += line + '\n';
+	}
+}
+
+static void benchDumps(int argc, char* argv[]) {
+	TA<std::string>::Backend backend(0);
+	TAMultiReader reader(backend);
+	for (int i = 1; i < argc; ++i)
+		load(reader, argv[i]);
+	std::cout << reader.automata.size() << " automata loaded" << std::endl;
+	Times times;
+	for (size_t i = 0; i < reader.automata.size(); ++i)
+		measure(times, reader.automata[i]);
+	times.print();
+}
+
+// labels 3k are leaves, 3k + 1 and 3k + 2 have arity 1 and 2
+static void randomTA(TA<int>& ta, size_t states) {
+	const size_t labels = 1 + rnd() % 4;
+	std::vector<size_t> lhs;
+	for (size_t k = 0; k < states; ++k)
+		ta.addTransition(lhs, 3 * (rnd() % labels), k);
+	for (size_t k = states * (1 + rnd() % 3); k > 0; --k) {
+		const int label = 3 * (rnd() % labels) + 1 + rnd() % 2;
+		lhs.resize(label % 3);
+		for (size_t i = 0; i < lhs.size(); ++i)
+			lhs[i] = rnd() % states;
+		ta.addTransition(lhs, label, rnd() % states);
+	}
+	ta.addFinalState(rnd() % states);
+}
+
+static void benchRandom() {
+	TA<int>::Backend backend(0);
+	Times times;
+	for (int round = 0; round < 300; ++round) {
+		TA<int> ta(backend);
+		randomTA(ta, 150 + rnd() % 51);
+		measure(times, ta);
+	}
+	std::cout << "300 random automata" << std::endl;
+	times.print();
+
+	LTS lts;
+	OLRTAlgorithm alg;
+	BitRelation rel;
+	Timer t;
+	for (int round = 0; round < 3000; ++round) {
+		const size_t states = 200 + rnd() % 100;
+		const size_t labels = 1 + rnd() % 6;
+		lts.reset(labels, states);
+		for (size_t k = states * (rnd() % 4) + rnd() % 3; k > 0; --k) {
+			const size_t q = rnd() % states;
+			const size_t a = rnd() % labels;
+			lts.addTransition(q, a, rnd() % states);
+		}
+		lts.finalize();
+		alg.reset(lts);
+		alg.init();
+		alg.run();
+		alg.buildRel(states, rel);
+	}
+	std::cout << "3000 random LTSs: " << t.elapsed() << " s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		if (argc > 1)
+			benchDumps(argc, argv);
+		else
+			benchRandom();
+	} catch (const std::exception& e) {
+		std::cerr << "error: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIT_RELATION_H
+#define BIT_RELATION_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// binary relation stored as a packed bit matrix; each row occupies a whole
+// number of 64-bit words and the padding bits beyond the last column are kept
+// cleared, so that the row kernels below can work on whole words
+class BitRelation {
+
+public:
+
+	typedef uint64_t word_type;
+
+	static const size_t wordBits = 64;
+
+private:
+
+	size_t _rows;
+	size_t _cols;
+	size_t _words;
+	std::vector<word_type> _data;
+
+	static size_t wordCount(size_t cols) {
+		return (cols + wordBits - 1) / wordBits;
+	}
+
+	static word_type bitOf(size_t col) {
+		return static_cast<word_type>(1) << (col % wordBits);
+	}
+
+	static size_t ctz(word_type w) {
+		assert(w);
+		return __builtin_ctzll(w);
+	}
+
+	// mask of the valid bits in the last word of a row
+	word_type lastMask() const {
+		const size_t rem = this->_cols % wordBits;
+		return (rem) ? ((static_cast<word_type>(1) << rem) - 1) : ~static_cast<word_type>(0);
+	}
+
+	void trimRow(size_t row) {
+		if (this->_words)
+			this->row(row)[this->_words - 1] &= this->lastMask();
+	}
+
+public:
+
+	// row kernels, written as plain loops over whole words so that the compiler
+	// is able to vectorize them
+
+	static void rowAnd(word_type* __restrict__ dst, const word_type* __restrict__ src, size_t words) {
+		for (size_t i = 0; i < words; ++i)
+			dst[i] &= src[i];
+	}
+
+	static void rowOr(word_type* __restrict__ dst, const word_type* __restrict__ src, size_t words) {
+		for (size_t i = 0; i < words; ++i)
+			dst[i] |= src[i];
+	}
+
+	static void rowAndNot(word_type* __restrict__ dst, const word_type* __restrict__ src, size_t words) {
+		for (size_t i = 0; i < words; ++i)
+			dst[i] &= ~src[i];
+	}
+
+	// true if the rows have at least one column in common
+	static bool rowsIntersect(const word_type* a, const word_type* b, size_t words) {
+		for (size_t i = 0; i < words; ++i) {
+			if (a[i] & b[i])
+				return true;
+		}
+		return false;
+	}
+
+	// true if each column of a is also present in b
+	static bool rowSubseteq(const word_type* a, const word_type* b, size_t words) {
+		for (size_t i = 0; i < words; ++i) {
+			if (a[i] & ~b[i])
+				return false;
+		}
+		return true;
+	}
+
+public:
+
+	BitRelation(size_t size = 0, bool value = false)
+		: _rows(size), _cols(size), _words(wordCount(size)),
+		_data(size * wordCount(size), (value) ? ~static_cast<word_type>(0) : 0) {
+		if (value) {
+			for (size_t i = 0; i < this->_rows; ++i)
+				this->trimRow(i);
+		}
+	}
+
+	BitRelation(size_t rows, size_t cols, bool value)
+		: _rows(rows), _cols(cols), _words(wordCount(cols)),
+		_data(rows * wordCount(cols), (value) ? ~static_cast<word_type>(0) : 0) {
+		if (value) {
+			for (size_t i = 0; i < this->_rows; ++i)
+				this->trimRow(i);
+		}
+	}
+
+	// count of rows, which is also the count of columns for square relations
+	size_t size() const {
+		return this->_rows;
+	}
+
+	size_t rows() const {
+		return this->_rows;
+	}
+
+	size_t cols() const {
+		return this->_cols;
+	}
+
+	// count of words per row
+	size_t words() const {
+		return this->_words;
+	}
+
+	word_type* row(size_t i) {
+		assert(i < this->_rows);
+		return &this->_data[i * this->_words];
+	}
+
+	const word_type* row(size_t i) const {
+		assert(i < this->_rows);
+		return &this->_data[i * this->_words];
+	}
+
+	bool get(size_t i, size_t j) const {
+		assert(j < this->_cols);
+		return (this->row(i)[j / wordBits] & bitOf(j)) != 0;
+	}
+
+	void set(size_t i, size_t j, bool value = true) {
+		assert(j < this->_cols);
+		word_type& w = this->row(i)[j / wordBits];
+		if (value)
+			w |= bitOf(j);
+		else
+			w &= ~bitOf(j);
+	}
+
+	void reset(size_t i, size_t j) {
+		this->set(i, j, false);
+	}
+
+	void fill(bool value) {
+		std::fill(this->_data.begin(), this->_data.end(), (value) ? ~static_cast<word_type>(0) : 0);
+		if (value) {
+			for (size_t i = 0; i < this->_rows; ++i)
+				this->trimRow(i);
+		}
+	}
+
+	// resize to a square relation, the cells already present are preserved
+	// and the newly added ones are set to value
+	void resize(size_t size, bool value = false) {
+		BitRelation tmp(size, value);
+		const size_t rows = std::min(this->_rows, size);
+		const size_t words = std::min(this->_words, tmp._words);
+		// the padding bits of the original rows are always cleared, so only
+		// the columns up to the end of the last copied word need a fix
+		const size_t end = std::min(size, words * wordBits);
+		for (size_t i = 0; i < rows; ++i) {
+			std::memcpy(tmp.row(i), this->row(i), words * sizeof(word_type));
+			if (value) {
+				for (size_t j = this->_cols; j < end; ++j)
+					tmp.set(i, j);
+			}
+			tmp.trimRow(i);
+		}
+		this->swap(tmp);
+	}
+
+	void swap(BitRelation& rhs) {
+		std::swap(this->_rows, rhs._rows);
+		std::swap(this->_cols, rhs._cols);
+		std::swap(this->_words, rhs._words);
+		this->_data.swap(rhs._data);
+	}
+
+	// make the relation an identity of the given size
+	void identity(size_t size) {
+		BitRelation tmp(size, false);
+		for (size_t i = 0; i < size; ++i)
+			tmp.set(i, i);
+		this->swap(tmp);
+	}
+
+	// row-wise operations with a row of (possibly) another relation, which has
+	// to be a different row; if the rows differ in length, only the common
+	// prefix of words is processed, which gives the right result for OR and
+	// ANDNOT
+
+	void rowOr(size_t i, const BitRelation& src, size_t srcRow) {
+		assert((this != &src) || (i != srcRow));
+		BitRelation::rowOr(this->row(i), src.row(srcRow), std::min(this->_words, src._words));
+		this->trimRow(i);
+	}
+
+	void rowAndNot(size_t i, const BitRelation& src, size_t srcRow) {
+		assert((this != &src) || (i != srcRow));
+		BitRelation::rowAndNot(this->row(i), src.row(srcRow), std::min(this->_words, src._words));
+	}
+
+	void rowAnd(size_t i, const BitRelation& src, size_t srcRow) {
+		assert((this != &src) || (i != srcRow));
+		assert(this->_words == src._words);
+		BitRelation::rowAnd(this->row(i), src.row(srcRow), this->_words);
+	}
+
+	void copyRow(size_t i, const BitRelation& src, size_t srcRow) {
+		assert(this->_words == src._words);
+		if ((this != &src) || (i != srcRow))
+			std::memcpy(this->row(i), src.row(srcRow), this->_words * sizeof(word_type));
+	}
+
+	bool rowEmpty(size_t i) const {
+		const word_type* r = this->row(i);
+		for (size_t k = 0; k < this->_words; ++k) {
+			if (r[k])
+				return false;
+		}
+		return true;
+	}
+
+	// true if the given rows of this and src have a column in common
+	bool rowsIntersect(size_t i, const BitRelation& src, size_t srcRow) const {
+		assert(this->_words == src._words);
+		return BitRelation::rowsIntersect(this->row(i), src.row(srcRow), this->_words);
+	}
+
+	// true if the given row of this is included in the given row of src
+	bool rowSubseteq(size_t i, const BitRelation& src, size_t srcRow) const {
+		assert(this->_words == src._words);
+		return BitRelation::rowSubseteq(this->row(i), src.row(srcRow), this->_words);
+	}
+
+	// call f(j) for each j related to i, in the ascending order
+	template <class F>
+	void forEachInRow(size_t i, F f) const {
+		const word_type* r = this->row(i);
+		for (size_t k = 0; k < this->_words; ++k) {
+			for (word_type w = r[k]; w; w &= w - 1)
+				f(k * wordBits + ctz(w));
+		}
+	}
+
+	// intersection
+	BitRelation& operator&=(const BitRelation& rhs) {
+		assert(this->_rows == rhs._rows && this->_cols == rhs._cols);
+		if ((this != &rhs) && !this->_data.empty())
+			BitRelation::rowAnd(&this->_data[0], &rhs._data[0], this->_data.size());
+		return *this;
+	}
+
+	// union
+	BitRelation& operator|=(const BitRelation& rhs) {
+		assert(this->_rows == rhs._rows && this->_cols == rhs._cols);
+		if ((this != &rhs) && !this->_data.empty())
+			BitRelation::rowOr(&this->_data[0], &rhs._data[0], this->_data.size());
+		return *this;
+	}
+
+	// transposition
+	void transposed(BitRelation& dst) const {
+		BitRelation tmp(this->_cols, this->_rows, false);
+		for (size_t i = 0; i < this->_rows; ++i)
+			this->forEachInRow(i, [&tmp, i](size_t j) { tmp.set(j, i); });
+		dst.swap(tmp);
+	}
+
+	// Warshall's algorithm on whole rows: whenever i is related to k, all
+	// successors of k are added to the successors of i
+	void transitiveClosure() {
+		assert(this->_rows == this->_cols);
+		for (size_t k = 0; k < this->_rows; ++k) {
+			const word_type* rk = this->row(k);
+			for (size_t i = 0; i < this->_rows; ++i) {
+				if ((i != k) && this->get(i, k))
+					BitRelation::rowOr(this->row(i), rk, this->_words);
+			}
+		}
+	}
+
+	bool operator==(const BitRelation& rhs) const {
+		return (this->_rows == rhs._rows) && (this->_cols == rhs._cols) && (this->_data == rhs._data);
+	}
+
+	bool operator!=(const BitRelation& rhs) const {
+		return !(*this == rhs);
+	}
+
+	friend std::ostream& operator<<(std::ostream& os, const BitRelation& rel) {
+		for (size_t i = 0; i < rel._rows; ++i) {
+			for (size_t j = 0; j < rel._cols; ++j)
+				os << rel.get(i, j);
+			os << std::endl;
+		}
+		return os;
+	}
+
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BIT_SET_H
+#define BIT_SET_H
+
+#include <cassert>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include "bitrelation.hh"
+
+// set of states over the universe {0, ..., size - 1} stored as a bit vector
+// with the same word layout as a row of BitRelation, so that it can be
+// directly tested against the rows of a relation over the same states
+class BitSet {
+
+public:
+
+	typedef BitRelation::word_type word_type;
+
+private:
+
+	size_t _size;
+	std::vector<word_type> _data;
+
+	static word_type bitOf(size_t i) {
+		return static_cast<word_type>(1) << (i % BitRelation::wordBits);
+	}
+
+public:
+
+	BitSet(size_t size = 0)
+		: _size(size), _data((size + BitRelation::wordBits - 1) / BitRelation::wordBits, 0) {}
+
+	size_t size() const {
+		return this->_size;
+	}
+
+	size_t words() const {
+		return this->_data.size();
+	}
+
+	bool get(size_t i) const {
+		assert(i < this->_size);
+		return (this->_data[i / BitRelation::wordBits] & bitOf(i)) != 0;
+	}
+
+	void set(size_t i) {
+		assert(i < this->_size);
+		this->_data[i / BitRelation::wordBits] |= bitOf(i);
+	}
+
+	void reset(size_t i) {
+		assert(i < this->_size);
+		this->_data[i / BitRelation::wordBits] &= ~bitOf(i);
+	}
+
+	bool empty() const {
+		for (size_t k = 0; k < this->_data.size(); ++k) {
+			if (this->_data[k])
+				return false;
+		}
+		return true;
+	}
+
+	// count of elements
+	size_t count() const {
+		size_t cnt = 0;
+		for (size_t k = 0; k < this->_data.size(); ++k)
+			cnt += __builtin_popcountll(this->_data[k]);
+		return cnt;
+	}
+
+	bool subseteq(const BitSet& rhs) const {
+		assert(this->_size == rhs._size);
+		return this->_data.empty() || BitRelation::rowSubseteq(&this->_data[0], &rhs._data[0], this->_data.size());
+	}
+
+	// true if the set has an element in common with the given row of rel
+	bool intersects(const BitRelation& rel, size_t row) const {
+		assert(this->words() == rel.words());
+		return !this->_data.empty() && BitRelation::rowsIntersect(&this->_data[0], rel.row(row), this->_data.size());
+	}
+
+	// remove the elements present in the given row of rel
+	void subtract(const BitRelation& rel, size_t row) {
+		assert(this->words() == rel.words());
+		if (!this->_data.empty())
+			BitRelation::rowAndNot(&this->_data[0], rel.row(row), this->_data.size());
+	}
+
+	// call f(i) for each element i, in the ascending order
+	template <class F>
+	void forEach(F f) const {
+		for (size_t k = 0; k < this->_data.size(); ++k) {
+			for (word_type w = this->_data[k]; w; w &= w - 1)
+				f(k * BitRelation::wordBits + __builtin_ctzll(w));
+		}
+	}
+
+	bool operator==(const BitSet& rhs) const {
+		return (this->_size == rhs._size) && (this->_data == rhs._data);
+	}
+
+	bool operator!=(const BitSet& rhs) const {
+		return !(*this == rhs);
+	}
+
+	friend size_t hash_value(const BitSet& x) {
+		return boost::hash_range(x._data.begin(), x._data.end());
+	}
+
+	friend std::ostream& operator<<(std::ostream& os, const BitSet& x) {
+		os << '{';
+		bool first = true;
+		for (size_t i = 0; i < x._size; ++i) {
+			if (!x.get(i))
+				continue;
+			os << ((first) ? "" : ",") << i;
+			first = false;
+		}
+		return os << '}';
+	}
+
+};
+
+#endif
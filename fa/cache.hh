@@ -24,7 +24,10 @@
 #include <list>
 #include <set>
 #include <algorithm>
+#include <ostream>
+#include <cassert>
 
+#include <boost/functional/hash.hpp>
 #include <boost/unordered_map.hpp>
 
 template <class T>
@@ -53,6 +56,10 @@ public:
 		this->listeners.push_back(x);
 	}
 
+	void removeListener(Listener* x) {
+		this->listeners.erase(std::remove(this->listeners.begin(), this->listeners.end(), x), this->listeners.end());
+	}
+
 	value_type* find(const T& x) {
 		typename store_type::iterator i = this->store.find(x);
 		return (i == this->store.end())?(NULL):(&*i);
@@ -262,6 +269,178 @@ public:
 	}
 
 };
+// key of CachedSetOp
+template <class I>
+struct CachedSetKey {
+
+	// the items in a canonical order
+	std::vector<I*> items;
+	// further data distinguishing the entries (operation, parameters, ...)
+	std::vector<size_t> data;
+
+	size_t hash() const {
+		size_t h = boost::hash_range(this->items.begin(), this->items.end());
+		boost::hash_combine(h, boost::hash_range(this->data.begin(), this->data.end()));
+		return h;
+	}
+
+	bool operator==(const CachedSetKey& rhs) const {
+		return (this->items == rhs.items) && (this->data == rhs.data);
+	}
+
+	friend size_t hash_value(const CachedSetKey& key) {
+		return key.hash();
+	}
+
+};
+
+// memoizes values keyed by sets of items interned in a Cache<T> (e.g. automata
+// given by their hash-consed transitions); an entry is invalidated as soon as
+// any of its items is dropped from the cache, and at most 'capacity' entries
+// are kept, the least recently used ones are evicted first
+template <class T, class V>
+class CachedSetOp : public Cache<T>::Listener {
+
+public:
+
+	typedef typename Cache<T>::value_type item_type;
+	typedef CachedSetKey<item_type> Key;
+
+protected:
+
+	typedef std::list<const Key*> lru_type;
+
+	struct Entry {
+
+		V value;
+		typename lru_type::iterator lru;
+
+	};
+
+	typedef boost::unordered_map<Key, Entry> store_type;
+	typedef boost::unordered_map<item_type*, std::set<const Key*> > item_map_type;
+
+	Cache<T>& cache;
+	size_t capacity;
+
+	store_type store;
+	item_map_type itemMap;
+	// the most recently used entries go first
+	lru_type lru;
+
+	size_t cntHits;
+	size_t cntMisses;
+	size_t cntEvictions;
+	size_t cntInvalidations;
+
+	// unlinks the entry, its value is moved to trash in order to be destroyed
+	// only once the cache is consistent again (destroying a value may release
+	// some items and thus call drop() recursively)
+	void erase(typename store_type::iterator i, std::vector<V>& trash) {
+		for (typename std::vector<item_type*>::const_iterator j = i->first.items.begin(); j != i->first.items.end(); ++j) {
+			typename item_map_type::iterator k = this->itemMap.find(*j);
+			assert(k != this->itemMap.end());
+			k->second.erase(&i->first);
+			if (k->second.empty())
+				this->itemMap.erase(k);
+		}
+		this->lru.erase(i->second.lru);
+		trash.push_back(V());
+		std::swap(trash.back(), i->second.value);
+		this->store.erase(i);
+	}
+
+	CachedSetOp(const CachedSetOp&);
+	CachedSetOp& operator=(const CachedSetOp&);
+
+public:
+
+	CachedSetOp(Cache<T>& cache, size_t capacity)
+		: cache(cache), capacity(capacity), store(), itemMap(), lru(),
+		cntHits(0), cntMisses(0), cntEvictions(0), cntInvalidations(0) {
+		this->cache.addListener(this);
+	}
+
+	virtual ~CachedSetOp() {
+		this->cache.removeListener(this);
+		this->clear();
+	}
+
+	bool enabled() const {
+		return this->capacity > 0;
+	}
+
+	// returns NULL if there is no such entry
+	const V* find(const Key& key) {
+		typename store_type::iterator i = this->store.find(key);
+		if (i == this->store.end()) {
+			++this->cntMisses;
+			return NULL;
+		}
+		++this->cntHits;
+		this->lru.splice(this->lru.begin(), this->lru, i->second.lru);
+		return &i->second.value;
+	}
+
+	void insert(const Key& key, const V& value) {
+		if (!this->capacity)
+			return;
+		std::pair<typename store_type::iterator, bool> p = this->store.insert(std::make_pair(key, Entry()));
+		if (!p.second)
+			return;
+		p.first->second.value = value;
+		this->lru.push_front(&p.first->first);
+		p.first->second.lru = this->lru.begin();
+		for (typename std::vector<item_type*>::const_iterator j = key.items.begin(); j != key.items.end(); ++j)
+			this->itemMap.insert(std::make_pair(*j, std::set<const Key*>())).first->second.insert(&p.first->first);
+		std::vector<V> trash;
+		while (this->store.size() > this->capacity) {
+			this->erase(this->store.find(*this->lru.back()), trash);
+			++this->cntEvictions;
+		}
+	}
+
+	void clear() {
+		std::vector<V> trash;
+		while (!this->store.empty())
+			this->erase(this->store.begin(), trash);
+	}
+
+	virtual void drop(item_type* x) {
+		typename item_map_type::iterator i = this->itemMap.find(x);
+		if (i == this->itemMap.end())
+			return;
+		const std::vector<const Key*> keys(i->second.begin(), i->second.end());
+		std::vector<V> trash;
+		for (typename std::vector<const Key*>::const_iterator j = keys.begin(); j != keys.end(); ++j) {
+			this->erase(this->store.find(**j), trash);
+			++this->cntInvalidations;
+		}
+	}
+
+	size_t size() const {
+		return this->store.size();
+	}
+
+	size_t hits() const {
+		return this->cntHits;
+	}
+
+	size_t misses() const {
+		return this->cntMisses;
+	}
+
+	friend std::ostream& operator<<(std::ostream& os, const CachedSetOp& op) {
+		const size_t lookups = op.cntHits + op.cntMisses;
+		os << op.cntHits << " hit(s) out of " << lookups << " lookup(s)";
+		if (lookups)
+			os << " (" << (100 * op.cntHits / lookups) << "%)";
+		return os << ", " << op.cntEvictions << " eviction(s), " << op.cntInvalidations
+			<< " invalidation(s), " << op.store.size() << " entry(ies)";
+	}
+
+};
+
 /*
 template <class T, class V>
 class CachedBinaryOpLRU : public CachedBinaryOp<T, std::pair<V, typename std::list<std::pair<T, T> >::iterator> > {
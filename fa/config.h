@@ -50,4 +50,17 @@
  */
 #define FA_FUSION_ENABLED					1
 
+/**
+ * maximal count of simulations (and minimized automata) remembered per tree
+ * automata backend, 0 disables the cache (default is 1024)
+ */
+#define FA_SIM_CACHE_SIZE					1024
+
+/**
+ * append every automaton minimized by means of simulations to the given file
+ * in the Timbuk format, to be replayed by bench_simulation (default is "", i.e.
+ * disabled)
+ */
+#define FA_SIM_DUMP_FILE					""
+
 #endif /* CONFIG_H */
@@ -20,68 +20,186 @@
 #ifndef LTS_H
 #define LTS_H
 
+#include <cassert>
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
 #include "smartset.hh"
 
+// labelled transition system; the transitions are collected by addTransition()
+// and then compressed by finalize() into flat arrays (CSR), where the
+// predecessors (successors) of a state under a label occupy a contiguous range;
+// the storage is kept by reset(), so that an LTS can be reused without
+// reallocating
 class LTS {
 
+public:
+
+	// contiguous range of state (or label) indices
+	class Range {
+
+		const size_t* _begin;
+		const size_t* _end;
+
+	public:
+
+		typedef const size_t* const_iterator;
+
+		Range(const size_t* begin, const size_t* end) : _begin(begin), _end(end) {}
+
+		const_iterator begin() const {
+			return this->_begin;
+		}
+
+		const_iterator end() const {
+			return this->_end;
+		}
+
+		size_t size() const {
+			return this->_end - this->_begin;
+		}
+
+		bool empty() const {
+			return this->_begin == this->_end;
+		}
+
+	};
+
+private:
+
+	struct Transition {
+
+		size_t q;
+		size_t a;
+		size_t r;
+
+		Transition(size_t q, size_t a, size_t r) : q(q), a(a), r(r) {}
+
+	};
+
 	size_t _labels;
 	size_t _states;
-	size_t _transitions;
-	std::vector<std::vector<std::vector<size_t> > > _dataPre;
-	std::vector<SmartSet> _lPre;
+	bool _finalized;
+	// transitions in the order of their insertion
+	std::vector<Transition> _buffer;
+	// pre(r, a) is _pre[_preOffset[a*_states + r] .. _preOffset[a*_states + r + 1]]
+	std::vector<size_t> _preOffset;
+	std::vector<size_t> _pre;
+	// post(q, a) is _post[_postOffset[a*_states + q] .. _postOffset[a*_states + q + 1]]
+	std::vector<size_t> _postOffset;
+	std::vector<size_t> _post;
+	// lPre(r) are the labels a for which pre(r, a) is not empty
+	std::vector<size_t> _lPreOffset;
+	std::vector<size_t> _lPre;
+	// insertion points used by finalize()
+	std::vector<size_t> _cursor;
+	std::vector<size_t> _lPreCursor;
+
+	static Range range(const std::vector<size_t>& offset, const std::vector<size_t>& data, size_t i) {
+		const size_t* base = (data.empty()) ? (NULL) : (&data[0]);
+		return Range(base + offset[i], base + offset[i + 1]);
+	}
+
+	// turn counts stored at [i + 1] into offsets stored at [i]
+	static void prefixSum(std::vector<size_t>& offset) {
+		for (size_t i = 1; i < offset.size(); ++i)
+			offset[i] += offset[i - 1];
+	}
 
 public:
 
 	LTS(size_t labels = 0, size_t states = 0) :
-		_labels(labels), _states(states), _transitions(0),
-		_dataPre(labels, std::vector<std::vector<size_t> >(states)),
-		_lPre(states, SmartSet(labels)) {}
-/*
-	LTS(const LTS& lts) :
-		_labels(lts._labels), _states(lts._states), _transitions(lts._transitions),
-		_dataPre(lts._dataPre),
-		_lPre(lts._lPre) {}
-*/
+		_labels(labels), _states(states), _finalized(false) {}
+
+	void reset(size_t labels, size_t states) {
+		this->_labels = labels;
+		this->_states = states;
+		this->_finalized = false;
+		this->_buffer.clear();
+	}
+
 	void addTransition(size_t q, size_t a, size_t r) {
-		if (a >= this->_dataPre.size())
+		if (a >= this->_labels)
 			throw std::runtime_error("label index out of range");
-		if (r >= this->_dataPre[a].size()) {
-			std::cout << r << "<" << this->_dataPre[a].size() << "\n";
+		if (r >= this->_states) {
+			std::cout << r << "<" << this->_states << "\n";
 			throw std::runtime_error("state index out of range");
 		}
-		if (q >= this->_dataPre[a].size())
+		if (q >= this->_states)
 			throw std::runtime_error("state index out of range");
-		this->_dataPre[a][r].push_back(q);
-		this->_lPre[r].add(a);
-		++this->_transitions;
+		this->_buffer.push_back(Transition(q, a, r));
+		this->_finalized = false;
 	}
 
-	const std::vector<size_t>& pre(size_t q, size_t a) const {
-		return this->_dataPre[a][q];
-	}
-/*
-	method iter f =
-    Array.iteri (fun a pre_a -> Array.iteri (fun r pre_a_r -> List.iter (fun q -> f q a r) pre_a_r) pre_a) _data_pre
-*/
-	const std::vector<std::vector<std::vector<size_t> > >& dataPre() const { return this->_dataPre; }
-
-	void buildPost(size_t label, std::vector<std::vector<size_t> >& dst) const {
-		dst.clear();
-		dst.resize(this->_states);
-		for (size_t i = 0; i < this->_dataPre[label].size(); ++i) {
-			for (std::vector<size_t>::const_iterator j = this->_dataPre[label][i].begin(); j != this->_dataPre[label][i].end(); ++j)
-				dst[*j].push_back(i);
+	// build the compressed representation by counting sort; the order of
+	// insertion is preserved within each range, lPre(r) lists the labels in the
+	// reverse order of their first occurrence
+	void finalize() {
+		const size_t buckets = this->_labels * this->_states;
+		this->_preOffset.assign(buckets + 1, 0);
+		this->_postOffset.assign(buckets + 1, 0);
+		this->_lPreOffset.assign(this->_states + 1, 0);
+		for (std::vector<Transition>::const_iterator i = this->_buffer.begin(); i != this->_buffer.end(); ++i) {
+			if (!this->_preOffset[i->a*this->_states + i->r + 1]++)
+				++this->_lPreOffset[i->r + 1];
+			++this->_postOffset[i->a*this->_states + i->q + 1];
+		}
+		LTS::prefixSum(this->_preOffset);
+		LTS::prefixSum(this->_postOffset);
+		LTS::prefixSum(this->_lPreOffset);
+		this->_pre.resize(this->_buffer.size());
+		this->_post.resize(this->_buffer.size());
+		this->_lPre.resize(this->_lPreOffset.back());
+		// pre and lPre
+		this->_cursor.assign(this->_preOffset.begin(), this->_preOffset.end() - 1);
+		this->_lPreCursor.assign(this->_lPreOffset.begin() + 1, this->_lPreOffset.end());
+		for (std::vector<Transition>::const_iterator i = this->_buffer.begin(); i != this->_buffer.end(); ++i) {
+			const size_t bucket = i->a*this->_states + i->r;
+			if (this->_cursor[bucket] == this->_preOffset[bucket])
+				this->_lPre[--this->_lPreCursor[i->r]] = i->a;
+			this->_pre[this->_cursor[bucket]++] = i->q;
+		}
+		// post, ordered by the target state first
+		this->_cursor.assign(this->_postOffset.begin(), this->_postOffset.end() - 1);
+		for (size_t a = 0; a < this->_labels; ++a) {
+			for (size_t r = 0; r < this->_states; ++r) {
+				const size_t bucket = a*this->_states + r;
+				for (size_t k = this->_preOffset[bucket]; k < this->_preOffset[bucket + 1]; ++k)
+					this->_post[this->_cursor[a*this->_states + this->_pre[k]]++] = r;
+			}
 		}
+		this->_finalized = true;
 	}
-	
+
+	// states q such that q --a--> r
+	Range pre(size_t r, size_t a) const {
+		assert(this->_finalized);
+		return LTS::range(this->_preOffset, this->_pre, a*this->_states + r);
+	}
+
+	// states r such that q --a--> r
+	Range post(size_t q, size_t a) const {
+		assert(this->_finalized);
+		return LTS::range(this->_postOffset, this->_post, a*this->_states + q);
+	}
+
+	// labels a such that there is a transition q --a--> r
+	Range lPre(size_t r) const {
+		assert(this->_finalized);
+		return LTS::range(this->_lPreOffset, this->_lPre, r);
+	}
+
 	void buildDelta(std::vector<SmartSet>& delta, std::vector<SmartSet>& delta1) const {
+		assert(this->_finalized);
 		delta.resize(this->_labels);
 		delta1.resize(this->_labels);
 		for (size_t a = 0; a < this->_labels; ++a) {
-			delta[a] = SmartSet(this->_states);
-			delta1[a] = SmartSet(this->_states);
-			for (size_t i = 0; i < this->_dataPre[a].size(); ++i) {
-				for (std::vector<size_t>::const_iterator j = this->_dataPre[a][i].begin(); j != this->_dataPre[a][i].end(); ++j) {
+			delta[a].reset(this->_states);
+			delta1[a].reset(this->_states);
+			for (size_t i = 0; i < this->_states; ++i) {
+				Range pre = this->pre(i, a);
+				for (Range::const_iterator j = pre.begin(); j != pre.end(); ++j) {
 					delta[a].add(i);
 					delta1[a].add(*j);
 				}
@@ -89,10 +207,6 @@ public:
 		}
 	}
 
-	const std::vector<SmartSet>& lPre() const {
-		return this->_lPre;
-	}
-	
 	size_t labels() const {
 		return this->_labels;
 	}
@@ -101,32 +215,21 @@ public:
 		return this->_states;
 	}
 
+	size_t transitions() const {
+		return this->_buffer.size();
+	}
+
 	void dump() const {
 		std::cout << "states: " << this->_states << ", labels: " << this->_labels << std::endl;
 		for (size_t i = 0; i < this->_labels; ++i) {
 			for (size_t j = 0; j < this->_states; ++j) {
-				for (size_t k = 0; k < this->_dataPre[i][j].size(); ++k)
-					std::cout << this->_dataPre[i][j][k] << " --" << i << "--> " << j << std::endl;
+				Range pre = this->pre(j, i);
+				for (Range::const_iterator k = pre.begin(); k != pre.end(); ++k)
+					std::cout << *k << " --" << i << "--> " << j << std::endl;
 			}
 		}
 	}
 
-/*
-(*
-		method setData d = (
-		_data <- d;
-		_nsymbols <- Array.length _data;
-		_nstates <- Array.length _data.(0)
-	)
-*)	
-	method nsymbols = _nsymbols
-	method nstates = _nstates
-	method ntransitions = _ntransitions
-	
-	method stats =
-		Printf.sprintf "states: %d, symbols: %d, transitions: %d" _nstates _nsymbols _ntransitions
-
-*/
 };
 
 #endif
@@ -44,6 +44,22 @@ public:
 
 	Counter(const Counter& counter)
 		: _data(counter._data.size()), _key(counter._key), _range(counter._range) {}
+
+	Counter() : _data(), _key(NULL), _range(NULL) {}
+
+	// make all rows empty, the storage of the rows is kept for later use
+	void reset(size_t labels, const std::vector<std::vector<size_t> >& key, const std::vector<size_t>& range) {
+		this->_data.resize(labels);
+		for (std::vector<std::vector<size_t> >::iterator i = this->_data.begin(); i != this->_data.end(); ++i)
+			i->clear();
+		this->_key = &key;
+		this->_range = &range;
+	}
+
+	// same as the copy constructor, but reusing the storage
+	void resetFrom(const Counter& counter) {
+		this->reset(counter._data.size(), *counter._key, *counter._range);
+	}
 /*
 	void setKey(const std::vector<std::vector<int> >& key, const std::vector<int>& range) {
 		this->_key = &key;
@@ -120,21 +136,18 @@ protected:
 
 public:
 
+	StateListElem()
+		: _state(0), _block(NULL), _next(this), _prev(this) {}
+
 	StateListElem(size_t state, OLRTBlock* block)
 		: _state(state), _block(block), _next(this), _prev(this) {}
 
-	StateListElem(size_t state, OLRTBlock* block, StateListElem*& dst)
-		: _state(state), _block(block) {
+	void init(size_t state, OLRTBlock* block, StateListElem*& dst) {
+		this->_state = state;
+		this->_block = block;
 		this->insert(dst);
 	}
 	
-	~StateListElem() {
-		if (this != this->_next) {
-			this->_next->_prev = this->_prev;
-			this->_prev->_next = this->_next;
-		}
-	}
-	
 	void moveToList(StateListElem*& src, StateListElem*& dst) {
 		assert(src);
 		if (this == this->_next)
@@ -179,22 +192,43 @@ class OLRTBlock {
 	
 public:
 
-	OLRTBlock(size_t index, const LTS& lts, const std::vector<std::vector<size_t> >& key, const std::vector<size_t>& range)
-		: _index(index), _states(NULL), _remove(lts.labels()), _counter(lts.labels(), key, range), _intersection(NULL), _inset(lts.labels()), _tmp(NULL) {
+	// blocks are recycled by OLRTAlgorithm, so the actual construction is done
+	// by init(); the list elements of the states are owned by OLRTAlgorithm too
+	OLRTBlock()
+		: _index(0), _states(NULL), _remove(), _counter(), _intersection(NULL), _inset(), _tmp(NULL) {}
+
+	// the initial block containing all states, elems provides one element per state
+	void init(size_t index, const LTS& lts, const std::vector<std::vector<size_t> >& key, const std::vector<size_t>& range, std::vector<StateListElem>& elems) {
+		this->_index = index;
+		this->_states = NULL;
+		this->_remove.assign(lts.labels(), NULL);
+		this->_counter.reset(lts.labels(), key, range);
+		this->_intersection = NULL;
+		this->_inset.reset(lts.labels());
+		this->_tmp = NULL;
 		for (size_t i = 0; i < lts.states(); ++i) {
-			new StateListElem(i, this, this->_states);
-			for (SmartSet::iterator j = lts.lPre()[i].begin(); j != lts.lPre()[i].end(); ++j)
+			elems[i].init(i, this, this->_states);
+			LTS::Range lPre = lts.lPre(i);
+			for (LTS::Range::const_iterator j = lPre.begin(); j != lPre.end(); ++j)
 				this->_inset.add(*j);
 		}
 	}
-	
-	OLRTBlock(size_t index, OLRTBlock* parent, const LTS& lts)
-		: _index(index), _states(parent->_tmp), _remove(lts.labels(), NULL), _counter(parent->_counter), _inset(lts.labels()), _tmp(NULL) {
+
+	// a block made of the states moved to parent's temporary list
+	void init(size_t index, OLRTBlock* parent, const LTS& lts) {
+		this->_index = index;
+		this->_states = parent->_tmp;
+		this->_remove.assign(lts.labels(), NULL);
+		this->_counter.resetFrom(parent->_counter);
+		this->_intersection = NULL;
+		this->_inset.reset(lts.labels());
+		this->_tmp = NULL;
 		parent->_tmp = NULL;
 		parent->_intersection = this;
 		StateListElem* elem = this->_states;
 		do {
-			for (SmartSet::iterator i = lts.lPre()[elem->state()].begin(); i != lts.lPre()[elem->state()].end(); ++i) {
+			LTS::Range lPre = lts.lPre(elem->state());
+			for (LTS::Range::const_iterator i = lPre.begin(); i != lPre.end(); ++i) {
 				parent->_inset.remove(*i);
 				this->_inset.add(*i);
 			}
@@ -202,12 +236,6 @@ public:
 			elem = elem->next();
 		} while (elem != this->_states);
 	}
-	
-	~OLRTBlock() {
-		while (this->_states != this->_states->next())
-			delete this->_states->next();
-		delete this->_states;
-	}
 
 	StateListElem* states() {
 		return this->_states;
@@ -299,7 +327,17 @@ class OLRTAlgorithm {
 	std::vector<size_t> _range;
 	
 	std::vector<std::vector<size_t>*> _removeCache;
-	
+	// storage reused by consecutive runs
+	std::vector<StateListElem> _elems;
+	std::vector<OLRTBlock*> _blockCache;
+	std::vector<OLRTBlock*> _splitList;
+	std::vector<OLRTBlock*> _removeList;
+	std::vector<StateListElem*> _prev;
+	std::vector<size_t> _tmp2;
+
+	OLRTAlgorithm(const OLRTAlgorithm&);
+	OLRTAlgorithm& operator=(const OLRTAlgorithm&);
+
 	std::vector<size_t>* rcAlloc() {
 		if (this->_removeCache.empty())
 			return new std::vector<size_t>;
@@ -318,10 +356,41 @@ class OLRTAlgorithm {
 			delete *i;
 	}
 
+	OLRTBlock* blockAlloc() {
+		if (this->_blockCache.empty())
+			return new OLRTBlock();
+		OLRTBlock* block = this->_blockCache.back();
+		this->_blockCache.pop_back();
+		return block;
+	}
+
+	// create a block from the states moved to parent's temporary list
+	OLRTBlock* splitBlock(OLRTBlock* parent) {
+		OLRTBlock* block = this->blockAlloc();
+		block->init(this->_relation.newEntry(), parent, *this->_lts);
+		this->_partition.push_back(block);
+		return block;
+	}
+
+	// move all blocks (and their pending remove lists) to the caches
+	void releasePartition() {
+		for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i) {
+			for (std::vector<std::vector<size_t>*>::iterator j = (*i)->remove().begin(); j != (*i)->remove().end(); ++j) {
+				if (*j)
+					this->rcFree(*j);
+				*j = NULL;
+			}
+			this->_blockCache.push_back(*i);
+		}
+		this->_partition.clear();
+		this->_queue.clear();
+	}
+
 protected:
 
 	void fastSplit(const std::vector<size_t>& remove) {
-		std::vector<OLRTBlock*> splitList;
+		std::vector<OLRTBlock*>& splitList = this->_splitList;
+		splitList.clear();
 		for (std::vector<size_t>::const_iterator i = remove.begin(); i != remove.end(); ++i) {
 			StateListElem* elem = this->_index[*i];
 			elem->block()->moveToTmp(elem);
@@ -331,24 +400,25 @@ protected:
 			StateListElem* elem = this->_index[*i];
 			if (elem->block()->tmp() != NULL) {
 				splitList.push_back(elem->block());
-				OLRTBlock* block = new OLRTBlock(this->_relation.newEntry(), elem->block(), *this->_lts);
-				this->_partition.push_back(block);
+				this->splitBlock(elem->block());
 			}
 		}
 		for (std::vector<OLRTBlock*>::reverse_iterator i = splitList.rbegin(); i != splitList.rend(); ++i) {
 			OLRTBlock* bint = (*i)->intersection();
 			(*i)->intersection(NULL);
 //			for (std::vector<OLRTBlock*>::iterator j = this->_partition.begin(); j != this->_partition.end(); ++j) {
+			BitRelation& rel = this->_relation.data();
 			for (std::vector<OLRTBlock*>::reverse_iterator j = this->_partition.rbegin(); j != this->_partition.rend(); ++j) {
-				this->_relation.data()[(*j)->index()][bint->index()] = this->_relation.data()[(*j)->index()][(*i)->index()];
-				this->_relation.data()[bint->index()][(*j)->index()] = this->_relation.data()[(*i)->index()][(*j)->index()];
+				rel.set((*j)->index(), bint->index(), rel.get((*j)->index(), (*i)->index()));
+				rel.set(bint->index(), (*j)->index(), rel.get((*i)->index(), (*j)->index()));
 			}
 		}
 	}
 
 	void split(const std::vector<size_t>& remove, std::vector<OLRTBlock*>& removeList) {
 		removeList.clear();
-		std::vector<OLRTBlock*> splitList;
+		std::vector<OLRTBlock*>& splitList = this->_splitList;
+		splitList.clear();
 //		for (std::vector<int>::const_iterator i = remove.begin(); i != remove.end(); ++i) {
 		for (std::vector<size_t>::const_reverse_iterator i = remove.rbegin(); i != remove.rend(); ++i) {
 			StateListElem* elem = this->_index[*i];
@@ -361,9 +431,7 @@ protected:
 			StateListElem* elem = this->_index[*i];
 			if (elem->block()->tmp() != NULL) {
 				splitList.push_back(elem->block());
-				OLRTBlock* block = new OLRTBlock(this->_relation.newEntry(), elem->block(), *this->_lts);
-				this->_partition.push_back(block);
-				removeList.push_back(block);
+				removeList.push_back(this->splitBlock(elem->block()));
 			}
 		}
 //		for (std::vector<OLRTBlock*>::iterator i = splitList.begin(); i != splitList.end(); ++i) {
@@ -371,9 +439,10 @@ protected:
 			OLRTBlock* bint = (*i)->intersection();
 			(*i)->intersection(NULL);
 //			for (std::vector<OLRTBlock*>::iterator j = this->_partition.begin(); j != this->_partition.end(); ++j) {
+			BitRelation& rel = this->_relation.data();
 			for (std::vector<OLRTBlock*>::reverse_iterator j = this->_partition.rbegin(); j != this->_partition.rend(); ++j) {
-				this->_relation.data()[(*j)->index()][bint->index()] = this->_relation.data()[(*j)->index()][(*i)->index()];
-				this->_relation.data()[bint->index()][(*j)->index()] = this->_relation.data()[(*i)->index()][(*j)->index()];
+				rel.set((*j)->index(), bint->index(), rel.get((*j)->index(), (*i)->index()));
+				rel.set(bint->index(), (*j)->index(), rel.get((*i)->index(), (*j)->index()));
 			}
 			for (SmartSet::iterator j = bint->inset().begin(); j != bint->inset().end(); ++j) {
 				bint->counter().copyRow(*j, (*i)->counter());
@@ -394,26 +463,28 @@ protected:
 		for (size_t i = 0; i < remove->size(); ++i)
 			std::cout << (*remove)[i] << " ";
 		std::cout << std::endl;*/
-		std::vector<StateListElem*> prev;
+		std::vector<StateListElem*>& prev = this->_prev;
 		block->storeStates(prev);
-		std::vector<OLRTBlock*> removeList;
+		std::vector<OLRTBlock*>& removeList = this->_removeList;
 		this->split(*remove, removeList);
 		std::fill(this->_tmp.begin(), this->_tmp.end(), true);
 		for (std::vector<StateListElem*>::iterator i = prev.begin(); i != prev.end(); ++i) {
-			for (std::vector<size_t>::const_iterator j = this->_lts->dataPre()[label][(*i)->state()].begin(); j != this->_lts->dataPre()[label][(*i)->state()].end(); ++j) {
+			LTS::Range pre = this->_lts->pre((*i)->state(), label);
+			for (LTS::Range::const_iterator j = pre.begin(); j != pre.end(); ++j) {
 				StateListElem* elem = this->_index[*j];
 				OLRTBlock* block2 = elem->block();
 				if (this->_tmp[block2->index()]) {
 					this->_tmp[block2->index()] = false;
 					for (std::vector<OLRTBlock*>::iterator k = removeList.begin(); k != removeList.end(); ++k) {
 						assert(block2->index() != (*k)->index());
-						if (this->_relation.data()[block2->index()][(*k)->index()]) {
-							this->_relation.data()[block2->index()][(*k)->index()] = false;
+						if (this->_relation.data().get(block2->index(), (*k)->index())) {
+							this->_relation.data().reset(block2->index(), (*k)->index());
 							for (SmartSet::iterator a = (*k)->inset().begin(); a != (*k)->inset().end(); ++a) {
 								if (block2->inset().contains(*a)) {
 									StateListElem* elem2 = (*k)->states();
 									do {
-										for (std::vector<size_t>::const_iterator l = this->_lts->dataPre()[*a][elem2->state()].begin(); l != this->_lts->dataPre()[*a][elem2->state()].end(); ++l) {
+										LTS::Range pre2 = this->_lts->pre(elem2->state(), *a);
+										for (LTS::Range::const_iterator l = pre2.begin(); l != pre2.end(); ++l) {
 											if (!block2->counter().decr(*a, *l)) {
 												if (!block2->remove()[*a]) {
 													block2->remove()[*a] = this->rcAlloc();
@@ -436,27 +507,32 @@ protected:
 
 public:
 
+	// an algorithm without an LTS, reset() has to be called before init()
+	OLRTAlgorithm()
+		: _lts(NULL), _partition(), _relation(), _tmp(), _removeCache() {}
+
 	OLRTAlgorithm(const LTS& lts)
-		: _lts(&lts), _partition(), _relation(), _tmp(lts.states()), _removeCache() {
-		OLRTBlock* block = new OLRTBlock(this->_relation.newEntry(), lts, this->_key, this->_range);
-		block->storeStates(this->_index);
-		this->_partition.push_back(block);
+		: _lts(NULL), _partition(), _relation(), _tmp(), _removeCache() {
+		this->reset(lts);
 	}
 
 	~OLRTAlgorithm() {
-		for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i)
+		this->releasePartition();
+		for (std::vector<OLRTBlock*>::iterator i = this->_blockCache.begin(); i != this->_blockCache.end(); ++i)
 			delete *i;
 		this->rcCollect();
 	}
-	
+
+	// prepare for a new computation over lts (which needs to be finalized);
+	// all the storage allocated by the previous runs is reused
 	void reset(const LTS& lts) {
-		for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i)
-			delete *i;
-		this->_partition.clear();
+		this->releasePartition();
 		this->_relation.reset();
 		this->_lts = &lts;
 		this->_tmp.resize(lts.states());
-		OLRTBlock* block = new OLRTBlock(this->_relation.newEntry(), lts, this->_key, this->_range);
+		this->_elems.resize(lts.states());
+		OLRTBlock* block = this->blockAlloc();
+		block->init(this->_relation.newEntry(), lts, this->_key, this->_range, this->_elems);
 		block->storeStates(this->_index);
 		this->_partition.push_back(block);
 	}
@@ -472,52 +548,49 @@ public:
 			for (SmartSet::iterator i = this->_delta1[a].begin(); i != this->_delta1[a].end(); ++i)
 				this->_key[a][*i] = x++;
 		}
-		std::vector<size_t> tmp2;
 		for (size_t a = 0; a < this->_lts->labels(); ++a) {
 //			this->dump();
-			this->_delta1[a].buildVector(tmp2);
-			this->fastSplit(tmp2);
+			this->_delta1[a].buildVector(this->_tmp2);
+			this->fastSplit(this->_tmp2);
 		}
-		std::vector<std::vector<bool> > tmp[2];
-		tmp[0].resize(this->_lts->labels(), std::vector<bool>(this->_partition.size(), true));
-		tmp[1].resize(this->_lts->labels(), std::vector<bool>(this->_partition.size(), true));
+		// tmp[0] (tmp[1]) relates a label to blocks with no state (not) having it
+		BitRelation tmp[2] = {
+			BitRelation(this->_lts->labels(), this->_partition.size(), true),
+			BitRelation(this->_lts->labels(), this->_partition.size(), true)
+		};
 		for (size_t a = 0; a < this->_lts->labels(); ++a) {
 			for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i) {
 				StateListElem* elem = (*i)->states();
 				do {
-					tmp[(this->_delta1[a].contains(elem->state()))?(1):(0)][a][(*i)->index()] = false;
+					tmp[(this->_delta1[a].contains(elem->state()))?(1):(0)].reset(a, (*i)->index());
 					elem = elem->next();
 				} while (elem != (*i)->states());
 			}
 		}
 		for (size_t a = 0; a < this->_lts->labels(); ++a) {
 			for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i) {
-				if (tmp[0][a][(*i)->index()]) {
-					for (std::vector<OLRTBlock*>::iterator j = this->_partition.begin(); j != this->_partition.end(); ++j) {
-						if (tmp[1][a][(*j)->index()])
-							this->_relation.data()[(*i)->index()][(*j)->index()] = false;
-					}
-				}
+				if (tmp[0].get(a, (*i)->index()))
+					this->_relation.data().rowAndNot((*i)->index(), tmp[1], a);
 			}			
 		}		
-		std::vector<std::vector<size_t> > post;
 //		for (std::vector<OLRTBlock*>::iterator i = this->_partition.begin(); i != this->_partition.end(); ++i) {
 		for (std::vector<OLRTBlock*>::reverse_iterator i = this->_partition.rbegin(); i != this->_partition.rend(); ++i) {
 			for (SmartSet::iterator j = (*i)->inset().begin(); j != (*i)->inset().end(); ++j) {
-				this->_lts->buildPost(*j, post);
 				for (SmartSet::iterator k = this->_delta1[*j].begin(); k != this->_delta1[*j].end(); ++k) {
-					for (std::vector<size_t>::iterator l = post[*k].begin(); l != post[*k].end(); ++l) {
-						if (this->_relation.data()[(*i)->index()][this->_index[*l]->block()->index()])
+					LTS::Range post = this->_lts->post(*k, *j);
+					for (LTS::Range::const_iterator l = post.begin(); l != post.end(); ++l) {
+						if (this->_relation.data().get((*i)->index(), this->_index[*l]->block()->index()))
 							(*i)->counter().incr(*j, *k);
 					}
 				}
 				for (size_t k = 0; k < this->_lts->states(); ++k)
 					this->_tmp[k] = this->_delta1[*j].contains(k);
 				for (std::vector<OLRTBlock*>::iterator k = this->_partition.begin(); k != this->_partition.end(); ++k) {
-					if (this->_relation.data()[(*i)->index()][(*k)->index()]) {
+					if (this->_relation.data().get((*i)->index(), (*k)->index())) {
 						StateListElem* elem = (*k)->states();
 						do {
-							for (std::vector<size_t>::const_iterator l = this->_lts->dataPre()[*j][elem->state()].begin(); l != this->_lts->dataPre()[*j][elem->state()].end(); ++l)
+							LTS::Range pre = this->_lts->pre(elem->state(), *j);
+							for (LTS::Range::const_iterator l = pre.begin(); l != pre.end(); ++l)
 								this->_tmp[*l] = false;
 							elem = elem->next();
 						} while (elem != (*k)->states());
@@ -545,10 +618,8 @@ public:
 		}
 		for (std::vector<size_t>::const_iterator i = remove.begin(); i != remove.end(); ++i) {
 			StateListElem* elem = this->_index[*i];
-			if (elem->block()->tmp() != NULL) {
-				OLRTBlock* block = new OLRTBlock(this->_relation.newEntry(), elem->block(), *this->_lts);
-				this->_partition.push_back(block);
-			}
+			if (elem->block()->tmp() != NULL)
+				this->splitBlock(elem->block());
 		}
 	}
 
@@ -574,13 +645,21 @@ public:
 		return this->_relation;
 	}
 	
-	void buildRel(size_t size, std::vector<std::vector<bool> >& rel) const {
-		rel.clear();
-		rel.resize(size, std::vector<bool>(size));
+	void buildRel(size_t size, BitRelation& rel) const {
+		rel = BitRelation(size);
+		// states of the same block share the row, so compute it only once
+		std::vector<size_t> first(this->_relation.data().size(), size);
 		for (size_t i = 0; i < size; ++i) {
 			size_t ii = this->_index[i]->block()->index();
-			for (size_t j = 0; j < size; ++j)
-				rel[i][j] = this->_relation.data()[ii][this->_index[j]->block()->index()];
+			if (first[ii] < size) {
+				rel.copyRow(i, rel, first[ii]);
+				continue;
+			}
+			first[ii] = i;
+			for (size_t j = 0; j < size; ++j) {
+				if (this->_relation.data().get(ii, this->_index[j]->block()->index()))
+					rel.set(i, j);
+			}
 		}
 	}
 	
@@ -119,7 +119,13 @@ public:
 			this->_index[i->first] = this->_elements.end();
 		this->_elements.clear();
 	}
-	
+
+	// make the set empty over the universe {0, ..., size - 1}
+	void reset(size_t size) {
+		this->_elements.clear();
+		this->_index.assign(size, this->_elements.end());
+	}
+
 	void buildVector(std::vector<size_t>& v) const {
 		v.clear();
 		for (std::list<std::pair<size_t, size_t> >::const_iterator i = this->_elements.begin(); i != this->_elements.end(); ++i)
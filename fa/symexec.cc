@@ -623,6 +623,9 @@ public:
 			CL_DEBUG_AT(1, "forester has evaluated " << this->execMan.statesEvaluated()
 				<< " state(s) in " << this->execMan.tracesEvaluated() << " trace(s) using "
 				<< this->boxMan.boxDatabase().size() << " box(es)");
+			CL_DEBUG_AT(1, "simulation cache: " << this->taBackend.simCache);
+			CL_DEBUG_AT(1, "minimization cache: " << this->taBackend.minCache);
+			CL_DEBUG_AT(1, "fixpoint minimization cache: " << this->fixpointBackend.minCache);
 
 		}
 		catch (std::exception& e)
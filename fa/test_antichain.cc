@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// checks the antichain-based TA::subseteq() on 2000 pairs of random tree
+// automata against a naive inclusion check, which determinizes the bigger
+// automaton; half of the pairs are made so that the inclusion holds, both
+// the positive and the negative answers have to be seen
+
+#include <iostream>
+#include <set>
+#include <utility>
+#include <vector>
+
+// the template bodies of TA<T> are not in the header
+#include "treeaut.cc"
+
+struct Trans {
+	std::vector<size_t> lhs;
+	int label;
+	size_t rhs;
+};
+
+struct Aut {
+	std::vector<Trans> trans;
+	std::set<size_t> finalStates;
+};
+
+// a set of states of the bigger automaton, there are less than 64 of them
+typedef unsigned long long Macrostate;
+
+static unsigned long long seed = 2468;
+
+static size_t rnd() {
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed >> 33;
+}
+
+// labels 3k are leaves, 3k + 1 and 3k + 2 have arity 1 and 2
+static void randomAut(Aut& aut, size_t states, size_t labels) {
+	for (size_t k = 0; k < 1 + states / 2; ++k) {
+		Trans t;
+		t.label = 3 * (rnd() % labels);
+		t.rhs = rnd() % states;
+		aut.trans.push_back(t);
+	}
+	for (size_t k = states * (1 + rnd() % 2); k > 0; --k) {
+		Trans t;
+		t.label = 3 * (rnd() % labels) + 1 + rnd() % 2;
+		t.lhs.resize(t.label % 3);
+		for (size_t i = 0; i < t.lhs.size(); ++i)
+			t.lhs[i] = rnd() % states;
+		t.rhs = rnd() % states;
+		aut.trans.push_back(t);
+	}
+	for (size_t k = 1 + rnd() % 2; k > 0; --k)
+		aut.finalStates.insert(rnd() % states);
+}
+
+// a subset of the transitions of src, with the states renamed, accepts a
+// subset of the language of src
+static void subAut(Aut& dst, const Aut& src, size_t offset) {
+	for (size_t k = 0; k < src.trans.size(); ++k) {
+		if (rnd() % 4 == 0)
+			continue;
+		Trans t = src.trans[k];
+		for (size_t i = 0; i < t.lhs.size(); ++i)
+			t.lhs[i] += offset;
+		t.rhs += offset;
+		dst.trans.push_back(t);
+	}
+	for (std::set<size_t>::const_iterator i = src.finalStates.begin(); i != src.finalStates.end(); ++i) {
+		if (rnd() % 3)
+			dst.finalStates.insert(*i + offset);
+	}
+	if (dst.finalStates.empty())
+		dst.finalStates.insert(*src.finalStates.begin() + offset);
+}
+
+// the states of b reachable by the determinized b in a(s[0], ..., s[n - 1])
+static Macrostate post(const Aut& b, int label, const std::vector<Macrostate>& s) {
+	Macrostate res = 0;
+	for (size_t i = 0; i < b.trans.size(); ++i) {
+		const Trans& t = b.trans[i];
+		if (t.label != label)
+			continue;
+		bool match = true;
+		for (size_t k = 0; match && k < t.lhs.size(); ++k)
+			match = s[k] & (1ULL << t.lhs[k]);
+		if (match)
+			res |= 1ULL << t.rhs;
+	}
+	return res;
+}
+
+// L(a) is a subset of L(b) iff no tree takes a to a final state while taking
+// the determinized b only to non-final states
+static bool naiveSubseteq(const Aut& a, const Aut& b) {
+	Macrostate bFinal = 0;
+	for (std::set<size_t>::const_iterator i = b.finalStates.begin(); i != b.finalStates.end(); ++i)
+		bFinal |= 1ULL << *i;
+	// pairs of a state of a and a macrostate of b reachable by the same tree
+	std::set<std::pair<size_t, Macrostate> > reach;
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		// the macrostates reached so far together with each state of a
+		std::vector<std::vector<Macrostate> > reached(64);
+		for (std::set<std::pair<size_t, Macrostate> >::const_iterator i = reach.begin(); i != reach.end(); ++i)
+			reached[i->first].push_back(i->second);
+		for (size_t i = 0; i < a.trans.size(); ++i) {
+			const Trans& t = a.trans[i];
+			bool empty = false;
+			for (size_t k = 0; k < t.lhs.size(); ++k)
+				empty = empty || reached[t.lhs[k]].empty();
+			if (empty)
+				continue;
+			// all the combinations of the macrostates of the left-hand side
+			std::vector<size_t> pos(t.lhs.size(), 0);
+			std::vector<Macrostate> s(t.lhs.size());
+			size_t k = 0;
+			while (k < t.lhs.size() || pos.empty()) {
+				for (size_t j = 0; j < t.lhs.size(); ++j)
+					s[j] = reached[t.lhs[j]][pos[j]];
+				if (reach.insert(std::make_pair(t.rhs, post(b, t.label, s))).second)
+					changed = true;
+				if (pos.empty())
+					break;
+				for (k = 0; k < t.lhs.size() && ++pos[k] == reached[t.lhs[k]].size(); ++k)
+					pos[k] = 0;
+			}
+		}
+	}
+	for (std::set<std::pair<size_t, Macrostate> >::const_iterator i = reach.begin(); i != reach.end(); ++i) {
+		if (a.finalStates.count(i->first) && !(i->second & bFinal))
+			return false;
+	}
+	return true;
+}
+
+static void buildTA(TA<int>& ta, const Aut& aut) {
+	for (size_t k = 0; k < aut.trans.size(); ++k)
+		ta.addTransition(aut.trans[k].lhs, aut.trans[k].label, aut.trans[k].rhs);
+	for (std::set<size_t>::const_iterator i = aut.finalStates.begin(); i != aut.finalStates.end(); ++i)
+		ta.addFinalState(*i);
+}
+
+int main() {
+	size_t errors = 0, cntPositive = 0, cntNegative = 0;
+	TA<int>::Backend backend;
+	for (int round = 0; round < 2000; ++round) {
+		const size_t labels = 1 + rnd() % 3;
+		Aut a, b;
+		randomAut(b, 2 + rnd() % 10, labels);
+		if (round % 2)
+			subAut(a, b, rnd() % 8);
+		else
+			randomAut(a, 2 + rnd() % 10, labels);
+
+		TA<int> taA(backend), taB(backend), tmp(backend), trimmed(backend);
+		buildTA(taA, a);
+		buildTA(taB, b);
+		// subseteq() needs the smaller automaton without useless states
+		taA.uselessFree(tmp).unreachableFree(trimmed);
+
+		const bool expected = naiveSubseteq(a, b);
+		if (TA<int>::subseteq(trimmed, taB) != expected) {
+			std::cerr << "round " << round << ": subseteq() returns " << !expected << '\n';
+			++errors;
+		}
+		++((expected)?(cntPositive):(cntNegative));
+	}
+
+	// both answers have to be covered
+	if (cntPositive < 500 || cntNegative < 500) {
+		std::cerr << "only " << cntPositive << " positive and " << cntNegative << " negative check(s)\n";
+		++errors;
+	}
+
+	if (errors)
+		std::cerr << "error: " << errors << " check(s) failed\n";
+
+	return (errors)?(1):(0);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// checks the simulations computed by OLRTAlgorithm on 3000 random LTSs (some
+// of them with fake splits) against a naive greatest fixpoint computation;
+// a single LTS and a single algorithm are reused for all of them, so that
+// any state left behind by the previous run shows up
+
+#include <iostream>
+#include <vector>
+
+#include "simalg.hh"
+
+typedef std::vector<std::vector<bool> > NaiveRel;
+
+struct Trans {
+	size_t q;
+	size_t a;
+	size_t r;
+};
+
+static unsigned long long seed = 4242;
+
+static size_t rnd() {
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed >> 33;
+}
+
+// q <= r iff every q -a-> q' is matched by some r -a-> r' such that q' <= r'
+static void naiveSimulation(NaiveRel& rel, const std::vector<Trans>& trans, size_t states) {
+	rel.assign(states, std::vector<bool>(states, true));
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (size_t q = 0; q < states; ++q) {
+			for (size_t r = 0; r < states; ++r) {
+				for (size_t i = 0; rel[q][r] && i < trans.size(); ++i) {
+					if (trans[i].q != q)
+						continue;
+					bool found = false;
+					for (size_t j = 0; !found && j < trans.size(); ++j)
+						found = trans[j].q == r && trans[j].a == trans[i].a && rel[trans[i].r][trans[j].r];
+					if (!found) {
+						rel[q][r] = false;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+}
+
+int main() {
+	size_t errors = 0;
+	LTS lts;
+	OLRTAlgorithm alg;
+	for (int round = 0; round < 3000; ++round) {
+		const size_t states = 1 + rnd() % ((round % 5 == 0)?(150):(20));
+		const size_t labels = 1 + rnd() % 6;
+		std::vector<Trans> trans(states * (rnd() % 4) + rnd() % 3);
+		for (size_t k = 0; k < trans.size(); ++k) {
+			trans[k].q = rnd() % states;
+			trans[k].a = rnd() % labels;
+			trans[k].r = rnd() % states;
+		}
+		// the blocks created by the fake splits are all related initially, so
+		// they do not change the result
+		std::vector<std::vector<size_t> > part(rnd() % 3);
+		for (size_t p = 0; p < part.size(); ++p) {
+			for (size_t s = 0; s < states; ++s) {
+				if (rnd() % 3 == 0)
+					part[p].push_back(s);
+			}
+		}
+
+		lts.reset(labels, states);
+		for (size_t k = 0; k < trans.size(); ++k)
+			lts.addTransition(trans[k].q, trans[k].a, trans[k].r);
+		lts.finalize();
+		alg.reset(lts);
+		for (size_t p = 0; p < part.size(); ++p)
+			alg.fakeSplit(part[p]);
+		alg.init();
+		alg.run();
+		BitRelation rel;
+		alg.buildRel(states, rel);
+
+		NaiveRel ref;
+		naiveSimulation(ref, trans, states);
+		size_t cnt = 0;
+		for (size_t i = 0; i < states; ++i) {
+			for (size_t j = 0; j < states; ++j) {
+				if (rel.get(i, j) != ref[i][j])
+					++cnt;
+			}
+		}
+		if (cnt) {
+			std::cerr << "round " << round << ": " << cnt << " cell(s) of the simulation differ\n";
+			++errors;
+		}
+	}
+
+	if (errors)
+		std::cerr << "error: " << errors << " check(s) failed\n";
+
+	return (errors)?(1):(0);
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// checks the memos of TA::Backend on 3000 random automata drawn from a small
+// pool; the same operations are done in a backend with a tiny capacity, so
+// that the entries are evicted and invalidated all the time, and in a backend
+// without the memos, and the results have to be the same
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// the template bodies of TA<T> are not in the header
+#include "treeaut.cc"
+
+static unsigned long long seed = 777;
+
+static size_t rnd() {
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed >> 33;
+}
+
+// the automaton is given by its own seed, labels 3k are leaves, 3k + 1 and
+// 3k + 2 have arity 1 and 2
+static void randomTA(TA<int>& ta, unsigned long long taSeed) {
+	const unsigned long long old = seed;
+	seed = taSeed;
+	const size_t states = 2 + rnd() % 12;
+	const size_t labels = 1 + rnd() % 3;
+	std::vector<size_t> lhs;
+	for (size_t k = 0; k < states; ++k)
+		ta.addTransition(lhs, 3 * (rnd() % labels), k);
+	for (size_t k = states * (1 + rnd() % 2); k > 0; --k) {
+		const int label = 3 * (rnd() % labels) + 1 + rnd() % 2;
+		lhs.resize(label % 3);
+		for (size_t i = 0; i < lhs.size(); ++i)
+			lhs[i] = rnd() % states;
+		ta.addTransition(lhs, label, rnd() % states);
+	}
+	ta.addFinalState(rnd() % states);
+	seed = old;
+}
+
+static std::string print(const TA<int>& ta) {
+	std::vector<std::string> v;
+	for (TA<int>::Iterator i = ta.begin(); i != ta.end(); ++i) {
+		std::ostringstream s;
+		s << *i;
+		v.push_back(s.str());
+	}
+	std::sort(v.begin(), v.end());
+	std::ostringstream s;
+	for (size_t i = 0; i < v.size(); ++i)
+		s << v[i] << ' ';
+	s << '|';
+	for (std::set<size_t>::const_iterator i = ta.getFinalStates().begin(); i != ta.getFinalStates().end(); ++i)
+		s << ' ' << *i;
+	return s.str();
+}
+
+static std::string print(const BitRelation& rel) {
+	std::ostringstream s;
+	for (size_t i = 0; i < rel.size(); ++i) {
+		for (size_t j = 0; j < rel.size(); ++j)
+			s << rel.get(i, j);
+	}
+	return s.str();
+}
+
+struct Run {
+
+	TA<int>::Backend backend;
+	// the automata still alive, the others may have released their transitions
+	std::vector<TA<int>*> live;
+
+	Run(size_t cacheSize) : backend(cacheSize), live() {}
+
+	~Run() {
+		for (size_t i = 0; i < this->live.size(); ++i)
+			delete this->live[i];
+	}
+
+	// the results of the operations selected by op
+	std::string step(unsigned long long taSeed, size_t op) {
+		TA<int>* ta = new TA<int>(this->backend);
+		randomTA(*ta, taSeed);
+		if (op & 1)
+			ta->addFinalState(0);
+		this->live.push_back(ta);
+		Index<size_t> stateIndex;
+		ta->buildSortedStateIndex(stateIndex);
+		BitRelation dwn;
+		ta->downwardSimulation(dwn, stateIndex);
+		TA<int> a(this->backend), b(this->backend);
+		if (op & 2)
+			ta->minimized(a);
+		else
+			ta->minimizedCombo(a);
+		a.minimized(b);
+		return print(dwn) + '\n' + print(a) + '\n' + print(b);
+	}
+
+	void drop(size_t k) {
+		delete this->live[k];
+		this->live.erase(this->live.begin() + k);
+	}
+
+};
+
+int main() {
+	size_t errors = 0;
+	Run cached(4), plain(0);
+	for (int round = 0; round < 3000; ++round) {
+		// a small pool of automata, so that the same ones come again
+		const unsigned long long taSeed = rnd() % 20;
+		const size_t op = rnd() % 4;
+		if (cached.step(taSeed, op) != plain.step(taSeed, op)) {
+			std::cerr << "round " << round << ": the cached results differ\n";
+			++errors;
+		}
+		// drop some automata, so that their transitions may be released
+		while (cached.live.size() > 3 || (!cached.live.empty() && rnd() % 3 == 0)) {
+			const size_t k = rnd() % cached.live.size();
+			cached.drop(k);
+			plain.drop(k);
+		}
+	}
+
+	if (!cached.backend.simCache.hits() || !cached.backend.minCache.hits()) {
+		std::cerr << "the memos have never been hit\n";
+		++errors;
+	}
+
+	std::cerr << "sim: " << cached.backend.simCache << "\nmin: " << cached.backend.minCache << "\n";
+
+	if (errors)
+		std::cerr << "error: " << errors << " check(s) failed\n";
+
+	return (errors)?(1):(0);
+}
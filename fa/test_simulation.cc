@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2012 Jiri Simacek
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// checks the downward and upward simulations of 400 random tree automata
+// against a naive greatest fixpoint computation; the automata are also built
+// in reverse order in another backend, which changes the order of their
+// (address-sorted) transitions, and the results have to be the same
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// the template bodies of TA<T> are not in the header
+#include "treeaut.cc"
+
+struct Trans {
+	std::vector<size_t> lhs;
+	int label;
+	size_t rhs;
+};
+
+typedef std::vector<std::vector<bool> > NaiveRel;
+
+static unsigned long long seed = 12345;
+
+static size_t rnd() {
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed >> 33;
+}
+
+// labels 3k are leaves, 3k + 1 and 3k + 2 have arity 1 and 2
+static void randomTrans(std::vector<Trans>& dst, size_t states, size_t labels, size_t cnt) {
+	for (size_t k = 0; k < states; ++k) {
+		Trans t;
+		t.label = 3 * (rnd() % labels);
+		t.rhs = k;
+		dst.push_back(t);
+	}
+	for (size_t k = 0; k < cnt; ++k) {
+		Trans t;
+		t.label = 3 * (rnd() % labels) + 1 + rnd() % 2;
+		t.lhs.resize(t.label % 3);
+		for (size_t i = 0; i < t.lhs.size(); ++i)
+			t.lhs[i] = rnd() % states;
+		t.rhs = rnd() % states;
+		dst.push_back(t);
+	}
+}
+
+// q <= r iff every transition a(q1, ..., qn) -> q is matched by some
+// a(r1, ..., rn) -> r such that qi <= ri
+static void naiveDownward(NaiveRel& rel, const std::vector<Trans>& trans, size_t states) {
+	rel.assign(states, std::vector<bool>(states, true));
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (size_t q = 0; q < states; ++q) {
+			for (size_t r = 0; r < states; ++r) {
+				for (size_t i = 0; rel[q][r] && i < trans.size(); ++i) {
+					if (trans[i].rhs != q)
+						continue;
+					bool found = false;
+					for (size_t j = 0; !found && j < trans.size(); ++j) {
+						if (trans[j].rhs != r || trans[j].label != trans[i].label)
+							continue;
+						found = true;
+						for (size_t k = 0; found && k < trans[i].lhs.size(); ++k)
+							found = rel[trans[i].lhs[k]][trans[j].lhs[k]];
+					}
+					if (!found) {
+						rel[q][r] = false;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+}
+
+// q <= r iff r is final if q is, and every a(.., q, ..) -> q' (q at position
+// x) is matched by some a(.., r, ..) -> r' (r at position x) such that
+// q' <= r' and the other states are related by the downward simulation
+static void naiveUpward(NaiveRel& rel, const std::vector<Trans>& trans, size_t states, const NaiveRel& dwn, size_t final) {
+	rel.assign(states, std::vector<bool>(states, true));
+	for (size_t r = 0; r < states; ++r)
+		rel[final][r] = (r == final);
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (size_t q = 0; q < states; ++q) {
+			for (size_t r = 0; r < states; ++r) {
+				for (size_t i = 0; rel[q][r] && i < trans.size(); ++i) {
+					for (size_t x = 0; rel[q][r] && x < trans[i].lhs.size(); ++x) {
+						if (trans[i].lhs[x] != q)
+							continue;
+						bool found = false;
+						for (size_t j = 0; !found && j < trans.size(); ++j) {
+							if (trans[j].label != trans[i].label || trans[j].lhs[x] != r)
+								continue;
+							found = rel[trans[i].rhs][trans[j].rhs];
+							for (size_t k = 0; found && k < trans[i].lhs.size(); ++k) {
+								if (k != x)
+									found = dwn[trans[i].lhs[k]][trans[j].lhs[k]];
+							}
+						}
+						if (!found) {
+							rel[q][r] = false;
+							changed = true;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+static void buildTA(TA<int>& ta, const std::vector<Trans>& trans, size_t final, bool reverse) {
+	for (size_t k = 0; k < trans.size(); ++k) {
+		const Trans& t = trans[(reverse)?(trans.size() - 1 - k):(k)];
+		ta.addTransition(t.lhs, t.label, t.rhs);
+	}
+	ta.addFinalState(final);
+}
+
+// the sorted state index of the random automata is the identity
+static size_t compare(const BitRelation& rel, const NaiveRel& ref) {
+	size_t cnt = 0;
+	for (size_t i = 0; i < ref.size(); ++i) {
+		for (size_t j = 0; j < ref.size(); ++j) {
+			if (rel.get(i, j) != ref[i][j])
+				++cnt;
+		}
+	}
+	return cnt;
+}
+
+static std::string print(const TA<int>& ta) {
+	std::vector<std::string> v;
+	for (TA<int>::Iterator i = ta.begin(); i != ta.end(); ++i) {
+		std::ostringstream s;
+		s << *i;
+		v.push_back(s.str());
+	}
+	std::sort(v.begin(), v.end());
+	std::ostringstream s;
+	for (size_t i = 0; i < v.size(); ++i)
+		s << v[i] << ' ';
+	return s.str();
+}
+
+int main() {
+	size_t errors = 0;
+	for (int round = 0; round < 400; ++round) {
+		const size_t states = 2 + rnd() % ((round % 4 == 0)?(140):(20));
+		const size_t labels = 1 + rnd() % 4;
+		std::vector<Trans> trans;
+		randomTrans(trans, states, labels, states * (1 + rnd() % 3));
+		const size_t final = rnd() % states;
+
+		NaiveRel dwnRef, upRef;
+		naiveDownward(dwnRef, trans, states);
+		naiveUpward(upRef, trans, states, dwnRef, final);
+
+		std::string minimized[2];
+		for (int reverse = 0; reverse < 2; ++reverse) {
+			TA<int>::Backend backend;
+			TA<int> ta(backend);
+			buildTA(ta, trans, final, reverse);
+			Index<size_t> stateIndex;
+			ta.buildSortedStateIndex(stateIndex);
+
+			BitRelation dwn, up;
+			ta.downwardSimulation(dwn, stateIndex);
+			ta.upwardSimulation(up, stateIndex, dwn);
+			if (const size_t cnt = compare(dwn, dwnRef)) {
+				std::cerr << "round " << round << ": " << cnt << " cell(s) of the downward simulation differ\n";
+				++errors;
+			}
+			if (const size_t cnt = compare(up, upRef)) {
+				std::cerr << "round " << round << ": " << cnt << " cell(s) of the upward simulation differ\n";
+				++errors;
+			}
+
+			// subseteq() needs automata without useless states
+			TA<int> dst(backend), tmp(backend), trimmed(backend);
+			ta.minimizedCombo(dst);
+			ta.uselessFree(tmp).unreachableFree(trimmed);
+			if (!TA<int>::subseteq(trimmed, dst) || !TA<int>::subseteq(dst, trimmed)) {
+				std::cerr << "round " << round << ": minimizedCombo() changes the language\n";
+				++errors;
+			}
+			minimized[reverse] = print(dst);
+		}
+
+		if (minimized[0] != minimized[1]) {
+			std::cerr << "round " << round << ": minimizedCombo() depends on the order of transitions\n";
+			++errors;
+		}
+	}
+
+	if (errors)
+		std::cerr << "error: " << errors << " check(s) failed\n";
+
+	return (errors)?(1):(0);
+}
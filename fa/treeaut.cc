@@ -23,12 +23,15 @@
 #include <algorithm>
 #include <stdexcept>
 #include <ostream>
+#include <fstream>
+#include <sstream>
 
 #include <boost/unordered_map.hpp>
 
 #include "treeaut.hh"
 #include "simalg.hh"
 #include "antichainext.hh"
+#include "timbuk.hh"
 
 using std::vector;
 using std::set;
@@ -60,21 +63,21 @@ struct LhsEnv {
 		return x;
 	}
 
-	static bool sim(const LhsEnv& e1, const LhsEnv& e2, const vector<vector<bool> >& sim) {
+	static bool sim(const LhsEnv& e1, const LhsEnv& e2, const BitRelation& sim) {
 		if ((e1.index != e2.index) || (e1.data.size() != e2.data.size()))
 			return false;
 		for (size_t i = 0; i < e1.data.size(); ++i) {
-			if (!sim[e1.data[i]][e2.data[i]])
+			if (!sim.get(e1.data[i], e2.data[i]))
 				return false;
 		}
 		return true;
 	}
 
-	static bool eq(const LhsEnv& e1, const LhsEnv& e2, const vector<vector<bool> >& sim) {
+	static bool eq(const LhsEnv& e1, const LhsEnv& e2, const BitRelation& sim) {
 		if ((e1.index != e2.index) || (e1.data.size() != e2.data.size()))
 			return false;
 		for (size_t i = 0; i < e1.data.size(); ++i) {
-			if (!sim[e1.data[i]][e2.data[i]] || !sim[e2.data[i]][e1.data[i]])
+			if (!sim.get(e1.data[i], e2.data[i]) || !sim.get(e2.data[i], e1.data[i]))
 				return false;
 		}
 		return true;
@@ -132,11 +135,11 @@ struct Env {
 		return x;
 	}
 
-	static bool sim(const Env& e1, const Env& e2, const vector<vector<bool> >& sim) {
+	static bool sim(const Env& e1, const Env& e2, const BitRelation& sim) {
 		return (e1.label == e2.label) && LhsEnv::sim(*e1.lhs, *e2.lhs, sim);
 	}
 	
-	static bool eq(const Env& e1, const Env& e2, const vector<vector<bool> >& sim) {
+	static bool eq(const Env& e1, const Env& e2, const BitRelation& sim) {
 		return (e1.label == e2.label) && LhsEnv::eq(*e1.lhs, *e2.lhs, sim);
 	}
 
@@ -159,29 +162,50 @@ void TA<T>::downwardTranslation(LTS& lts, const Index<size_t>& stateIndex, const
 	// build an index of non-translated left-hand sides
 	Index<const vector<size_t>*> lhs;
 	this->buildLhsIndex(lhs);
-	lts = LTS(labelIndex.size() + this->maxRank, stateIndex.size() + lhs.size());
+	lts.reset(labelIndex.size() + this->maxRank, stateIndex.size() + lhs.size());
 	for (Index<const vector<size_t>*>::iterator i = lhs.begin(); i != lhs.end(); ++i) {
 		for (size_t j = 0; j < i->first->size(); ++j)
 			lts.addTransition(stateIndex.size() + i->second, labelIndex.size() + j, stateIndex[(*i->first)[j]]);
 	}
 	for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
 		lts.addTransition(stateIndex[(*i)->first._rhs], labelIndex[(*i)->first._label], stateIndex.size() + lhs[&((*i)->first._lhs->first)]);
+	lts.finalize();
 }
 
 template <class T>
-void TA<T>::downwardSimulation(vector<vector<bool> >& rel, const Index<size_t>& stateIndex) const {
-	LTS lts;
+void TA<T>::downwardSimulation(BitRelation& rel, const Index<size_t>& stateIndex) const {
+	sim_cache_type& cache = this->backend->simCache;
+	cache_key_type key;
+	if (cache.enabled()) {
+		// the relation does not depend on the final states, but it is indexed
+		// by stateIndex
+		this->buildCacheKey(key);
+		vector<pair<size_t, size_t> > layout(stateIndex.begin(), stateIndex.end());
+		std::sort(layout.begin(), layout.end());
+		for (vector<pair<size_t, size_t> >::const_iterator i = layout.begin(); i != layout.end(); ++i) {
+			key.data.push_back(i->first);
+			key.data.push_back(i->second);
+		}
+		if (const BitRelation* cached = cache.find(key)) {
+			rel = *cached;
+			return;
+		}
+	}
+	// the LTS and the algorithm are kept by the backend to reuse their storage
+	LTS& lts = this->backend->lts;
 	Index<T> labelIndex;
 	this->buildLabelIndex(labelIndex);
 	this->downwardTranslation(lts, stateIndex, labelIndex);
-	OLRTAlgorithm alg(lts);
+	OLRTAlgorithm& alg = this->backend->olrt;
+	alg.reset(lts);
 	alg.init();
 	alg.run();
 	alg.buildRel(stateIndex.size(), rel);
+	cache.insert(key, rel);
 }
 
 template <class T>
-void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const vector<vector<bool> >& sim) const {
+void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, BitRelation& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const BitRelation& sim) const {
 	set<LhsEnv> lhsEnvSet;
 	map<Env, size_t> envMap;
 	vector<const Env*> head;
@@ -211,41 +235,43 @@ void TA<T>::upwardTranslation(LTS& lts, vector<vector<size_t> >& part, vector<ve
 			}
 		}
 	}
-	lts = LTS(labelIndex.size() + 1, stateIndex.size() + envMap.size());
+	lts.reset(labelIndex.size() + 1, stateIndex.size() + envMap.size());
 	for (typename set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
 		vector<size_t> lhs;
 		stateIndex.translate(lhs, (*i)->first._lhs->first);
 		size_t label = labelIndex[(*i)->first._label];
 		size_t rhs = stateIndex[(*i)->first._rhs];
 		for (size_t j = 0; j < lhs.size(); ++j) {
-			// find particular env
+			// find particular env, the environments are numbered after the states
 			map<Env, size_t>::iterator env = Env::find(LhsEnv::find(lhs, j, lhsEnvSet), label, rhs, envMap);
-			lts.addTransition(lhs[j], labelIndex.size(), env->second);
-			lts.addTransition(env->second, label, rhs);
+			lts.addTransition(lhs[j], labelIndex.size(), env->second + stateIndex.size());
+			lts.addTransition(env->second + stateIndex.size(), label, rhs);
 		}
 	}
-	rel = vector<vector<bool> >(part.size() + 2, vector<bool>(part.size() + 2, false));
+	lts.finalize();
+	rel = BitRelation(part.size() + 2);
 	// 0 non-accepting, 1 accepting, 2 .. environments
-	rel[0][0] = true;
-	rel[0][1] = true;
-	rel[1][1] = true;
+	rel.set(0, 0);
+	rel.set(0, 1);
+	rel.set(1, 1);
 	for (size_t i = 0; i < head.size(); ++i) {
 		for (size_t j = 0; j < head.size(); ++j) {
 			if (Env::sim(*head[i], *head[j], sim))
-				rel[i + 2][j + 2] = true;
+				rel.set(i + 2, j + 2);
 		}
 	}
 }
 
 template <class T>
-void TA<T>::upwardSimulation(vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const vector<vector<bool> >& param) const {
-	LTS lts;
+void TA<T>::upwardSimulation(BitRelation& rel, const Index<size_t>& stateIndex, const BitRelation& param) const {
+	LTS& lts = this->backend->lts;
 	Index<T> labelIndex;
 	this->buildLabelIndex(labelIndex);
 	std::vector<std::vector<size_t> > part;
-	std::vector<std::vector<bool> > initRel;
+	BitRelation initRel;
 	this->upwardTranslation(lts, part, initRel, stateIndex, labelIndex, param);
-	OLRTAlgorithm alg(lts);
+	OLRTAlgorithm& alg = this->backend->olrt;
+	alg.reset(lts);
 	// accepting states to block 1
 	std::vector<size_t> finalStates;
 	stateIndex.translate(finalStates, vector<size_t>(this->finalStates.begin(), this->finalStates.end())); 
@@ -265,6 +291,43 @@ bool TA<T>::subseteq(const TA<T>& a, const TA<T>& b) {
 	return AntichainExt<T>::subseteq(a, b);
 }
 
+template <class T>
+void TA<T>::dumpTimbuk(const char* fileName, const char* name) const {
+	std::ofstream out(fileName, std::ios::app);
+	TimbukWriter writer(out);
+	Index<size_t> stateIndex;
+	this->buildSortedStateIndex(stateIndex);
+	Index<T> labelIndex;
+	this->buildLabelIndex(labelIndex);
+	vector<size_t> arity(labelIndex.size());
+	for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i)
+		arity[labelIndex[(*i)->first._label]] = (*i)->first._lhs->first.size();
+	writer.startAlphabet();
+	for (size_t i = 0; i < arity.size(); ++i)
+		writer.writeLabel(i, arity[i]);
+	writer.endl();
+	writer.newModel(name);
+	writer.endl();
+	writer.startStates();
+	for (size_t i = 0; i < stateIndex.size(); ++i)
+		writer.writeState(i);
+	writer.endl();
+	writer.startFinalStates();
+	for (std::set<size_t>::const_iterator i = this->finalStates.begin(); i != this->finalStates.end(); ++i)
+		writer.writeState(stateIndex[*i]);
+	writer.endl();
+	writer.startTransitions();
+	writer.endl();
+	for (typename std::set<typename trans_cache_type::value_type*>::const_iterator i = this->transitions.begin(); i != this->transitions.end(); ++i) {
+		vector<size_t> lhs;
+		stateIndex.translate(lhs, (*i)->first._lhs->first);
+		std::ostringstream label;
+		label << 'l' << labelIndex[(*i)->first._label];
+		writer.writeTransition(lhs, label.str(), stateIndex[(*i)->first._rhs]);
+		writer.endl();
+	}
+}
+
 // this is really sad :-(
 #include "forestaut.hh"
 template class TA<label_type>;
@@ -26,13 +26,17 @@
 #include <algorithm>
 #include <cassert>
 #include <stdexcept>
+#include <memory>
 
 #include <boost/unordered_set.hpp>
 #include <boost/unordered_map.hpp>
 
+#include "config.h"
+#include "bitrelation.hh"
 #include "cache.hh"
 #include "utils.hh"
 #include "lts.hh"
+#include "simalg.hh"
 
 using std::vector;
 using std::set;
@@ -165,11 +169,11 @@ public:
 
 	~TT() { this->lhsCache.release(this->_lhs);	}
 
-	bool llhsLessThan(const TT& rhs, const std::vector<std::vector<bool> >& cons, const Index<size_t>& stateIndex) const {
+	bool llhsLessThan(const TT& rhs, const BitRelation& cons, const Index<size_t>& stateIndex) const {
 		if (this->_label != rhs._label)
 			return false;
 		for (size_t i = 0; i < this->_lhs->first.size(); ++i) {
-			if (!cons[stateIndex[this->_lhs->first[i]]][stateIndex[rhs._lhs->first[i]]])
+			if (!cons.get(stateIndex[this->_lhs->first[i]], stateIndex[rhs._lhs->first[i]]))
 				return false;
 		}
 		return true;
@@ -207,11 +211,26 @@ public:
 
     typedef Cache<TT<T> > trans_cache_type;
 
+	typedef CachedSetKey<typename trans_cache_type::value_type> cache_key_type;
+	typedef CachedSetOp<TT<T>, BitRelation> sim_cache_type;
+	typedef CachedSetOp<TT<T>, std::shared_ptr<const TA<T> > > min_cache_type;
+
 	// this is the place where transitions are stored
 	struct Backend {
 
 		typename TTBase<T>::lhs_cache_type lhsCache;
 		trans_cache_type transCache;
+		// storage reused by the simulation computations
+		LTS lts;
+		OLRTAlgorithm olrt;
+		// downward simulations and minimized automata keyed by the transitions
+		sim_cache_type simCache;
+		min_cache_type minCache;
+
+		// cacheSize overrides FA_SIM_CACHE_SIZE, 0 disables the memos
+		explicit Backend(size_t cacheSize = FA_SIM_CACHE_SIZE)
+			: lhsCache(), transCache(), lts(), olrt(),
+			simCache(transCache, cacheSize), minCache(transCache, cacheSize) {}
 
 	};
 
@@ -610,38 +629,31 @@ public:
 
 	void downwardTranslation(LTS& lts, const Index<size_t>& stateIndex, const Index<T>& labelIndex) const;
 
-	void downwardSimulation(std::vector<std::vector<bool> >& rel, const Index<size_t>& stateIndex) const;
+	void downwardSimulation(BitRelation& rel, const Index<size_t>& stateIndex) const;
 
-	void upwardTranslation(LTS& lts, std::vector<std::vector<size_t> >& part, vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const vector<vector<bool> >& sim) const;
+	void upwardTranslation(LTS& lts, std::vector<std::vector<size_t> >& part, BitRelation& rel, const Index<size_t>& stateIndex, const Index<T>& labelIndex, const BitRelation& sim) const;
 
-	void upwardSimulation(vector<vector<bool> >& rel, const Index<size_t>& stateIndex, const std::vector<std::vector<bool> >& param) const;
+	void upwardSimulation(BitRelation& rel, const Index<size_t>& stateIndex, const BitRelation& param) const;
 
-	static void combinedSimulation(vector<vector<bool> >& dst, const vector<vector<bool> >& dwn, const vector<vector<bool> >& up) {
+	static void combinedSimulation(BitRelation& dst, const BitRelation& dwn, const BitRelation& up) {
 		size_t size = dwn.size();
-		vector<vector<bool> > dut(size, vector<bool>(size, false));
+		// dut[i][j] iff there is k such that dwn[i][k] and up[j][k]
+		BitRelation dut(size);
 		for (size_t i = 0; i < size; ++i) {
 			for (size_t j = 0; j < size; ++j) {
-				for (size_t k = 0; k < size; ++k) {
-					if (dwn[i][k] && up[j][k]) {
-						dut[i][j] = true;
-						break;
-					}
-				}
+				if (dwn.rowsIntersect(i, up, j))
+					dut.set(i, j);
 			}
 		}
-		dst = dut;
+		// keep dst[i][j] iff each k such that dwn[j][k] satisfies dut[i][k]
+		BitRelation tmp(dut);
 		for (size_t i = 0; i < size; ++i) {
 			for (size_t j = 0; j < size; ++j) {
-				if (!dst[i][j])
-					continue;
-				for (size_t k = 0; k < size; ++k) {
-					if (dwn[j][k] && !dut[i][k]) {
-						dst[i][j] = false;
-						break;
-					}
-				}
+				if (tmp.get(i, j) && !dwn.rowSubseteq(j, dut, i))
+					tmp.reset(i, j);
 			}
 		}
+		dst.swap(tmp);
 	}
 
 	template <class F>
@@ -781,7 +793,7 @@ public:
 	}
 */
 	template <class F>
-	static bool transMatch(const TT<T>* t1, const TT<T>* t2, F f, const std::vector<std::vector<bool> >& mat, const Index<size_t>& stateIndex) {
+	static bool transMatch(const TT<T>* t1, const TT<T>* t2, F f, const BitRelation& mat, const Index<size_t>& stateIndex) {
 
 		if (!f(*t1, *t2))
 			return false;
@@ -791,7 +803,7 @@ public:
 
 		bool match = true;
 		for (size_t m = 0; m < t1->_lhs->first.size(); ++m) {
-			if (!mat[stateIndex[t1->_lhs->first[m]]][stateIndex[t2->_lhs->first[m]]]) {
+			if (!mat.get(stateIndex[t1->_lhs->first[m]], stateIndex[t2->_lhs->first[m]])) {
 				match = false;
 				break;
 			}
@@ -802,12 +814,12 @@ public:
 
 	// currently erases '1' from the relation
 	template <class F>
-	void heightAbstraction(std::vector<std::vector<bool> >& result, size_t height, F f, const Index<size_t>& stateIndex) const {
+	void heightAbstraction(BitRelation& result, size_t height, F f, const Index<size_t>& stateIndex) const {
 
 		td_cache_type cache;
 		this->buildTDCache(cache);
 
-		std::vector<std::vector<bool> > tmp;
+		BitRelation tmp;
 
 		while (height--) {
 			tmp = result;
@@ -819,7 +831,7 @@ public:
 				).first;
 				for (Index<size_t>::iterator k = stateIndex.begin(); k != stateIndex.end(); ++k) {
 					size_t state2 = k->second;
-					if ((state1 == state2) || !tmp[state1][state2])
+					if ((state1 == state2) || !tmp.get(state1, state2))
 						continue;
 					typename td_cache_type::iterator l = cache.insert(
 						std::make_pair(k->first, std::vector<const TT<T>*>())
@@ -836,23 +848,19 @@ public:
 							break;
 					}
 					if (!match)
-						result[state1][state2] = false;
+						result.reset(state1, state2);
 				}
 			}
 		}
 
-		for (size_t i = 0; i < result.size(); ++i) {
-			for (size_t j = 0; j < i; ++j) {
-				if (!result[i][j])
-					result[j][i] = false;
-				if (!result[j][i])
-					result[i][j] = false;
-			}
-		}
+		// keep only the symmetric part of the relation
+		BitRelation inv;
+		result.transposed(inv);
+		result &= inv;
 
 	}
 
-	void predicateAbstraction(std::vector<std::vector<bool> >& result, const TA<T>& predicate, const Index<size_t>& stateIndex) const {
+	void predicateAbstraction(BitRelation& result, const TA<T>& predicate, const Index<size_t>& stateIndex) const {
 		std::vector<size_t> states;
 		this->intersectingStates(states, predicate);
 		std::set<size_t> s;
@@ -862,18 +870,18 @@ public:
 			if (s.count(i) == 1)
 				continue;
 			for (size_t j = 0; j < i; ++j) {
-				result[i][j] = 0;
-				result[j][i] = 0;
+				result.reset(i, j);
+				result.reset(j, i);
 			}
 			for (size_t j = i + 1; j < result.size(); ++j) {
-				result[i][j] = 0;
-				result[j][i] = 0;
+				result.reset(i, j);
+				result.reset(j, i);
 			}
 		}
 	}
 
 	// collapses states according to a given relation
-	TA<T>& collapsed(TA<T>& dst, const vector<vector<bool> >& rel, const Index<size_t>& stateIndex) const {
+	TA<T>& collapsed(TA<T>& dst, const BitRelation& rel, const Index<size_t>& stateIndex) const {
 		std::vector<size_t> headIndex;
 		utils::relBuildClasses(rel, headIndex);
 		// TODO: perhaps improve indexing
@@ -1003,7 +1011,7 @@ public:
 		return dst;
 	}
 
-	TA<T>& downwardSieve(TA<T>& dst, const std::vector<std::vector<bool> >& cons, const Index<size_t>& stateIndex) const {
+	TA<T>& downwardSieve(TA<T>& dst, const BitRelation& cons, const Index<size_t>& stateIndex) const {
 
 		td_cache_type cache;
 		this->buildTDCache(cache);
@@ -1034,38 +1042,86 @@ public:
 
 	}
 
-	TA<T>& minimized(TA<T>& dst, const std::vector<std::vector<bool> >& cons, const Index<size_t>& stateIndex) const {
+	TA<T>& minimized(TA<T>& dst, const BitRelation& cons, const Index<size_t>& stateIndex) const {
 		typename TA<T>::Backend backend;
-		std::vector<vector<bool> > dwn;
+		BitRelation dwn;
 		this->downwardSimulation(dwn, stateIndex);
 		utils::relAnd(dwn, cons, dwn);
 		TA<T> tmp1(backend), tmp2(backend), tmp3(backend);
 		return this->collapsed(tmp1, dwn, stateIndex).uselessFree(tmp2).downwardSieve(tmp3, dwn, stateIndex).unreachableFree(dst);
 	}
 
-	TA<T>& minimizedCombo(TA<T>& dst) const {
+protected:
+
+	// operations remembered in Backend::minCache
+	enum { MIN_DOWNWARD, MIN_COMBO };
+
+	TA<T>& computeMinimized(TA<T>& dst, size_t op) const {
 		Index<size_t> stateIndex;
 		this->buildSortedStateIndex(stateIndex);
+		if (op == MIN_DOWNWARD) {
+			BitRelation cons(stateIndex.size(), true);
+			return this->minimized(dst, cons, stateIndex);
+		}
 		typename TA<T>::Backend backend;
-		std::vector<vector<bool> > dwn;
+		BitRelation dwn;
 		this->downwardSimulation(dwn, stateIndex);
-		std::vector<vector<bool> > up;
+		BitRelation up;
 		this->upwardSimulation(up, stateIndex, dwn);
-		std::vector<vector<bool> > rel;
+		BitRelation rel;
 		TA<T>::combinedSimulation(rel, dwn, up);
 		TA<T> tmp(backend);
-		return this->collapsed(tmp, rel, stateIndex).minimized(dst);
+		return this->collapsed(tmp, rel, stateIndex).computeMinimized(dst, MIN_DOWNWARD);
+	}
+
+	// same as computeMinimized(), but the result is looked up in (and stored to)
+	// the cache of the backend first
+	TA<T>& cachedMinimized(TA<T>& dst, size_t op) const {
+		if (*FA_SIM_DUMP_FILE)
+			this->dumpTimbuk(FA_SIM_DUMP_FILE, (op == MIN_COMBO)?("combo"):("downward"));
+		min_cache_type& cache = this->backend->minCache;
+		if (!cache.enabled())
+			return this->computeMinimized(dst, op);
+		cache_key_type key;
+		this->buildCacheKey(key);
+		key.data.push_back(op);
+		key.data.insert(key.data.end(), this->finalStates.begin(), this->finalStates.end());
+		std::shared_ptr<const TA<T> > res;
+		if (const std::shared_ptr<const TA<T> >* cached = cache.find(key)) {
+			res = *cached;
+		} else {
+			std::shared_ptr<TA<T> > tmp(new TA<T>(*this->backend));
+			this->computeMinimized(*tmp, op);
+			cache.insert(key, tmp);
+			res = tmp;
+		}
+		dst.addFinalStates(res->finalStates);
+		return res->copyTransitions(dst);
+	}
+
+public:
+
+	// the transitions are hash-consed and kept sorted, so the sequence of their
+	// addresses identifies the automaton (up to the final states)
+	void buildCacheKey(cache_key_type& key) const {
+		key.items.assign(this->transitions.begin(), this->transitions.end());
+		key.data.clear();
+	}
+
+	TA<T>& minimizedCombo(TA<T>& dst) const {
+		return this->cachedMinimized(dst, MIN_COMBO);
 	}
 
 	TA<T>& minimized(TA<T>& dst) const {
-		Index<size_t> stateIndex;
-		this->buildSortedStateIndex(stateIndex);
-		std::vector<std::vector<bool> > cons(stateIndex.size(), std::vector<bool>(stateIndex.size(), true));
-		return this->minimized(dst, cons, stateIndex);
+		return this->cachedMinimized(dst, MIN_DOWNWARD);
 	}
 
 	static bool subseteq(const TA<T>& a, const TA<T>& b);
 
+	// appends the automaton to fileName in the Timbuk format, the labels are
+	// named by their index (see bench_simulation.cc)
+	void dumpTimbuk(const char* fileName, const char* name) const;
+
 	template <class F>
 	static TA<T>& rename(TA<T>& dst, const TA<T>& src, F f, bool addFinalStates = true) {
 		std::vector<size_t> lhs;
@@ -1157,7 +1213,7 @@ public:
 		reduce(dst, a, index, offset);
 		aSize = index.size();
 		index.clear();
-		reduce(dst, b, index, aSize, offset);
+		reduce(dst, b, index, aSize + offset);
 		return dst;
 	}
 
@@ -27,6 +27,8 @@
 #include <unordered_set>
 #include <unordered_map>
 
+#include "bitrelation.hh"
+
 #ifndef NDEBUG
 #define CL_CDEBUG(l, x) CL_DEBUG_AT(l, x)
 #define CL_CDEBUG_MSG(l, x) CL_DEBUG_MSG_AT(l, x)
@@ -212,13 +214,13 @@ class utils {
 public:
 	
 	// build equivalence classes
-	static void relBuildClasses(const std::vector<std::vector<bool> >& rel, std::vector<size_t>& headIndex) {
+	static void relBuildClasses(const BitRelation& rel, std::vector<size_t>& headIndex) {
 		headIndex.resize(rel.size());
 		std::vector<size_t> head;
 		for (size_t i = 0; i < rel.size(); ++i) {
 			bool found = false;
 			for (size_t j = 0; j < head.size(); ++j) {
-				if (rel[i][head[j]] && rel[head[j]][i]) {
+				if (rel.get(i, head[j]) && rel.get(head[j], i)) {
 					headIndex[i] = head[j];
 					found = true;
 					break;
@@ -232,13 +234,13 @@ public:
 	}
 
 	// build equivalence classes
-	static void relBuildClasses(const std::vector<std::vector<bool> >& rel, std::vector<size_t>& index, std::vector<size_t>& head) {
+	static void relBuildClasses(const BitRelation& rel, std::vector<size_t>& index, std::vector<size_t>& head) {
 		index.resize(rel.size());
 		head.clear();
 		for (size_t i = 0; i < rel.size(); ++i) {
 			bool found = false;
 			for (size_t j = 0; j < head.size(); ++j) {
-				if (rel[i][head[j]] && rel[head[j]][i]) {
+				if (rel.get(i, head[j]) && rel.get(head[j], i)) {
 					index[i] = j;
 					found = true;
 					break;
@@ -252,31 +254,23 @@ public:
 	}
 
 	// and composition
-	static void relAnd(std::vector<std::vector<bool> >& dst, const std::vector<std::vector<bool> >& src1, const std::vector<std::vector<bool> >& src2) {
-		dst.resize(src1.size(), std::vector<bool>(src1.size()));
-		for (size_t i = 0; i < src1.size(); ++i) {
-			for (size_t j = 0; j < src1.size(); ++j)
-				dst[i][j] = src1[i][j] && src2[i][j];
-		}
+	static void relAnd(BitRelation& dst, const BitRelation& src1, const BitRelation& src2) {
+		BitRelation tmp(src1);
+		tmp &= src2;
+		dst.swap(tmp);
 	}
 	
 	// transposition
-	static void relInv(std::vector<std::vector<bool> >& dst, const std::vector<std::vector<bool> >& src) {
-		dst.resize(src.size(), std::vector<bool>(src.size()));
-		for (size_t i = 0; i < src.size(); ++i) {
-			for (size_t j = 0; j < src.size(); ++j)
-				dst[j][i] = src[i][j];
-		}
+	static void relInv(BitRelation& dst, const BitRelation& src) {
+		src.transposed(dst);
 	}
 
 	// relation index
-	static void relIndex(std::vector<std::vector<size_t> >& dst, const std::vector<std::vector<bool> >& src) {
+	static void relIndex(std::vector<std::vector<size_t> >& dst, const BitRelation& src) {
 		dst.resize(src.size());
 		for (size_t i = 0; i < src.size(); ++i) {
-			for (size_t j = 0; j < src.size(); ++j) {
-				if (src[i][j])
-					dst[i].push_back(j);					
-			}
+			std::vector<size_t>& row = dst[i];
+			src.forEachInRow(i, [&row](size_t j) { row.push_back(j); });
 		}
 	}
 
@@ -356,13 +350,8 @@ public:
 	}
 
 	// print
-	static std::ostream& relPrint(std::ostream& os, const std::vector<std::vector<bool> >& src) {
-		for (size_t i = 0; i < src.size(); ++i) {
-			for (size_t j = 0; j < src.size(); ++j)
-				os << src[i][j];
-			os << std::endl;
-		}
-		return os;
+	static std::ostream& relPrint(std::ostream& os, const BitRelation& src) {
+		return os << src;
 	}
 
 	template <class T>
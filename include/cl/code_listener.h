@@ -124,6 +124,13 @@ struct cl_init_data {
  */
 void cl_global_init(struct cl_init_data *init_data);
 
+/**
+ * read back the collection of call-backs currently used to print messages
+ * @param init_data - where to store the call-backs (and debugging level)
+ * @note This is useful to chain custom call-backs with the current ones.
+ */
+void cl_global_get_init_data(struct cl_init_data *init_data);
+
 /**
  * global initialization - it sets built-in functions to print messages
  * @param app_name - name of the application which appears in all messages. If
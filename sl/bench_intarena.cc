@@ -0,0 +1,404 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file bench_intarena.cc
+ * micro-benchmark of IntervalArena against its original implementation, the
+ * results of both implementations are cross-checked along the way
+ */
+
+#include "intarena.hh"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+// CL_BREAK_IF() in debug builds prints it, the bench is not linked with version.c
+const char *GIT_SHA1 = "bench_intarena";
+
+#define LA_AGGRESSIVE_OPTIMIZATION          0
+
+/// the original implementation of IntervalArena (std::map of std::map)
+template <typename TInt, typename TObj>
+class LegacyArena {
+    public:
+        typedef std::set<TObj>                      TSet;
+
+        // for compatibility with STL
+        typedef std::pair<TInt, TInt>               key_type;
+        typedef std::pair<key_type, TObj>           value_type;
+
+    private:
+        typedef std::set<TObj>                      TLeaf;
+        typedef std::map</* beg */ TInt, TLeaf>     TLine;
+        typedef std::map</* end */ TInt, TLine>     TCont;
+        TCont                                       cont_;
+
+    public:
+        void add(const key_type &, const TObj);
+        void sub(const key_type &, const TObj);
+        void intersects(TSet &dst, const key_type &key) const;
+        void exactMatch(TSet &dst, const key_type &key) const;
+
+        void clear() {
+            cont_.clear();
+        }
+
+        LegacyArena& operator+=(const value_type &item) {
+            this->add(item.first, item.second);
+            return *this;
+        }
+
+        LegacyArena& operator-=(const value_type &item) {
+            this->sub(item.first, item.second);
+            return *this;
+        }
+};
+
+template <typename TInt, typename TObj>
+void LegacyArena<TInt, TObj>::add(const key_type &key, const TObj obj)
+{
+    const TInt beg = key.first;
+    const TInt end = key.second;
+    CL_BREAK_IF(end <= beg);
+
+    cont_[end][beg].insert(obj);
+}
+
+template <typename TInt, typename TObj>
+void LegacyArena<TInt, TObj>::sub(const key_type &key, const TObj obj)
+{
+    const TInt winBeg = key.first;
+    const TInt winEnd = key.second;
+    CL_BREAK_IF(winEnd <= winBeg);
+
+    std::vector<value_type> recoverList;
+
+    const typename TCont::iterator itEnd = cont_.end();
+    typename TCont::iterator it =
+        cont_.lower_bound(winBeg + /* right-open interval given as key */ 1);
+
+    while (itEnd != it) {
+        TLine &line = it->second;
+#if !LA_AGGRESSIVE_OPTIMIZATION
+        if (line.empty()) {
+            // skip orphans
+            ++it;
+            continue;
+        }
+#endif
+        typename TLine::iterator lineIt = line.begin();
+        TInt beg = lineIt->first;
+        if (winEnd <= beg) {
+            // we are beyond the window already
+            ++it;
+            continue;
+        }
+
+        const TInt end = it->first;
+        bool anyHit = false;
+
+        const typename TLine::iterator lineItEnd = line.end();
+        do {
+            // make sure the basic window axioms hold
+            CL_BREAK_IF(winEnd <= beg);
+            CL_BREAK_IF(end <= winBeg);
+
+            // remove the object from the current leaf (if found)
+            TLeaf &os = lineIt->second;
+            if (os.erase(obj)) {
+                anyHit = true;
+
+                if (beg < winBeg) {
+                    // schedule "the part above" for re-insertion
+                    const key_type key(beg, winBeg);
+                    const value_type item(key, obj);
+                    recoverList.push_back(item);
+                }
+            }
+
+#if LA_AGGRESSIVE_OPTIMIZATION
+            if (os.empty())
+                // FIXME: Can we remove items from std::map during traversal??
+                line.erase(lineIt++);
+            else
+#endif
+            ++lineIt;
+
+            if (lineItEnd == lineIt)
+                // end of line
+                break;
+
+            beg = lineIt->first;
+        }
+        while (beg < winEnd);
+
+        if (anyHit) {
+            if (winEnd < end) {
+                // schedule "the part beyond" for re-insertion
+                const key_type key(winEnd, end);
+                const value_type item(key, obj);
+                recoverList.push_back(item);
+            }
+
+#if LA_AGGRESSIVE_OPTIMIZATION
+            if (line.empty()) {
+                // FIXME: Can we remove items from std::map during traversal??
+                cont_.erase(it++);
+                continue;
+            }
+#endif
+        }
+
+        ++it;
+    }
+
+    // go through the recoverList and re-insert the missing parts
+    BOOST_FOREACH(const value_type &rItem, recoverList) {
+        const key_type &key = rItem.first;
+        const TObj obj = rItem.second;
+        const TInt beg = key.first;
+        const TInt end = key.second;
+
+        cont_[end][beg].insert(obj);
+    }
+}
+
+template <typename TInt, typename TObj>
+void LegacyArena<TInt, TObj>::intersects(TSet &dst, const key_type &key) const
+{
+    const TInt winBeg = key.first;
+    const TInt winEnd = key.second;
+    CL_BREAK_IF(winEnd <= winBeg);
+
+    typename TCont::const_iterator it =
+        cont_.lower_bound(winBeg + /* right-open interval given as key */ 1);
+
+    for (; cont_.end() != it; ++it) {
+        const TLine &line = it->second;
+#if !LA_AGGRESSIVE_OPTIMIZATION
+        if (line.empty())
+            // skip orphans
+            continue;
+#endif
+        typename TLine::const_iterator lineIt = line.begin();
+        TInt beg = lineIt->first;
+        if (winEnd <= beg)
+            // we are beyond the window already
+            continue;
+
+        const typename TLine::const_iterator lineItEnd = line.end();
+        do {
+            // make sure the basic window axioms hold
+            CL_BREAK_IF(winEnd <= beg);
+            CL_BREAK_IF(/* end */ it->first <= winBeg);
+
+            const TLeaf &os = lineIt->second;
+            std::copy(os.begin(), os.end(), std::inserter(dst, dst.begin()));
+
+            // increment for next wheel
+            if (lineItEnd == ++lineIt)
+                // end of line
+                break;
+
+            beg = lineIt->first;
+        }
+        while (beg < winEnd);
+    }
+}
+
+template <typename TInt, typename TObj>
+void LegacyArena<TInt, TObj>::exactMatch(TSet &dst, const key_type &key) const
+{
+    typedef typename TCont::const_iterator TEndIt;
+    const TEndIt itEnd = cont_.find(/* end */ key.second);
+    if (cont_.end() == itEnd)
+        // upper bound not found
+        return;
+
+    const TLine &line = itEnd->second;
+    const typename TLine::const_iterator itBeg = line.find(/* beg */ key.first);
+    if (line.end() == itBeg)
+        // lower bound not found
+        return;
+
+    const TLeaf &leaf = itBeg->second;
+    std::copy(leaf.begin(), leaf.end(), std::inserter(dst, dst.begin()));
+}
+
+
+namespace {
+
+typedef long                                TInt;
+typedef int                                 TObj;
+typedef std::pair<TInt, TInt>               TKey;
+typedef std::set<TObj>                      TSet;
+
+int cntErrors;
+
+/// one layout of a root entity to benchmark the arena with
+struct Layout {
+    const char                 *name;
+    int                         cntFields;
+    TInt                        fieldSize;
+    bool                        uniBlock;
+};
+
+const Layout layouts[] = {
+    { "struct, 16 fields",                  16,      8, false },
+    { "struct, 256 fields",                 256,     8, false },
+    { "struct, 256 fields + calloc()",      256,     8, true  },
+    { "array, 4096 items",                  4096,    4, false },
+    { "array, 4096 items + calloc()",       4096,    4, true  }
+};
+
+template <class TArena>
+void fill(TArena &arena, const Layout &lay) {
+    const TInt size = lay.cntFields * lay.fieldSize;
+    if (lay.uniBlock)
+        arena += typename TArena::value_type(TKey(0, size), /* obj */ 0);
+
+    for (int i = 0; i < lay.cntFields; ++i) {
+        const TInt beg = i * lay.fieldSize;
+        const TKey key(beg, beg + lay.fieldSize);
+        arena += typename TArena::value_type(key, /* obj */ i + 1);
+    }
+}
+
+/// a typical mix of operations performed by SymHeapCore on a root entity
+template <class TArena>
+size_t workload(TArena &arena, const Layout &lay, const int rounds) {
+    size_t hits = 0;
+    const TInt size = lay.cntFields * lay.fieldSize;
+
+    for (int r = 0; r < rounds; ++r) {
+        // copy-on-write clone of the root entity
+        TArena copy(arena);
+
+        for (int i = 0; i < lay.cntFields; ++i) {
+            const TInt beg = i * lay.fieldSize;
+            const TKey key(beg, beg + lay.fieldSize);
+
+            if (!(i % 4)) {
+                // rewrite the field in between the lookups as setValueOf() does
+                copy -= typename TArena::value_type(key, /* obj */ i + 1);
+                copy += typename TArena::value_type(key, /* obj */ i + 1);
+            }
+
+            // overlap query as done by setValueOf()
+            TSet overlaps;
+            copy.intersects(overlaps, key);
+            hits += overlaps.size();
+
+            // exact match as done by objAt()
+            TSet exact;
+            copy.exactMatch(exact, key);
+            hits += exact.size();
+        }
+
+        // carve a field out of the uniform block and put it back
+        const TInt mid = (lay.cntFields / 2) * lay.fieldSize;
+        const TKey key(mid, mid + lay.fieldSize);
+        copy -= typename TArena::value_type(key, /* obj */ 0);
+        copy += typename TArena::value_type(key, /* obj */ 0);
+
+        TSet all;
+        copy.intersects(all, TKey(0, size));
+        hits += all.size();
+    }
+
+    return hits;
+}
+
+void crossCheck(const Layout &lay) {
+    IntervalArena<TInt, TObj> arena;
+    LegacyArena<TInt, TObj> legacy;
+    fill(arena, lay);
+    fill(legacy, lay);
+
+    const TInt size = lay.cntFields * lay.fieldSize;
+    srand(lay.cntFields);
+
+    for (int i = 0; i < 0x100; ++i) {
+        TInt beg = rand() % size;
+        TInt end = beg + 1 + rand() % (4 * lay.fieldSize);
+        const TKey key(beg, end);
+        const TObj obj = rand() % (lay.cntFields + 1);
+
+        if (i & 1) {
+            arena -= std::make_pair(key, obj);
+            legacy -= std::make_pair(key, obj);
+        }
+        else if (i & 2) {
+            arena += std::make_pair(key, obj);
+            legacy += std::make_pair(key, obj);
+        }
+
+        TSet s1, s2;
+        arena.intersects(s1, key);
+        legacy.intersects(s2, key);
+        if (s1 != s2)
+            ++cntErrors;
+
+        s1.clear();
+        s2.clear();
+        arena.exactMatch(s1, key);
+        legacy.exactMatch(s2, key);
+        if (s1 != s2)
+            ++cntErrors;
+    }
+}
+
+template <class TArena>
+double measure(const Layout &lay, size_t *pHits) {
+    TArena arena;
+    fill(arena, lay);
+
+    const int rounds = 1 + 0x8000 / lay.cntFields;
+    const clock_t start = clock();
+    *pHits = workload(arena, lay, rounds);
+    return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+}
+
+} // namespace
+
+int main() {
+    BOOST_FOREACH(const Layout &lay, layouts) {
+        crossCheck(lay);
+
+        size_t hitsNew, hitsOld;
+        const double tNew = measure<IntervalArena<TInt, TObj> >(lay, &hitsNew);
+        const double tOld = measure<LegacyArena<TInt, TObj> >(lay, &hitsOld);
+        if (hitsNew != hitsOld)
+            ++cntErrors;
+
+        std::cout << lay.name
+            << ": legacy " << tOld << " s"
+            << ", flat " << tNew << " s"
+            << std::endl;
+    }
+
+    if (cntErrors)
+        std::cerr << "error: " << cntErrors << " mismatch(es) detected\n";
+
+    return !!cntErrors;
+}
@@ -0,0 +1,673 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file bench_intrange.cc
+ * differential test and micro-benchmark of the inline IR::Range kernel against
+ * its original implementation
+ */
+
+#include "intrange.hh"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+using IR::TInt;
+using IR::TUInt;
+using IR::Range;
+using IR::Int0;
+using IR::Int1;
+using IR::IntMin;
+using IR::IntMax;
+using IR::RzMin;
+using IR::RzMax;
+
+/// the original implementation of IR::Range operations (without the checks)
+namespace Legacy {
+
+TInt greatestCommonDivisor(TInt a, TInt b) {
+    if (a < Int0)
+        a = -a;
+    if (b < Int0)
+        b = -b;
+
+    while (a != b) {
+        if (a < b)
+            b -= a;
+        else
+            a -= b;
+    }
+
+    return a;
+}
+
+Range join(const Range &rng1, const Range &rng2) {
+    Range result;
+    result.lo = std::min(rng1.lo, rng2.lo);
+    result.hi = std::max(rng1.hi, rng2.hi);
+    result.alignment = Int1;
+    return result;
+}
+
+bool isCovered(const Range &small, const Range &big) {
+    return (big.lo <= small.lo)
+        && (small.hi <= big.hi)
+        && (Int1 == big.alignment || big.alignment ==
+                greatestCommonDivisor(small.alignment, big.alignment));
+}
+
+TInt invertInt(const TInt num) {
+    if (IntMin == num)
+        return IntMax;
+    else if (IntMax == num)
+        return IntMin;
+    else
+        return -num;
+}
+
+Range neg(Range rng) {
+    const TInt hi = invertInt(rng.lo);
+    rng.lo = invertInt(rng.hi);
+    rng.hi = hi;
+    return rng;
+}
+
+enum EIntBinOp {
+    IBO_ADD,
+    IBO_MUL,
+    IBO_LSHIFT,
+    IBO_RSHIFT
+};
+
+void intBinOp(TInt *pDst, const TInt other, const EIntBinOp code) {
+    switch (code) {
+        case IBO_ADD:
+            (*pDst) += other;
+            break;
+
+        case IBO_MUL:
+            (*pDst) *= other;
+            break;
+
+        case IBO_LSHIFT:
+            (*pDst) <<= other;
+            break;
+
+        case IBO_RSHIFT:
+            (*pDst) >>= other;
+            break;
+    }
+}
+
+void rngBinOp(Range &rng, const Range &other, const EIntBinOp code) {
+    if (IntMin != rng.lo) {
+        if (IntMin == other.lo)
+            rng.lo = IntMin;
+        else
+            intBinOp(&rng.lo, other.lo, code);
+    }
+
+    if (IntMax != rng.hi) {
+        if (IntMax == other.hi)
+            rng.hi = IntMax;
+        else
+            intBinOp(&rng.hi, other.hi, code);
+    }
+}
+
+TInt alignmentOf(const Range &rng) {
+    if (rng.lo != rng.hi)
+        return rng.alignment;
+
+    const TInt num = rng.lo;
+    if (!num)
+        return Int1;
+    else if (num < Int0)
+        return -num;
+    else
+        return num;
+}
+
+Range add(Range rng, const Range &other) {
+    const TInt al1 = Legacy::alignmentOf(rng);
+    const TInt al2 = Legacy::alignmentOf(other);
+
+    rngBinOp(rng, other, IBO_ADD);
+
+    rng.alignment = Int1;
+    if (rng.lo != rng.hi)
+        rng.alignment = greatestCommonDivisor(al1, al2);
+
+    return rng;
+}
+
+Range sub(const Range &rng, const Range &other) {
+    return add(rng, neg(other));
+}
+
+Range mul(Range rng, const Range &other) {
+    TInt coef = Int1;
+    const bool isRange1 = (rng.lo != rng.hi);
+    const bool isRange2 = (other.lo != other.hi);
+    if (isRange1 != isRange2)
+        coef = (isRange1) ? other.lo : rng.lo;
+
+    if (Int0 == coef)
+        coef = Int1;
+    else if (coef < Int0)
+        coef = -coef;
+
+    rngBinOp(rng, other, IBO_MUL);
+
+    if (rng.lo == rng.hi)
+        rng.alignment = Int1;
+    else {
+        rng.alignment *= other.alignment;
+        rng.alignment *= coef;
+    }
+
+    return rng;
+}
+
+Range shl(Range rng, const TUInt n) {
+    rngBinOp(rng, IR::rngFromNum(n), IBO_LSHIFT);
+    rng.alignment = Int1;
+    return rng;
+}
+
+Range shr(Range rng, const TUInt n) {
+    rngBinOp(rng, IR::rngFromNum(n), IBO_RSHIFT);
+    rng.alignment = Int1;
+    return rng;
+}
+
+} // namespace Legacy
+
+namespace {
+
+// exact arithmetic used to decide whether a result is sound
+__extension__ typedef __int128              TWide;
+
+int cntErrors;
+
+enum EOp {
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_SHL,
+    OP_SHR
+};
+
+const char *opNames[] = {
+    "+",
+    "-",
+    "*",
+    "<<",
+    ">>"
+};
+
+std::ostream& operator<<(std::ostream &str, const Range &rng) {
+    return str << "[" << rng.lo << ", " << rng.hi
+        << "] / " << rng.alignment;
+}
+
+void reportError(
+        const char                 *what,
+        const EOp                   op,
+        const Range                &rng1,
+        const Range                &rng2,
+        const Range                &result)
+{
+    if (++cntErrors < 0x10)
+        std::cerr << "error: " << what << ": " << rng1 << " " << opNames[op]
+            << " " << rng2 << " = " << result << "\n";
+}
+
+/// the same conditions as checked by IR::chkRange(), but returns a bool
+bool isValid(const Range &rng) {
+    if (IntMin != rng.lo && (rng.lo < RzMin || RzMax < rng.lo))
+        return false;
+    if (IntMax != rng.hi && (rng.hi < RzMin || RzMax < rng.hi))
+        return false;
+    if (IntMax == rng.lo || IntMin == rng.hi || rng.hi < rng.lo)
+        return false;
+    if (rng.alignment < Int1)
+        return false;
+    if (IntMin != rng.lo && rng.lo % rng.alignment)
+        return false;
+    if (IntMax != rng.hi && rng.hi % rng.alignment)
+        return false;
+    if (IntMin != rng.lo && IntMax != rng.hi
+            && 1 + rng.hi - rng.lo < rng.alignment)
+        return false;
+
+    return true;
+}
+
+/// true if the exact value is represented by the given range
+bool contains(const Range &rng, const TWide val) {
+    if (IntMin != rng.lo && val < rng.lo)
+        return false;
+    if (IntMax != rng.hi && rng.hi < val)
+        return false;
+
+    return !(val % rng.alignment);
+}
+
+/// compute the exact result of the operation on two concrete values
+TWide exactOp(const EOp op, const TWide a, const TWide b) {
+    switch (op) {
+        case OP_ADD:
+            return a + b;
+
+        case OP_SUB:
+            return a - b;
+
+        case OP_MUL:
+            return a * b;
+
+        case OP_SHL:
+            return a * (static_cast<TWide>(1) << b);
+
+        case OP_SHR:
+            return a >> b;
+    }
+
+    return 0;
+}
+
+Range newOp(const EOp op, const Range &rng1, const Range &rng2) {
+    switch (op) {
+        case OP_ADD:
+            return rng1 + rng2;
+
+        case OP_SUB:
+            return rng1 - rng2;
+
+        case OP_MUL:
+            return rng1 * rng2;
+
+        case OP_SHL:
+            return rng1 << rng2.lo;
+
+        case OP_SHR:
+            return rng1 >> rng2.lo;
+    }
+
+    return IR::FullRange;
+}
+
+Range legacyOp(const EOp op, const Range &rng1, const Range &rng2) {
+    switch (op) {
+        case OP_ADD:
+            return Legacy::add(rng1, rng2);
+
+        case OP_SUB:
+            return Legacy::sub(rng1, rng2);
+
+        case OP_MUL:
+            return Legacy::mul(rng1, rng2);
+
+        case OP_SHL:
+            return Legacy::shl(rng1, rng2.lo);
+
+        case OP_SHR:
+            return Legacy::shr(rng1, rng2.lo);
+    }
+
+    return IR::FullRange;
+}
+
+/// concrete values of a finite range, or a few samples of an infinite one
+void samplesOf(std::vector<TWide> &dst, const Range &rng) {
+    dst.clear();
+
+    const TInt al = rng.alignment;
+    if (IntMin != rng.lo && IntMax != rng.hi && rng.hi - rng.lo <= 0x40 * al) {
+        // enumerate all the values
+        for (TInt i = rng.lo; i <= rng.hi; i += al)
+            dst.push_back(i);
+
+        return;
+    }
+
+    // lower end of the range
+    const TWide lo = (IntMin == rng.lo)
+        ? static_cast<TWide>(RzMin) * 2 / al * al
+        : static_cast<TWide>(rng.lo);
+
+    // upper end of the range
+    const TWide hi = (IntMax == rng.hi)
+        ? static_cast<TWide>(RzMax) * 2 / al * al
+        : static_cast<TWide>(rng.hi);
+
+    for (int i = 0; i < 4; ++i) {
+        dst.push_back(lo + i * al);
+        dst.push_back(hi - i * al);
+    }
+
+    dst.push_back(/* somewhere in the middle */ (lo / 2 + hi / 2) / al * al);
+}
+
+/// check that the result of the new implementation is a valid and sound range
+bool checkSound(
+        const EOp                   op,
+        const Range                &rng1,
+        const Range                &rng2,
+        const Range                &result)
+{
+    if (!isValid(result)) {
+        reportError("invalid result", op, rng1, rng2, result);
+        return false;
+    }
+
+    std::vector<TWide> samples1, samples2;
+    samplesOf(samples1, rng1);
+    samplesOf(samples2, rng2);
+
+    BOOST_FOREACH(const TWide a, samples1) {
+        BOOST_FOREACH(const TWide b, samples2) {
+            if (contains(result, exactOp(op, a, b)))
+                continue;
+
+            reportError("unsound result", op, rng1, rng2, result);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// check the new implementation, compare with the old one if that one is sound
+void crossCheck(const EOp op, const Range &rng1, const Range &rng2) {
+    const Range result = newOp(op, rng1, rng2);
+    if (!checkSound(op, rng1, rng2, result))
+        return;
+
+    const Range legacy = legacyOp(op, rng1, rng2);
+    if (!isValid(legacy))
+        // the original implementation cannot handle this case
+        return;
+
+    std::vector<TWide> samples1, samples2;
+    samplesOf(samples1, rng1);
+    samplesOf(samples2, rng2);
+
+    BOOST_FOREACH(const TWide a, samples1)
+        BOOST_FOREACH(const TWide b, samples2)
+            if (!contains(legacy, exactOp(op, a, b)))
+                // the original implementation is not sound here
+                return;
+
+    // singular ranges are not aligned, so check the number itself in that case
+    const bool covered = (result.lo == result.hi)
+        ? contains(legacy, result.lo)
+        : IR::isCovered(result, legacy);
+
+    if (!covered)
+        reportError("less precise than legacy", op, rng1, rng2, result);
+}
+
+/// all valid ranges in [-lim, lim], including infinite bounds if requested
+void genRanges(std::vector<Range> &dst, const TInt lim, const bool infinite) {
+    std::vector<TInt> los, his;
+    if (infinite) {
+        los.push_back(IntMin);
+        his.push_back(IntMax);
+    }
+
+    for (TInt i = -lim; i <= lim; ++i) {
+        los.push_back(i);
+        his.push_back(i);
+    }
+
+    BOOST_FOREACH(const TInt lo, los) {
+        BOOST_FOREACH(const TInt hi, his) {
+            for (TInt al = Int1; al <= 4; ++al) {
+                Range rng;
+                rng.lo = lo;
+                rng.hi = hi;
+                rng.alignment = al;
+                if (isValid(rng) && (lo != hi || Int1 == al))
+                    dst.push_back(rng);
+            }
+        }
+    }
+}
+
+/// exhaustive check of all pairs of small ranges
+void exhaustiveCheck() {
+    std::vector<Range> ranges;
+    genRanges(ranges, /* lim */ 6, /* infinite */ true);
+
+    BOOST_FOREACH(const Range &rng1, ranges) {
+        BOOST_FOREACH(const Range &rng2, ranges) {
+            crossCheck(OP_ADD, rng1, rng2);
+            crossCheck(OP_SUB, rng1, rng2);
+            crossCheck(OP_MUL, rng1, rng2);
+
+            if (Legacy::join(rng1, rng2) != IR::join(rng1, rng2))
+                reportError("join mismatch", OP_ADD, rng1, rng2,
+                        IR::join(rng1, rng2));
+
+            if (Legacy::isCovered(rng1, rng2) != IR::isCovered(rng1, rng2))
+                reportError("isCovered() mismatch", OP_ADD, rng1, rng2,
+                        rng1);
+        }
+
+        for (TInt n = Int0; n < 8; ++n) {
+            crossCheck(OP_SHL, rng1, IR::rngFromNum(n));
+            crossCheck(OP_SHR, rng1, IR::rngFromNum(n));
+        }
+    }
+}
+
+/// true if the bound is either taken from rngOld, a threshold, or infinity
+bool isWideningBound(
+        const TInt                  bound,
+        const TInt                  old,
+        const TInt                  inf,
+        const IR::TThresholds      &thrs)
+{
+    return (old == bound)
+        || (inf == bound)
+        || std::binary_search(thrs.begin(), thrs.end(), bound);
+}
+
+/// exhaustive check of widening with thresholds on small ranges
+void wideningCheck() {
+    IR::TThresholds thrs;
+    thrs.push_back(-3);
+    thrs.push_back(0);
+    thrs.push_back(5);
+
+    std::vector<Range> ranges;
+    genRanges(ranges, /* lim */ 6, /* infinite */ true);
+
+    BOOST_FOREACH(const Range &rngOld, ranges) {
+        BOOST_FOREACH(const Range &rngNew, ranges) {
+            const Range rng = IR::widen(rngOld, rngNew, thrs);
+            if (!isValid(rng)
+                    || !IR::isCovered(rngOld, rng)
+                    || !IR::isCovered(rngNew, rng)
+                    || !isWideningBound(rng.lo, rngOld.lo, IntMin, thrs)
+                    || !isWideningBound(rng.hi, rngOld.hi, IntMax, thrs))
+                reportError("widening failed", OP_ADD, rngOld, rngNew, rng);
+
+            // widening of a stable range has to reach the fixed-point
+            if (IR::isCovered(rngNew, rngOld) && rng != IR::join(rngOld, rngOld))
+                reportError("widening not stable", OP_ADD, rngOld, rngNew, rng);
+        }
+    }
+}
+
+/// random number spread over all magnitudes of the red zone
+TInt randNum() {
+    const int bits = rand() % 62;
+    TInt num = 0;
+    for (int i = 0; i < 4; ++i)
+        num = (num << 16) ^ (rand() & 0xFFFF);
+
+    num &= (Int1 << bits) - 1;
+    return (rand() & 1) ? -num : num;
+}
+
+Range randRange() {
+    switch (rand() % 8) {
+        case 0:
+            return IR::FullRange;
+
+        case 1:
+        case 2:
+            return IR::rngFromNum(randNum());
+
+        default:
+            break;
+    }
+
+    Range rng;
+    rng.alignment = Int1 << (rand() % 4);
+
+    TInt a = randNum() / rng.alignment * rng.alignment;
+    TInt b = randNum() / rng.alignment * rng.alignment;
+    if (b < a)
+        std::swap(a, b);
+    if (a == b)
+        b += rng.alignment;
+
+    rng.lo = (rand() % 8) ? a : IntMin;
+    rng.hi = (rand() % 8) ? b : IntMax;
+    return rng;
+}
+
+/// randomized check of soundness for big numbers where overflows happen
+void randomCheck() {
+    srand(0x1234);
+
+    for (int i = 0; i < 0x10000; ++i) {
+        const Range rng1 = randRange();
+        const Range rng2 = randRange();
+
+        // the original gcd() can loop for ages on big numbers, skip it here
+        checkSound(OP_ADD, rng1, rng2, rng1 + rng2);
+        checkSound(OP_SUB, rng1, rng2, rng1 - rng2);
+        checkSound(OP_MUL, rng1, rng2, rng1 * rng2);
+
+        const Range shift = IR::rngFromNum(rand() % 64);
+        checkSound(OP_SHL, rng1, shift, rng1 << shift.lo);
+        checkSound(OP_SHR, rng1, shift, rng1 >> shift.lo);
+    }
+}
+
+/// a typical mix of operations performed by SymProc on offsets and sizes
+template <class TKernel>
+TInt workload(const std::vector<Range> &ranges, const int rounds) {
+    TInt sum = Int0;
+    const size_t cnt = ranges.size();
+
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < cnt; ++i) {
+            const Range &rng1 = ranges[i];
+            const Range &rng2 = ranges[(i * 7 + r) % cnt];
+
+            const Range res = TKernel::op(rng1, rng2);
+            sum += res.lo ^ res.hi ^ res.alignment;
+        }
+    }
+
+    return sum;
+}
+
+struct NewKernel {
+    static Range op(const Range &rng1, const Range &rng2) {
+        Range res = (rng1 + rng2) * rng2 - rng1;
+        if (IR::isCovered(rng1, rng2))
+            res = IR::join(res, rng1 << 2);
+
+        return res;
+    }
+};
+
+struct LegacyKernel {
+    static Range op(const Range &rng1, const Range &rng2) {
+        Range res = Legacy::sub(Legacy::mul(Legacy::add(rng1, rng2), rng2),
+                rng1);
+        if (Legacy::isCovered(rng1, rng2))
+            res = Legacy::join(res, Legacy::shl(rng1, 2));
+
+        return res;
+    }
+};
+
+template <class TKernel>
+double measure(const std::vector<Range> &ranges, TInt *pSum) {
+    const int rounds = 0x400;
+    const clock_t start = clock();
+    *pSum = workload<TKernel>(ranges, rounds);
+    return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+}
+
+void benchmark() {
+    // non-negative offsets and sizes where both implementations are sound
+    std::vector<Range> ranges;
+    srand(0x4321);
+    for (int i = 0; i < 0x400; ++i) {
+        const TInt lo = (rand() % 0x100) * 8;
+        if (rand() % 2) {
+            ranges.push_back(IR::rngFromNum(lo));
+            continue;
+        }
+
+        Range rng;
+        rng.lo = lo;
+        rng.hi = lo + (1 + rand() % 0x10) * 8;
+        rng.alignment = 8;
+        ranges.push_back(rng);
+    }
+
+    TInt sumNew, sumOld;
+    const double tNew = measure<NewKernel>(ranges, &sumNew);
+    const double tOld = measure<LegacyKernel>(ranges, &sumOld);
+    if (sumNew != sumOld)
+        ++cntErrors;
+
+    std::cout << "offset arithmetic"
+        << ": legacy " << tOld << " s"
+        << ", inline " << tNew << " s"
+        << std::endl;
+}
+
+} // namespace
+
+int main() {
+    exhaustiveCheck();
+    wideningCheck();
+    randomCheck();
+    benchmark();
+
+    if (cntErrors)
+        std::cerr << "error: " << cntErrors << " mismatch(es) detected\n";
+
+    return !!cntErrors;
+}
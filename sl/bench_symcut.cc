@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file bench_symcut.cc
+ * micro-benchmark of splitHeapByCVars() on heaps where the cut keeps a small,
+ * or a dominating part of the heap, the results are cross-checked by joining
+ * the frame back and comparing with the original heap.  The last part times
+ * the whole call/return cycle, i.e. splitHeapByCVars() followed by
+ * joinHeapsByCVars(), for a small cut of a large heap.
+ */
+
+#include "config.h"
+
+#include <cl/code_listener.h>
+#include <cl/storage.hh>
+
+#include "symcmp.hh"
+#include "symcut.hh"
+#include "symheap.hh"
+#include "symtrace.hh"
+
+#include <ctime>
+#include <iostream>
+
+#include <boost/foreach.hpp>
+
+// the entry point of the plug-in (cl_symexec.cc) is not linked with the bench
+void clEasyRun(const CodeStorage::Storage &, const char *) {
+}
+
+namespace {
+
+int cntErrors;
+
+/// count of gl vars, each of them points to a list of its own
+const int cntVars = 0x40;
+
+struct cl_type          ptrType;
+struct cl_type_item     ptrItem;
+
+void initStor(CodeStorage::Storage &stor) {
+    ptrType.uid         = 1;
+    ptrType.code        = CL_TYPE_PTR;
+    ptrType.name        = 0;
+    ptrType.size        = sizeof(void *);
+    ptrType.item_cnt    = 1;
+    ptrType.items       = &ptrItem;
+    ptrItem.type        = &ptrType;
+    ptrItem.name        = 0;
+    ptrItem.offset      = 0;
+    stor.types.insert(&ptrType);
+
+    for (int uid = 1; uid <= cntVars; ++uid) {
+        CodeStorage::Var &var = stor.vars[uid];
+        var.code = CodeStorage::VAR_GL;
+        var.uid  = uid;
+        var.type = &ptrType;
+    }
+}
+
+/// gl var 'uid' points to a NULL-terminated list of the given length
+void buildList(SymHeap &sh, const int uid, const int len) {
+    TValId at = sh.addrOfVar(CVar(uid, 0), /* createIfNeeded */ true);
+    for (int i = 0; i < len; ++i) {
+        const TValId node = sh.heapAlloc(IR::rngFromNum(sizeof(void *)));
+        ObjHandle(sh, at, &ptrType).setValue(node);
+        at = node;
+    }
+
+    ObjHandle(sh, at, &ptrType).setValue(VAL_NULL);
+}
+
+/// one shape of the cut to benchmark splitHeapByCVars() with
+struct Workload {
+    const char                 *name;
+    int                         cntCut;
+};
+
+const Workload workloads[] = {
+    { "cut by 1 of 64 vars",                1  },
+    { "cut by 8 of 64 vars",                8  },
+    { "cut by 48 of 64 vars",               48 },
+    { "cut by 63 of 64 vars",               63 }
+};
+
+void crossCheck(const SymHeap &sh, const TCVarList &cut) {
+    SymHeap part(sh);
+    SymHeap frame(sh.stor(), new Trace::TransientNode("bench_symcut"));
+    splitHeapByCVars(&part, cut, &frame);
+    joinHeapsByCVars(&part, &frame);
+    if (!areEqual(sh, part))
+        ++cntErrors;
+}
+
+double measure(const SymHeap &sh, const TCVarList &cut, const int rounds) {
+    const clock_t start = clock();
+    for (int r = 0; r < rounds; ++r) {
+        SymHeap part(sh);
+        SymHeap frame(sh.stor(), new Trace::TransientNode("bench_symcut"));
+        splitHeapByCVars(&part, cut, &frame);
+    }
+
+    return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/// split and join back, as a call of a fnc that does not change the heap does
+double measureCallRet(const SymHeap &sh, const TCVarList &cut, const int rounds)
+{
+    const clock_t start = clock();
+    for (int r = 0; r < rounds; ++r) {
+        SymHeap part(sh);
+        SymHeap frame(sh.stor(), new Trace::TransientNode("bench_symcut"));
+        splitHeapByCVars(&part, cut, &frame);
+        joinHeapsByCVars(&part, &frame);
+    }
+
+    return static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+}
+
+} // namespace
+
+int main() {
+    CodeStorage::Storage stor;
+    initStor(stor);
+
+    SymHeap sh(stor, new Trace::TransientNode("bench_symcut"));
+    for (int uid = 1; uid <= cntVars; ++uid)
+        buildList(sh, uid, /* len */ 0x20);
+
+    BOOST_FOREACH(const Workload &wl, workloads) {
+        TCVarList cut;
+        for (int uid = 1; uid <= wl.cntCut; ++uid)
+            cut.push_back(CVar(uid, 0));
+
+        crossCheck(sh, cut);
+
+        const double t = measure(sh, cut, /* rounds */ 0x10);
+        std::cout << wl.name << ": " << t << " s" << std::endl;
+    }
+
+    // a small cut of a large heap, the callee sees a list of 4 nodes, while
+    // the frame holds a list of the given length
+    const TCVarList cut(1, CVar(1, 0));
+    for (int len = 0x400; len <= 0x4000; len <<= 2) {
+        SymHeap big(stor, new Trace::TransientNode("bench_symcut"));
+        buildList(big, 1, /* len */ 4);
+        buildList(big, 2, len);
+        crossCheck(big, cut);
+
+        const double t = measureCallRet(big, cut, /* rounds */ 0x10);
+        std::cout << "call/return, 4 of " << (4 + len) << " nodes cut: "
+            << t << " s" << std::endl;
+    }
+
+    if (cntErrors)
+        std::cerr << "error: " << cntErrors << " mismatch(es) detected\n";
+
+    return !!cntErrors;
+}
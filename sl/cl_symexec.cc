@@ -19,21 +19,36 @@
 
 #include "config.h"
 
+#include <cl/code_listener.h>
 #include <cl/easy.hh>
 #include <cl/cl_msg.hh>
 #include <cl/clutil.hh>
 #include <cl/storage.hh>
 
 #include "memdebug.hh"
+#include "plotenum.hh"
 #include "symbt.hh"
 #include "symdump.hh"
 #include "symexec.hh"
 #include "symproc.hh"
+#include "symreport.hh"
 #include "symstate.hh"
 #include "symtrace.hh"
 #include "util.hh"
 
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
 #include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <boost/foreach.hpp>
 
@@ -46,6 +61,14 @@ void parseConfigString(SymExecParams &sep, std::string cnf) {
     if (cnf.empty())
         return;
 
+    const size_t comma = cnf.find(',');
+    if (string::npos != comma) {
+        // comma separated list of parameters
+        parseConfigString(sep, cnf.substr(0, comma));
+        parseConfigString(sep, cnf.substr(comma + 1));
+        return;
+    }
+
     if (string("oom") == cnf) {
         CL_DEBUG("parseConfigString: \"OOM simulation\" mode requested");
         sep.oomSimulation = true;
@@ -58,8 +81,6 @@ void parseConfigString(SymExecParams &sep, std::string cnf) {
         return;
     }
 
-    // TODO: make it possible to handle both parameters together (comma
-    // separated list or whatever)
     // TODO: document all the parameters somewhere
     if (string("noplot") == cnf) {
         CL_DEBUG("parseConfigString: \"noplot\" mode requested");
@@ -73,6 +94,42 @@ void parseConfigString(SymExecParams &sep, std::string cnf) {
         return;
     }
 
+    if (string("dedup_reports") == cnf) {
+        CL_DEBUG("parseConfigString: deduplication of reports requested");
+        sep.dedupReports = true;
+        return;
+    }
+
+    if (string("int_widening") == cnf) {
+        CL_DEBUG("parseConfigString: widening of int ranges requested");
+        sep.intWidening = true;
+        return;
+    }
+
+    if (string("resume") == cnf) {
+        CL_DEBUG("parseConfigString: resume from checkpoint requested");
+        sep.resume = true;
+        return;
+    }
+
+    if (string("sched:fifo") == cnf) {
+        CL_DEBUG("parseConfigString: FIFO block scheduler requested");
+        sep.schedOrder = BSO_FIFO;
+        return;
+    }
+
+    if (string("sched:dfs") == cnf) {
+        CL_DEBUG("parseConfigString: DFS block scheduler requested");
+        sep.schedOrder = BSO_DFS;
+        return;
+    }
+
+    if (string("sched:wto") == cnf) {
+        CL_DEBUG("parseConfigString: WTO block scheduler requested");
+        sep.schedOrder = BSO_WTO;
+        return;
+    }
+
     const char *cstr = cnf.c_str();
     const char *elPrefix = "error_label:";
     const size_t elPrefixLen = strlen(elPrefix);
@@ -83,6 +140,84 @@ void parseConfigString(SymExecParams &sep, std::string cnf) {
         return;
     }
 
+    const char *budgetPrefix = "call_cache_budget:";
+    const size_t budgetPrefixLen = strlen(budgetPrefix);
+    if (!strncmp(cstr, budgetPrefix, budgetPrefixLen)) {
+        cstr += budgetPrefixLen;
+        const long budget = atol(cstr);
+        if (0 < budget) {
+            CL_DEBUG("parseConfigString: call cache budget is "
+                    << budget << " MiB");
+            sep.callCacheBudget = static_cast<size_t>(budget) << 20;
+            return;
+        }
+    }
+
+    const char *sdPrefix = "summary_dir:";
+    const size_t sdPrefixLen = strlen(sdPrefix);
+    if (!strncmp(cstr, sdPrefix, sdPrefixLen)) {
+        cstr += sdPrefixLen;
+        CL_DEBUG("parseConfigString: summary directory is \"" << cstr << "\"");
+        sep.summaryDir = cstr;
+        return;
+    }
+
+    const char *ckPrefix = "checkpoint:";
+    const size_t ckPrefixLen = strlen(ckPrefix);
+    if (!strncmp(cstr, ckPrefix, ckPrefixLen)) {
+        cstr += ckPrefixLen;
+        CL_DEBUG("parseConfigString: checkpoint file is \"" << cstr << "\"");
+        sep.checkpointFile = cstr;
+        return;
+    }
+
+    const char *ciPrefix = "checkpoint_interval:";
+    const size_t ciPrefixLen = strlen(ciPrefix);
+    if (!strncmp(cstr, ciPrefix, ciPrefixLen)) {
+        cstr += ciPrefixLen;
+        const int interval = atoi(cstr);
+        if (0 <= interval) {
+            CL_DEBUG("parseConfigString: checkpoint interval is "
+                    << interval << " s");
+            sep.checkpointInterval = interval;
+            return;
+        }
+    }
+
+    const char *tlPrefix = "trace_level:";
+    const size_t tlPrefixLen = strlen(tlPrefix);
+    if (!strncmp(cstr, tlPrefix, tlPrefixLen)) {
+        cstr += tlPrefixLen;
+        const int level = atoi(cstr);
+        if (Trace::TL_NONE <= level && level <= Trace::TL_FULL) {
+            CL_DEBUG("parseConfigString: trace level is " << level);
+            sep.traceLevel = static_cast<Trace::ETraceLevel>(level);
+            return;
+        }
+    }
+
+    const char *mdPrefix = "mem_dump:";
+    const size_t mdPrefixLen = strlen(mdPrefix);
+    if (!strncmp(cstr, mdPrefix, mdPrefixLen)) {
+        cstr += mdPrefixLen;
+        CL_DEBUG("parseConfigString: memory usage dump file is \""
+                << cstr << "\"");
+        sep.memDumpFile = cstr;
+        return;
+    }
+
+    const char *jobsPrefix = "jobs:";
+    const size_t jobsPrefixLen = strlen(jobsPrefix);
+    if (!strncmp(cstr, jobsPrefix, jobsPrefixLen)) {
+        cstr += jobsPrefixLen;
+        const int cntJobs = atoi(cstr);
+        if (0 < cntJobs) {
+            CL_DEBUG("parseConfigString: " << cntJobs << " job(s) requested");
+            sep.cntJobs = cntJobs;
+            return;
+        }
+    }
+
     CL_WARN("unhandled config string: \"" << cnf << "\"");
 }
 
@@ -140,24 +275,305 @@ void execFnc(const CodeStorage::Fnc &fnc, const SymExecParams &ep,
     }
 }
 
+void plotPendingTraces() {
+    if (!Trace::Globals::alive())
+        return;
+
+    // plot all pending trace graphs
+    Trace::GraphProxy *glProxy = Trace::Globals::instance()->glProxy();
+    glProxy->plotAll();
+
+    // kill Trace::Globals, which may trigger the final trace graph cleanup
+    Trace::Globals::cleanup();
+    printMemUsage("Trace::Globals::cleanup");
+}
+
+void execVirtualRoot(const CodeStorage::Fnc &fnc, const SymExecParams &ep) {
+    CL_BREAK_IF(!isDefined(fnc));
+
+    const struct cl_loc *lw = locationOf(fnc);
+    CL_DEBUG_MSG(lw, nameOf(fnc)
+            << "() is defined, but not called from anywhere");
+
+    // each of the virtual roots is checkpointed into a file of its own
+    SymExecParams epRoot(ep);
+    if (!epRoot.checkpointFile.empty())
+        epRoot.checkpointFile += std::string(".") + nameOf(fnc);
+
+    // perform symbolic execution for a virtual root
+    execFnc(fnc, epRoot);
+    printMemUsage("execFnc");
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// analysis of virtual roots in worker processes
+//
+// Each virtual root is analyzed in a forked process, which gets its own copy
+// of all the global state (Trace::Globals, statistics, etc.), whereas the
+// read-only CodeStorage::Storage is shared with the parent process.  Messages
+// of a worker are recorded into a temporary file and replayed by the parent in
+// the order of virtual roots, so that the output is the same as if the roots
+// were analyzed sequentially.
+namespace {
+    typedef const CodeStorage::Fnc                     *TFnc;
+    typedef std::vector<TFnc>                           TFncList;
+
+    /// where the messages of the current worker process go
+    FILE *jobOutput;
+
+    void jobWrite(const char kind, const char *msg) {
+        fputc(kind, jobOutput);
+        fputs(msg, jobOutput);
+        fputc('\0', jobOutput);
+    }
+
+    void jobDebug(const char *msg) { jobWrite('d', msg); }
+    void jobWarn (const char *msg) { jobWrite('w', msg); }
+    void jobError(const char *msg) { jobWrite('e', msg); }
+    void jobNote (const char *msg) { jobWrite('n', msg); }
+
+    void jobDie(const char *msg) {
+        jobWrite('e', msg);
+        fflush(jobOutput);
+        _exit(EXIT_FAILURE);
+    }
+
+    void jobRun(
+            FILE                            *output,
+            const CodeStorage::Fnc          &fnc,
+            const SymExecParams             &ep)
+    {
+        jobOutput = output;
+
+        struct cl_init_data init;
+        init.debug          = jobDebug;
+        init.warn           = jobWarn;
+        init.error          = jobError;
+        init.note           = jobNote;
+        init.die            = jobDie;
+        init.debug_level    = cl_debug_level();
+        cl_global_init(&init);
+
+        // avoid name clashes of plots from concurrently analyzed roots
+        PlotEnumerator::instance()->setPrefix(std::string(nameOf(fnc)) + "-");
+
+        execVirtualRoot(fnc, ep);
+        plotPendingTraces();
+        Report::printSummary();
+
+        // do not run any destructors/atexit handlers of the host process
+        fflush(output);
+        _exit(EXIT_SUCCESS);
+    }
+
+    void jobReplay(FILE *output) {
+        rewind(output);
+
+        int kind;
+        while (EOF != (kind = fgetc(output))) {
+            std::string msg;
+            int c;
+            while (EOF != (c = fgetc(output)) && c)
+                msg += static_cast<char>(c);
+
+            const char *text = msg.c_str();
+            switch (kind) {
+                case 'd':   cl_debug(text); break;
+                case 'w':   cl_warn (text); break;
+                case 'e':   cl_error(text); break;
+                case 'n':   cl_note (text); break;
+                default:
+                    CL_BREAK_IF("jobReplay() got garbage on input");
+            }
+        }
+    }
+
+    struct Job {
+        FILE                *output;
+        bool                done;
+        bool                ok;
+
+        Job():
+            output(0),
+            done(false),
+            ok(false)
+        {
+        }
+    };
+
+    typedef std::map<pid_t, unsigned /* idx */>         TRunning;
+
+    enum EWaitResult {
+        WR_RUNNING,
+        WR_DONE,
+        WR_FAILED
+    };
+
+    /// wait for the given worker process, retry if interrupted by a signal
+    EWaitResult waitForWorker(Job &job, const pid_t pid, const bool block) {
+        int status;
+        pid_t rv;
+        do
+            rv = waitpid(pid, &status, (block) ? 0 : WNOHANG);
+        while (rv < 0 && EINTR == errno);
+
+        if (!rv)
+            return WR_RUNNING;
+
+        if (rv < 0)
+            return WR_FAILED;
+
+        job.done = true;
+        job.ok = WIFEXITED(status) && !WEXITSTATUS(status);
+        return WR_DONE;
+    }
+
+    /// kill the given worker process and reap it, so that it is not orphaned
+    void killWorker(Job &job, const pid_t pid) {
+        kill(pid, SIGKILL);
+
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && EINTR == errno)
+            ;
+
+        job.done = true;
+        job.ok = false;
+    }
+
+    /// wait until at least one of the running workers finishes
+    bool waitForWorkers(std::vector<Job> &jobs, TRunning &running) {
+        typedef TRunning::const_reference TRef;
+
+        std::vector<pid_t> finished;
+        pid_t oldest = 0;
+        unsigned oldestIdx = UINT_MAX;
+        bool failed = false;
+
+        // collect the workers that have already finished
+        BOOST_FOREACH(TRef item, running) {
+            switch (waitForWorker(jobs[item.second], item.first, false)) {
+                case WR_DONE:
+                    finished.push_back(item.first);
+                    continue;
+
+                case WR_FAILED:
+                    failed = true;
+                    break;
+
+                case WR_RUNNING:
+                    if (item.second < oldestIdx) {
+                        oldest = item.first;
+                        oldestIdx = item.second;
+                    }
+                    continue;
+            }
+
+            break;
+        }
+
+        if (!failed && finished.empty()) {
+            // the messages are replayed in the order of roots, so the oldest
+            // worker is the one that holds the output back
+            if (WR_DONE == waitForWorker(jobs[oldestIdx], oldest, true))
+                finished.push_back(oldest);
+            else
+                failed = true;
+        }
+
+        BOOST_FOREACH(const pid_t pid, finished)
+            running.erase(pid);
+
+        return !failed;
+    }
+
+    /// return count of roots processed, the rest needs to be run sequentially
+    unsigned execVirtualRootsInParallel(
+            const TFncList                  &roots,
+            const SymExecParams             &ep)
+    {
+        const unsigned cnt = roots.size();
+        std::vector<Job> jobs(cnt);
+        TRunning running;
+        unsigned next = 0;
+        unsigned flushed = 0;
+        bool forkFailed = false;
+
+        while (flushed < next || (!forkFailed && next < cnt)) {
+            // start as many workers as allowed
+            while (!forkFailed && next < cnt && running.size() < ep.cntJobs) {
+                FILE *output = tmpfile();
+                if (!output) {
+                    CL_WARN("tmpfile() failed, analyzing sequentially");
+                    forkFailed = true;
+                    break;
+                }
+
+                // make sure the buffered output is not written twice
+                fflush(0);
+
+                const pid_t pid = fork();
+                if (pid < 0) {
+                    CL_WARN("fork() failed, analyzing sequentially");
+                    fclose(output);
+                    forkFailed = true;
+                    break;
+                }
+
+                if (!pid)
+                    // worker process, this never returns
+                    jobRun(output, *roots[next], ep);
+
+                jobs[next].output = output;
+                running[pid] = next++;
+            }
+
+            if (!running.empty() && !waitForWorkers(jobs, running)) {
+                // unable to wait for the workers, give up on them
+                CL_WARN("waitpid() failed, killing the worker processes");
+                typedef TRunning::const_reference TRef;
+                BOOST_FOREACH(TRef item, running)
+                    killWorker(jobs[item.second], item.first);
+
+                running.clear();
+                forkFailed = true;
+            }
+
+            // replay the messages of finished workers in the order of roots
+            while (flushed < next && jobs[flushed].done) {
+                Job &job = jobs[flushed];
+                jobReplay(job.output);
+                fclose(job.output);
+
+                if (!job.ok) {
+                    const CodeStorage::Fnc &fnc = *roots[flushed];
+                    CL_ERROR_MSG(locationOf(fnc), "worker process analyzing "
+                            << nameOf(fnc) << "() has not finished properly");
+                }
+
+                ++flushed;
+            }
+        }
+
+        return flushed;
+    }
+}
+
 void execVirtualRoots(const CodeStorage::Storage &stor, const SymExecParams &ep)
 {
     namespace CG = CodeStorage::CallGraph;
 
     // go through all root nodes
+    TFncList roots;
     const CG::Graph &cg = stor.callGraph;
-    BOOST_FOREACH(const CG::Node *node, cg.roots) {
-        const CodeStorage::Fnc &fnc = *node->fnc;
-        CL_BREAK_IF(!isDefined(fnc));
+    BOOST_FOREACH(const CG::Node *node, cg.roots)
+        roots.push_back(node->fnc);
 
-        const struct cl_loc *lw = locationOf(fnc);
-        CL_DEBUG_MSG(lw, nameOf(fnc)
-                << "() is defined, but not called from anywhere");
+    unsigned idx = 0;
+    if (1 < ep.cntJobs && 1 < roots.size())
+        idx = execVirtualRootsInParallel(roots, ep);
 
-        // perform symbolic execution for a virtual root
-        execFnc(fnc, ep);
-        printMemUsage("execFnc");
-    }
+    for (; idx < roots.size(); ++idx)
+        execVirtualRoot(*roots[idx], ep);
 }
 
 void launchSymExec(const CodeStorage::Storage &stor, const SymExecParams &ep) {
@@ -193,19 +609,24 @@ void clEasyRun(const CodeStorage::Storage &stor, const char *configString) {
     // read parameters of symbolic execution
     SymExecParams ep;
     parseConfigString(ep, configString);
+    if (ep.resume && ep.checkpointFile.empty()) {
+        CL_WARN("resume requested, but no checkpoint file given");
+        ep.resume = false;
+    }
+
+    // apply the process-wide settings
+    setMemDumpFile(ep.memDumpFile);
+    Trace::setTraceLevel(ep.traceLevel);
+    Report::setDedup(ep.dedupReports);
 
     // run symbolic execution
     launchSymExec(stor, ep);
 
-    if (Trace::Globals::alive()) {
-        // plot all pending trace graphs
-        Trace::GraphProxy *glProxy = Trace::Globals::instance()->glProxy();
-        glProxy->plotAll();
+    // plot all pending trace graphs
+    plotPendingTraces();
 
-        // kill Trace::Globals, which may trigger the final trace graph cleanup
-        Trace::Globals::cleanup();
-        printMemUsage("Trace::Globals::cleanup");
-    }
+    // summarize the repeated diagnostics that have been suppressed
+    Report::printSummary();
 
     printPeakMemUsage();
 }
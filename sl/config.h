@@ -132,6 +132,12 @@
  */
 #define SE_CALL_CACHE_MISS_THR              0x10
 
+/**
+ * default count of seconds between two checkpoints of the symbolic execution,
+ * zero means that checkpoints are taken only on SIGUSR1
+ */
+#define SE_CHECKPOINT_INTERVAL              600
+
 /**
  * if non-zero, penalize length of SLS abstraction path by the given number in
  * case the path consists of concrete objects only
@@ -226,6 +232,12 @@
  */
 #define SE_RESTRICT_SLS_MINLEN              2
 
+/**
+ * upper bound of the size of a file with summaries of a single function [in
+ * bytes], the file is started over once it grows beyond the limit
+ */
+#define SE_SUMMARY_FILE_LIMIT               0x400000
+
 /**
  * if 1, the symcut module allows generic minimal lengths to survive a function
  * call/return.  @b Not recommended unless SymCallCache has been rewritten to
@@ -233,6 +245,16 @@
  */
 #define SE_SYMCUT_PRESERVES_MIN_LENGTHS     1
 
+/**
+ * if 1, splitHeapByCVars() does not deep-copy the bigger one of the two parts
+ * of heap (the part cut out for the callee, or the frame).  Instead, it
+ * destroys the other part in a (copy-on-write) copy of the original heap, so
+ * that the untouched entities remain shared with the caller as long as
+ * SH_COPY_ON_WRITE is enabled.  joinHeapsByCVars() then merges the smaller
+ * heap into a copy-on-write copy of the bigger one.
+ */
+#define SE_SYMCUT_SHARES_ENTITIES           1
+
 /**
  * - 0 ... disable tracking non-pointer values
  * - 1 ... basic tracking of non-pointer values
@@ -242,6 +264,8 @@
 
 /**
  * if 1, use a DFS scheduler at the level of basic blocks; if 0, use BFS
+ * @note this is only the default, which can be overridden at run-time by the
+ * plug-in arguments sched:fifo, sched:dfs, or sched:wto
  */
 #define SE_USE_DFS_SCHEDULER                0
 
@@ -255,11 +279,23 @@
  */
 #define SH_DELAYED_OBJECTS_DESTRUCTION      1
 
+/**
+ * count of entity IDs per chunk of EntStore; as long as SH_COPY_ON_WRITE is
+ * enabled, the chunks are shared among copies of SymHeap and cloned on write
+ */
+#define SH_ENT_STORE_CHUNK_SIZE             64
+
 /**
  * if 1, allow to assign unused heap IDs to newly created heap entities
  */
 #define SH_REUSE_FREE_IDS                   0
 
+/**
+ * if 1, track roots changed since the last segment discovery on the heap, so
+ * that discoverBestAbstraction() re-probes only the affected entry candidates
+ */
+#define SH_TRACK_DIRTY_ROOTS                1
+
 /**
  * if 1, write the contents of both parts of a DLS pair
  */
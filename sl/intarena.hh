@@ -21,16 +21,27 @@
 #define H_GUARD_INTARENA_H
 
 #include "config.h"
+#include "memdebug.hh"
 
-#include <map>
+#include <algorithm>
+#include <limits>
 #include <set>
 #include <vector>
 
 #include <boost/foreach.hpp>
 
-#define IA_AGGRESSIVE_OPTIMIZATION          0
+/// arenas of at least this count of intervals use the max-end index for lookup
+#define IA_INDEX_THRESHOLD                  0x20
 
-/// ad-hoc implementation;  wastes memory, performance, and human resources
+/**
+ * set of (interval, object) pairs kept in a flat vector sorted by the interval
+ *
+ * Copying the arena is a single allocation, there are no per-node allocations.
+ * Large arenas are additionally indexed by an implicit binary tree of maximal
+ * interval ends, which gives O(log n + k) intersects().  The index is built
+ * lazily on the first lookup, then it is updated along with items_ on each
+ * change (only the part of it that has shifted), and it is never copied.
+ */
 template <typename TInt, typename TObj>
 class IntervalArena {
     public:
@@ -41,19 +52,84 @@ class IntervalArena {
         typedef std::pair<key_type, TObj>           value_type;
 
     private:
-        typedef std::set<TObj>                      TLeaf;
-        typedef std::map</* beg */ TInt, TLeaf>     TLine;
-        typedef std::map</* end */ TInt, TLine>     TCont;
-        TCont                                       cont_;
+        struct Item {
+            TInt                                    beg;
+            TInt                                    end;
+            TObj                                    obj;
+
+            Item(TInt beg_, TInt end_, TObj obj_):
+                beg(beg_),
+                end(end_),
+                obj(obj_)
+            {
+            }
+
+            bool operator<(const Item &ref) const {
+                if (beg != ref.beg)
+                    return (beg < ref.beg);
+                if (end != ref.end)
+                    return (end < ref.end);
+                return (obj < ref.obj);
+            }
+
+            bool operator==(const Item &ref) const {
+                return (beg == ref.beg)
+                    && (end == ref.end)
+                    && (obj == ref.obj);
+            }
+        };
+
+        /// compare items by the interval only, usable for lookup by key_type
+        struct KeyLess {
+            bool operator()(const Item &item, const key_type &key) const {
+                return (item.beg != key.first)
+                    ? (item.beg < key.first)
+                    : (item.end < key.second);
+            }
+
+            bool operator()(const key_type &key, const Item &item) const {
+                return (key.first != item.beg)
+                    ? (key.first < item.beg)
+                    : (key.second < item.end);
+            }
+        };
+
+        typedef std::vector<Item, MemAccountAllocator<Item, MC_ARENA> > TItems;
+
+        /// all (beg, end, obj) triples sorted, without duplicates
+        TItems                                      items_;
+
+        /// max end over each node of an implicit binary tree built on items_
+        mutable std::vector<TInt>                   maxEnd_;
+        mutable unsigned                            leaves_;
 
     public:
+        IntervalArena():
+            leaves_(0)
+        {
+        }
+
+        /// the index is not copied, it is rebuilt lazily if ever needed
+        IntervalArena(const IntervalArena &ref):
+            items_(ref.items_),
+            leaves_(0)
+        {
+        }
+
+        IntervalArena& operator=(const IntervalArena &ref) {
+            items_ = ref.items_;
+            this->invalidate();
+            return *this;
+        }
+
         void add(const key_type &, const TObj);
         void sub(const key_type &, const TObj);
         void intersects(TSet &dst, const key_type &key) const;
         void exactMatch(TSet &dst, const key_type &key) const;
 
         void clear() {
-            cont_.clear();
+            items_.clear();
+            this->invalidate();
         }
 
         IntervalArena& operator+=(const value_type &item) {
@@ -65,16 +141,49 @@ class IntervalArena {
             this->sub(item.first, item.second);
             return *this;
         }
+
+    private:
+        void invalidate() {
+            maxEnd_.clear();
+            leaves_ = 0;
+        }
+
+        /// count of items with beg < winEnd (they form a prefix of items_)
+        unsigned prefixBefore(const TInt winEnd) const {
+            const key_type key(winEnd, std::numeric_limits<TInt>::min());
+            return std::lower_bound(items_.begin(), items_.end(), key,
+                    KeyLess()) - items_.begin();
+        }
+
+        void buildIndex() const;
+        void updateIndex(unsigned from, unsigned cntOld);
+
+        void collect(
+                TSet                                &dst,
+                const unsigned                      node,
+                const unsigned                      beg,
+                const unsigned                      end,
+                const unsigned                      limit,
+                const TInt                          winBeg)
+            const;
 };
 
 template <typename TInt, typename TObj>
 void IntervalArena<TInt, TObj>::add(const key_type &key, const TObj obj)
 {
-    const TInt beg = key.first;
-    const TInt end = key.second;
-    CL_BREAK_IF(end <= beg);
+    const Item item(key.first, key.second, obj);
+    CL_BREAK_IF(item.end <= item.beg);
+
+    const typename TItems::iterator it =
+        std::lower_bound(items_.begin(), items_.end(), item);
 
-    cont_[end][beg].insert(obj);
+    if (items_.end() != it && item == *it)
+        // already there
+        return;
+
+    const unsigned pos = it - items_.begin();
+    items_.insert(it, item);
+    this->updateIndex(pos, items_.size() - 1);
 }
 
 template <typename TInt, typename TObj>
@@ -84,96 +193,130 @@ void IntervalArena<TInt, TObj>::sub(const key_type &key, const TObj obj)
     const TInt winEnd = key.second;
     CL_BREAK_IF(winEnd <= winBeg);
 
-    std::vector<value_type> recoverList;
+    std::vector<Item> recoverList;
 
-    const typename TCont::iterator itEnd = cont_.end();
-    typename TCont::iterator it =
-        cont_.lower_bound(winBeg + /* right-open interval given as key */ 1);
+    // only the intervals starting before the window ends can be affected
+    const typename TItems::iterator itEnd =
+        items_.begin() + this->prefixBefore(winEnd);
 
-    while (itEnd != it) {
-        TLine &line = it->second;
-#if !IA_AGGRESSIVE_OPTIMIZATION
-        if (line.empty()) {
-            // skip orphans
-            ++it;
-            continue;
-        }
-#endif
-        typename TLine::iterator lineIt = line.begin();
-        TInt beg = lineIt->first;
-        if (winEnd <= beg) {
-            // we are beyond the window already
-            ++it;
+    // remove the matching items in place, keeping the order of the others
+    typename TItems::iterator dst = items_.begin();
+    typename TItems::iterator firstHit = itEnd;
+    for (typename TItems::iterator it = items_.begin(); itEnd != it; ++it) {
+        const Item &item = *it;
+        if (item.obj != obj || item.end <= winBeg) {
+            // keep this item
+            *dst++ = item;
             continue;
         }
 
-        const TInt end = it->first;
-        bool anyHit = false;
-
-        const typename TLine::iterator lineItEnd = line.end();
-        do {
-            // make sure the basic window axioms hold
-            CL_BREAK_IF(winEnd <= beg);
-            CL_BREAK_IF(end <= winBeg);
-
-            // remove the object from the current leaf (if found)
-            TLeaf &os = lineIt->second;
-            if (os.erase(obj)) {
-                anyHit = true;
-
-                if (beg < winBeg) {
-                    // schedule "the part above" for re-insertion
-                    const key_type key(beg, winBeg);
-                    const value_type item(key, obj);
-                    recoverList.push_back(item);
-                }
-            }
+        if (itEnd == firstHit)
+            // the items from here on are going to shift
+            firstHit = it;
 
-#if IA_AGGRESSIVE_OPTIMIZATION
-            if (os.empty())
-                // FIXME: Can we remove items from std::map during traversal??
-                line.erase(lineIt++);
-            else
-#endif
-            ++lineIt;
+        if (item.beg < winBeg)
+            // schedule "the part above" for re-insertion
+            recoverList.push_back(Item(item.beg, winBeg, obj));
 
-            if (lineItEnd == lineIt)
-                // end of line
-                break;
+        if (winEnd < item.end)
+            // schedule "the part beyond" for re-insertion
+            recoverList.push_back(Item(winEnd, item.end, obj));
+    }
 
-            beg = lineIt->first;
-        }
-        while (beg < winEnd);
-
-        if (anyHit) {
-            if (winEnd < end) {
-                // schedule "the part beyond" for re-insertion
-                const key_type key(winEnd, end);
-                const value_type item(key, obj);
-                recoverList.push_back(item);
-            }
+    if (dst == itEnd)
+        // nothing removed
+        return;
 
-#if IA_AGGRESSIVE_OPTIMIZATION
-            if (line.empty()) {
-                // FIXME: Can we remove items from std::map during traversal??
-                cont_.erase(it++);
-                continue;
-            }
-#endif
-        }
+    const unsigned pos = firstHit - items_.begin();
+    const unsigned cntOld = items_.size();
+    items_.erase(dst, itEnd);
+    this->updateIndex(pos, cntOld);
 
-        ++it;
+    // go through the recoverList and re-insert the missing parts
+    BOOST_FOREACH(const Item &item, recoverList)
+        this->add(key_type(item.beg, item.end), obj);
+}
+
+template <typename TInt, typename TObj>
+void IntervalArena<TInt, TObj>::buildIndex() const
+{
+    const unsigned cnt = items_.size();
+
+    unsigned leaves = 1;
+    while (leaves < cnt)
+        leaves <<= 1;
+
+    // the unused leaves can never intersect anything
+    maxEnd_.assign(/* root at 1 */ leaves << 1,
+            std::numeric_limits<TInt>::min());
+
+    for (unsigned idx = 0; idx < cnt; ++idx)
+        maxEnd_[leaves + idx] = items_[idx].end;
+
+    for (unsigned node = leaves - 1; node; --node)
+        maxEnd_[node] = std::max(maxEnd_[node << 1], maxEnd_[(node << 1) + 1]);
+
+    leaves_ = leaves;
+}
+
+/// refresh the leaves that have shifted since 'from' and their ancestors
+template <typename TInt, typename TObj>
+void IntervalArena<TInt, TObj>::updateIndex(
+        const unsigned                      from,
+        const unsigned                      cntOld)
+{
+    if (!leaves_)
+        // no index built yet
+        return;
+
+    const unsigned cnt = items_.size();
+    if (leaves_ < cnt) {
+        // no room for the new item, the index will be rebuilt if needed
+        this->invalidate();
+        return;
     }
 
-    // go through the recoverList and re-insert the missing parts
-    BOOST_FOREACH(const value_type &rItem, recoverList) {
-        const key_type &key = rItem.first;
-        const TObj obj = rItem.second;
-        const TInt beg = key.first;
-        const TInt end = key.second;
+    const unsigned to = std::max(cnt, cntOld);
+    if (to <= from)
+        return;
+
+    for (unsigned idx = from; idx < to; ++idx)
+        maxEnd_[leaves_ + idx] = (idx < cnt)
+            ? items_[idx].end
+            : std::numeric_limits<TInt>::min();
+
+    // go up level by level, each level covers half of the nodes below it
+    unsigned lo = (leaves_ + from) >> 1;
+    unsigned hi = (leaves_ + to - 1) >> 1;
+    for (; lo; lo >>= 1, hi >>= 1)
+        for (unsigned node = lo; node <= hi; ++node)
+            maxEnd_[node] =
+                std::max(maxEnd_[node << 1], maxEnd_[(node << 1) + 1]);
+}
+
+template <typename TInt, typename TObj>
+void IntervalArena<TInt, TObj>::collect(
+        TSet                                &dst,
+        const unsigned                      node,
+        const unsigned                      beg,
+        const unsigned                      end,
+        const unsigned                      limit,
+        const TInt                          winBeg)
+    const
+{
+    if (limit <= beg || maxEnd_[node] <= winBeg)
+        // the whole subtree is out of the window
+        return;
 
-        cont_[end][beg].insert(obj);
+    if (1U == end - beg) {
+        // leaf
+        dst.insert(items_[beg].obj);
+        return;
     }
+
+    const unsigned mid = (beg + end) >> 1;
+    this->collect(dst, (node << 1),      beg, mid, limit, winBeg);
+    this->collect(dst, (node << 1) + 1,  mid, end, limit, winBeg);
 }
 
 template <typename TInt, typename TObj>
@@ -183,59 +326,33 @@ void IntervalArena<TInt, TObj>::intersects(TSet &dst, const key_type &key) const
     const TInt winEnd = key.second;
     CL_BREAK_IF(winEnd <= winBeg);
 
-    typename TCont::const_iterator it =
-        cont_.lower_bound(winBeg + /* right-open interval given as key */ 1);
-
-    for (; cont_.end() != it; ++it) {
-        const TLine &line = it->second;
-#if !IA_AGGRESSIVE_OPTIMIZATION
-        if (line.empty())
-            // skip orphans
-            continue;
-#endif
-        typename TLine::const_iterator lineIt = line.begin();
-        TInt beg = lineIt->first;
-        if (winEnd <= beg)
-            // we are beyond the window already
-            continue;
-
-        const typename TLine::const_iterator lineItEnd = line.end();
-        do {
-            // make sure the basic window axioms hold
-            CL_BREAK_IF(winEnd <= beg);
-            CL_BREAK_IF(/* end */ it->first <= winBeg);
+    const unsigned limit = this->prefixBefore(winEnd);
+    if (limit < IA_INDEX_THRESHOLD) {
+        // small enough to go through the prefix linearly
+        for (unsigned idx = 0; idx < limit; ++idx) {
+            const Item &item = items_[idx];
+            if (winBeg < item.end)
+                dst.insert(item.obj);
+        }
 
-            const TLeaf &os = lineIt->second;
-            std::copy(os.begin(), os.end(), std::inserter(dst, dst.begin()));
+        return;
+    }
 
-            // increment for next wheel
-            if (lineItEnd == ++lineIt)
-                // end of line
-                break;
+    if (!leaves_)
+        this->buildIndex();
 
-            beg = lineIt->first;
-        }
-        while (beg < winEnd);
-    }
+    this->collect(dst, /* root */ 1, 0, leaves_, limit, winBeg);
 }
 
 template <typename TInt, typename TObj>
 void IntervalArena<TInt, TObj>::exactMatch(TSet &dst, const key_type &key) const
 {
-    typedef typename TCont::const_iterator TEndIt;
-    const TEndIt itEnd = cont_.find(/* end */ key.second);
-    if (cont_.end() == itEnd)
-        // upper bound not found
-        return;
-
-    const TLine &line = itEnd->second;
-    const typename TLine::const_iterator itBeg = line.find(/* beg */ key.first);
-    if (line.end() == itBeg)
-        // lower bound not found
-        return;
+    typedef typename TItems::const_iterator TIter;
+    const std::pair<TIter, TIter> range =
+        std::equal_range(items_.begin(), items_.end(), key, KeyLess());
 
-    const TLeaf &leaf = itBeg->second;
-    std::copy(leaf.begin(), leaf.end(), std::inserter(dst, dst.begin()));
+    for (TIter it = range.first; range.second != it; ++it)
+        dst.insert(it->obj);
 }
 
 #endif /* H_GUARD_INTARENA_H */
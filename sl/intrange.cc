@@ -19,34 +19,17 @@
 
 #include "intrange.hh"
 
-#include <algorithm>                // for std::min and std::max
-#include <climits>
-
 namespace IR {
 
 // /////////////////////////////////////////////////////////////////////////////
-// implementation of Range
-
-const TInt Int0   = 0L;
-const TInt Int1   = 1L;
-const TInt IntMin = LONG_MIN;
-const TInt IntMax = LONG_MAX;
-
-const Range FullRange = {
-    /* lo        */ IntMin,
-    /* hi        */ IntMax,
-    /* alignment */ Int1
-};
-
-// we use the bit next to MSB to detect improper handling of IntMin/IntMax
-#define RZ_MIN (IntMin >> 1)
-#define RZ_MAX (IntMax >> 1)
+// implementation of Range, most of the operations are inline in intrange.hh
 
 // return true if the given number is located somewhere in the Red Zone (RZ)
 #define RZ_CORRUPTION(n) (\
-        (IntMin != (n) && (n) < RZ_MIN) || \
-        (IntMax != (n) && RZ_MAX < (n)))
+        (IntMin != (n) && (n) < RzMin) || \
+        (IntMax != (n) && RzMax < (n)))
 
+#ifndef NDEBUG
 void chkRange(const Range &rng) {
     // check red zone
     CL_BREAK_IF(RZ_CORRUPTION(rng.lo));
@@ -64,207 +47,30 @@ void chkRange(const Range &rng) {
     if (IntMin != rng.lo && IntMax != rng.hi)
         CL_BREAK_IF(1 + rng.hi - rng.lo < rng.alignment);
 }
-
-// TODO: replace this implementation by something useful (it can loop badly)
-TInt greatestCommonDivisor(TInt a, TInt b) {
-    CL_BREAK_IF(a < RZ_MIN || RZ_MAX < a);
-    CL_BREAK_IF(b < RZ_MIN || RZ_MAX < b);
-
-#if SE_DISABLE_ALIGNMENT_TRACKING
-    return Int1;
 #endif
 
-    if (a < Int0)
-        a = -a;
-    if (b < Int0)
-        b = -b;
-
-    while (a != b) {
-        if (a < b)
-            b -= a;
-        else
-            a -= b;
-    }
-
-    CL_BREAK_IF(a < Int1);
-    return a;
-}
-
-Range join(const Range &rng1, const Range &rng2) {
-    Range result;
-    result.lo = std::min(rng1.lo, rng2.lo);
-    result.hi = std::max(rng1.hi, rng2.hi);
-
-    // TODO
-    result.alignment = Int1;
-
-    chkRange(result);
-    return result;
-}
-
-bool isRangeByNum(bool *pIsRange1, const Range &rng1, const Range &rng2) {
-    const bool isRange1 = !isSingular(rng1);
-    const bool isRange2 = !isSingular(rng2);
-    if (isRange1 == isRange2)
-        return false;
-
-    *pIsRange1 = isRange1;
-    return true;
-}
-
-bool isCovered(const Range &small, const Range &big) {
-    chkRange(small);
-    chkRange(big);
-
-    return (big.lo <= small.lo)
-        && (small.hi <= big.hi)
-        && (Int1 == big.alignment || big.alignment ==
-                greatestCommonDivisor(small.alignment, big.alignment));
-}
-
-bool isSingular(const Range &range) {
-    chkRange(range);
-    return (range.lo == range.hi);
-}
-
-bool isAligned(const Range &range) {
-    chkRange(range);
-    return (Int1 < range.alignment);
-}
-
-TInt widthOf(const Range &range) {
-    chkRange(range);
-    return /* closed interval */ 1 + range.hi - range.lo;
-}
-
-TInt invertInt(const TInt num) {
-    CL_BREAK_IF(RZ_CORRUPTION(num));
-
-    if (IntMin == num)
-        return IntMax;
-    else if (IntMax == num)
-        return IntMin;
-    else
-        return -num;
-}
-
-enum EIntBinOp {
-    IBO_ADD,
-    IBO_MUL,
-    IBO_LSHIFT,
-    IBO_RSHIFT
-};
-
-inline void intBinOp(TInt *pDst, const TInt other, const EIntBinOp code) {
-    switch (code) {
-        case IBO_ADD:
-            (*pDst) += other;
-            break;
-
-        case IBO_MUL:
-            (*pDst) *= other;
-            break;
+Range widen(const Range &rngOld, const Range &rngNew, const TThresholds &thrs)
+{
+    Range rng = join(rngOld, rngNew);
 
-        case IBO_LSHIFT:
-            (*pDst) <<= other;
-            break;
+    if (rng.lo < rngOld.lo) {
+        // the lower bound is growing, jump to the nearest threshold below
+        TThresholds::const_iterator it =
+            std::upper_bound(thrs.begin(), thrs.end(), rng.lo);
 
-        case IBO_RSHIFT:
-            (*pDst) >>= other;
-            break;
+        rng.lo = (thrs.begin() == it)
+            ? IntMin
+            : *(--it);
     }
-}
-
-// the real arithmetic actually works only for "small" numbers this way
-inline void rngBinOp(Range &rng, const Range &other, const EIntBinOp code) {
-    chkRange(rng);
-    chkRange(other);
-
-    if (IntMin != rng.lo) {
-        if (IntMin == other.lo)
-            rng.lo = IntMin;
-        else
-            intBinOp(&rng.lo, other.lo, code);
-    }
-
-    if (IntMax != rng.hi) {
-        if (IntMax == other.hi)
-            rng.hi = IntMax;
-        else
-            intBinOp(&rng.hi, other.hi, code);
-    }
-}
-
-TInt alignmentOf(const Range &rng) {
-    chkRange(rng);
-
-    if (!isSingular(rng))
-        return rng.alignment;
-
-    CL_BREAK_IF(Int1 != rng.alignment);
-    const TInt num = rng.lo;
-    if (!num)
-        return Int1;
-    else if (num < Int0)
-        return -num;
-    else
-        return num;
-}
-
-Range& operator+=(Range &rng, const Range &other) {
-    // this needs to be done before rng is modified
-    const TInt al1 = alignmentOf(rng);
-    const TInt al2 = alignmentOf(other);
-
-    // perform the actual range operation
-    rngBinOp(rng, other, IBO_ADD);
-
-    // compute the resulting alignment
-    rng.alignment = Int1;
-    if (!isSingular(rng))
-        rng.alignment = greatestCommonDivisor(al1, al2);
-
-    chkRange(rng);
-    return rng;
-}
-
-Range& operator<<=(Range &rng, const TUInt n) {
-    rngBinOp(rng, rngFromNum(n), IBO_LSHIFT);
-    rng.alignment = Int1;
-    chkRange(rng);
-    return rng;
-}
-
-Range& operator>>=(Range &rng, const TUInt n) {
-    rngBinOp(rng, rngFromNum(n), IBO_RSHIFT);
-    rng.alignment = Int1;
-    chkRange(rng);
-    return rng;
-}
-
-Range& operator*=(Range &rng, const Range &other) {
-    // this needs to be done before rng is modified
-    TInt coef = Int1;
-    bool isRange1;
-    if (isRangeByNum(&isRange1, rng, other))
-        coef = (isRange1) ? other.lo : rng.lo;
-
-    if (Int0 == coef)
-        // the result is going to be zero anyway
-        coef = Int1;
-    else if (coef < Int0)
-        // TODO: double check if we are still on the safe side here
-        coef = -coef;
 
-    // perform the actual range operation
-    rngBinOp(rng, other, IBO_MUL);
+    if (rngOld.hi < rng.hi) {
+        // the upper bound is growing, jump to the nearest threshold above
+        const TThresholds::const_iterator it =
+            std::lower_bound(thrs.begin(), thrs.end(), rng.hi);
 
-    if (rng.lo == rng.hi)
-        rng.alignment = Int1;
-    else {
-        // compute the resulting alignment
-        rng.alignment *= other.alignment;
-        rng.alignment *= coef;
+        rng.hi = (thrs.end() == it)
+            ? IntMax
+            : *it;
     }
 
     chkRange(rng);
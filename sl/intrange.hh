@@ -22,15 +22,36 @@
 
 #include "config.h"
 
+#include <algorithm>                // for std::min and std::max
+#include <climits>
+#include <vector>
+
+/**
+ * @file intrange.hh
+ * IR::Range - integral intervals with alignment, most of the operations are
+ * inline as they are used on the hot path of SymProc and the join of values
+ */
+
+/// true if we can use the overflow checking built-ins of the compiler
+#if defined(__GNUC__) && (5 <= __GNUC__)
+#   define IR_HAVE_OVERFLOW_BUILTINS 1
+#else
+#   define IR_HAVE_OVERFLOW_BUILTINS 0
+#endif
+
 namespace IR {
 
 typedef signed long                 TInt;
 typedef unsigned long               TUInt;
 
-extern const TInt Int0;
-extern const TInt Int1;
-extern const TInt IntMin;
-extern const TInt IntMax;
+const TInt Int0   = 0L;
+const TInt Int1   = 1L;
+const TInt IntMin = LONG_MIN;
+const TInt IntMax = LONG_MAX;
+
+/// we use the bit next to MSB to detect improper handling of IntMin/IntMax
+const TInt RzMin  = IntMin >> 1;
+const TInt RzMax  = IntMax >> 1;
 
 /// a closed interval over integral domain
 struct Range {
@@ -51,10 +72,18 @@ inline Range rngFromNum(TInt num) {
     return rng;
 }
 
-extern const Range FullRange;
+const Range FullRange = {
+    /* lo        */ IntMin,
+    /* hi        */ IntMax,
+    /* alignment */ Int1
+};
 
 /// this does nothing unless running a debug build
+#ifdef NDEBUG
+inline void chkRange(const Range &) { }
+#else
 void chkRange(const Range &rng);
+#endif
 
 inline bool operator==(const Range &a, const Range &b) {
     return (a.lo        == b.lo)
@@ -66,8 +95,54 @@ inline bool operator!=(const Range &a, const Range &b) {
     return !operator==(a, b);
 }
 
+/// return true if the range contain exactly one number; break if no one at all
+inline bool isSingular(const Range &range) {
+    chkRange(range);
+    return (range.lo == range.hi);
+}
+
+/// return true if the range is non-trivially aligned
+inline bool isAligned(const Range &range) {
+    chkRange(range);
+    return (Int1 < range.alignment);
+}
+
+/// return the count of integral numbers that belong to the given range
+inline TInt widthOf(const Range &range) {
+    chkRange(range);
+
+    // computed in the unsigned domain to avoid undefined behavior on overflow
+    const TUInt width = /* closed interval */ 1UL
+        + static_cast<TUInt>(range.hi)
+        - static_cast<TUInt>(range.lo);
+
+    return static_cast<TInt>(width);
+}
+
+/// return true if exactly one of the given ranges represents a single number
+inline bool isRangeByNum(bool *pIsRange1, const Range &rng1, const Range &rng2)
+{
+    const bool isRange1 = !isSingular(rng1);
+    const bool isRange2 = !isSingular(rng2);
+    if (isRange1 == isRange2)
+        return false;
+
+    *pIsRange1 = isRange1;
+    return true;
+}
+
 /// invert polarity of the number
-TInt invertInt(const TInt);
+inline TInt invertInt(const TInt num) {
+    CL_BREAK_IF(IntMin != num && num < RzMin);
+    CL_BREAK_IF(IntMax != num && RzMax < num);
+
+    if (IntMin == num)
+        return IntMax;
+    else if (IntMax == num)
+        return IntMin;
+    else
+        return -num;
+}
 
 /// invert polarity of the range
 inline Range operator-(Range rng) {
@@ -78,17 +153,246 @@ inline Range operator-(Range rng) {
     return rng;
 }
 
+/// Euclid's algorithm, operands are expected to fit into the red zone
+inline TInt greatestCommonDivisor(TInt a, TInt b) {
+    CL_BREAK_IF(a < RzMin || RzMax < a);
+    CL_BREAK_IF(b < RzMin || RzMax < b);
+
+#if SE_DISABLE_ALIGNMENT_TRACKING
+    (void) a;
+    (void) b;
+    return Int1;
+#else
+    if (a < Int0)
+        a = -a;
+    if (b < Int0)
+        b = -b;
+
+    while (b) {
+        const TInt rem = a % b;
+        a = b;
+        b = rem;
+    }
+
+    // gcd(0, 0) is not defined, fall back to the trivial alignment
+    return (a) ? a : Int1;
+#endif
+}
+
+/// return the alignment of the range, singular ranges are aligned to their value
+inline TInt alignmentOf(const Range &rng) {
+    chkRange(rng);
+
+    if (!isSingular(rng))
+        return rng.alignment;
+
+    CL_BREAK_IF(Int1 != rng.alignment);
+    const TInt num = rng.lo;
+    if (!num)
+        return Int1;
+    else if (num < Int0)
+        return -num;
+    else
+        return num;
+}
+
+/// true if the number does not fit into [RzMin, RzMax]
+inline bool isOutOfRz(const TInt num) {
+    // a single unsigned comparison instead of two signed ones
+    return static_cast<TUInt>(RzMax) - static_cast<TUInt>(RzMin)
+        < static_cast<TUInt>(num) - static_cast<TUInt>(RzMin);
+}
+
+/// multiply two numbers from the red zone, return false if the result leaves it
+inline bool mulInRz(TInt *pDst, const TInt a, const TInt b) {
+#if IR_HAVE_OVERFLOW_BUILTINS
+    return !__builtin_mul_overflow(a, b, pDst)
+        && !isOutOfRz(*pDst);
+#else
+    const TUInt ua = (a < Int0) ? -static_cast<TUInt>(a) : a;
+    const TUInt ub = (b < Int0) ? -static_cast<TUInt>(b) : b;
+    if (ub && static_cast<TUInt>(RzMax) / ub < ua)
+        return false;
+
+    *pDst = a * b;
+    return true;
+#endif
+}
+
+/// add two lower bounds, IntMin stands for minus infinity and is saturating
+inline TInt addLoBound(const TInt a, const TInt b) {
+    if (IntMin == a || IntMin == b)
+        return IntMin;
+
+    // both operands are in the red zone, so the sum itself cannot overflow
+    const TInt sum = a + b;
+    return (isOutOfRz(sum)) ? IntMin : sum;
+}
+
+/// add two upper bounds, IntMax stands for plus infinity and is saturating
+inline TInt addHiBound(const TInt a, const TInt b) {
+    if (IntMax == a || IntMax == b)
+        return IntMax;
+
+    // both operands are in the red zone, so the sum itself cannot overflow
+    const TInt sum = a + b;
+    return (isOutOfRz(sum)) ? IntMax : sum;
+}
+
+/// multiply two bounds, IntMin/IntMax stand for infinities and are saturating
+inline TInt mulBound(const TInt a, const TInt b) {
+    if (!a || !b)
+        return Int0;
+
+    TInt product;
+    if (IntMin != a && IntMax != a && IntMin != b && IntMax != b
+            && mulInRz(&product, a, b))
+        return product;
+
+    // saturate according to the sign of the result
+    return ((a < Int0) == (b < Int0))
+        ? IntMax
+        : IntMin;
+}
+
 /// add another range, but preserve boundary values if already reached
-Range& operator+=(Range &rng, const Range &other);
+inline Range& operator+=(Range &rng, const Range &other) {
+    chkRange(rng);
+    chkRange(other);
+
+    if (rng.lo == rng.hi && other.lo == other.hi) {
+        // fast path for two numbers
+        const TInt sum = rng.lo + other.lo;
+        if (!isOutOfRz(sum)) {
+            rng = rngFromNum(sum);
+            return rng;
+        }
+    }
+
+    // this needs to be done before rng is modified
+    const TInt al1 = alignmentOf(rng);
+    const TInt al2 = alignmentOf(other);
+
+    // perform the actual range operation
+    rng.lo = addLoBound(rng.lo, other.lo);
+    rng.hi = addHiBound(rng.hi, other.hi);
+
+    // compute the resulting alignment
+    rng.alignment = Int1;
+    if (rng.lo != rng.hi)
+        rng.alignment = greatestCommonDivisor(al1, al2);
+
+    chkRange(rng);
+    return rng;
+}
 
 /// multiply by another range, but preserve boundary values if already reached
-Range& operator*=(Range &rng, const Range &other);
+inline Range& operator*=(Range &rng, const Range &other) {
+    chkRange(rng);
+    chkRange(other);
+
+    const bool isNum1 = (rng.lo   == rng.hi);
+    const bool isNum2 = (other.lo == other.hi);
+    if (isNum1 && isNum2) {
+        // fast path for two numbers
+        TInt product;
+        if (mulInRz(&product, rng.lo, other.lo)) {
+            rng = rngFromNum(product);
+            return rng;
+        }
+    }
+
+    // this needs to be done before rng is modified
+    TInt coef = Int1;
+    if (isNum1 != isNum2)
+        coef = (isNum1) ? rng.lo : other.lo;
+
+    if (Int0 == coef)
+        // the result is going to be zero anyway
+        coef = Int1;
+    else if (coef < Int0)
+        coef = -coef;
+
+    // perform the actual range operation
+    if (Int0 <= rng.lo && Int0 <= other.lo) {
+        // fast path for non-negative ranges, the bounds are monotonic
+        rng.lo = mulBound(rng.lo, other.lo);
+        rng.hi = mulBound(rng.hi, other.hi);
+    }
+    else {
+        // the extremes can be reached by any of the four combinations
+        const TInt ll = mulBound(rng.lo, other.lo);
+        const TInt lh = mulBound(rng.lo, other.hi);
+        const TInt hl = mulBound(rng.hi, other.lo);
+        const TInt hh = mulBound(rng.hi, other.hi);
+        rng.lo = std::min(std::min(ll, lh), std::min(hl, hh));
+        rng.hi = std::max(std::max(ll, lh), std::max(hl, hh));
+    }
+
+    // an infinite bound on the wrong side means we know nothing at all
+    if (IntMax == rng.lo)
+        rng.lo = IntMin;
+    if (IntMin == rng.hi)
+        rng.hi = IntMax;
+
+    // compute the resulting alignment
+    if (rng.lo == rng.hi)
+        rng.alignment = Int1;
+    else if (!mulInRz(&rng.alignment, rng.alignment, other.alignment)
+            || !mulInRz(&rng.alignment, rng.alignment, coef))
+        rng.alignment = Int1;
+
+    chkRange(rng);
+    return rng;
+}
 
 /// bitwise AND on range where the bitmask is a single number
 Range& operator&=(Range &rng, TInt mask);
 
-Range& operator<<=(Range &rng, const TUInt);
-Range& operator>>=(Range &rng, const TUInt);
+/// multiply by 2^n, but preserve boundary values if already reached
+inline Range& operator<<=(Range &rng, const TUInt n) {
+    chkRange(rng);
+
+    // shift beyond the red zone saturates any non-zero bound
+    const TInt coef = (n < /* bits of RzMax */ 62UL)
+        ? (Int1 << n)
+        : IntMax;
+
+    if (IntMin != rng.lo) {
+        rng.lo = mulBound(rng.lo, coef);
+        if (IntMax == rng.lo)
+            rng.lo = IntMin;
+    }
+
+    if (IntMax != rng.hi) {
+        rng.hi = mulBound(rng.hi, coef);
+        if (IntMin == rng.hi)
+            rng.hi = IntMax;
+    }
+
+    rng.alignment = Int1;
+    chkRange(rng);
+    return rng;
+}
+
+/// arithmetic shift to the right, preserve boundary values if already reached
+inline Range& operator>>=(Range &rng, const TUInt n) {
+    chkRange(rng);
+
+    // shifting by the width of TInt or more is undefined
+    const TUInt bits = sizeof(TInt) * CHAR_BIT - 1UL;
+    const TUInt by = (n < bits) ? n : bits;
+
+    if (IntMin != rng.lo)
+        rng.lo >>= by;
+
+    if (IntMax != rng.hi)
+        rng.hi >>= by;
+
+    rng.alignment = Int1;
+    chkRange(rng);
+    return rng;
+}
 
 /// subtract another range, but preserve boundary values if already reached
 inline Range& operator-=(Range &rng, const Range &other) {
@@ -127,22 +431,41 @@ inline Range operator>>(Range rng, const TUInt n) {
 }
 
 /// return a range that covers both given ranges, preserve alignment if possible
-Range join(const Range &rng1, const Range &rng2);
+inline Range join(const Range &rng1, const Range &rng2) {
+    Range result;
+    result.lo = std::min(rng1.lo, rng2.lo);
+    result.hi = std::max(rng1.hi, rng2.hi);
 
-/// return true if exactly one of the given ranges represents a single number
-bool isRangeByNum(bool *pIsRange1, const Range &rng1, const Range &rng2);
+    // TODO
+    result.alignment = Int1;
 
-/// true if the small range is inside the big one (sharing endpoints is fine)
-bool isCovered(const Range &small, const Range &big);
+    chkRange(result);
+    return result;
+}
 
-/// return true if the range contain exactly one number; break if no one at all
-bool isSingular(const Range &);
+/// sorted list of integral constants to widen the bounds of ranges to
+typedef std::vector<TInt>           TThresholds;
 
-/// return true if the range is non-trivially aligned
-bool isAligned(const Range &);
+/**
+ * return a range that covers both given ranges, the bounds of rngOld that are
+ * not stable are moved to the nearest threshold (or infinity if there is none)
+ */
+Range widen(const Range &rngOld, const Range &rngNew, const TThresholds &thrs);
 
-/// return the count of integral numbers that beTInt the given range
-TInt widthOf(const Range &);
+/// true if the small range is inside the big one (sharing endpoints is fine)
+inline bool isCovered(const Range &small, const Range &big) {
+    chkRange(small);
+    chkRange(big);
+
+    // gcd(small.alignment, big.alignment) == big.alignment without the loop
+    return (big.lo <= small.lo)
+        && (small.hi <= big.hi)
+        && (Int1 == big.alignment
+#if !SE_DISABLE_ALIGNMENT_TRACKING
+            || !(small.alignment % big.alignment)
+#endif
+           );
+}
 
 } // namespace IR
 
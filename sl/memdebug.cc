@@ -22,18 +22,48 @@
 
 #include <cl/cl_msg.hh>
 
+#include <fstream>
 #include <iomanip>
 
+#include <sys/stat.h>
+
+const char* memCategoryName(const EMemCategory cat) {
+    switch (cat) {
+        case MC_HEAP_ENTITY:    return "heap_entity";
+        case MC_ENT_STORE:      return "ent_store";
+        case MC_ARENA:          return "arena";
+        case MC_CALL_CACHE:     return "call_cache";
+        case MC_TRACE:          return "trace";
+        case MC_LAST:           break;
+    }
+
+    CL_BREAK_IF("invalid call of memCategoryName()");
+    return "";
+}
+
 #if DEBUG_MEM_USAGE
 #   include <malloc.h>
 
+// glibc provides mallinfo2() with fields of type size_t since 2.33
+#if defined(__GLIBC__) \
+    && (2 < __GLIBC__ || (2 == __GLIBC__ && 33 <= __GLIBC_MINOR__))
+#   define HAVE_MALLINFO2                   1
+#else
+#   define HAVE_MALLINFO2                   0
+#endif
+
 static bool overflowDetected;
 static ssize_t peak;
+static std::string memDumpFile;
 
 bool rawMemUsage(ssize_t *pDst) {
     if (::overflowDetected)
         return false;
 
+#if HAVE_MALLINFO2
+    struct mallinfo2 info = mallinfo2();
+    const ssize_t raw = info.uordblks;
+#else
     struct mallinfo info = mallinfo();
     const ssize_t raw = info.uordblks;
     const unsigned mib = raw >> /* MiB */ 20;
@@ -42,6 +72,7 @@ bool rawMemUsage(ssize_t *pDst) {
         ::overflowDetected = true;
         return false;
     }
+#endif
 
     *pDst = raw;
     if (peak < raw)
@@ -98,12 +129,71 @@ std::ostream& operator<<(std::ostream &str, const AmountFormatter &fmt) {
     return str;
 }
 
-#include <iostream>
-bool printMemUsage(const char *fnc) {
+void setMemDumpFile(const std::string &fileName) {
+    ::memDumpFile = fileName;
+}
+
+bool dumpMemAccounts(const std::string &fileName, const char *label) {
+    // check whether we need to write the header line
+    struct stat st;
+    const bool needHeader = stat(fileName.c_str(), &st) || !st.st_size;
+
+    std::fstream str(fileName.c_str(), std::ios::out | std::ios::app);
+    if (!str)
+        return false;
+
+    if (needHeader) {
+        str << "label\tmalloc";
+        for (int i = 0; i < MC_LAST; ++i) {
+            const char *name = memCategoryName(static_cast<EMemCategory>(i));
+            str << "\t" << name << "_live\t" << name << "_peak";
+        }
+        str << "\n";
+    }
+
     ssize_t cb;
     if (!currentMemUsage(&cb))
+        cb = -1;
+
+    str << label << "\t" << cb;
+    for (int i = 0; i < MC_LAST; ++i)
+        str << "\t" << memAccounts()[i].live << "\t" << memAccounts()[i].peak;
+    str << "\n";
+
+    return !!str;
+}
+
+void printMemAccounts(const char *fnc) {
+    for (int i = 0; i < MC_LAST; ++i) {
+        const MemAccount &acc = memAccounts()[i];
+        if (!acc.peak)
+            continue;
+
+        CL_DEBUG("    " << std::setw(12) << std::left
+                << memCategoryName(static_cast<EMemCategory>(i))
+                << AmountFormatter(acc.live,
+                    /* MiB */ 20,
+                    /* int digits */ 4,
+                    /* dec digits */ 2)
+                << " MB live, "
+                << AmountFormatter(acc.peak,
+                    /* MiB */ 20,
+                    /* int digits */ 4,
+                    /* dec digits */ 2)
+                << " MB peak");
+    }
+
+    if (!::memDumpFile.empty() && !dumpMemAccounts(::memDumpFile, fnc))
+        CL_WARN("failed to dump memory usage to " << ::memDumpFile);
+}
+
+bool printMemUsage(const char *fnc) {
+    ssize_t cb;
+    if (!currentMemUsage(&cb)) {
         // instead of printing misleading numbers, we rather print nothing
+        printMemAccounts(fnc);
         return false;
+    }
 
     CL_DEBUG("current memory usage: " << AmountFormatter(cb,
                 /* MiB */ 20,
@@ -111,6 +201,7 @@ bool printMemUsage(const char *fnc) {
                 /* dec digits */ 2)
             << " MB (just completed " << fnc << "())");
 
+    printMemAccounts(fnc);
     return true;
 }
 
@@ -125,6 +216,9 @@ bool printPeakMemUsage() {
                 /* dec digits */ 2)
             << " MB");
 
+    if (!::memDumpFile.empty())
+        dumpMemAccounts(::memDumpFile, "peak");
+
     return true;
 }
 
@@ -150,4 +244,13 @@ bool printPeakMemUsage() {
     return false;
 }
 
+bool dumpMemAccounts(const std::string &, const char *) {
+    return false;
+}
+
+void setMemDumpFile(const std::string &fileName) {
+    if (!fileName.empty())
+        CL_WARN("mem_dump requires a build with DEBUG_MEM_USAGE enabled");
+}
+
 #endif
@@ -20,11 +20,25 @@
 #ifndef H_GUARD_MEM_DEBUG_H
 #define H_GUARD_MEM_DEBUG_H
 
+#include "config.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <limits>
+#include <new>
 #include <string>
 
+#include <sys/types.h>
+
 /**
  * @file memdebug.hh
- * @todo some dox
+ * memory usage statistics, including per-category accounting of the data
+ * structures allocated by the analyzer
+ *
+ * The accounting is compiled in only as long as DEBUG_MEM_USAGE is enabled,
+ * which config.h does for debug builds only.  With NDEBUG defined, MemAccounted
+ * and MemAccountAllocator cost nothing, the dump functions do nothing, and the
+ * @b mem_dump option is ignored with a warning.
  */
 
 /// provide the raw amount of currently allocated memory (as glibc reports it)
@@ -42,4 +56,133 @@ bool printMemUsage(const char *justCompletedFncName);
 /// print the peak over all calls of rawMemUsage(), but relative to the drift
 bool printPeakMemUsage();
 
+/// categories of memory accounted by MemAccounted and MemAccountAllocator
+enum EMemCategory {
+    MC_HEAP_ENTITY,         ///< objects and values of SymHeap
+    MC_ENT_STORE,           ///< tables and chunks of EntStore
+    MC_ARENA,               ///< storage of IntervalArena
+    MC_CALL_CACHE,          ///< call contexts of SymCallCache
+    MC_TRACE,               ///< nodes of the trace graph
+    MC_LAST                 ///< count of the categories, not a category
+};
+
+#if DEBUG_MEM_USAGE
+/// live and peak amount of memory (in bytes) per category
+struct MemAccount {
+    ssize_t                 live;
+    ssize_t                 peak;
+};
+
+/// the accounts are defined here, so that the users need not link memdebug.cc
+inline MemAccount* memAccounts() {
+    static MemAccount accounts[MC_LAST];
+    return accounts;
+}
+
+inline void memAccountAlloc(const EMemCategory cat, const size_t size) {
+    MemAccount &acc = memAccounts()[cat];
+    acc.live += size;
+    if (acc.peak < acc.live)
+        acc.peak = acc.live;
+}
+
+inline void memAccountFree(const EMemCategory cat, const size_t size) {
+    memAccounts()[cat].live -= size;
+}
+#else
+inline void memAccountAlloc(const EMemCategory, const size_t) { }
+inline void memAccountFree(const EMemCategory, const size_t) { }
+#endif
+
+/// human-readable name of the given category
+const char* memCategoryName(EMemCategory);
+
+/**
+ * append live/peak amounts of all categories to the given file as a single
+ * tab-separated line (a header line is written first if the file is empty)
+ * @param label label of the record, e.g. name of the just completed function
+ */
+bool dumpMemAccounts(const std::string &fileName, const char *label);
+
+/// set the file printMemUsage() dumps the accounts into (empty to disable)
+void setMemDumpFile(const std::string &fileName);
+
+/// base class that accounts all instances of its descendants to a category
+template <EMemCategory TCat>
+struct MemAccounted {
+    static void* operator new(size_t size) {
+        memAccountAlloc(TCat, size);
+        return ::operator new(size);
+    }
+
+    static void operator delete(void *ptr, size_t size) {
+        memAccountFree(TCat, size);
+        ::operator delete(ptr);
+    }
+};
+
+/// STL allocator that accounts the memory it allocates to a category
+template <typename T, EMemCategory TCat>
+class MemAccountAllocator {
+    public:
+        typedef T                   value_type;
+        typedef T*                  pointer;
+        typedef const T*            const_pointer;
+        typedef T&                  reference;
+        typedef const T&            const_reference;
+        typedef size_t              size_type;
+        typedef ptrdiff_t           difference_type;
+
+        template <typename U> struct rebind {
+            typedef MemAccountAllocator<U, TCat> other;
+        };
+
+        MemAccountAllocator() { }
+
+        template <typename U>
+        MemAccountAllocator(const MemAccountAllocator<U, TCat> &) { }
+
+        pointer address(reference ref) const { return &ref; }
+        const_pointer address(const_reference ref) const { return &ref; }
+
+        size_type max_size() const {
+            return std::numeric_limits<size_type>::max() / sizeof(T);
+        }
+
+        pointer allocate(size_type cnt, const void * = 0) {
+            const size_t size = cnt * sizeof(T);
+            memAccountAlloc(TCat, size);
+            return static_cast<pointer>(::operator new(size));
+        }
+
+        void deallocate(pointer ptr, size_type cnt) {
+            memAccountFree(TCat, cnt * sizeof(T));
+            ::operator delete(ptr);
+        }
+
+        void construct(pointer ptr, const T &val) {
+            new(ptr) T(val);
+        }
+
+        void destroy(pointer ptr) {
+            ptr->~T();
+        }
+};
+
+template <typename T, typename U, EMemCategory TCat>
+inline bool operator==(
+        const MemAccountAllocator<T, TCat> &,
+        const MemAccountAllocator<U, TCat> &)
+{
+    return true;
+}
+
+template <typename T, typename U, EMemCategory TCat>
+inline bool operator!=(
+        const MemAccountAllocator<T, TCat> &,
+        const MemAccountAllocator<U, TCat> &)
+{
+    return false;
+}
+
 #endif /* H_GUARD_MEM_DEBUG_H */
@@ -49,6 +49,7 @@ std::string PlotEnumerator::decorate(std::string name) {
     // merge name with ID
     name += "-";
     name += str.str();
+    name.insert(0, prefix_);
 
 #ifdef SYMPLOT_STOP_CONDITION
     if (SYMPLOT_STOP_CONDITION(name))
@@ -41,6 +41,11 @@ class PlotEnumerator {
         // generate kind of more unique name
         std::string decorate(std::string name);
 
+        /// prepend the given prefix to all names decorated from now on
+        void setPrefix(const std::string &prefix) {
+            prefix_ = prefix;
+        }
+
     private:
         static PlotEnumerator *inst_;
         PlotEnumerator() { }
@@ -49,6 +54,7 @@ class PlotEnumerator {
     private:
         typedef std::map<std::string, int> TMap;
         TMap map_;
+        std::string prefix_;
 };
 
 #endif /* H_GUARD_PLOT_ENUM_H */
@@ -117,14 +117,16 @@ bool resolveCallocSize(
     const TValId valNelem = core.valFromOperand(opList[/* nelem */ 2]);
     IR::Range nelem;
     if (!rngFromVal(&nelem, sh, valNelem) || nelem.lo < IR::Int0) {
-        CL_ERROR_MSG(lw, "'nelem' arg of calloc() is not a known integer");
+        SE_ERROR_MSG(core, lw,
+                "'nelem' arg of calloc() is not a known integer");
         return false;
     }
 
     const TValId valElsize = core.valFromOperand(opList[/* elsize */ 3]);
     IR::Range elsize;
     if (!rngFromVal(&elsize, sh, valElsize) || elsize.lo < IR::Int0) {
-        CL_ERROR_MSG(lw, "'elsize' arg of calloc() is not a known integer");
+        SE_ERROR_MSG(core, lw,
+                "'elsize' arg of calloc() is not a known integer");
         return false;
     }
 
@@ -132,7 +134,10 @@ bool resolveCallocSize(
     return true;
 }
 
-void printUserMessage(SymProc &proc, const struct cl_operand &opMsg)
+void printUserMessage(
+        SymProc                                     &proc,
+        const struct cl_operand                     &opMsg,
+        const EMsgLevel                             level)
 {
     const TValId valMsg = proc.valFromOperand(opMsg);
 
@@ -143,7 +148,7 @@ void printUserMessage(SymProc &proc, const struct cl_operand &opMsg)
         return;
 
     const struct cl_loc *loc = proc.lw();
-    CL_NOTE_MSG(loc, "user message: " << msg);
+    SE_NOTE_MSG(proc, level, loc, "user message: " << msg);
 }
 
 bool validateStringOp(SymProc &proc, TOp op, TSizeRange *pSize = 0) {
@@ -160,7 +165,7 @@ bool validateStringOp(SymProc &proc, TOp op, TSizeRange *pSize = 0) {
     }
 
     if (!proc.checkForInvalidDeref(val, sizeof(char)))
-        CL_ERROR_MSG(loc, "failed to imply a zero-terminated string");
+        SE_ERROR_MSG(proc, loc, "failed to imply a zero-terminated string");
 
     return false;
 }
@@ -262,8 +267,9 @@ bool handleBreak(
     }
 
     // print what happened
-    CL_WARN_MSG(&insn.loc, name << "() reached, stopping per user's request");
-    printUserMessage(core, opList[/* msg */ 2]);
+    SE_WARN_MSG(core, &insn.loc,
+            name << "() reached, stopping per user's request");
+    printUserMessage(core, opList[/* msg */ 2], ML_WARN);
     core.printBackTrace(ML_WARN);
 
     // trap to debugger
@@ -344,7 +350,8 @@ bool handleKzalloc(
     const TValId valSize = core.valFromOperand(opList[/* size */ 2]);
     IR::Range size;
     if (!rngFromVal(&size, core.sh(), valSize)) {
-        CL_ERROR_MSG(lw, "size arg of " << name << "() is not a known integer");
+        SE_ERROR_MSG(core, lw,
+                "size arg of " << name << "() is not a known integer");
         core.printBackTrace(ML_ERROR);
         return true;
     }
@@ -372,7 +379,7 @@ bool handleMalloc(
     const TValId valSize = core.valFromOperand(opList[/* size */ 2]);
     IR::Range size;
     if (!rngFromVal(&size, core.sh(), valSize) || size.lo < IR::Int0) {
-        CL_ERROR_MSG(lw, "size arg of malloc() is not a known integer");
+        SE_ERROR_MSG(core, lw, "size arg of malloc() is not a known integer");
         core.printBackTrace(ML_ERROR);
         return true;
     }
@@ -487,7 +494,7 @@ bool handlePrintf(
     const TValId valFmt = core.valFromOperand(opList[/* fmt */ 2]);
     const char *fmt;
     if (!stringFromVal(&fmt, sh, valFmt)) {
-        CL_ERROR_MSG(lw, "fmt arg of printf() is not a string literal");
+        SE_ERROR_MSG(core, lw, "fmt arg of printf() is not a string literal");
         core.printBackTrace(ML_ERROR);
         insertCoreHeap(dst, core, insn);
         return true;
@@ -507,7 +514,8 @@ bool handlePrintf(
         }
 
         if (opList.size() <= opIdx) {
-            CL_ERROR_MSG(lw, "insufficient count of arguments given to printf()");
+            SE_ERROR_MSG(core, lw,
+                    "insufficient count of arguments given to printf()");
             goto fail;
         }
 
@@ -530,7 +538,8 @@ bool handlePrintf(
                     goto fail;
 
             default:
-                CL_ERROR_MSG(lw, "unhandled conversion given to printf()");
+                SE_ERROR_MSG(core, lw,
+                        "unhandled conversion given to printf()");
                 goto fail;
         }
 
@@ -540,7 +549,7 @@ bool handlePrintf(
 
     if (opIdx < opList.size()) {
         // this is quite suspicious, but would not crash the program
-        CL_WARN_MSG(lw, "too many arguments given to printf()");
+        SE_WARN_MSG(core, lw, "too many arguments given to printf()");
         core.printBackTrace(ML_WARN);
     }
 
@@ -625,7 +634,8 @@ bool handleStrncpy(
 
     IR::Range size;
     if (!rngFromVal(&size, sh, valSize) || size.lo < IR::Int0) {
-        CL_ERROR_MSG(loc, "n arg of " << name << "() is not a known integer");
+        SE_ERROR_MSG(core, loc,
+                "n arg of " << name << "() is not a known integer");
         core.printBackTrace(ML_ERROR);
         return true;
     }
@@ -834,11 +844,11 @@ bool handleError(
     }
 
     // print the error message
-    CL_ERROR_MSG(loc, name
+    SE_ERROR_MSG(core, loc, name
             << "() reached, analysis of this code path will not continue");
 
     // print the user message and backtrace
-    printUserMessage(core, opList[/* msg */ 2]);
+    printUserMessage(core, opList[/* msg */ 2], ML_ERROR);
     core.printBackTrace(ML_ERROR);
     return true;
 }
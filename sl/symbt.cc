@@ -33,6 +33,7 @@
 #include <utility>
 
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/tuple/tuple.hpp>
 
 struct SymBackTrace::Private {
@@ -200,6 +201,23 @@ unsigned SymBackTrace::size() const {
     return d->btStack.size();
 }
 
+size_t SymBackTrace::hash() const {
+    size_t hash = 0;
+
+    BOOST_FOREACH(const Private::BtStackItem &item, d->btStack) {
+        boost::hash_combine(hash, uidOf(item.fnc));
+
+        const struct cl_loc *loc = item.loc;
+        if (!loc)
+            continue;
+
+        boost::hash_combine(hash, loc->line);
+        boost::hash_combine(hash, loc->column);
+    }
+
+    return hash;
+}
+
 int SymBackTrace::countOccurrencesOfFnc(int fncId) const {
     const CodeStorage::Fnc *fnc = d->fncById(fncId);
     return d->nestMap[fnc];
@@ -25,6 +25,8 @@
  * SymBackTrace - backtrace management
  */
 
+#include <cstddef>                  // needed for size_t
+
 struct CVar;
 class SymHeap;
 class SymProc;
@@ -88,6 +90,9 @@ class SymBackTrace {
         /// size of the backtrace, aka @b call @b depth
         unsigned size() const;
 
+        /// hash of the call stack (functions and locations of their calls)
+        size_t hash() const;
+
         /**
          * count occurrences of the given function.  Zero means the function
          * does not occur in the backtrace.  Non-zero means the function occurs
@@ -23,6 +23,7 @@
 #include <cl/cl_msg.hh>
 #include <cl/storage.hh>
 
+#include "memdebug.hh"
 #include "symabstract.hh"
 #include "symbt.hh"
 #include "symcmp.hh"
@@ -31,11 +32,16 @@
 #include "symheap.hh"
 #include "symjoin.hh"
 #include "symproc.hh"
+#include "symserial.hh"
 #include "symstate.hh"
+#include "symsummary.hh"
 #include "symutil.hh"
 #include "symtrace.hh"
 #include "util.hh"
 
+#include <algorithm>
+#include <list>
+#include <map>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -46,7 +52,8 @@ LOCAL_DEBUG_PLOTTER(symcall, DEBUG_SYMCALL)
 // call context cache per one fnc
 class PerFncCache {
     private:
-        typedef std::vector<SymCallCtx *> TCtxMap;
+        typedef MemAccountAllocator<SymCallCtx *, MC_CALL_CACHE>     TCtxAlloc;
+        typedef std::vector<SymCallCtx *, TCtxAlloc>                 TCtxMap;
 
         SymHeapUnion    huni_;
         TCtxMap         ctxMap_;
@@ -88,6 +95,21 @@ class PerFncCache {
             return false;
         }
 
+        /// remove the given call ctx from cache and destroy it
+        void evict(SymCallCtx *ctx) {
+            const TCtxMap::iterator it =
+                std::find(ctxMap_.begin(), ctxMap_.end(), ctx);
+
+            if (ctxMap_.end() == it) {
+                CL_BREAK_IF("PerFncCache::evict() has failed");
+                return;
+            }
+
+            huni_.eraseExisting(it - ctxMap_.begin());
+            ctxMap_.erase(it);
+            delete ctx;
+        }
+
         void updateCacheEntry(const SymHeap &of, SymHeap by) {
 #if !SE_ENABLE_CALL_CACHE
             CL_BREAK_IF("invalid call of PerFncCache::updateCacheEntry()");
@@ -192,26 +214,68 @@ int PerFncCache::lookupCore(const SymHeap &sh) {
 struct SymCallCache::Private {
     typedef const CodeStorage::Fnc                     &TFncRef;
     typedef CodeStorage::TVarSet                        TFncVarSet;
-    typedef std::map<int /* uid */, PerFncCache>        TCache;
+    // PerFncCache is stored by value, so the nodes of the map are accounted
+    typedef std::pair<const int, PerFncCache>           TCacheItem;
+    typedef MemAccountAllocator<TCacheItem, MC_CALL_CACHE> TCacheAlloc;
+    typedef std::map<int /* uid */, PerFncCache, std::less<int>, TCacheAlloc>
+                                                        TCache;
     typedef std::vector<SymCallCtx *>                   TCtxStack;
+    typedef std::list<SymCallCtx *>                     TLruList;
+    typedef std::pair<unsigned /* cnt */, size_t /* size */>
+                                                        TStorageRef;
+    typedef std::map<const void *, TStorageRef>         TStorageRefs;
+
+    // memory accounting, see SymCallCtx::Private::storage
+    const size_t                budget;
+    size_t                      usage;
+    size_t                      peak;
+
+    /// count of call contexts referring to each block of storage
+    TStorageRefs                storageRefs;
+
+    /// call contexts not in use, the least recently used first
+    TLruList                    lru;
+
+    // statistics
+    unsigned long               cntHits;
+    unsigned long               cntMisses;
+    unsigned long               cntEvictions;
+    unsigned long               cntSummaryHits;
 
     TCache                      cache;
+    SymSummaryStore            *summaries;
     TCtxStack                   ctxStack;
     SymBackTrace                bt;
 
+    int pullGlVarFromStack(SymHeap &glSubHeap, const CVar &cv);
     void importGlVar(SymHeap &sh, const CVar &cv);
+    bool loadSummary(PerFncCache &pfc, SymCallCtx *ctx);
     void resolveHeapCut(TCVarList &cut, SymHeap &sh, TFncRef &fnc);
+    void restoreCtx(TFncRef fnc, const SymHeap &entry, const SymState &res);
+    void enforceBudget();
     SymCallCtx* getCallCtx(const SymHeap &entry, TFncRef fnc);
 
-    Private(TStorRef stor, bool ptrace):
+    Private(TStorRef stor, bool ptrace, size_t budget_):
+        budget(budget_),
+        usage(0),
+        peak(0),
+        cntHits(0),
+        cntMisses(0),
+        cntEvictions(0),
+        cntSummaryHits(0),
+        summaries(0),
         bt(stor, ptrace)
     {
     }
+
+    ~Private() {
+        delete summaries;
+    }
 };
 
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of SymCallCtx
-struct SymCallCtx::Private {
+struct SymCallCtx::Private: public MemAccounted<MC_CALL_CACHE> {
     SymCallCache::Private       *cd;
     const CodeStorage::Fnc      *fnc;
     SymHeap                     entry;
@@ -221,7 +285,15 @@ struct SymCallCtx::Private {
     int                         nestLevel;
     bool                        computed;
     bool                        flushed;
-
+    TStorageMap                 storage;    ///< blocks accounted in cd->usage
+    SymCallCache::Private::TLruList::iterator
+                                lruPos;     ///< cd->lru.end() if not listed
+    size_t                      msgStart;   ///< journal size on ctx creation
+
+    void account();
+    void release();
+    void enterLru(SymCallCtx *self);
+    void leaveLru();
     void assignReturnValue(SymHeap &sh);
     void destroyStackFrame(SymHeap &sh);
 
@@ -233,7 +305,9 @@ struct SymCallCtx::Private {
         callFrame(cd_->bt.stor(),
                 new Trace::TransientNode("SymCallCtx::Private::callFrame")),
         computed(false),
-        flushed(false)
+        flushed(false),
+        lruPos(cd_->lru.end()),
+        msgStart(0)
     {
     }
 };
@@ -244,6 +318,8 @@ SymCallCtx::SymCallCtx(SymCallCache::Private *cd):
 }
 
 SymCallCtx::~SymCallCtx() {
+    d->leaveLru();
+    d->release();
     delete d;
 }
 
@@ -267,6 +343,66 @@ SymState& SymCallCtx::rawResults() {
     return d->rawResults;
 }
 
+void SymCallCtx::Private::account() {
+    // gather the memory occupied by the entry and the cached results, the
+    // blocks of storage shared among the heaps are listed only once
+    CL_BREAK_IF(!this->storage.empty());
+    this->entry.gatherStorage(this->storage);
+    this->callFrame.gatherStorage(this->storage);
+    BOOST_FOREACH(const SymHeap *sh, this->rawResults)
+        sh->gatherStorage(this->storage);
+
+    // count only the blocks not yet referred to by other call contexts
+    size_t &usage = this->cd->usage;
+    BOOST_FOREACH(TStorageMap::const_reference item, this->storage) {
+        SymCallCache::Private::TStorageRef &ref =
+            this->cd->storageRefs[item.first];
+
+        if (!ref.first++) {
+            ref.second = item.second;
+            usage += item.second;
+        }
+    }
+
+    if (this->cd->peak < usage)
+        this->cd->peak = usage;
+}
+
+void SymCallCtx::Private::release() {
+    typedef SymCallCache::Private::TStorageRefs TStorageRefs;
+    TStorageRefs &refs = this->cd->storageRefs;
+    size_t &usage = this->cd->usage;
+
+    BOOST_FOREACH(TStorageMap::const_reference item, this->storage) {
+        const TStorageRefs::iterator it = refs.find(item.first);
+        CL_BREAK_IF(refs.end() == it);
+        if (--it->second.first)
+            // still referred to by another call context
+            continue;
+
+        // the size counted by the first call context referring to the block
+        CL_BREAK_IF(usage < it->second.second);
+        usage -= it->second.second;
+        refs.erase(it);
+    }
+
+    this->storage.clear();
+}
+
+void SymCallCtx::Private::enterLru(SymCallCtx *self) {
+    CL_BREAK_IF(self->d != this || this->cd->lru.end() != this->lruPos);
+    this->lruPos = this->cd->lru.insert(this->cd->lru.end(), self);
+}
+
+void SymCallCtx::Private::leaveLru() {
+    if (this->cd->lru.end() == this->lruPos)
+        // in use, thus not listed
+        return;
+
+    this->cd->lru.erase(this->lruPos);
+    this->lruPos = this->cd->lru.end();
+}
+
 void SymCallCtx::Private::assignReturnValue(SymHeap &sh) {
     const cl_operand &op = *this->dst;
     if (CL_OPERAND_VOID == op.code)
@@ -438,9 +574,22 @@ void SymCallCtx::flushCallResults(SymState &dst) {
         dst.insert(sh);
     }
 
-    // mark as done
+    if (!d->computed) {
+        d->account();
+
+        SymSummaryStore *summaries = d->cd->summaries;
+        if (summaries) {
+            // persist the just computed results for the subsequent runs
+            TSummaryMsgList msgs;
+            summaries->journalSince(msgs, d->msgStart);
+            summaries->store(*d->fnc, d->entry, d->rawResults, msgs);
+        }
+    }
+
+    // mark as done, the ctx may be evicted from now on
     d->computed = true;
     d->flushed = true;
+    d->enterLru(this);
 
     // leave backtrace
     d->cd->bt.popCall();
@@ -477,10 +626,23 @@ void SymCallCtx::invalidate() {
 #endif
 }
 
+void SymCallCtx::importGlVarsOf(const SymHeap &sh) {
+    CL_BREAK_IF(this != d->cd->ctxStack.back());
+
+    TValList live;
+    sh.gatherRootObjects(live, isGlVar);
+    BOOST_FOREACH(const TValId root, live) {
+        const CVar cv(sh.cVarByRoot(root));
+        if (!isVarAlive(d->entry, cv))
+            // this updates the corresponding cache entries as well
+            d->cd->importGlVar(d->entry, cv);
+    }
+}
+
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of SymCallCache
-SymCallCache::SymCallCache(TStorRef stor, bool ptrace):
-    d(new Private(stor, ptrace))
+SymCallCache::SymCallCache(TStorRef stor, bool ptrace, size_t budget):
+    d(new Private(stor, ptrace, budget))
 {
 }
 
@@ -492,6 +654,129 @@ SymBackTrace& SymCallCache::bt() {
     return d->bt;
 }
 
+void SymCallCache::enableSummaries(const std::string &dir, size_t salt) {
+#if SE_ENABLE_CALL_CACHE
+    CL_BREAK_IF(d->summaries);
+    d->summaries = new SymSummaryStore(d->bt.stor(), dir, salt);
+#else
+    (void) dir;
+    (void) salt;
+    CL_WARN("function summaries need SE_ENABLE_CALL_CACHE, ignoring them");
+#endif
+}
+
+void SymCallCache::printStats() const {
+    CL_NOTE("___ SymCallCache: "
+            << d->cntHits << " hit(s), "
+            << d->cntMisses << " miss(es), "
+            << d->cntEvictions << " eviction(s), "
+            << (d->usage >> 10) << " KiB in use, "
+            << (d->peak >> 10) << " KiB at peak, budget "
+            << (d->budget >> 10) << " KiB");
+
+    if (d->summaries)
+        CL_NOTE("___ SymCallCache: "
+                << d->cntSummaryHits << " summary hit(s) loaded from disk");
+}
+
+void SymCallCache::saveCache(SymWriter &wr) const {
+    // keep the LRU order, so that the eviction works the same after loading
+    const Private::TLruList &ctxs = d->lru;
+
+    wr.writeNum(ctxs.size());
+    BOOST_FOREACH(const SymCallCtx *item, ctxs) {
+        const SymCallCtx::Private *ctx = item->d;
+        wr.writeNum(uidOf(*ctx->fnc));
+        wr.writeHeap(ctx->entry);
+        wr.writeState(ctx->rawResults);
+    }
+}
+
+bool SymCallCache::loadCache(SymReader &rd) {
+    using namespace CodeStorage;
+    TStorRef stor = d->bt.stor();
+
+    typedef std::map<int /* uid */, const Fnc *> TFncMap;
+    TFncMap fncMap;
+    BOOST_FOREACH(const Fnc *fnc, stor.fncs)
+        fncMap[uidOf(*fnc)] = fnc;
+
+    long long cnt;
+    if (!rd.readNum(&cnt))
+        return false;
+
+    for (long long i = 0; i < cnt; ++i) {
+        long long uid;
+        if (!rd.readNum(&uid))
+            return false;
+
+        const TFncMap::const_iterator it = fncMap.find(uid);
+        if (fncMap.end() == it)
+            return false;
+
+        const Fnc &fnc = *it->second;
+        SymHeap entry(stor, new Trace::RootNode(&fnc));
+        SymHeapUnion results;
+        if (!rd.readHeap(&entry)
+                || !rd.readState(results, new Trace::RootNode(&fnc)))
+            return false;
+
+        d->restoreCtx(fnc, entry, results);
+    }
+
+    return true;
+}
+
+void SymCallCache::Private::restoreCtx(
+        TFncRef                         fnc,
+        const SymHeap                   &entry,
+        const SymState                  &results)
+{
+#if 1 == SE_ENABLE_CALL_CACHE
+    PerFncCache &pfc = this->cache[uidOf(fnc)];
+    SymCallCtx *&ctx = pfc.lookup(entry);
+    if (ctx)
+        // already in the cache
+        return;
+
+    ctx = new SymCallCtx(this);
+    ctx->d->fnc         = &fnc;
+    ctx->d->entry       = entry;
+    ctx->d->computed    = true;
+    ctx->d->flushed     = true;
+    ctx->d->enterLru(ctx);
+
+    BOOST_FOREACH(const SymHeap *sh, results)
+        ctx->d->rawResults.insert(*sh);
+
+    ctx->d->account();
+#else
+    // the join-based lookup may generalize the entry, which the results would
+    // not be valid for any more
+    (void) fnc;
+    (void) entry;
+    (void) results;
+#endif
+}
+
+void SymCallCache::Private::enforceBudget() {
+    if (!this->budget)
+        // unlimited
+        return;
+
+    // evict the least recently used contexts first, the ones used by the
+    // current backtrace are not listed, so that nothing is visited in vain
+    while (this->budget < this->usage && !this->lru.empty()) {
+        SymCallCtx *ctx = this->lru.front();
+        const int uid = uidOf(*ctx->d->fnc);
+        this->cache[uid].evict(ctx);
+        ++this->cntEvictions;
+    }
+
+    if (this->budget < this->usage)
+        CL_DEBUG("SymCallCache is over budget, but nothing more to evict");
+}
+
 void pullGlVar(SymHeap &result, SymHeap origin, const CVar &cv) {
     // do not try to combine things, it causes problems
     CL_BREAK_IF(!areEqual(result, SymHeap(origin.stor(), origin.traceNode())));
@@ -526,18 +811,12 @@ void pushGlVar(SymHeap &dst, const SymHeap &glSubHeap, const CVar &cv) {
     joinHeapsByCVars(&dst, &glSubHeap);
 }
 
-void SymCallCache::Private::importGlVar(SymHeap &entry, const CVar &cv) {
+int SymCallCache::Private::pullGlVarFromStack(
+        SymHeap                         &glSubHeap,
+        const CVar                      &cv)
+{
     const int cnt = this->ctxStack.size();
-    if (!cnt) {
-        // empty ctx stack --> no heap to import the var from
-        initGlVar(entry, cv);
-        return;
-    }
-
-    TStorRef stor = entry.stor();
-    const struct cl_loc *loc = 0;
-    std::string varString = varToString(stor, cv.uid, &loc);
-    CL_DEBUG_MSG(loc, "<G> importGlVar() imports variable " << varString);
+    CL_BREAK_IF(!cnt);
 
     // seek the gl var going through the ctx stack backward
     int idx;
@@ -551,10 +830,26 @@ void SymCallCache::Private::importGlVar(SymHeap &entry, const CVar &cv) {
 
     // 'origin' is the heap that we are importing the gl var from
     const SymHeap &origin = this->ctxStack[idx]->d->callFrame;
+    pullGlVar(glSubHeap, origin, cv);
+    return idx;
+}
 
-    // pull the designated gl var from 'origin'
+void SymCallCache::Private::importGlVar(SymHeap &entry, const CVar &cv) {
+    const int cnt = this->ctxStack.size();
+    if (!cnt) {
+        // empty ctx stack --> no heap to import the var from
+        initGlVar(entry, cv);
+        return;
+    }
+
+    TStorRef stor = entry.stor();
+    const struct cl_loc *loc = 0;
+    std::string varString = varToString(stor, cv.uid, &loc);
+    CL_DEBUG_MSG(loc, "<G> importGlVar() imports variable " << varString);
+
+    // pull the designated gl var from the nearest call frame that has it
     SymHeap glSubHeap(stor, new Trace::TransientNode("importGlVar()"));
-    pullGlVar(glSubHeap, origin, cv);
+    int idx = this->pullGlVarFromStack(glSubHeap, cv);
 
     // go through all heaps above the 'origin' up to the current call level
     for (; idx < cnt; ++idx) {
@@ -577,6 +872,62 @@ void SymCallCache::Private::importGlVar(SymHeap &entry, const CVar &cv) {
     pushGlVar(entry, glSubHeap, cv);
 }
 
+bool SymCallCache::Private::loadSummary(PerFncCache &pfc, SymCallCtx *ctx) {
+    SymHeap &entry = ctx->d->entry;
+    TStorRef stor = entry.stor();
+
+    const SymSummaryStore::TSummaryList &sums =
+        this->summaries->lookup(*ctx->d->fnc);
+
+    BOOST_FOREACH(const SymSummary *sum, sums) {
+        // gl vars that were imported lazily while computing the summary
+        TCVarList missing;
+        TValList live;
+        sum->entry.gatherRootObjects(live, isGlVar);
+        BOOST_FOREACH(const TValId root, live) {
+            const CVar cv(sum->entry.cVarByRoot(root));
+            if (!isVarAlive(entry, cv))
+                missing.push_back(cv);
+        }
+
+        // import them the same way as the computation did, but only locally
+        SymHeap probe(entry);
+        BOOST_FOREACH(const CVar &cv, missing) {
+            SymHeap glSubHeap(stor, new Trace::TransientNode("loadSummary()"));
+            this->pullGlVarFromStack(glSubHeap, cv);
+            pushGlVar(probe, glSubHeap, cv);
+        }
+
+        if (!areEqual(probe, sum->entry))
+            continue;
+
+        // summary matched, now import the gl vars for real
+        if (!missing.empty()) {
+            const SymHeap src(entry);
+            BOOST_FOREACH(const CVar &cv, missing)
+                this->importGlVar(entry, cv);
+
+            pfc.updateCacheEntry(src, entry);
+        }
+
+        BOOST_FOREACH(const SymHeap &sh, sum->results)
+            ctx->d->rawResults.insert(sh);
+
+        // the messages would otherwise be lost for this run
+        SymSummaryStore::replay(sum->msgs);
+
+        const struct cl_loc *loc = locationOf(*ctx->d->fnc);
+        CL_DEBUG_MSG(loc, "SymCallCache reuses a summary of "
+                << nameOf(*ctx->d->fnc) << "() loaded from disk");
+
+        ctx->d->computed = true;
+        ctx->d->account();
+        return true;
+    }
+
+    return false;
+}
+
 void SymCallCache::Private::resolveHeapCut(
         TCVarList                       &cut,
         SymHeap                         &sh,
@@ -686,17 +1037,29 @@ void setCallArgs(
 }
 
 SymCallCtx* SymCallCache::Private::getCallCtx(const SymHeap &entry, TFncRef fnc) {
+    // make some room in the cache if needed
+    this->enforceBudget();
+
     // cache lookup
     const int uid = uidOf(fnc);
     PerFncCache &pfc = this->cache[uid];
     SymCallCtx *&ctx = pfc.lookup(entry);
     if (!ctx) {
         // cache miss
+        ++this->cntMisses;
         ctx = new SymCallCtx(this);
         ctx->d->fnc     = &fnc;
         ctx->d->entry   = entry;
         Trace::waiveCloneOperation(ctx->d->entry);
 
+        if (this->summaries) {
+            ctx->d->msgStart = this->summaries->journalSize();
+
+            // the root function has no caller to import gl vars from
+            if (!this->ctxStack.empty() && this->loadSummary(pfc, ctx))
+                ++this->cntSummaryHits;
+        }
+
         // enter ctx stack
         this->ctxStack.push_back(ctx);
         return ctx;
@@ -719,6 +1082,8 @@ SymCallCtx* SymCallCache::Private::getCallCtx(const SymHeap &entry, TFncRef fnc)
     }
 
     // enter ctx stack
+    ++this->cntHits;
+    ctx->d->leaveLru();
     this->ctxStack.push_back(ctx);
 
     // all OK, return the cached ctx
@@ -28,9 +28,13 @@
 
 #include "symheap.hh"
 
+#include <string>
+
 class SymBackTrace;
-class SymState;
 class SymCallCtx;
+class SymReader;
+class SymState;
+class SymWriter;
 
 namespace CodeStorage {
     struct Fnc;
@@ -40,12 +44,33 @@ namespace CodeStorage {
 /// persistent cache for results of fncs called during the symbolic execution
 class SymCallCache {
     public:
-        /// create long term cache, this should happen once per SymExec lifetime
-        SymCallCache(TStorRef stor, bool ptrace);
+        /**
+         * create long term cache, this should happen once per SymExec lifetime
+         * @param budget upper bound of memory occupied by the cached call
+         * contexts (in bytes), zero means unlimited
+         */
+        SymCallCache(TStorRef stor, bool ptrace, size_t budget = 0);
         ~SymCallCache();
 
         SymBackTrace& bt();
 
+        /**
+         * store the computed call contexts on disk and reuse the ones stored
+         * by previous runs of the analyzer
+         * @param dir directory where the summaries are stored
+         * @param salt hash of the analysis settings the results depend on
+         */
+        void enableSummaries(const std::string &dir, size_t salt);
+
+        /// print hit/miss/eviction statistics of the cache
+        void printStats() const;
+
+        /// serialize all call contexts with the results already computed
+        void saveCache(SymWriter &wr) const;
+
+        /// load call contexts serialized by saveCache() into the cache
+        bool loadCache(SymReader &rd);
+
         /**
          * cache entry point.  This returns either existing, or a newly created
          * call context.
@@ -113,6 +138,14 @@ class SymCallCtx {
          */
         void flushCallResults(SymState &dst);
 
+        /**
+         * import gl variables that are alive in the given heap, but not in
+         * entry() yet.  This is used to bring the entry of a context that is
+         * being restored from a checkpoint up to date with the gl variables
+         * imported lazily before the checkpoint was taken.
+         */
+        void importGlVarsOf(const SymHeap &sh);
+
         /**
          * invalidate the context, which may trigger its removal from cache and
          * consequently destruction of the SymCallCtx object itself
@@ -31,6 +31,7 @@
 #include <stack>
 
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/tuple/tuple.hpp>
 
 bool matchPlainValuesCore(
@@ -221,10 +222,8 @@ bool cmpValues(
         return false;
 
     if (VT_CUSTOM == code) {
-        // match pair of custom values
-        const CustomValue cVal1 = sh1.valUnwrapCustom(v1);
-        const CustomValue cVal2 = sh2.valUnwrapCustom(v2);
-        return (cVal1 == cVal2);
+        // custom values are interned, so it is enough to compare their IDs
+        return (sh1.valCustomId(v1) == sh2.valCustomId(v2));
     }
 
     if (isPossibleToDeref(code))
@@ -336,6 +335,10 @@ bool areEqual(
         const SymHeap           &sh1,
         const SymHeap           &sh2)
 {
+    if (sh1.sharesDataWith(sh2))
+        // physically shared data, no need to traverse anything
+        return true;
+
     SymHeap &sh1Writable = const_cast<SymHeap &>(sh1);
     SymHeap &sh2Writable = const_cast<SymHeap &>(sh2);
 
@@ -366,3 +369,126 @@ bool areEqual(
     return sh1.matchPreds(sh2, vMap[0])
         && sh2.matchPreds(sh1, vMap[1]);
 }
+
+size_t hashOfCustomValue(const CustomValue &cVal) {
+    const ECustomValue code = cVal.code();
+    size_t hash = static_cast<size_t>(code);
+
+    switch (code) {
+        case CV_INVALID:
+            break;
+
+        case CV_FNC:
+            boost::hash_combine(hash, cVal.uid());
+            break;
+
+        case CV_INT_RANGE:
+            boost::hash_combine(hash, cVal.rng().lo);
+            boost::hash_combine(hash, cVal.rng().hi);
+            boost::hash_combine(hash, cVal.rng().alignment);
+            break;
+
+        case CV_REAL:
+            boost::hash_combine(hash, cVal.fpn());
+            break;
+
+        case CV_STRING:
+            boost::hash_combine(hash, cVal.str());
+            break;
+    }
+
+    return hash;
+}
+
+/// hash the properties of a root that matchRoots() and cmpValues() compare
+size_t hashOfRoot(const SymHeap &sh, const TValId root) {
+    const EValueTarget code = sh.valTarget(root);
+    size_t hash = static_cast<size_t>(code);
+
+    const TSizeRange size = sh.valSizeOfTarget(root);
+    boost::hash_combine(hash, size.lo);
+    boost::hash_combine(hash, size.hi);
+    boost::hash_combine(hash, size.alignment);
+    boost::hash_combine(hash, sh.valTargetProtoLevel(root));
+
+    if (!isAbstract(code))
+        return hash;
+
+    const EObjKind kind = sh.valTargetKind(root);
+    boost::hash_combine(hash, static_cast<int>(kind));
+    boost::hash_combine(hash, sh.segMinLength(root));
+    if (OK_OBJ_OR_NULL == kind)
+        // this kind has no binding
+        return hash;
+
+    const BindingOff &bf = sh.segBinding(root);
+    boost::hash_combine(hash, bf.head);
+    boost::hash_combine(hash, bf.next);
+    boost::hash_combine(hash, bf.prev);
+    return hash;
+}
+
+size_t hashOfHeap(const SymHeap &sh)
+{
+    SymHeap &writable = const_cast<SymHeap &>(sh);
+
+    // program variables have to match exactly, so their order is stable
+    TCVarList vars;
+    gatherProgramVars(vars, sh);
+    std::sort(vars.begin(), vars.end());
+
+    size_t hash = vars.size();
+    WorkList<TValId> wl;
+    BOOST_FOREACH(const CVar &cv, vars) {
+        boost::hash_combine(hash, cv.uid);
+        boost::hash_combine(hash, cv.inst);
+
+        const TValId root = writable.addrOfVar(cv, /* createIfNeeded */ false);
+        wl.schedule(root);
+    }
+
+    // go through all roots that dfsCmp() would follow, the order of visiting
+    // is not canonical, so that we combine the per-root hashes commutatively
+    size_t rootsHash = 0;
+    TValId root;
+    while (wl.next(root)) {
+        size_t rootHash = hashOfRoot(sh, root);
+
+        // custom values at the same offset may be read via several objects
+        typedef std::pair<TOffset, size_t> TCustomItem;
+        std::set<TCustomItem> customs;
+
+        ObjList objs;
+        sh.gatherLiveObjects(objs, root);
+        BOOST_FOREACH(const ObjHandle &obj, objs) {
+            const TValId val = obj.value();
+            if (val <= 0)
+                continue;
+
+            const EValueTarget code = sh.valTarget(val);
+            if (VT_CUSTOM == code) {
+                const TOffset off = sh.valOffset(obj.placedAt());
+                const size_t cHash = hashOfCustomValue(sh.valUnwrapCustom(val));
+                customs.insert(TCustomItem(off, cHash));
+                continue;
+            }
+
+            if (isPossibleToDeref(code))
+                wl.schedule(writable.valRoot(val));
+        }
+
+        BOOST_FOREACH(const TCustomItem &item, customs) {
+            boost::hash_combine(rootHash, item.first);
+            boost::hash_combine(rootHash, item.second);
+        }
+
+        rootsHash += rootHash;
+    }
+
+    boost::hash_combine(hash, wl.cntSeen());
+    boost::hash_combine(hash, rootsHash);
+
+    // matchPreds() establishes a bijection among predicates of equal heaps
+    boost::hash_combine(hash, sh.cntPreds());
+    return hash;
+}
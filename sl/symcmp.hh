@@ -37,6 +37,13 @@ bool areEqual(
         const SymHeap           &sh1,
         const SymHeap           &sh2);
 
+/**
+ * isomorphism-invariant fingerprint of the given symbolic heap
+ * @note areEqual(sh1, sh2) implies (hashOfHeap(sh1) == hashOfHeap(sh2)), so
+ * that areEqual() needs to be called only if the fingerprints collide
+ */
+size_t hashOfHeap(const SymHeap &sh);
+
 inline bool checkNonPosValues(int a, int b) {
     if (0 < a && 0 < b)
         // we'll need to properly compare positive values
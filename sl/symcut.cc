@@ -31,7 +31,9 @@
 #include "symtrace.hh"
 #include "worklist.hh"
 
+#include <algorithm>
 #include <iomanip>
+#include <iterator>
 #include <map>
 #include <set>
 
@@ -329,7 +331,8 @@ void deepCopy(DeepCopyData &dc) {
 }
 
 void prune(const SymHeap &src, SymHeap &dst,
-           /* NON-const */ DeepCopyData::TCut &cut, bool forwardOnly = false)
+           /* NON-const */ DeepCopyData::TCut &cut, bool forwardOnly = false,
+           TValSet *pSrcRoots = 0)
 {
     DeepCopyData dc(src, dst, cut, !forwardOnly);
     DeepCopyData::TCut snap(cut);
@@ -348,8 +351,188 @@ void prune(const SymHeap &src, SymHeap &dst,
 
     // go through the worklist
     deepCopy(dc);
+
+    if (!pSrcRoots)
+        return;
+
+    // roots of all values of src that have been copied
+    BOOST_FOREACH(TValMap::const_reference item, dc.valMap)
+        if (0 < item.first)
+            pSrcRoots->insert(src.valRoot(item.first));
+}
+
+#if SE_SYMCUT_SHARES_ENTITIES
+/// what prune() would copy, gathered without actually copying anything
+struct ShareCutData {
+    typedef DeepCopyData::TCut                                  TCut;
+
+    SymHeap             &sh;
+    TCut                &cut;
+
+    /// roots of values prune() would put into its valMap
+    TValSet             relevantRoots;
+
+    /// roots prune() would copy (each of them is scheduled at most once)
+    WorkList<TValId>    wl;
+
+    ShareCutData(SymHeap &sh_, TCut &cut_):
+        sh(sh_),
+        cut(cut_)
+    {
+    }
+};
+
+void shareValue(ShareCutData &sc, const TValId val) {
+    if (val <= 0)
+        // special values always match
+        return;
+
+    SymHeap &sh = sc.sh;
+    const TValId root = sh.valRoot(val);
+    sc.relevantRoots.insert(root);
+    if (VAL_NULL == root)
+        // the same as trackUses() does, nothing to track actually
+        return;
+
+    if (isPossibleToDeref(sh.valTarget(root))) {
+        // the target is going to be kept
+        sc.wl.schedule(root);
+        return;
+    }
+
+    // the same as trackUses() does, keep all objects using the value
+    ObjList uses;
+    sh.usedBy(uses, val, /* liveOnly */ true);
+    BOOST_FOREACH(const ObjHandle &obj, uses) {
+        const TValId at = obj.placedAt();
+        if (isPossibleToDeref(sh.valTarget(at)))
+            sc.wl.schedule(sh.valRoot(at));
+    }
+}
+
+void shareRoot(ShareCutData &sc, const TValId root) {
+    SymHeap &sh = sc.sh;
+    sc.relevantRoots.insert(root);
+
+    if (0 < root) {
+        // the same as trackUses() does, keep all objects pointing to the root
+        ObjList refs;
+        sh.pointedBy(refs, root);
+        BOOST_FOREACH(const ObjHandle &obj, refs)
+            sc.wl.schedule(sh.valRoot(obj.placedAt()));
+
+        if (isProgramVar(sh.valTarget(root)))
+            // enlarge the cut if needed
+            sc.cut.insert(sh.cVarByRoot(root));
+    }
+
+    // go through values of all live objects inside the root
+    ObjList objs;
+    sh.gatherLiveObjects(objs, root);
+    BOOST_FOREACH(const ObjHandle &obj, objs) {
+        if (isComposite(obj.objType(), /* includingArray */ false))
+            continue;
+
+        shareValue(sc, obj.value());
+    }
+}
+
+/**
+ * the same as prune() with sh as both src and dst, but without copying
+ * @return false if the part to keep does not dominate the heap, in which case
+ * sh is left intact and the caller is supposed to use prune() instead
+ */
+bool pruneInPlace(SymHeap &sh, /* NON-const */ DeepCopyData::TCut &cut) {
+    ShareCutData sc(sh, cut);
+    const DeepCopyData::TCut snap(cut);
+
+    // go through all program variables
+    BOOST_FOREACH(CVar cv, snap)
+        sc.wl.schedule(sh.addrOfVar(cv, /* createIfNeeded */ true));
+
+    if (sh.valLastKnownTypeOfTarget(VAL_ADDR_OF_RET))
+        sc.wl.schedule(VAL_ADDR_OF_RET);
+
+    // gather all the roots to be kept
+    TValId root;
+    while (sc.wl.next(root))
+        shareRoot(sc, root);
+
+    if (2 * sc.wl.cntSeen() < sh.cntRootObjects())
+        // copying the small part to keep is cheaper than destroying the rest
+        return false;
+
+    TValList live, junk;
+    sh.gatherRootObjects(live);
+    BOOST_FOREACH(const TValId root, live)
+        if (VAL_ADDR_OF_RET != root && !sc.wl.seen(root))
+            junk.push_back(root);
+
+    // destroy all the other roots, the kept ones remain shared with the origin
+    BOOST_FOREACH(const TValId root, junk)
+        sh.valDestroyTarget(root);
+
+    if (sh.cntPreds())
+        // the same as copyRelevantPreds() does, drop the predicates of the rest
+        sh.dropIrrelevantPreds(sc.relevantRoots);
+
+    return true;
 }
 
+/**
+ * destroy the part of heap that prune() has copied elsewhere, sh is supposed
+ * to be a (copy-on-write) copy of the heap prune() has been copying from
+ * @param cutRoots roots of the values prune() has copied (see pSrcRoots)
+ */
+void destroyCutInPlace(SymHeap &sh, const TValSet &cutRoots) {
+    BOOST_FOREACH(const TValId root, cutRoots) {
+        if (VAL_ADDR_OF_RET == root)
+            // VAL_ADDR_OF_RET is copied to both parts
+            continue;
+
+        if (isPossibleToDeref(sh.valTarget(root)))
+            sh.valDestroyTarget(root);
+    }
+
+    if (!sh.cntPreds())
+        return;
+
+    TValList predVals;
+    TValPairList neqs;
+    sh.gatherNeqPreds(neqs);
+    BOOST_FOREACH(const TValPair &item, neqs) {
+        predVals.push_back(item.first);
+        predVals.push_back(item.second);
+    }
+
+    TCoinList coins;
+    sh.gatherCoincidences(coins);
+    BOOST_FOREACH(TCoinList::const_reference item, coins) {
+        predVals.push_back(item.first.first);
+        predVals.push_back(item.first.second);
+    }
+
+    // the same as copyRelevantPreds() does, drop the predicates over values
+    // cut out, and over values no live object in the frame refers to
+    TValSet dropRoots(cutRoots);
+    BOOST_FOREACH(const TValId val, predVals) {
+        if (val <= 0)
+            continue;
+
+        const TValId root = sh.valRoot(val);
+        if (isPossibleToDeref(sh.valTarget(root)))
+            continue;
+
+        ObjList uses;
+        sh.usedBy(uses, val, /* liveOnly */ true);
+        if (uses.empty())
+            dropRoots.insert(root);
+    }
+
+    sh.dropPredsOf(dropRoots);
+}
+#endif
+
 void splitHeapByCVars(
         SymHeap                     *srcDst,
         const TCVarList             &cut,
@@ -377,8 +560,25 @@ void splitHeapByCVars(
 #if DEBUG_SYMCUT || !defined NDEBUG
     const unsigned cntOrig = cset.size();
 #endif
+#if SE_SYMCUT_SHARES_ENTITIES
+    // start with a copy-on-write copy of the original heap
+    SymHeap dst(*srcDst);
+    dst.traceUpdate(new Trace::TransientNode("splitHeapByCVars()"));
+
+    // roots of the part to keep, if it has been deep-copied
+    TValSet cutRoots;
+    const bool cutInPlace = pruneInPlace(dst, cset);
+    if (!cutInPlace) {
+        // fall back to deep copy of the part to keep
+        dst = SymHeap(srcDst->stor(),
+                new Trace::TransientNode("splitHeapByCVars()"));
+        prune(*srcDst, dst, cset, /* forwardOnly */ false,
+                (saveFrameTo) ? &cutRoots : 0);
+    }
+#else
     SymHeap dst(srcDst->stor(), new Trace::TransientNode("splitHeapByCVars()"));
     prune(*srcDst, dst, cset);
+#endif
 
     if (!saveFrameTo) {
         // we're done
@@ -388,17 +588,26 @@ void splitHeapByCVars(
 #if DEBUG_SYMCUT
     CL_DEBUG("splitHeapByCVars() is computing the frame...");
 #endif
-    // get the complete list of program variables
-    TCVarList all;
+    // get the complete set of program variables
+    DeepCopyData::TCut all;
     gatherProgramVars(all, *srcDst);
 
-    // compute set difference (we cannot use std::set_difference since 'all' is
-    // not sorted, which would break the algorithm badly)
+    // compute set difference
     DeepCopyData::TCut complement;
-    BOOST_FOREACH(const CVar &cv, all)
-        if (!hasKey(cset, cv))
-            complement.insert(cv);
-
+    std::set_difference(all.begin(), all.end(), cset.begin(), cset.end(),
+            std::inserter(complement, complement.end()));
+
+#if SE_SYMCUT_SHARES_ENTITIES
+    if (!cutInPlace) {
+        // the frame dominates the heap, start with a copy-on-write copy of the
+        // original heap and destroy only the part that has been cut out
+        const Trace::NodeHandle trFrame(saveFrameTo->traceNode());
+        *saveFrameTo = *srcDst;
+        saveFrameTo->traceUpdate(trFrame.node());
+        destroyCutInPlace(*saveFrameTo, cutRoots);
+    }
+    else
+#endif
     // compute the corresponding frame
     prune(*srcDst, *saveFrameTo, complement);
 
@@ -441,6 +650,31 @@ void joinHeapsByCVars(
 {
 #if SE_DISABLE_SYMCUT
     return;
+#endif
+#if SE_SYMCUT_SHARES_ENTITIES
+    if (srcDst->lastId() < src2->lastId()
+            && !src2->valLastKnownTypeOfTarget(VAL_ADDR_OF_RET))
+    {
+        // *src2 is the bigger one, e.g. a frame shared with the caller, merge
+        // *srcDst into a copy-on-write copy of it instead, so that the cost
+        // depends on the size of *srcDst only
+        DeepCopyData::TCut cset;
+        gatherProgramVars(cset, *srcDst);
+
+        SymHeap dst(*src2);
+        const TObjType cltRet = srcDst->valLastKnownTypeOfTarget(VAL_ADDR_OF_RET);
+        if (cltRet)
+            // the target of VAL_ADDR_OF_RET needs to exist before it is copied
+            dst.valSetLastKnownTypeOfTarget(VAL_ADDR_OF_RET, cltRet);
+
+        prune(*srcDst, dst, cset);
+
+        // keep the trace of *srcDst
+        const Trace::NodeHandle trace(srcDst->traceNode());
+        dst.traceUpdate(trace.node());
+        srcDst->swap(dst);
+        return;
+    }
 #endif
     // gather _all_ program variables of *src2
     DeepCopyData::TCut cset;
@@ -29,8 +29,10 @@
 #include "symseg.hh"
 #include "symutil.hh"
 #include "util.hh"
+#include "worklist.hh"
 
 #include <algorithm>                // for std::copy()
+#include <iterator>                 // for std::back_inserter()
 #include <set>
 
 #include <boost/foreach.hpp>
@@ -592,6 +594,40 @@ unsigned /* len */ selectBestAbstraction(
     return bestLen;
 }
 
+#if SH_TRACK_DIRTY_ROOTS
+/// heap roots that a segment may start at and go through any of the dirty roots
+void gatherAffectedEntries(
+        TValList                    &dst,
+        SymHeap                     &sh,
+        const TValSet               &dirty)
+{
+    WorkList<TValId> wl;
+    BOOST_FOREACH(const TValId root, dirty)
+        wl.schedule(root);
+
+    // TValSet is ordered, so is the resulting list of entries
+    TValSet entries;
+
+    TValId root;
+    while (wl.next(root)) {
+        const EValueTarget code = sh.valTarget(root);
+        if (!isOnHeap(code))
+            // the predecessors of freed roots have been marked dirty already
+            continue;
+
+        entries.insert(root);
+
+        // any object pointing at the root may precede it on a path
+        ObjList refs;
+        sh.pointedBy(refs, root);
+        BOOST_FOREACH(const ObjHandle &obj, refs)
+            wl.schedule(sh.valRoot(obj.placedAt()));
+    }
+
+    std::copy(entries.begin(), entries.end(), std::back_inserter(dst));
+}
+#endif
+
 unsigned /* len */ discoverBestAbstraction(
         SymHeap             &sh,
         BindingOff          *off,
@@ -601,7 +637,15 @@ unsigned /* len */ discoverBestAbstraction(
 
     // go through all potential segment entries
     TValList addrs;
-    sh.gatherRootObjects(addrs, isOnHeap);
+#if SH_TRACK_DIRTY_ROOTS
+    // the previous discovery on this heap found nothing, unless it was changed
+    TValSet dirty;
+    if (sh.gatherDirtyRoots(dirty))
+        gatherAffectedEntries(addrs, sh, dirty);
+    else
+#endif
+        sh.gatherRootObjects(addrs, isOnHeap);
+
     BOOST_FOREACH(const TValId at, addrs) {
         // use ProbeEntryVisitor visitor to validate the potential segment entry
         SegCandidate segc;
@@ -616,5 +660,10 @@ unsigned /* len */ discoverBestAbstraction(
         candidates.push_back(segc);
     }
 
-    return selectBestAbstraction(sh, candidates, off, entry);
+    const unsigned len = selectBestAbstraction(sh, candidates, off, entry);
+    if (!len)
+        // nothing to abstract, no need to look at the same roots next time
+        sh.clearDirtyRoots();
+
+    return len;
 }
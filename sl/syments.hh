@@ -21,7 +21,9 @@
 #define H_GUARD_SYM_ENTS_H
 
 #include "config.h"
+#include "memdebug.hh"
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -164,10 +166,22 @@ struct RefCntLib<RCO_NON_VIRT>: public RefCntLibBase {
 };
 
 
+/**
+ * two-level table of entities indexed by their IDs
+ *
+ * The IDs are split into chunks of SH_ENT_STORE_CHUNK_SIZE entities.  Both the
+ * table of chunks and the chunks themselves are reference-counted, so that
+ * copying of EntStore is O(1) as long as SH_COPY_ON_WRITE is enabled.  A write
+ * access then clones only the table of chunks and the chunk being written to.
+ */
 template <class TBaseEnt>
 class EntStore {
     public:
-        EntStore() { }
+        EntStore():
+            tab_(new Table)
+        {
+        }
+
         inline EntStore(const EntStore &);
         inline ~EntStore();
 
@@ -178,7 +192,7 @@ class EntStore {
 
         template <typename TId> TId lastId() const {
             // we need to be careful with integral arithmetic on enums
-            const long last = -1L + ents_.size();
+            const long last = -1L + tab_->size;
             return static_cast<TId>(last);
         }
 
@@ -186,6 +200,15 @@ class EntStore {
             return (this->lastId<TId>() < id) || (id < 0);
         }
 
+        /// true if both stores physically share their table of entities
+        bool sharesDataWith(const EntStore &ref) const {
+            return (tab_ == ref.tab_);
+        }
+
+        /// key the table and each chunk by its address, see SymHeapCore
+        template <class TDst>
+        inline void gatherStorage(TDst &dst, const size_t sizeOfEnt) const;
+
         template <typename TId> inline const TBaseEnt* getEntRO(const TId id);
         template <typename TId> inline TBaseEnt* getEntRW(const TId id);
 
@@ -199,16 +222,125 @@ class EntStore {
         // intentionally not implemented
         EntStore& operator=(const EntStore &);
 
-        std::vector<TBaseEnt *>                 ents_;
+        enum {
+            CHUNK_SIZE = SH_ENT_STORE_CHUNK_SIZE
+        };
+
+        struct Chunk: public MemAccounted<MC_ENT_STORE> {
+            RefCounter                          refCnt;
+            TBaseEnt                            *ents[CHUNK_SIZE];
+
+            Chunk() {
+                std::fill(ents, ents + CHUNK_SIZE, static_cast<TBaseEnt *>(0));
+            }
+
+            inline Chunk(const Chunk &);
+            inline ~Chunk();
+
+            private:
+                // intentionally not implemented
+                Chunk& operator=(const Chunk &);
+        };
+
+        typedef MemAccountAllocator<Chunk *, MC_ENT_STORE>  TChunkAlloc;
+
+        struct Table: public MemAccounted<MC_ENT_STORE> {
+            RefCounter                          refCnt;
+            std::vector<Chunk *, TChunkAlloc>   chunks;
+            unsigned                            size;
+
+            Table():
+                size(0)
+            {
+            }
+
+            inline Table(const Table &);
+            inline ~Table();
+
+            private:
+                // intentionally not implemented
+                Table& operator=(const Table &);
+        };
+
+        Table                                  *tab_;
 
 #if SH_REUSE_FREE_IDS
         std::queue<unsigned>                    freeIds_;
 #endif
+
+        template <typename TId> inline TBaseEnt* const& slotRO(const TId) const;
+        template <typename TId> inline TBaseEnt*& slotRW(const TId);
+        inline void grow(unsigned size);
 };
 
 
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of EntStore
+template <class TBaseEnt>
+EntStore<TBaseEnt>::Chunk::Chunk(const Chunk &ref):
+    refCnt(ref.refCnt)
+{
+    std::copy(ref.ents, ref.ents + CHUNK_SIZE, ents);
+    BOOST_FOREACH(TBaseEnt *&ent, ents)
+        if (ent)
+            RefCntLib<RCO_VIRTUAL>::enter(ent);
+}
+
+template <class TBaseEnt>
+EntStore<TBaseEnt>::Chunk::~Chunk() {
+    BOOST_FOREACH(TBaseEnt *&ent, ents)
+        if (ent)
+            RefCntLib<RCO_VIRTUAL>::leave(ent);
+}
+
+template <class TBaseEnt>
+EntStore<TBaseEnt>::Table::Table(const Table &ref):
+    refCnt(ref.refCnt),
+    chunks(ref.chunks),
+    size(ref.size)
+{
+    BOOST_FOREACH(Chunk *&chunk, chunks)
+        RefCntLib<RCO_NON_VIRT>::enter(chunk);
+}
+
+template <class TBaseEnt>
+EntStore<TBaseEnt>::Table::~Table() {
+    BOOST_FOREACH(Chunk *&chunk, chunks)
+        RefCntLib<RCO_NON_VIRT>::leave(chunk);
+}
+
+template <class TBaseEnt>
+template <typename TId>
+TBaseEnt* const& EntStore<TBaseEnt>::slotRO(const TId id) const {
+    const unsigned idx = id;
+    const Chunk *chunk = tab_->chunks[idx / CHUNK_SIZE];
+    return chunk->ents[idx % CHUNK_SIZE];
+}
+
+template <class TBaseEnt>
+template <typename TId>
+TBaseEnt*& EntStore<TBaseEnt>::slotRW(const TId id) {
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(tab_);
+
+    const unsigned idx = id;
+    Chunk *&chunk = tab_->chunks[idx / CHUNK_SIZE];
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(chunk);
+    return chunk->ents[idx % CHUNK_SIZE];
+}
+
+template <class TBaseEnt>
+void EntStore<TBaseEnt>::grow(const unsigned size) {
+    CL_BREAK_IF(size < tab_->size);
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(tab_);
+
+    // allocate the missing chunks (if any)
+    std::vector<Chunk *, TChunkAlloc> &chunks = tab_->chunks;
+    while (chunks.size() * CHUNK_SIZE < size)
+        chunks.push_back(new Chunk);
+
+    tab_->size = size;
+}
+
 template <class TBaseEnt>
 template <typename TId>
 TId EntStore<TBaseEnt>::assignId(TBaseEnt *ptr) {
@@ -218,14 +350,17 @@ TId EntStore<TBaseEnt>::assignId(TBaseEnt *ptr) {
     if (!this->freeIds_.empty()) {
         const TId id = static_cast<TId>(this->freeIds_.front());
         this->freeIds_.pop();
-        this->ents_[id] = ptr;
+        this->slotRW(id) = ptr;
         CL_DEBUG("reusing heap ID #" << id 
-                << " (heap size is " << this->ents_.size() << ")");
+                << " (heap size is " << tab_->size << ")");
         return id;
     }
 #endif
-    this->ents_.push_back(ptr);
-    return this->lastId<TId>();
+    this->grow(tab_->size + 1);
+
+    const TId id = this->lastId<TId>();
+    this->slotRW(id) = ptr;
+    return id;
 }
 
 template <class TBaseEnt>
@@ -235,9 +370,9 @@ void EntStore<TBaseEnt>::assignId(const TId id, TBaseEnt *ptr) {
 
     // make sure we have enough space allocated
     if (this->lastId<TId>() < id)
-        ents_.resize(id + 1, 0);
+        this->grow(id + 1);
 
-    TBaseEnt *&ref = ents_[id];
+    TBaseEnt *&ref = this->slotRW(id);
 
     // if this fails, you wanted to overwrite pointer to a valid entity
     CL_BREAK_IF(ref);
@@ -251,7 +386,7 @@ void EntStore<TBaseEnt>::releaseEnt(const TId id) {
 #if SH_REUSE_FREE_IDS
     freeIds_.push(id);
 #endif
-    RefCntLib<RCO_VIRTUAL>::leave(ents_[id]);
+    RefCntLib<RCO_VIRTUAL>::leave(this->slotRW(id));
 }
 
 template <class TBaseEnt>
@@ -260,23 +395,32 @@ bool EntStore<TBaseEnt>::isValidEnt(const TId id) const {
     if (this->outOfRange(id))
         return false;
 
-    return !!ents_[id];
+    return !!this->slotRO(id);
 }
 
 template <class TBaseEnt>
 EntStore<TBaseEnt>::EntStore(const EntStore &ref):
-    ents_(ref.ents_)
+    tab_(ref.tab_)
 {
-    BOOST_FOREACH(TBaseEnt *&ent, ents_)
-        if (ent)
-            RefCntLib<RCO_VIRTUAL>::enter(ent);
+    // the chunks are cloned lazily on write (if SH_COPY_ON_WRITE is enabled)
+    RefCntLib<RCO_NON_VIRT>::enter(tab_);
 }
 
 template <class TBaseEnt>
 EntStore<TBaseEnt>::~EntStore() {
-    BOOST_FOREACH(TBaseEnt *ent, ents_)
-        if (ent)
-            RefCntLib<RCO_VIRTUAL>::leave(ent);
+    RefCntLibBase::leave(tab_);
+}
+
+template <class TBaseEnt>
+template <class TDst>
+void EntStore<TBaseEnt>::gatherStorage(TDst &dst, const size_t sizeOfEnt) const
+{
+    const std::vector<Chunk *, TChunkAlloc> &chunks = tab_->chunks;
+    dst[tab_] = sizeof(Table) + chunks.size() * sizeof(Chunk *);
+
+    // each slot of a chunk is counted as if it was occupied
+    BOOST_FOREACH(const Chunk *chunk, chunks)
+        dst[chunk] = sizeof(Chunk) + CHUNK_SIZE * sizeOfEnt;
 }
 
 template <class TBaseEnt>
@@ -287,7 +431,7 @@ inline const TBaseEnt* EntStore<TBaseEnt>::getEntRO(const TId id)
     CL_BREAK_IF(this->outOfRange(id));
 
     // if this fails, the ID is no longer valid
-    const TBaseEnt *ptr = ents_[id];
+    const TBaseEnt *ptr = this->slotRO(id);
     CL_BREAK_IF(!ptr);
     return ptr;
 }
@@ -299,7 +443,7 @@ inline TBaseEnt* EntStore<TBaseEnt>::getEntRW(const TId id)
 #ifndef NDEBUG
     this->getEntRO(id);
 #endif
-    TBaseEnt *&entRW = ents_[id];
+    TBaseEnt *&entRW = this->slotRW(id);
     RefCntLib<RCO_VIRTUAL>::requireExclusivity(entRW);
     return entRW;
 }
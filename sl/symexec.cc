@@ -32,17 +32,24 @@
 #include "symdebug.hh"
 #include "sympath.hh"
 #include "symproc.hh"
+#include "symserial.hh"
 #include "symstate.hh"
 #include "symutil.hh"
 #include "symtrace.hh"
 #include "util.hh"
 
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <map>
 #include <queue>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
 
 LOCAL_DEBUG_PLOTTER(nondetCond, DEBUG_SE_NONDET_COND)
 
@@ -65,6 +72,203 @@ struct ExecStackItem {
 
 typedef std::deque<ExecStackItem> TExecStack;
 
+// /////////////////////////////////////////////////////////////////////////////
+// checkpoints of the symbolic execution
+typedef const CodeStorage::Block                           *TBlock;
+typedef std::map<int /* uid */, const CodeStorage::Fnc *>   TFncMap;
+typedef std::map<std::string, TBlock>                       TBlockMap;
+
+/// state of a basic block in SymExecEngine, as stored in a checkpoint
+struct BlockSnapshot {
+    TBlock                              bb;
+    SymHeapList                         state;
+    std::vector<bool>                   done;
+    SymStateMap::TContBlock             inbound;
+};
+
+/// complete state of SymExecEngine, as stored in a checkpoint
+struct EngineSnapshot {
+    const CodeStorage::Fnc             *fnc;
+    SymHeapList                         results;
+    bool                                endReached;
+    std::vector<BlockSnapshot>          blocks;
+    BlockScheduler::TBlockList          queue;
+
+    /// the block of a pending call, zero if taken between two basic blocks
+    TBlock                              block;
+    unsigned                            insnIdx;
+    unsigned                            heapIdx;
+    SymHeapList                         localState;
+    SymHeapList                         nextLocalState;
+
+    EngineSnapshot():
+        fnc(0),
+        endReached(false),
+        block(0),
+        insnIdx(0),
+        heapIdx(0)
+    {
+    }
+};
+
+typedef std::vector<EngineSnapshot>                 TSnapshotList;
+
+void writeBlockList(SymWriter &wr, const std::vector<TBlock> &bbs) {
+    wr.writeNum(bbs.size());
+    BOOST_FOREACH(const TBlock bb, bbs)
+        wr.writeStr(bb->name());
+}
+
+void writeSnapshot(SymWriter &wr, const EngineSnapshot &snap) {
+    wr.writeNum(uidOf(*snap.fnc));
+    wr.writeState(snap.results);
+    wr.writeNum(snap.endReached);
+
+    wr.writeNum(snap.blocks.size());
+    BOOST_FOREACH(const BlockSnapshot &bs, snap.blocks) {
+        wr.writeStr(bs.bb->name());
+        wr.writeState(bs.state);
+        BOOST_FOREACH(const bool done, bs.done)
+            wr.writeNum(done);
+
+        writeBlockList(wr, bs.inbound);
+    }
+
+    writeBlockList(wr, snap.queue);
+
+    if (!snap.block) {
+        wr.writeStr(std::string());
+        return;
+    }
+
+    wr.writeStr(snap.block->name());
+    wr.writeNum(snap.insnIdx);
+    wr.writeNum(snap.heapIdx);
+    wr.writeState(snap.localState);
+    wr.writeState(snap.nextLocalState);
+}
+
+bool readBlock(TBlock *pBb, SymReader &rd, const TBlockMap &bMap) {
+    std::string name;
+    if (!rd.readStr(&name))
+        return false;
+
+    const TBlockMap::const_iterator it = bMap.find(name);
+    if (bMap.end() == it)
+        return false;
+
+    *pBb = it->second;
+    return true;
+}
+
+bool readBlockList(std::vector<TBlock> &dst, SymReader &rd, const TBlockMap &bMap)
+{
+    long long cnt;
+    if (!rd.readNum(&cnt))
+        return false;
+
+    for (long long i = 0; i < cnt; ++i) {
+        TBlock bb;
+        if (!readBlock(&bb, rd, bMap))
+            return false;
+
+        dst.push_back(bb);
+    }
+
+    return true;
+}
+
+bool readSnapshot(EngineSnapshot &snap, SymReader &rd, const TFncMap &fncMap) {
+    long long uid;
+    if (!rd.readNum(&uid))
+        return false;
+
+    const TFncMap::const_iterator it = fncMap.find(uid);
+    if (fncMap.end() == it)
+        return false;
+
+    const CodeStorage::Fnc &fnc = *it->second;
+    snap.fnc = &fnc;
+
+    TBlockMap bMap;
+    BOOST_FOREACH(const TBlock bb, fnc.cfg)
+        bMap[bb->name()] = bb;
+
+    long long endReached;
+    if (!rd.readState(snap.results, new Trace::RootNode(&fnc))
+            || !rd.readNum(&endReached))
+        return false;
+
+    snap.endReached = endReached;
+
+    long long cntBlocks;
+    if (!rd.readNum(&cntBlocks))
+        return false;
+
+    for (long long i = 0; i < cntBlocks; ++i) {
+        snap.blocks.push_back(BlockSnapshot());
+        BlockSnapshot &bs = snap.blocks.back();
+        if (!readBlock(&bs.bb, rd, bMap)
+                || !rd.readState(bs.state, new Trace::RootNode(&fnc)))
+            return false;
+
+        for (unsigned j = 0; j < bs.state.size(); ++j) {
+            long long done;
+            if (!rd.readNum(&done))
+                return false;
+
+            bs.done.push_back(done);
+        }
+
+        if (!readBlockList(bs.inbound, rd, bMap))
+            return false;
+    }
+
+    if (!readBlockList(snap.queue, rd, bMap))
+        return false;
+
+    std::string name;
+    if (!rd.readStr(&name))
+        return false;
+
+    if (name.empty())
+        // taken between two basic blocks
+        return true;
+
+    long long insnIdx, heapIdx;
+    const TBlockMap::const_iterator bIt = bMap.find(name);
+    if (bMap.end() == bIt
+            || !rd.readNum(&insnIdx)
+            || !rd.readNum(&heapIdx)
+            || !rd.readState(snap.localState, new Trace::RootNode(&fnc))
+            || !rd.readState(snap.nextLocalState, new Trace::RootNode(&fnc)))
+        return false;
+
+    // check the engine is really waiting for a call
+    const TBlock bb = bIt->second;
+    if (insnIdx < 0 || static_cast<long long>(bb->size()) <= insnIdx
+            || CL_INSN_CALL != bb->operator[](insnIdx)->code
+            || heapIdx < 1
+            || static_cast<long long>(snap.localState.size()) < heapIdx)
+        return false;
+
+    snap.block      = bb;
+    snap.insnIdx    = insnIdx;
+    snap.heapIdx    = heapIdx;
+    return true;
+}
+
+/// hash of the settings that the results of a fnc call may depend on
+size_t summarySalt(const SymExecParams &ep) {
+    size_t salt = 0;
+    boost::hash_combine(salt, std::string(GIT_SHA1));
+    boost::hash_combine(salt, ep.trackUninit);
+    boost::hash_combine(salt, ep.oomSimulation);
+    boost::hash_combine(salt, ep.errLabel);
+    boost::hash_combine(salt, ep.intWidening);
+    return salt;
+}
+
 // /////////////////////////////////////////////////////////////////////////////
 // SymExec
 class SymExec: public IStatsProvider {
@@ -72,8 +276,12 @@ class SymExec: public IStatsProvider {
         SymExec(const CodeStorage::Storage &stor, const SymExecParams &ep):
             stor_(stor),
             params_(ep),
-            callCache_(stor, ep.ptrace)
+            callCache_(stor, ep.ptrace, ep.callCacheBudget),
+            checkpointRequested_(false),
+            lastCheckpoint_(time(0))
         {
+            if (!ep.summaryDir.empty())
+                callCache_.enableSummaries(ep.summaryDir, summarySalt(ep));
         }
 
         /// just to avoid memory leakage in case an exception falls through
@@ -84,7 +292,10 @@ class SymExec: public IStatsProvider {
                 SymHeap                     entry,
                 const CodeStorage::Insn     &insn);
 
-        void enterCall(SymCallCtx *ctx, SymState &results);
+        void enterCall(
+                SymCallCtx                  *ctx,
+                SymState                    &results,
+                const EngineSnapshot        *snap = 0);
 
         void execFnc(
                 SymState                    &results,
@@ -94,11 +305,32 @@ class SymExec: public IStatsProvider {
 
         virtual void printStats() const;
 
+        /// take a checkpoint once all the engines are in a consistent state
+        void requestCheckpoint();
+
+        /// take a checkpoint if requested, or if the interval has elapsed
+        void checkpointIfNeeded();
+
     private:
         const CodeStorage::Storage              &stor_;
         SymExecParams                           params_;
         SymCallCache                            callCache_;
         TExecStack                              execStack_;
+        bool                                    checkpointRequested_;
+        time_t                                  lastCheckpoint_;
+
+        void writeCheckpoint();
+
+        bool readCheckpoint(
+                std::vector<SymHeap>        &entries,
+                TSnapshotList               &snaps,
+                std::istream                &str,
+                const CodeStorage::Fnc      &fnc);
+
+        bool resumeFromCheckpoint(
+                SymState                    &results,
+                SymCallCtx                  *ctx,
+                const CodeStorage::Fnc      &fnc);
 };
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -108,22 +340,28 @@ class SymExecEngine: public IStatsProvider {
         SymExecEngine(
                 SymState                &results,
                 const SymHeap           &entry,
-                const IStatsProvider    &stats,
+                SymExec                 &se,
                 const SymExecParams     &ep,
-                SymBackTrace            &bt):
+                SymBackTrace            &bt,
+                const EngineSnapshot    *snap = 0):
             stor_(entry.stor()),
             params_(ep),
             bt_(bt),
             dst_(results),
-            stats_(stats),
+            se_(se),
+            fnc_(bt.topFnc()),
             ptracer_(stateMap_),
+            sched_(ep.schedOrder),
             block_(0),
             insnIdx_(0),
             heapIdx_(0),
             waiting_(false),
             endReached_(false)
         {
-            this->initEngine(entry);
+            if (snap)
+                this->restoreEngine(*snap);
+            else
+                this->initEngine(entry);
 
             // register path printer
             bt_.pushPathTracer(&ptracer_);
@@ -140,18 +378,23 @@ class SymExecEngine: public IStatsProvider {
         virtual void printStats() const;
 
         // TODO: describe the interface briefly
+        const CodeStorage::Fnc&         fnc() const;
         const SymHeap&                  callEntry() const;
         const CodeStorage::Insn&        callInsn() const;
         SymState&                       callResults();
         bool                            endReached() const;
         void                            forceEndReached();
 
+        /// @param atCall false if taken between two basic blocks
+        void saveSnapshot(EngineSnapshot &dst, bool atCall);
+
     private:
         const CodeStorage::Storage      &stor_;
         SymExecParams                   params_;
         SymBackTrace                    &bt_;
         SymState                        &dst_;
-        const IStatsProvider            &stats_;
+        SymExec                         &se_;
+        const CodeStorage::Fnc          *fnc_;
         std::string                     fncName_;
 
         SymStateMap                     stateMap_;
@@ -168,11 +411,19 @@ class SymExecEngine: public IStatsProvider {
         SymHeapList                     callResults_;
         const struct cl_loc             *lw_;
 
+        typedef std::map<const CodeStorage::Block *, IR::TThresholds>
+                                        TThresholdMap;
+        TThresholdMap                   thresholds_;
+
     private:
         void initEngine(const SymHeap &init);
 
+        void restoreEngine(const EngineSnapshot &snap);
+
         void joinCallResults();
 
+        const IR::TThresholds& loopThresholds(const CodeStorage::Block *head);
+
         void updateState(SymHeap &sh, const CodeStorage::Block *ofBlock);
 
         void updateStateInBranch(
@@ -228,6 +479,82 @@ void SymExecEngine::initEngine(const SymHeap &init)
     sched_.schedule(entry);
 }
 
+void SymExecEngine::restoreEngine(const EngineSnapshot &snap) {
+    CL_BREAK_IF(fnc_ != snap.fnc);
+    fncName_ = nameOf(*fnc_);
+    lw_ = locationOf(*fnc_);
+    CL_DEBUG_MSG(lw_, ">>> resuming " << fncName_ << "() from a checkpoint");
+
+    BOOST_FOREACH(const SymHeap *sh, snap.results)
+        dst_.insert(*sh);
+
+    endReached_ = snap.endReached;
+
+    BOOST_FOREACH(const BlockSnapshot &bs, snap.blocks) {
+        SymStateMarked &state = stateMap_[bs.bb];
+        state = bs.state;
+        for (unsigned i = 0; i < bs.done.size(); ++i)
+            if (bs.done[i])
+                state.setDone(i);
+
+        BOOST_FOREACH(const TBlock src, bs.inbound)
+            stateMap_.insertInboundEdge(bs.bb, src);
+    }
+
+    BOOST_FOREACH(const TBlock bb, snap.queue)
+        sched_.schedule(bb);
+
+    // the engine has been already running when the checkpoint was taken
+    waiting_ = true;
+
+    block_ = snap.block;
+    if (!block_)
+        // taken between two basic blocks, run() goes to the main loop
+        return;
+
+    // waiting for results of a function call
+    insnIdx_        = snap.insnIdx;
+    heapIdx_        = snap.heapIdx;
+    localState_     = snap.localState;
+    nextLocalState_ = snap.nextLocalState;
+    lw_ = &block_->operator[](insnIdx_)->loc;
+    ptracer_.setBlock(block_);
+}
+
+void SymExecEngine::saveSnapshot(EngineSnapshot &dst, const bool atCall) {
+    dst.fnc         = fnc_;
+    dst.results     = dst_;
+    dst.endReached  = endReached_;
+
+    BOOST_FOREACH(const TBlock bb, fnc_->cfg) {
+        SymStateMap::TContBlock inbound;
+        stateMap_.gatherInboundEdges(inbound, bb);
+
+        const SymStateMarked &state = stateMap_[bb];
+        const unsigned cnt = state.size();
+        if (!cnt && inbound.empty())
+            continue;
+
+        dst.blocks.push_back(BlockSnapshot());
+        BlockSnapshot &bs = dst.blocks.back();
+        bs.bb       = bb;
+        bs.state    = state;
+        bs.inbound  = inbound;
+        for (unsigned i = 0; i < cnt; ++i)
+            bs.done.push_back(state.isDone(i));
+    }
+
+    dst.queue = sched_.queue();
+    if (!atCall)
+        return;
+
+    dst.block           = block_;
+    dst.insnIdx         = insnIdx_;
+    dst.heapIdx         = heapIdx_;
+    dst.localState      = localState_;
+    dst.nextLocalState  = nextLocalState_;
+}
+
 void SymExecEngine::execJump() {
     const CodeStorage::Insn *insn = block_->operator[](insnIdx_);
     const CodeStorage::TTargetList &tlist = insn->targets;
@@ -282,13 +609,84 @@ bool isLoopClosingEdge(
     return false;
 }
 
+/// collect integral constants compared by the condition closing the block
+void harvestThresholds(IR::TThresholds &dst, const CodeStorage::Block *bb) {
+    const unsigned cnt = bb->size();
+    if (cnt < 2)
+        return;
+
+    // we are looking for a CL_INSN_BINOP followed by CL_INSN_COND
+    const CodeStorage::Insn *insnCmp = bb->operator[](cnt - 2);
+    const CodeStorage::Insn *insnCnd = bb->back();
+    if (CL_INSN_COND != insnCnd->code || CL_INSN_BINOP != insnCmp->code)
+        return;
+
+    // the result of the comparison has to be the operand of the condition
+    const struct cl_operand &opDst = insnCmp->operands[/* dst */ 0];
+    const struct cl_operand &opCnd = insnCnd->operands[/* src */ 0];
+    if (CL_OPERAND_VAR != opDst.code || CL_OPERAND_VAR != opCnd.code
+            || opDst.accessor || opCnd.accessor
+            || varIdFromOperand(&opDst) != varIdFromOperand(&opCnd))
+        return;
+
+    for (unsigned i = /* src1 */ 1; i <= /* src2 */ 2; ++i) {
+        const struct cl_operand &op = insnCmp->operands[i];
+        if (CL_OPERAND_CST != op.code || CL_TYPE_INT != op.type->code)
+            continue;
+
+        const struct cl_cst &cst = op.data.cst;
+        if (CL_TYPE_INT != cst.code)
+            continue;
+
+        const IR::TInt num = cst.data.cst_int.value;
+        if (num <= IR::RzMin || IR::RzMax <= num)
+            continue;
+
+        // the comparison operator decides which of them is the right one
+        dst.push_back(num - IR::Int1);
+        dst.push_back(num);
+        dst.push_back(num + IR::Int1);
+    }
+}
+
+const IR::TThresholds& SymExecEngine::loopThresholds(
+        const CodeStorage::Block        *head)
+{
+    TThresholdMap::iterator it = thresholds_.find(head);
+    if (thresholds_.end() != it)
+        return it->second;
+
+    IR::TThresholds &dst = thresholds_[head];
+
+    // conditions checked at the beginning of the loop
+    harvestThresholds(dst, head);
+
+    // conditions checked at the end of the loop (on loop-closing edges)
+    BOOST_FOREACH(const CodeStorage::Block *bb, fnc_->cfg)
+        if (isLoopClosingEdge(/* term */ bb->back(), head))
+            harvestThresholds(dst, bb);
+
+    std::sort(dst.begin(), dst.end());
+    dst.erase(std::unique(dst.begin(), dst.end()), dst.end());
+
+    if (!dst.empty())
+        CL_DEBUG_MSG(lw_, "-L- " << dst.size()
+                << " widening threshold(s) found for block " << head->name());
+
+    return dst;
+}
+
 void SymExecEngine::updateState(SymHeap &sh, const CodeStorage::Block *ofBlock)
 {
     const std::string &name = ofBlock->name();
 
+    const IR::TThresholds *thresholds = 0;
     bool closingLoop = isLoopClosingEdge(/* term */ block_->back(), ofBlock);
-    if (closingLoop)
+    if (closingLoop) {
         CL_DEBUG_MSG(lw_, "-L- traversing a loop-closing edge");
+        if (params_.intWidening)
+            thresholds = &this->loopThresholds(ofBlock);
+    }
 
     // time to consider abstraction
 #if SE_ABSTRACT_ON_LOOP_EDGES_ONLY
@@ -301,7 +699,7 @@ void SymExecEngine::updateState(SymHeap &sh, const CodeStorage::Block *ofBlock)
 #endif
 
     // update _target_ state and check if anything has changed
-    if (!stateMap_.insert(ofBlock, block_, sh, closingLoop)) {
+    if (!stateMap_.insert(ofBlock, block_, sh, closingLoop, thresholds)) {
         CL_DEBUG_MSG(lw_, "--- block " << name
                      << " left intact (size of target is "
                      << stateMap_[ofBlock].size() << ")");
@@ -474,8 +872,9 @@ void SymExecEngine::execCondInsn() {
         return;
 
     if (isUninitialized(origin)) {
-        CL_WARN_MSG(lw_, "conditional jump depends on uninitialized value");
-        describeUnknownVal(proc, val, "use");
+        SE_WARN_MSG(proc, lw_,
+                "conditional jump depends on uninitialized value");
+        describeUnknownVal(proc, val, "use", ML_WARN);
         proc.printBackTrace(ML_WARN);
     }
 
@@ -704,7 +1103,14 @@ void SymExecEngine::joinCallResults() {
 bool /* complete */ SymExecEngine::run() {
     const CodeStorage::Fnc fnc = *bt_.topFnc();
 
-    if (waiting_) {
+    if (!waiting_) {
+        // we have a fresh instance of SymExecEngine
+        waiting_ = true;
+
+        // check for possible protocol error
+        CL_BREAK_IF(1 != sched_.cntWaiting());
+    }
+    else if (block_) {
         // pick up results of the pending call
         this->joinCallResults();
 
@@ -713,16 +1119,16 @@ bool /* complete */ SymExecEngine::run() {
             // ... and we've just hit another one
             return false;
     }
-    else {
-        // we have a fresh instance of SymExecEngine
-        waiting_ = true;
-
-        // check for possible protocol error
-        CL_BREAK_IF(1 != sched_.cntWaiting());
-    }
+    // else we have been resumed from a checkpoint taken between two blocks
 
     // main loop of SymExecEngine
-    while (sched_.getNext(&block_)) {
+    for (;;) {
+        // all engines on the exec stack are in a consistent state here
+        se_.checkpointIfNeeded();
+
+        if (!sched_.getNext(&block_))
+            break;
+
         // update location info and ptracer
         const CodeStorage::Insn *first = block_->front();
         lw_ = &first->loc;
@@ -827,6 +1233,10 @@ void SymExecEngine::dumpStateMap() {
     }
 }
 
+const CodeStorage::Fnc& SymExecEngine::fnc() const {
+    return *fnc_;
+}
+
 const SymHeap& SymExecEngine::callEntry() const {
     CL_BREAK_IF(heapIdx_ < 1);
     return localState_[heapIdx_ - /* already incremented for next wheel */ 1];
@@ -859,11 +1269,13 @@ void SymExecEngine::processPendingSignals() {
         return;
 
     CL_WARN_MSG(lw_, "caught signal " << signum);
-    stats_.printStats();
+    se_.printStats();
     printMemUsage("SymExec::printStats");
 
     switch (signum) {
         case SIGUSR1:
+            // checkpoint the analysis as soon as we leave the current block
+            se_.requestCheckpoint();
             break;
 
         default:
@@ -885,6 +1297,10 @@ SymExec::~SymExec() {
         delete item.eng;
         printMemUsage("SymExecEngine::~SymExecEngine");
     }
+
+    if (params_.callCacheBudget)
+        // the budget has been set explicitly, print how it worked out
+        callCache_.printStats();
 }
 
 const CodeStorage::Fnc* SymExec::resolveCallInsn(
@@ -909,12 +1325,12 @@ const CodeStorage::Fnc* SymExec::resolveCallInsn(
     int uid;
     if (!proc.fncFromOperand(&uid, opFnc)) {
         CL_BREAK_IF(CL_OPERAND_CST == opFnc.code);
-        CL_ERROR_MSG(lw, "failed to resolve indirect function call");
+        SE_ERROR_MSG(proc, lw, "failed to resolve indirect function call");
         goto fail;
     }
 
     if (SE_MAX_CALL_DEPTH < bt.size()) {
-        CL_ERROR_MSG(lw, "call depth exceeds SE_MAX_CALL_DEPTH"
+        SE_ERROR_MSG(proc, lw, "call depth exceeds SE_MAX_CALL_DEPTH"
                 << " (" << SE_MAX_CALL_DEPTH << ")");
         goto fail;
     }
@@ -922,7 +1338,7 @@ const CodeStorage::Fnc* SymExec::resolveCallInsn(
     fnc = stor_.fncs[uid];
     if (!isDefined(*fnc)) {
         const char *name = nameOf(*fnc);
-        CL_WARN_MSG(lw, "ignoring call of undefined function: "
+        SE_WARN_MSG(proc, lw, "ignoring call of undefined function: "
                 << name << "()");
 
         // do not treat this as a real error
@@ -958,14 +1374,19 @@ fail:
     return 0;
 }
 
-void SymExec::enterCall(SymCallCtx *ctx, SymState &results) {
+void SymExec::enterCall(
+        SymCallCtx                      *ctx,
+        SymState                        &results,
+        const EngineSnapshot            *snap)
+{
     // create engine
     SymExecEngine *eng = new SymExecEngine(
             ctx->rawResults(),
             ctx->entry(),
-            /* IStatsProvider */ *this,
+            *this,
             params_,
-            callCache_.bt());
+            callCache_.bt(),
+            snap);
 
     // initialize a stack item
     ExecStackItem item;
@@ -988,8 +1409,9 @@ void SymExec::execFnc(
     SymCallCtx *ctx = callCache_.getCallCtx(entry, fnc, insn);
     CL_BREAK_IF(!ctx || !ctx->needExec());
 
-    // root call
-    this->enterCall(ctx, results);
+    if (!params_.resume || !this->resumeFromCheckpoint(results, ctx, fnc))
+        // root call
+        this->enterCall(ctx, results);
 
     // main loop
     while (!execStack_.empty()) {
@@ -1056,10 +1478,15 @@ void SymExec::execFnc(
         // create a new engine and push it to the exec stack
         this->enterCall(ctx, item.eng->callResults());
     }
+
+    if (!params_.checkpointFile.empty())
+        // the analysis is complete, there is nothing to resume any more
+        remove(params_.checkpointFile.c_str());
 }
 
 void SymExec::printStats() const {
-    // TODO: print SymCallCache stats here as soon as we have implemented some
+    callCache_.printStats();
+    printJoinStats();
 
     BOOST_FOREACH(const ExecStackItem &item, execStack_) {
         const IStatsProvider *provider = item.eng;
@@ -1067,6 +1494,182 @@ void SymExec::printStats() const {
     }
 }
 
+void SymExec::requestCheckpoint() {
+    checkpointRequested_ = true;
+}
+
+void SymExec::checkpointIfNeeded() {
+    if (params_.checkpointFile.empty())
+        // checkpoints not enabled
+        return;
+
+    const time_t now = time(0);
+    const unsigned interval = params_.checkpointInterval;
+    if (!checkpointRequested_
+            && (!interval || now < lastCheckpoint_ + interval))
+        return;
+
+    checkpointRequested_ = false;
+    this->writeCheckpoint();
+
+    // do not count the time spent by writing the checkpoint
+    lastCheckpoint_ = time(0);
+}
+
+void SymExec::writeCheckpoint() {
+    CL_BREAK_IF(execStack_.empty());
+
+    // write a temporary file first, so that we never break the last checkpoint
+    const std::string &fileName = params_.checkpointFile;
+    const std::string tmpName = fileName + ".tmp";
+    std::ofstream str(tmpName.c_str(), std::ios::binary | std::ios::trunc);
+
+    SymWriter wr(str);
+    wr.writeNum(summarySalt(params_));
+
+    // the root fnc goes before the call cache, so that it is checked first
+    const CodeStorage::Fnc &root = execStack_.back().eng->fnc();
+    wr.writeNum(uidOf(root));
+    wr.writeStr(nameOf(root));
+    callCache_.saveCache(wr);
+
+    // the root call goes first, the engine on top of the stack goes last
+    wr.writeNum(execStack_.size());
+    const SymExecEngine *top = execStack_.front().eng;
+    BOOST_REVERSE_FOREACH(const ExecStackItem &item, execStack_) {
+        EngineSnapshot snap;
+        item.eng->saveSnapshot(snap, /* atCall */ top != item.eng);
+        writeSnapshot(wr, snap);
+        wr.writeHeap(item.ctx->entry());
+    }
+
+    str.close();
+    if (!str || rename(tmpName.c_str(), fileName.c_str())) {
+        CL_WARN("failed to write checkpoint: " << fileName);
+        return;
+    }
+
+    CL_NOTE("checkpoint written: " << fileName << " ("
+            << execStack_.size() << " call level(s))");
+}
+
+bool SymExec::readCheckpoint(
+        std::vector<SymHeap>            &entries,
+        TSnapshotList                   &snaps,
+        std::istream                    &str,
+        const CodeStorage::Fnc          &fnc)
+{
+    SymReader rd(stor_, str);
+
+    long long salt;
+    if (!rd.readNum(&salt)
+            || static_cast<long long>(summarySalt(params_)) != salt)
+        // taken by another version of the analyzer, or with other settings
+        return false;
+
+    long long uid;
+    std::string name;
+    if (!rd.readNum(&uid) || uidOf(fnc) != uid
+            || !rd.readStr(&name) || nameOf(fnc) != name)
+        // taken while analyzing another fnc, leave the call cache alone
+        return false;
+
+    if (!callCache_.loadCache(rd))
+        return false;
+
+    TFncMap fncMap;
+    BOOST_FOREACH(const CodeStorage::Fnc *fnc, stor_.fncs)
+        fncMap[uidOf(*fnc)] = fnc;
+
+    long long depth;
+    if (!rd.readNum(&depth) || depth < 1)
+        return false;
+
+    for (long long i = 0; i < depth; ++i) {
+        snaps.push_back(EngineSnapshot());
+        EngineSnapshot &snap = snaps.back();
+        if (!readSnapshot(snap, rd, fncMap))
+            return false;
+
+        SymHeap entry(stor_, new Trace::RootNode(snap.fnc));
+        if (!rd.readHeap(&entry))
+            return false;
+
+        entries.push_back(entry);
+    }
+
+    return true;
+}
+
+bool SymExec::resumeFromCheckpoint(
+        SymState                        &results,
+        SymCallCtx                      *ctx,
+        const CodeStorage::Fnc          &fnc)
+{
+    const struct cl_loc *loc = locationOf(fnc);
+    const std::string &fileName = params_.checkpointFile;
+    std::ifstream str(fileName.c_str(), std::ios::binary);
+    if (!str) {
+        CL_WARN_MSG(loc, "no checkpoint to resume from: " << fileName);
+        return false;
+    }
+
+    std::vector<SymHeap> entries;
+    TSnapshotList snaps;
+    if (!this->readCheckpoint(entries, snaps, str, fnc)
+            || &fnc != snaps.front().fnc)
+    {
+        CL_WARN_MSG(loc, "unusable checkpoint, starting from scratch: "
+                << fileName);
+        return false;
+    }
+
+    CL_NOTE_MSG(loc, "resuming from checkpoint: " << fileName << " ("
+            << snaps.size() << " call level(s))");
+
+    // rebuild the exec stack the same way as execFnc() has built it
+    SymState *dst = &results;
+    const unsigned depth = snaps.size();
+    for (unsigned i = 0; i < depth; ++i) {
+        if (i) {
+            SymExecEngine *caller = execStack_.front().eng;
+            dst = &caller->callResults();
+
+            const SymHeap &entry = caller->callEntry();
+            const CodeStorage::Insn &insn = caller->callInsn();
+            const CodeStorage::Fnc *callee =
+                this->resolveCallInsn(*dst, entry, insn);
+
+            ctx = (callee)
+                ? callCache_.getCallCtx(entry, *callee, insn)
+                : 0;
+
+            if (!ctx)
+                // the caller is going to pick up whatever we have got
+                break;
+
+            if (!ctx->needExec()) {
+                // the results are already available (e.g. a summary)
+                ctx->flushCallResults(*dst);
+                break;
+            }
+
+            if (callee != snaps[i].fnc) {
+                CL_BREAK_IF("SymExec::resumeFromCheckpoint() got a mismatch");
+                this->enterCall(ctx, *dst);
+                break;
+            }
+        }
+
+        // gl vars imported lazily before the checkpoint was taken
+        ctx->importGlVarsOf(entries[i]);
+
+        this->enterCall(ctx, *dst, &snaps[i]);
+    }
+
+    return true;
+}
+
 void execTopCall(
         SymState                        &results,
         const SymHeap                   &entry,
@@ -20,6 +20,9 @@
 #ifndef H_GUARD_SYM_EXEC_H
 #define H_GUARD_SYM_EXEC_H
 
+#include "symstate.hh"           // for EBlockSchedOrder
+#include "symtrace.hh"           // for Trace::ETraceLevel
+
 #include <string>
 
 /**
@@ -41,12 +44,31 @@ struct SymExecParams {
     bool skipPlot;          ///< simply ignore all ___sl_plot* calls
     bool ptrace;            ///< enable path tracing (a bit chatty)
     std::string errLabel;   ///< if not empty, treat reaching the label as error
+    EBlockSchedOrder schedOrder;    ///< order of basic blocks in SymExecEngine
+    unsigned cntJobs;       ///< count of processes analyzing virtual roots
+    size_t callCacheBudget; ///< memory budget of SymCallCache, 0 = unlimited
+    std::string summaryDir; ///< if not empty, keep fnc summaries in this dir
+    std::string checkpointFile; ///< if not empty, take checkpoints there
+    unsigned checkpointInterval;///< seconds between checkpoints, 0 = SIGUSR1
+    bool resume;            ///< resume the analysis from checkpointFile
+    std::string memDumpFile;///< if not empty, dump memory accounts there
+    Trace::ETraceLevel traceLevel;  ///< how much of the trace graph to keep
+    bool dedupReports;      ///< suppress repeats of already reported errors
+    bool intWidening;       ///< widen int ranges on loop-closing edges
 
     SymExecParams():
         trackUninit(false),
         oomSimulation(false),
         skipPlot(false),
-        ptrace(false)
+        ptrace(false),
+        schedOrder(defaultBlockSchedOrder()),
+        cntJobs(1),
+        callCacheBudget(0),
+        checkpointInterval(SE_CHECKPOINT_INTERVAL),
+        resume(false),
+        traceLevel(Trace::TL_FULL),
+        dedupReports(false),
+        intWidening(false)
     {
     }
 };
@@ -28,7 +28,9 @@
 #include "symutil.hh"
 #include "worklist.hh"
 
-#include <stack>
+#include <algorithm>
+#include <iterator>
+#include <map>
 
 #include <boost/foreach.hpp>
 
@@ -47,42 +49,97 @@ void gatherReferredRoots(TValList &dst, SymHeap &sh, TValId at) {
     }
 }
 
-bool isJunk(SymHeap &sh, TValId root) {
+/**
+ * facts about reachability of roots proven during a single run of the garbage
+ * collector.  The run only destroys junk, so a root once proven reachable from
+ * a non-heap object stays reachable, and a proven junk stays junk until it is
+ * destroyed.  Each root is thus traversed at most once per run, no matter how
+ * many of the killed pointers lead to it.
+ */
+class JunkDetector {
+    public:
+        JunkDetector(SymHeap &sh):
+            sh_(sh)
+        {
+        }
+
+        bool isJunk(TValId root);
+
+    private:
+        SymHeap                    &sh_;
+        TValSet                     junk_;
+        TValSet                     alive_;
+};
+
+bool JunkDetector::isJunk(const TValId root) {
+    if (!isOnHeap(sh_.valTarget(root)))
+        // non-heap objects cannot be JUNK (nor the already destroyed ones)
+        return false;
+
+    if (hasKey(junk_, root))
+        return true;
+
+    if (hasKey(alive_, root))
+        return false;
+
+    if (!sh_.pointedByCount(root)) {
+        // no referrers at all, there is nothing to traverse
+        junk_.insert(root);
+        return true;
+    }
+
+    // successor of each visited root on its way back to the given root
+    std::map<TValId, TValId> succOf;
+    TValList visited;
+
     WorkList<TValId> wl(root);
+    TValId at;
+    while (wl.next(at)) {
+        if (hasKey(junk_, at))
+            // whatever reaches a known junk is junk as well
+            continue;
 
-    while (wl.next(root)) {
-        const EValueTarget code = sh.valTarget(root);
-        if (!isOnHeap(code))
-            // non-heap objects cannot be JUNK
+        if (hasKey(alive_, at) || !isOnHeap(sh_.valTarget(at))) {
+            // the given root is reachable from 'at', so is the whole path
+            for (; root != at; at = succOf[at])
+                alive_.insert(at);
+
+            alive_.insert(root);
             return false;
+        }
+
+        visited.push_back(at);
 
         // go through all referrers
         ObjList refs;
-        sh.pointedBy(refs, root);
+        sh_.pointedBy(refs, at);
         BOOST_FOREACH(const ObjHandle &obj, refs) {
             const TValId refAt = obj.placedAt();
-            const TValId refRoot = sh.valRoot(refAt);
-            wl.schedule(refRoot);
+            const TValId refRoot = sh_.valRoot(refAt);
+            if (wl.schedule(refRoot))
+                succOf[refRoot] = at;
         }
     }
 
+    // nothing but heap objects can reach any of the visited roots
+    std::copy(visited.begin(), visited.end(),
+            std::inserter(junk_, junk_.begin()));
+
     return true;
 }
 
-bool gcCore(SymHeap &sh, TValId root, TValList *leakList, bool sharedOnly) {
-    CL_BREAK_IF(sh.valOffset(root));
+bool gcCore(
+        SymHeap                 &sh,
+        JunkDetector            &jd,
+        WorkList<TValId>        &wl,
+        TValList                *leakList,
+        const TValSet           *whiteList)
+{
     bool detected = false;
 
-    std::set<TValId> whiteList;
-    if (sharedOnly) {
-        whiteList.insert(root);
-        if (OK_DLS == sh.valTargetKind(root))
-            whiteList.insert(dlSegPeer(sh, root));
-    }
-
-    WorkList<TValId> wl(root);
+    TValId root;
     while (wl.next(root)) {
-        if (!isJunk(sh, root))
+        if (!jd.isJunk(root))
             // not a junk, keep going...
             continue;
 
@@ -90,8 +147,8 @@ bool gcCore(SymHeap &sh, TValId root, TValList *leakList, bool sharedOnly) {
         TValList refs;
         gatherReferredRoots(refs, sh, root);
 
-        if (sharedOnly) {
-            if (hasKey(whiteList, root))
+        if (whiteList) {
+            if (hasKey(*whiteList, root))
                 goto skip_root;
 
             if (0 < sh.valTargetProtoLevel(root))
@@ -114,11 +171,36 @@ skip_root:
 }
 
 bool collectJunk(SymHeap &sh, TValId root, TValList *leakList) {
-    return gcCore(sh, root, leakList, /* sharedOnly */ false);
+    CL_BREAK_IF(sh.valOffset(root));
+
+    JunkDetector jd(sh);
+    WorkList<TValId> wl(root);
+    return gcCore(sh, jd, wl, leakList, /* whiteList */ 0);
+}
+
+bool collectJunkFrom(SymHeap &sh, const TValList &roots, TValList *leakList) {
+    // a single run for all the roots, so that nothing is traversed twice
+    JunkDetector jd(sh);
+    WorkList<TValId> wl;
+    BOOST_FOREACH(const TValId root, roots) {
+        CL_BREAK_IF(sh.valOffset(root));
+        wl.schedule(root);
+    }
+
+    return gcCore(sh, jd, wl, leakList, /* whiteList */ 0);
 }
 
 bool collectSharedJunk(SymHeap &sh, TValId root, TValList *leakList) {
-    return gcCore(sh, root, leakList, /* sharedOnly */ true);
+    CL_BREAK_IF(sh.valOffset(root));
+
+    TValSet whiteList;
+    whiteList.insert(root);
+    if (OK_DLS == sh.valTargetKind(root))
+        whiteList.insert(dlSegPeer(sh, root));
+
+    JunkDetector jd(sh);
+    WorkList<TValId> wl(root);
+    return gcCore(sh, jd, wl, leakList, &whiteList);
 }
 
 bool destroyRootAndCollectJunk(
@@ -137,13 +219,7 @@ bool destroyRootAndCollectJunk(
     sh.valDestroyTarget(root);
 
     // now check for memory leakage
-    bool leaking = false;
-    BOOST_FOREACH(TValId val, killedPtrs) {
-        if (collectJunk(sh, val, leakList))
-            leaking = true;
-    }
-
-    return leaking;
+    return collectJunkFrom(sh, killedPtrs, leakList);
 }
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -40,6 +40,13 @@
  */
 bool collectJunk(SymHeap &sh, TValId root, TValList *leakList = 0);
 
+/**
+ * the same as collectJunk(), but for a bunch of roots at once.  All the roots
+ * are checked within a single run of the garbage collector, which visits each
+ * root of the heap at most once.
+ */
+bool collectJunkFrom(SymHeap &sh, const TValList &roots, TValList *leakList = 0);
+
 /// experimental
 bool collectSharedJunk(SymHeap &sh, TValId root, TValList *leakList = 0);
 
@@ -62,14 +69,11 @@ class LeakMonitor {
 
         template <class TCont>
         bool collectJunkFrom(const TCont &killedPtrs) {
-            bool leaking = false;
-            BOOST_FOREACH(TValId val, killedPtrs) {
-                const TValId root = sh_.valRoot(val);
-                if (collectJunk(sh_, root, &leakList_))
-                    leaking = true;
-            }
-
-            return leaking;
+            TValList roots;
+            BOOST_FOREACH(TValId val, killedPtrs)
+                roots.push_back(sh_.valRoot(val));
+
+            return ::collectJunkFrom(sh_, roots, &leakList_);
         }
 
         bool /* leaking */ destroyRoot(const TValId root) {
@@ -41,24 +41,13 @@
 #endif
 
 #include <algorithm>
+#include <deque>
 #include <map>
 #include <set>
 
 #include <boost/foreach.hpp>
 #include <boost/tuple/tuple.hpp>
 
-template <class TCont> typename TCont::value_type::second_type&
-assignInvalidIfNotFound(
-        TCont                                           &cont,
-        const typename TCont::value_type::first_type    &item)
-{
-    if (!hasKey(cont, item))
-        // -1 means "invalid", e.g. VAL_INVALID in case [T = map<???, TValId>]
-        cont[item] = static_cast<typename TCont::value_type::second_type>(-1);
-
-    return cont[item];
-}
-
 static bool bypassSelfChecks;
 
 void enableProtectedMode(bool enable) {
@@ -92,6 +81,8 @@ class NeqDb: public SymPairSet<TValId, /* IREFLEXIVE */ true> {
                 const SymHeapCore       &src,
                 const TValMap           &vMap)
             const;
+
+        friend void SymHeapCore::gatherNeqPreds(TValPairList &dst) const;
 };
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -138,6 +129,11 @@ class CVarMap {
                 CL_BREAK_IF("offset detected in CVarMap::remove()");
         }
 
+        void gather(TCVarSet &dst) const {
+            BOOST_FOREACH(TCont::const_reference item, cont_)
+                dst.insert(dst.end(), item.first);
+        }
+
         TValId find(const CVar &cVar) {
             // regular lookup
             TCont::iterator iter = cont_.find(cVar);
@@ -254,6 +250,84 @@ bool operator==(const CustomValue &a, const CustomValue &b) {
     return false;
 }
 
+struct CustomValueLess {
+    bool operator()(const CustomValue *a, const CustomValue *b) const {
+        const ECustomValue code = a->code();
+        if (code != b->code())
+            return (code < b->code());
+
+        switch (code) {
+            case CV_INVALID:
+                break;
+
+            case CV_FNC:
+                return (a->uid() < b->uid());
+
+            case CV_REAL:
+                return (a->fpn() < b->fpn());
+
+            case CV_STRING:
+                return (a->str() < b->str());
+
+            case CV_INT_RANGE: {
+                const IR::Range &rngA = a->rng();
+                const IR::Range &rngB = b->rng();
+                if (rngA.lo != rngB.lo)
+                    return (rngA.lo < rngB.lo);
+                if (rngA.hi != rngB.hi)
+                    return (rngA.hi < rngB.hi);
+                return (rngA.alignment < rngB.alignment);
+            }
+        }
+
+        CL_BREAK_IF("CustomValueLess got something special");
+        return false;
+    }
+};
+
+/// global table of custom values, each distinct value is stored only once
+class CustomValueTable {
+    private:
+        typedef std::map<const CustomValue *, TCustomId, CustomValueLess> TMap;
+
+        std::deque<CustomValue>     values_;
+        TMap                        idMap_;
+
+    public:
+        TCustomId intern(const CustomValue &cv) {
+            CL_BREAK_IF(CV_INVALID == cv.code());
+            TMap::const_iterator it = idMap_.find(&cv);
+            if (idMap_.end() != it)
+                return it->second;
+
+            // the values are never removed, so the references remain valid
+            const TCustomId id = values_.size();
+            values_.push_back(cv);
+            idMap_[&values_.back()] = id;
+            return id;
+        }
+
+        const CustomValue& valueOf(const TCustomId id) const {
+            CL_BREAK_IF(id < 0 || static_cast<TCustomId>(values_.size()) <= id);
+            return values_[id];
+        }
+};
+
+// intentionally never destroyed, heaps in static storage may outlive us
+static CustomValueTable *customValueTable;
+
+static TCustomId internCustomValue(const CustomValue &cv) {
+    if (!customValueTable)
+        customValueTable = new CustomValueTable;
+
+    return customValueTable->intern(cv);
+}
+
+static const CustomValue& customValueById(const TCustomId id) {
+    CL_BREAK_IF(!customValueTable);
+    return customValueTable->valueOf(id);
+}
+
 
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of SymHeapCore
@@ -321,7 +395,7 @@ inline EBlockKind bkFromClt(const TObjType clt) {
         : BK_DATA_OBJ;
 }
 
-class AbstractHeapEntity {
+class AbstractHeapEntity: public MemAccounted<MC_HEAP_ENTITY> {
     public:
         virtual AbstractHeapEntity* clone() const = 0;
 
@@ -453,13 +527,18 @@ struct CompValue: public BaseValue {
 };
 
 struct InternalCustomValue: public ReferableValue {
-    CustomValue                     customData;
+    TCustomId                       customId;
 
     InternalCustomValue(EValueTarget code_, EValueOrigin origin_):
-        ReferableValue(code_, origin_)
+        ReferableValue(code_, origin_),
+        customId(-1)
     {
     }
 
+    const CustomValue& customData() const {
+        return customValueById(customId);
+    }
+
     virtual InternalCustomValue* clone() const {
         return new InternalCustomValue(*this);
     }
@@ -490,42 +569,37 @@ struct RootValue: public AnchorValue {
 // cppcheck-suppress noConstructor
 class CustomValueMapper {
     private:
-        typedef std::map<int /* uid */, TValId>                 TCustomByUid;
-        typedef std::map<IR::TInt, TValId>                      TCustomByNum;
-        typedef std::map<double, TValId>                        TCustomByReal;
-        typedef std::map<std::string, TValId>                   TCustomByString;
+        typedef std::pair<TCustomId, TValId>                    TItem;
+        typedef std::vector<TItem>                              TItems;
 
-        TCustomByUid        fncMap;
-        TCustomByNum        numMap;
-        TCustomByReal       fpnMap;
-        TCustomByString     strMap;
-        TValId              inval_;
+        /// pairs sorted by IDs of the interned custom values
+        TItems              items_;
 
     public:
         RefCounter          refCnt;
 
     public:
-        TValId& lookup(const CustomValue &item) {
-            const ECustomValue code = item.code();
-            switch (code) {
-                case CV_INVALID:
-                default:
-                    CL_BREAK_IF("invalid call of CustomValueMapper::lookup()");
-                    return inval_ = VAL_INVALID;
-
-                case CV_FNC:
-                    return assignInvalidIfNotFound(fncMap, item.uid());
-
-                case CV_INT_RANGE:
-                    CL_BREAK_IF(!isSingular(item.rng()));
-                    return assignInvalidIfNotFound(numMap, item.rng().lo);
-
-                case CV_REAL:
-                    return assignInvalidIfNotFound(fpnMap, item.fpn());
-
-                case CV_STRING:
-                    return assignInvalidIfNotFound(strMap, item.str());
-            }
+        TValId& lookup(const TCustomId id) {
+            CL_BREAK_IF(id < 0);
+            const TItem key(id, VAL_INVALID);
+            TItems::iterator it =
+                std::lower_bound(items_.begin(), items_.end(), key);
+
+            if (items_.end() == it || it->first != id)
+                // not found, insert VAL_INVALID to be overwritten by caller
+                it = items_.insert(it, key);
+
+            return it->second;
+        }
+
+        TValId find(const TCustomId id) const {
+            const TItem key(id, VAL_INVALID);
+            TItems::const_iterator it =
+                std::lower_bound(items_.begin(), items_.end(), key);
+
+            return (items_.end() == it || it->first != id)
+                ? VAL_INVALID
+                : it->second;
         }
 };
 
@@ -534,6 +608,20 @@ struct TValSetWrapper: public TValSet {
     RefCounter refCnt;
 };
 
+#if SH_TRACK_DIRTY_ROOTS
+/// roots written to since the last call of SymHeapCore::clearDirtyRoots()
+struct DirtyRoots {
+    RefCounter                      refCnt;
+    bool                            all;
+    TValSet                         roots;
+
+    DirtyRoots():
+        all(true)
+    {
+    }
+};
+#endif
+
 struct SymHeapCore::Private {
     Private(Trace::Node *);
     Private(const Private &);
@@ -546,6 +634,14 @@ struct SymHeapCore::Private {
     CustomValueMapper              *cValueMap;
     CoincidenceDb                  *coinDb;
     NeqDb                          *neqDb;
+#if SH_TRACK_DIRTY_ROOTS
+    DirtyRoots                     *dirtyRoots;
+#endif
+
+    inline void markDirty(TValId root);
+    inline void markDirtyTarget(TValId val);
+    inline void markDirtyOwner(TObjId obj);
+    inline void markAllDirty();
 
     inline TObjId assignId(BlockEntity *);
     inline TValId assignId(BaseValue *);
@@ -638,11 +734,72 @@ inline TObjId SymHeapCore::Private::assignId(BlockEntity *hbData) {
     return this->ents.assignId<TObjId>(hbData);
 }
 
+inline void SymHeapCore::Private::markDirty(TValId root) {
+#if SH_TRACK_DIRTY_ROOTS
+    if (this->dirtyRoots->all || root <= 0)
+        // nothing to track
+        return;
+
+    if (hasKey(this->dirtyRoots->roots, root))
+        // already marked, do not clone the shared set for nothing
+        return;
+
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(this->dirtyRoots);
+    this->dirtyRoots->roots.insert(root);
+#else
+    (void) root;
+#endif
+}
+
+inline void SymHeapCore::Private::markDirtyTarget(TValId val) {
+#if SH_TRACK_DIRTY_ROOTS
+    if (this->dirtyRoots->all || val <= 0)
+        return;
+
+    const BaseValue *valData;
+    this->ents.getEntRO(&valData, val);
+    if (isAnyDataArea(valData->code))
+        this->markDirty(valData->valRoot);
+
+    // a predicate over the value (e.g. int or custom) changes its owners, too
+    BOOST_FOREACH(const TObjId obj, valData->usedBy)
+        this->markDirtyOwner(obj);
+#else
+    (void) val;
+#endif
+}
+
+inline void SymHeapCore::Private::markDirtyOwner(TObjId obj) {
+#if SH_TRACK_DIRTY_ROOTS
+    if (this->dirtyRoots->all)
+        return;
+
+    const BlockEntity *blData;
+    this->ents.getEntRO(&blData, obj);
+    this->markDirty(blData->root);
+#else
+    (void) obj;
+#endif
+}
+
+inline void SymHeapCore::Private::markAllDirty() {
+#if SH_TRACK_DIRTY_ROOTS
+    if (this->dirtyRoots->all)
+        return;
+
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(this->dirtyRoots);
+    this->dirtyRoots->all = true;
+    this->dirtyRoots->roots.clear();
+#endif
+}
+
 bool /* wasPtr */ SymHeapCore::Private::releaseValueOf(TObjId obj, TValId val) {
     if (val <= 0)
         // we do not track uses of special values
         return /* wasPtr */ false;
 
+    this->markDirtyOwner(obj);
+
     BaseValue *valData;
     this->ents.getEntRW(&valData, val);
     TObjIdSet &usedBy = valData->usedBy;
@@ -665,6 +822,7 @@ bool /* wasPtr */ SymHeapCore::Private::releaseValueOf(TObjId obj, TValId val) {
 
     // jump to root
     const TValId root = valData->valRoot;
+    this->markDirty(root);
     this->ents.getEntRW(&valData, root);
 
     RootValue *rootData = DCAST<RootValue *>(valData);
@@ -678,6 +836,8 @@ void SymHeapCore::Private::registerValueOf(TObjId obj, TValId val) {
     if (val <= 0)
         return;
 
+    this->markDirtyOwner(obj);
+
     // update usedBy
     BaseValue *valData;
     this->ents.getEntRW(&valData, val);
@@ -689,6 +849,7 @@ void SymHeapCore::Private::registerValueOf(TObjId obj, TValId val) {
 
     // update usedByGl
     const TValId root = valData->valRoot;
+    this->markDirty(root);
     RootValue *rootData;
     this->ents.getEntRW(&rootData, root);
     rootData->usedByGl.insert(obj);
@@ -889,7 +1050,7 @@ bool SymHeapCore::Private::writeCharToString(
     // extract the string that is going to be modified
     const InternalCustomValue *stringData =
         DCAST<const InternalCustomValue *>(dstData);
-    std::string str(stringData->customData.str());
+    std::string str(stringData->customData().str());
     CL_BREAK_IF(static_cast<TOffset>(str.size()) < pos || pos < 0);
 
     // modify the string accordingly as long as the result is still a string
@@ -904,7 +1065,7 @@ bool SymHeapCore::Private::writeCharToString(
         const InternalCustomValue *numData =
             DCAST<const InternalCustomValue *>(valData);
 
-        const IR::Range rng = numData->customData.rng();
+        const IR::Range rng = numData->customData().rng();
         if (!isSingular(rng))
             return false;
 
@@ -915,15 +1076,15 @@ bool SymHeapCore::Private::writeCharToString(
     // update the mapping of the string being assigned
     CL_DEBUG("CV_STRING replaced as a consequence of data reinterpretation");
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(this->cValueMap);
-    const CustomValue cvStr(str.c_str());
-    TValId &valStr = this->cValueMap->lookup(cvStr);
+    const TCustomId idStr = internCustomValue(CustomValue(str.c_str()));
+    TValId &valStr = this->cValueMap->lookup(idStr);
 
     if (VAL_INVALID == valStr) {
         // CV_STRING not found, wrap it as a new heap value
         valStr = this->valCreate(VT_CUSTOM, VO_ASSIGNED);
         InternalCustomValue *dstData;
         this->ents.getEntRW(&dstData, valStr);
-        dstData->customData = cvStr;
+        dstData->customId = idStr;
     }
 
     *pValDst = valStr;
@@ -961,7 +1122,7 @@ bool SymHeapCore::Private::reinterpretSingleObj(
         this->ents.getEntRO(&valData, valSrc);
 
         const TOffset off = dstData->off - srcData->off;
-        const std::string &str = valData->customData.str();
+        const std::string &str = valData->customData().str();
         CL_BREAK_IF(static_cast<TOffset>(str.size()) < off || off < 0);
 
         // byte-level access to zero-terminated strings
@@ -1272,6 +1433,7 @@ void SymHeapCore::Private::transferBlock(
         // no data to copy in here
         return;
 
+    this->markDirty(dstRoot);
     RootValue *rootDataDst;
     this->ents.getEntRW(&rootDataDst, dstRoot);
     const TOffset shift = dstOff - winBeg;
@@ -1319,6 +1481,9 @@ SymHeapCore::Private::Private(Trace::Node *trace):
     cValueMap   (new CustomValueMapper),
     coinDb      (new CoincidenceDb),
     neqDb       (new NeqDb)
+#if SH_TRACK_DIRTY_ROOTS
+    , dirtyRoots(new DirtyRoots)
+#endif
 {
     // allocate a root-value for VAL_NULL
     this->assignId(new RootValue(VT_INVALID, VO_INVALID));
@@ -1332,12 +1497,18 @@ SymHeapCore::Private::Private(const SymHeapCore::Private &ref):
     cValueMap   (ref.cValueMap),
     coinDb      (ref.coinDb),
     neqDb       (ref.neqDb)
+#if SH_TRACK_DIRTY_ROOTS
+    , dirtyRoots(ref.dirtyRoots)
+#endif
 {
     RefCntLib<RCO_NON_VIRT>::enter(this->liveRoots);
     RefCntLib<RCO_NON_VIRT>::enter(this->cVarMap);
     RefCntLib<RCO_NON_VIRT>::enter(this->cValueMap);
     RefCntLib<RCO_NON_VIRT>::enter(this->coinDb);
     RefCntLib<RCO_NON_VIRT>::enter(this->neqDb);
+#if SH_TRACK_DIRTY_ROOTS
+    RefCntLib<RCO_NON_VIRT>::enter(this->dirtyRoots);
+#endif
 }
 
 SymHeapCore::Private::~Private() {
@@ -1346,6 +1517,9 @@ SymHeapCore::Private::~Private() {
     RefCntLib<RCO_NON_VIRT>::leave(this->cValueMap);
     RefCntLib<RCO_NON_VIRT>::leave(this->coinDb);
     RefCntLib<RCO_NON_VIRT>::leave(this->neqDb);
+#if SH_TRACK_DIRTY_ROOTS
+    RefCntLib<RCO_NON_VIRT>::leave(this->dirtyRoots);
+#endif
 }
 
 TValId SymHeapCore::Private::objInit(TObjId obj) {
@@ -1612,6 +1786,7 @@ TValId SymHeapCore::Private::dupRoot(TValId rootAt) {
 
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(this->liveRoots);
     this->liveRoots->insert(imageAt);
+    this->markDirty(imageAt);
 
     BOOST_FOREACH(TLiveObjs::const_reference item, rootDataSrc->liveObjs)
         this->copySingleLiveBlock(imageAt, rootDataDst,
@@ -1772,12 +1947,66 @@ void SymHeapCore::swap(SymHeapCore &ref) {
     swapValues(this->d, ref.d);
 }
 
+bool SymHeapCore::sharesDataWith(const SymHeapCore &ref) const {
+    if (&stor_ != &ref.stor_)
+        return false;
+
+    // the trace graph node is not considered part of the heap
+    const Private &d1 = *this->d;
+    const Private &d2 = *ref.d;
+    return d1.ents.sharesDataWith(d2.ents)
+        && (d1.liveRoots    == d2.liveRoots)
+        && (d1.cVarMap      == d2.cVarMap)
+        && (d1.cValueMap    == d2.cValueMap)
+        && (d1.coinDb       == d2.coinDb)
+        && (d1.neqDb        == d2.neqDb);
+}
+
+bool SymHeapCore::gatherDirtyRoots(TValSet &dst) const {
+#if SH_TRACK_DIRTY_ROOTS
+    const DirtyRoots &dirty = *d->dirtyRoots;
+    if (dirty.all)
+        return false;
+
+    dst.insert(dirty.roots.begin(), dirty.roots.end());
+    return true;
+#else
+    (void) dst;
+    return false;
+#endif
+}
+
+void SymHeapCore::clearDirtyRoots() {
+#if SH_TRACK_DIRTY_ROOTS
+    const DirtyRoots &dirty = *d->dirtyRoots;
+    if (!dirty.all && dirty.roots.empty())
+        return;
+
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(d->dirtyRoots);
+    d->dirtyRoots->all = false;
+    d->dirtyRoots->roots.clear();
+#endif
+}
+
+void SymHeapCore::markDirtyRoot(TValId root) {
+    d->markDirty(root);
+}
+
 Trace::Node* SymHeapCore::traceNode() const {
     return d->traceHandle.node();
 }
 
 void SymHeapCore::traceUpdate(Trace::Node *node) {
-    d->traceHandle.reset(node);
+    if (Trace::TL_FULL == Trace::traceLevel()
+            || !node->isAuxiliary() || node->cntChildren())
+    {
+        d->traceHandle.reset(node);
+        return;
+    }
+
+    // the node is not needed to reconstruct error traces, bypass it
+    d->traceHandle.reset(node->parent());
+    delete node;
 }
 
 void SymHeapCore::objSetValue(TObjId obj, TValId val, TValSet *killedPtrs) {
@@ -1819,6 +2048,7 @@ TObjId SymHeapCore::Private::writeUniformBlock(
     const TObjId obj = this->assignId(blData);
 
     // check up to now arena consistency
+    this->markDirty(root);
     RootValue *rootData;
     this->ents.getEntRW(&rootData, root);
     CL_BREAK_IF(!this->chkArenaConsistency(rootData));
@@ -1943,7 +2173,7 @@ bool SymHeapCore::Private::findZeroInBlock(
         *provenPrefix = (off <= offSrc);
 
         // the length of the string is equal to the offset of its trailing zero
-        const std::string &str = valData->customData.str();
+        const std::string &str = valData->customData().str();
         *offDst = off + str.size();
         return true;
     }
@@ -2023,7 +2253,7 @@ TValId SymHeapCore::Private::shiftCustomValue(TValId ref, TOffset shift) {
     this->ents.getEntRO(&customDataRef, ref);
 
     // prepare a custom value template and compute the shifted range
-    const IR::Range rngRef = rngFromCustom(customDataRef->customData);
+    const IR::Range rngRef = rngFromCustom(customDataRef->customData());
     const CustomValue cv(rngRef + IR::rngFromNum(shift));
 
     // create a new CV_INT_RANGE custom value (do not recycle existing)
@@ -2032,7 +2262,7 @@ TValId SymHeapCore::Private::shiftCustomValue(TValId ref, TOffset shift) {
     this->ents.getEntRW(&customData, val);
     customData->anchor      = customDataRef->anchor;
     customData->offRoot     = customDataRef->offRoot + shift;
-    customData->customData  = cv;
+    customData->customId = internCustomValue(cv);
 
     // register this value as a dependent value by the anchor
     ReferableValue *refData;
@@ -2051,15 +2281,15 @@ TValId SymHeapCore::Private::wrapIntVal(const IR::TInt num) {
 
     // CV_INT values are supposed to be reused if they exist already
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(this->cValueMap);
-    const CustomValue cvRng(IR::rngFromNum(num));
-    TValId &valInt = this->cValueMap->lookup(cvRng);
+    const TCustomId idInt = internCustomValue(CustomValue(IR::rngFromNum(num)));
+    TValId &valInt = this->cValueMap->lookup(idInt);
 
     if (VAL_INVALID == valInt) {
         // CV_INT_RANGE not found, wrap it as a new heap value
         valInt = this->valCreate(VT_CUSTOM, VO_ASSIGNED);
         InternalCustomValue *intData;
         this->ents.getEntRW(&intData, valInt);
-        intData->customData = cvRng;
+        intData->customId = idInt;
     }
 
     return valInt;
@@ -2069,7 +2299,7 @@ void SymHeapCore::Private::replaceRngByInt(const InternalCustomValue *valData) {
     CL_DEBUG("replaceRngByInt() is taking place...");
 
     // we already expect a scalar at this point
-    const CustomValue &cvRng = valData->customData;
+    const CustomValue &cvRng = valData->customData();
     const IR::Range &rng = rngFromCustom(cvRng);
     CL_BREAK_IF(!isSingular(rng));
 
@@ -2086,7 +2316,7 @@ void SymHeapCore::Private::trimCustomValue(TValId val, const IR::Range &win) {
     this->ents.getEntRO(&customData, val);
 
     // extract the original integral ragne
-    const IR::Range &refRange = rngFromCustom(customData->customData);
+    const IR::Range &refRange = rngFromCustom(customData->customData());
     CL_BREAK_IF(isSingular(refRange));
 
     // compute the difference between the original and desired ranges
@@ -2112,10 +2342,10 @@ void SymHeapCore::Private::trimCustomValue(TValId val, const IR::Range &win) {
         this->ents.getEntRW(&depData, depVal);
 
         // shift the bounds accordingly
-        CustomValue &cvDep = depData->customData;
-        IR::Range &rngDep = cvDep.rng();
+        IR::Range rngDep = rngFromCustom(depData->customData());
         rngDep.lo += loShift;
         rngDep.hi -= hiShift;
+        depData->customId = internCustomValue(CustomValue(rngDep));
 
         if (isSingular(rngDep))
             // CV_INT_RANGE reduced to CV_INT
@@ -2279,6 +2509,9 @@ TValId SymHeapCore::valShift(TValId valToShift, TValId shiftBy) {
 }
 
 void SymHeapCore::valRestrictRange(TValId val, IR::Range win) {
+    // the value may be shared by any number of objects, do not track them
+    d->markAllDirty();
+
     const BaseValue *valData;
     d->ents.getEntRO(&valData, val);
 
@@ -2581,6 +2814,8 @@ void SymHeapCore::valReplace(TValId val, TValId replaceBy) {
 }
 
 void SymHeapCore::neqOp(ENeqOp op, TValId v1, TValId v2) {
+    d->markDirtyTarget(v1);
+    d->markDirtyTarget(v2);
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(d->neqDb);
 
     switch (op) {
@@ -2643,6 +2878,92 @@ void SymHeapCore::copyRelevantPreds(SymHeapCore &dst, const TValMap &valMap)
     }
 }
 
+static bool isRelevantVal(
+        const SymHeapCore           &sh,
+        const TValId                val,
+        const TValSet               &roots,
+        const bool                  inSet)
+{
+    if (val <= VAL_NULL)
+        // special values are always relevant
+        return true;
+
+    return inSet == hasKey(roots, sh.valRoot(val));
+}
+
+void SymHeapCore::dropIrrelevantPreds(const TValSet &relevantRoots) {
+    this->dropPreds(relevantRoots, /* inSet */ true);
+}
+
+void SymHeapCore::dropPredsOf(const TValSet &roots) {
+    this->dropPreds(roots, /* inSet */ false);
+}
+
+void SymHeapCore::dropPreds(const TValSet &roots, const bool inSet) {
+    // go through NeqDb
+    TValPairList neqs;
+    this->gatherNeqPreds(neqs);
+    BOOST_FOREACH(const TValPair &item, neqs) {
+        if (isRelevantVal(*this, item.first,  roots, inSet)
+                && isRelevantVal(*this, item.second, roots, inSet))
+            continue;
+
+        SymHeapCore::neqOp(NEQ_DEL, item.first, item.second);
+    }
+
+    // go through CoincidenceDb
+    TCoinList coins;
+    this->gatherCoincidences(coins);
+    BOOST_FOREACH(TCoinList::const_reference item, coins) {
+        const TValId valLt = item.first.first;
+        const TValId valGt = item.first.second;
+        if (isRelevantVal(*this, valLt, roots, inSet)
+                && isRelevantVal(*this, valGt, roots, inSet))
+            continue;
+
+        d->markDirtyTarget(valLt);
+        d->markDirtyTarget(valGt);
+        RefCntLib<RCO_NON_VIRT>::requireExclusivity(d->coinDb);
+        d->coinDb->del(valLt, valGt);
+    }
+}
+
+void SymHeapCore::gatherNeqPreds(TValPairList &dst) const {
+    BOOST_FOREACH(const NeqDb::TItem &item, d->neqDb->cont_)
+        dst.push_back(item);
+}
+
+void SymHeapCore::gatherCoincidences(TCoinList &dst) const {
+    const CoincidenceDb &coinDb = *d->coinDb;
+    BOOST_FOREACH(CoincidenceDb::const_reference ref, coinDb)
+        dst.push_back(ref);
+}
+
+void SymHeapCore::addCoincidence(TValId v1, TValId v2, TValId sum) {
+    d->markDirtyTarget(v1);
+    d->markDirtyTarget(v2);
+    RefCntLib<RCO_NON_VIRT>::requireExclusivity(d->coinDb);
+    d->coinDb->add(v1, v2, sum);
+}
+
+unsigned SymHeapCore::cntPreds() const {
+    return d->neqDb->size()
+        +  d->coinDb->size();
+}
+
+void SymHeapCore::gatherStorage(TStorageMap &dst) const {
+    // the entities are counted with the chunks of EntStore referring to them
+    d->ents.gatherStorage(dst, sizeof(AnchorValue));
+
+    // a node of a std::set/map per predicate
+    const size_t node = 4 * sizeof(void *);
+    dst[d->neqDb]   = sizeof(NeqDb)         + node * d->neqDb->size();
+    dst[d->coinDb]  = sizeof(CoincidenceDb) + node * d->coinDb->size();
+
+    // never shared with other instances
+    dst[d] = sizeof(Private);
+}
+
 bool SymHeapCore::matchPreds(const SymHeapCore &ref, const TValMap &valMap)
     const
 {
@@ -2914,6 +3235,10 @@ CVar SymHeapCore::cVarByRoot(TValId valRoot) const {
     return rootData->cVar;
 }
 
+void SymHeapCore::gatherCVars(TCVarSet &dst) const {
+    d->cVarMap->gather(dst);
+}
+
 TValId SymHeapCore::addrOfVar(CVar cv, bool createIfNeeded) {
     TValId addr = d->cVarMap->find(cv);
     if (0 < addr)
@@ -2975,6 +3300,10 @@ void SymHeapCore::gatherRootObjects(TValList &dst, bool (*filter)(EValueTarget))
             dst.push_back(at);
 }
 
+unsigned SymHeapCore::cntRootObjects() const {
+    return d->liveRoots->size();
+}
+
 TObjId SymHeapCore::valGetComposite(TValId val) const {
     const BaseValue *valData;
     d->ents.getEntRO(&valData, val);
@@ -3048,7 +3377,7 @@ TSizeRange SymHeapCore::valSizeOfString(TValId addr) const {
         const InternalCustomValue *customData =
             DCAST<const InternalCustomValue *>(valData);
 
-        const CustomValue &cv = customData->customData;
+        const CustomValue &cv = customData->customData();
         if (CV_STRING != cv.code())
             return /* error */ IR::rngFromNum(IR::Int0);
 
@@ -3078,6 +3407,7 @@ TSizeRange SymHeapCore::valSizeOfString(TValId addr) const {
 }
 
 void SymHeapCore::valSetLastKnownTypeOfTarget(TValId root, TObjType clt) {
+    d->markDirty(root);
     RootValue *rootData;
     d->ents.getEntRW(&rootData, root);
 
@@ -3105,6 +3435,11 @@ void SymHeapCore::Private::destroyRoot(TValId root) {
     RootValue *rootData;
     this->ents.getEntRW(&rootData, root);
 
+    // the objects pointing to the root are affected, too
+    this->markDirty(root);
+    BOOST_FOREACH(const TObjId obj, rootData->usedByGl)
+        this->markDirtyOwner(obj);
+
     EValueTarget code = VT_DELETED;
     const CVar cv = rootData->cVar;
     if (cv.uid != /* heap object */ -1) {
@@ -3193,12 +3528,13 @@ TValId SymHeapCore::valWrapCustom(CustomValue cVal) {
         const TValId val = d->valCreate(VT_CUSTOM, VO_ASSIGNED);
         InternalCustomValue *valData;
         d->ents.getEntRW(&valData, val);
-        valData->customData = cVal;
+        valData->customId = internCustomValue(cVal);
         return val;
     }
 
+    const TCustomId id = internCustomValue(cVal);
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(d->cValueMap);
-    TValId &val = d->cValueMap->lookup(cVal);
+    TValId &val = d->cValueMap->lookup(id);
     if (VAL_INVALID != val)
         // custom value already wrapped, we have to reuse it
         return val;
@@ -3207,7 +3543,7 @@ TValId SymHeapCore::valWrapCustom(CustomValue cVal) {
     val = d->valCreate(VT_CUSTOM, VO_ASSIGNED);
     InternalCustomValue *valData;
     d->ents.getEntRW(&valData, val);
-    valData->customData = cVal;
+    valData->customId = id;
     return val;
 }
 
@@ -3216,7 +3552,7 @@ const CustomValue& SymHeapCore::valUnwrapCustom(TValId val) const
     const InternalCustomValue *valData;
     d->ents.getEntRO(&valData, val);
 
-    const CustomValue &cv = valData->customData;
+    const CustomValue &cv = valData->customData();
     const ECustomValue code = cv.code();
 
     if (CV_INT_RANGE == code) {
@@ -3229,11 +3565,18 @@ const CustomValue& SymHeapCore::valUnwrapCustom(TValId val) const
     }
 
     // check the consistency of backward mapping
-    CL_BREAK_IF(val != d->cValueMap->lookup(valData->customData));
+    CL_BREAK_IF(val != d->cValueMap->find(valData->customId));
 
     return cv;
 }
 
+TCustomId SymHeapCore::valCustomId(TValId val) const {
+    const InternalCustomValue *valData;
+    d->ents.getEntRO(&valData, val);
+    CL_BREAK_IF(VT_CUSTOM != valData->code);
+    return valData->customId;
+}
+
 TProtoLevel SymHeapCore::valTargetProtoLevel(TValId val) const {
     if (val <= 0)
         // not a prototype for sure
@@ -3257,6 +3600,7 @@ void SymHeapCore::valTargetSetProtoLevel(TValId root, TProtoLevel level) {
     CL_BREAK_IF(this->valOffset(root));
     CL_BREAK_IF(level < 0);
 
+    d->markDirty(root);
     RootValue *rootData;
     d->ents.getEntRW(&rootData, root);
     rootData->protoLevel = level;
@@ -3385,6 +3729,14 @@ void SymHeap::swap(SymHeapCore &baseRef) {
     swapValues(this->d, ref.d);
 }
 
+bool SymHeap::sharesDataWith(const SymHeapCore &baseRef) const {
+    if (!SymHeapCore::sharesDataWith(baseRef))
+        return false;
+
+    const SymHeap &ref = DCAST<const SymHeap &>(baseRef);
+    return (this->d == ref.d);
+}
+
 TValId SymHeap::valClone(TValId val) {
     const TValId dup = SymHeapCore::valClone(val);
     if (dup <= 0 || VT_RANGE == this->valTarget(val))
@@ -3443,6 +3795,7 @@ void SymHeap::valTargetSetAbstract(
     // there is no 'prev' offset in OK_SEE_THROUGH
     CL_BREAK_IF(OK_SEE_THROUGH == kind && off.prev != off.next);
 
+    SymHeapCore::markDirtyRoot(root);
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(d);
 
     // clone the data
@@ -3471,6 +3824,7 @@ void SymHeap::valTargetSetConcrete(TValId root) {
     CL_BREAK_IF(this->valOffset(root));
     CL_BREAK_IF(!d->absRoots.isValidEnt(root));
 
+    SymHeapCore::markDirtyRoot(root);
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(d);
 
     // unregister an abstract object
@@ -3726,6 +4080,7 @@ void SymHeap::segSetMinLength(TValId seg, TMinLen len) {
     CL_BREAK_IF(this->valOffset(seg));
     CL_BREAK_IF(!d->absRoots.isValidEnt(seg));
 
+    SymHeapCore::markDirtyRoot(seg);
     RefCntLib<RCO_NON_VIRT>::requireExclusivity(d);
 
     AbstractRoot *aData = d->absRoots.getEntRW(seg);
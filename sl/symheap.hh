@@ -173,6 +173,9 @@ class CustomValue {
 
 bool operator==(const CustomValue &a, const CustomValue &b);
 
+/// ID of a custom value interned in a global table shared by all heaps
+typedef int                                             TCustomId;
+
 inline bool operator!=(const CustomValue &a, const CustomValue &b) {
     return !operator==(a, b);
 }
@@ -206,6 +209,15 @@ typedef std::set<TValId>                                TValSet;
 /// a type used for (injective) value IDs mapping
 typedef std::map<TValId, TValId>                        TValMap;
 
+/// list of value pairs, e.g. Neq predicates
+typedef std::vector<TValPair>                           TValPairList;
+
+/// list of coincidences, each of them maps a pair of values to their sum
+typedef std::vector<std::pair<TValPair, TValId> >       TCoinList;
+
+/// blocks of storage keyed by their addresses, each of them with its size
+typedef std::map<const void *, size_t>                  TStorageMap;
+
 /// a type used for type-info
 typedef const struct cl_type                           *TObjType;
 
@@ -310,6 +322,13 @@ class SymHeapCore {
         /// exchange the contents with the other heap (works in constant time)
         virtual void swap(SymHeapCore &);
 
+        /**
+         * true if both heaps still physically share all their data, which is
+         * only possible with SH_COPY_ON_WRITE enabled and implies areEqual()
+         * @note the check is conservative and works in constant time
+         */
+        virtual bool sharesDataWith(const SymHeapCore &) const;
+
         /// each symbolic heap is associated with a CodeStorage model of code
         TStorRef stor() const { return stor_; }
 
@@ -380,9 +399,34 @@ class SymHeapCore {
         /// transfer as many as possible extra heap predicates from this to dst
         void copyRelevantPreds(SymHeapCore &dst, const TValMap &valMap) const;
 
+        /// remove all extra predicates over values with roots not in the set
+        void dropIrrelevantPreds(const TValSet &relevantRoots);
+
+        /// remove all extra predicates over values with roots in the set
+        void dropPredsOf(const TValSet &roots);
+
         /// true if all Neq predicates can be mapped to Neq predicates in ref
         bool matchPreds(const SymHeapCore &ref, const TValMap &valMap) const;
 
+        /// list all Neq predicates, each of them as a pair of value IDs
+        void gatherNeqPreds(TValPairList &dst) const;
+
+        /// list all coincidences of values, see diffPointers()
+        void gatherCoincidences(TCoinList &dst) const;
+
+        /// define a coincidence of values as listed by gatherCoincidences()
+        void addCoincidence(TValId v1, TValId v2, TValId sum);
+
+        /// return the count of extra heap predicates (Neq and coincidences)
+        unsigned cntPreds() const;
+
+        /**
+         * gather a rough estimate of the memory occupied by the heap (in bytes)
+         * per block of storage, the blocks shared among copies of the heap are
+         * keyed by the same address, so that the caller can count them once
+         */
+        void gatherStorage(TStorageMap &dst) const;
+
     public:
         /// translate the given address by the given offset
         TValId valByOffset(TValId, TOffset offset);
@@ -433,6 +477,9 @@ class SymHeapCore {
         /// list of root heap entities satisfying the given filtering predicate
         void gatherRootObjects(TValList &dst, bool (*)(EValueTarget) = 0) const;
 
+        /// count of root heap entities, the same as gatherRootObjects() lists
+        unsigned cntRootObjects() const;
+
         /// list of live objects (including ptrs) owned by the given root entity
         void gatherLiveObjects(ObjList &dst, TValId root) const;
 
@@ -456,6 +503,9 @@ class SymHeapCore {
          */
         CVar cVarByRoot(TValId root) const;
 
+        /// all live program variables, without going through all the roots
+        void gatherCVars(TCVarSet &dst) const;
+
         /**
          * composite object given by val (applicable only on VT_COMPOSITE vals)
          * @todo should we operate on ObjHandle instead?
@@ -484,6 +534,9 @@ class SymHeapCore {
         /// unwrap a custom value, such as integer literal, or code pointer
         const CustomValue& valUnwrapCustom(TValId) const;
 
+        /// ID of the interned custom value, equal IDs mean equal custom values
+        TCustomId valCustomId(TValId) const;
+
     public:
         /// prototype level of the target root entity (0 means not a prototype)
         TProtoLevel valTargetProtoLevel(TValId) const;
@@ -491,6 +544,22 @@ class SymHeapCore {
         /// set prototype level of the given root (0 means not a prototype)
         void valTargetSetProtoLevel(TValId root, TProtoLevel level);
 
+    public:
+        /**
+         * gather roots that have been written to (or pointed to by a changed
+         * object) since the last call of clearDirtyRoots()
+         * @return false if all roots need to be considered dirty, which is
+         * the case of a newly created heap or if SH_TRACK_DIRTY_ROOTS is 0
+         */
+        bool gatherDirtyRoots(TValSet &dst) const;
+
+        /// consider all roots clean from now on
+        void clearDirtyRoots();
+
+    protected:
+        /// mark the given root as changed (see gatherDirtyRoots())
+        void markDirtyRoot(TValId root);
+
     protected:
         /// return a @b data pointer placed at the given address
         TObjId ptrAt(TValId at);
@@ -527,6 +596,8 @@ class SymHeapCore {
     private:
         struct Private;
         Private *d;
+
+        void dropPreds(const TValSet &roots, const bool inSet);
 };
 
 class ObjHandle {
@@ -754,6 +825,8 @@ class SymHeap: public SymHeapCore {
 
         virtual void swap(SymHeapCore &);
 
+        virtual bool sharesDataWith(const SymHeapCore &) const;
+
     public:
         /**
          * return @b kind of the target. Here @b kind means concrete object,
@@ -39,6 +39,7 @@
 #include <set>
 
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/tuple/tuple.hpp>
 
 static bool debuggingSymJoin = static_cast<bool>(DEBUG_SYMJOIN);
@@ -156,6 +157,7 @@ struct SymJoinCtx {
     TWorkList                   wl;
     EJoinStatus                 status;
     bool                        allowThreeWay;
+    const IR::TThresholds      *thresholds;
 
     typedef std::map<TValId /* seg */, TMinLen /* len */>       TSegLengths;
     TSegLengths                 segLengths;
@@ -180,12 +182,15 @@ struct SymJoinCtx {
 
     /// constructor used by joinSymHeaps()
     SymJoinCtx(SymHeap &dst_, const SymHeap &sh1_, const SymHeap &sh2_,
-            const bool allowThreeWay_):
+            const bool allowThreeWay_, const IR::TThresholds *thresholds_):
         dst(dst_),
         sh1(/* XXX */ const_cast<SymHeap &>(sh1_)),
         sh2(/* XXX */ const_cast<SymHeap &>(sh2_)),
         status(JS_USE_ANY),
-        allowThreeWay((1 < (SE_ALLOW_THREE_WAY_JOIN)) && allowThreeWay_)
+        allowThreeWay((1 < (SE_ALLOW_THREE_WAY_JOIN)) && allowThreeWay_),
+        thresholds((thresholds_ && !thresholds_->empty())
+                ? thresholds_
+                : 0)
     {
         initValMaps();
     }
@@ -196,7 +201,8 @@ struct SymJoinCtx {
         sh1(/* XXX */ const_cast<SymHeap &>(sh_)),
         sh2(/* XXX */ const_cast<SymHeap &>(sh_)),
         status(JS_USE_ANY),
-        allowThreeWay(0 < (SE_ALLOW_THREE_WAY_JOIN))
+        allowThreeWay(0 < (SE_ALLOW_THREE_WAY_JOIN)),
+        thresholds(0)
     {
         initValMaps();
     }
@@ -207,7 +213,8 @@ struct SymJoinCtx {
         sh1(sh_),
         sh2(sh_),
         status(JS_USE_ANY),
-        allowThreeWay(0 < (SE_ALLOW_THREE_WAY_JOIN))
+        allowThreeWay(0 < (SE_ALLOW_THREE_WAY_JOIN)),
+        thresholds(0)
     {
         initValMaps();
     }
@@ -538,6 +545,72 @@ bool checkNullConsistency(
     }
 }
 
+/// widen integral values if VAL_NULL or VAL_TRUE stands for one of them
+bool joinSpecialIntValues(
+        bool                    *pResult,
+        SymJoinCtx              &ctx,
+        const ObjHandle         &obj1,
+        const ObjHandle         &obj2,
+        const bool              readOnly)
+{
+    if (!ctx.thresholds)
+        // we are not widening
+        return false;
+
+    const TObjType clt1 = obj1.objType();
+    const TObjType clt2 = obj2.objType();
+    if (!clt1 || CL_TYPE_INT != clt1->code || !clt2 || CL_TYPE_INT != clt2->code)
+        // not an integral variable
+        return false;
+
+    const TValId v1 = obj1.value();
+    const TValId v2 = obj2.value();
+    if (v1 == v2)
+        return false;
+
+    const bool isSpecial1 = (VAL_NULL == v1 || VAL_TRUE == v1);
+    const bool isSpecial2 = (VAL_NULL == v2 || VAL_TRUE == v2);
+    if (!isSpecial1 && !isSpecial2)
+        // joinCustomValues() takes care of this
+        return false;
+
+    if (!isSpecial1 && VT_CUSTOM != ctx.sh1.valTarget(v1))
+        return false;
+    if (!isSpecial2 && VT_CUSTOM != ctx.sh2.valTarget(v2))
+        return false;
+
+    IR::Range rng1, rng2;
+    if (!rngFromVal(&rng1, ctx.sh1, v1) || !rngFromVal(&rng2, ctx.sh2, v2))
+        return false;
+
+    *pResult = true;
+    const TValPair vp(v1, v2);
+    if (readOnly || hasKey(ctx.matchLookup, vp))
+        return true;
+
+    const IR::Range rng = IR::widen(rng1, rng2, *ctx.thresholds);
+    SJ_DEBUG("<-- integral values widened by thresholds " << SJ_VALP(v1, v2));
+
+    if ((!isCovered(rng, rng1) && !updateJoinStatus(ctx, JS_USE_SH2))
+            || (!isCovered(rng, rng2) && !updateJoinStatus(ctx, JS_USE_SH1)))
+    {
+        *pResult = false;
+        return true;
+    }
+
+    // the special values are never mapped, store the pair in matchLookup
+    const TValId vDst = ctx.dst.valWrapCustom(CustomValue(rng));
+    ctx.matchLookup[vp] = vDst;
+
+    if (!isSpecial1)
+        *pResult = matchPlainValues(ctx.valMap1, ctx.sh1, ctx.dst, v1, vDst);
+
+    if (*pResult && !isSpecial2)
+        *pResult = matchPlainValues(ctx.valMap2, ctx.sh2, ctx.dst, v2, vDst);
+
+    return true;
+}
+
 bool bumpNestingLevel(const ObjHandle &obj) {
     if (!obj.isValid())
         return false;
@@ -599,6 +672,10 @@ bool joinFreshObjTripple(
         // the join has been already successful
         return true;
 
+    bool result;
+    if (!segClone && joinSpecialIntValues(&result, ctx, obj1, obj2, readOnly))
+        return result;
+
     if (VAL_NULL == v1 || VAL_NULL == v2) {
         if (segClone)
             // we got only one value and the value is VAL_NULL
@@ -1427,11 +1504,9 @@ bool joinCustomValues(
     SymHeap &sh1 = ctx.sh1;
     SymHeap &sh2 = ctx.sh2;
 
-    const CustomValue cVal1 = sh1.valUnwrapCustom(v1);
-    const CustomValue cVal2 = sh2.valUnwrapCustom(v2);
-    if (cVal1 == cVal2) {
-        // full match
-        const TValId vDst = ctx.dst.valWrapCustom(cVal1);
+    if (sh1.valCustomId(v1) == sh2.valCustomId(v2)) {
+        // full match (custom values are interned, so we compare IDs only)
+        const TValId vDst = ctx.dst.valWrapCustom(sh1.valUnwrapCustom(v1));
         return defineValueMapping(ctx, v1, v2, vDst);
     }
 
@@ -1447,9 +1522,18 @@ bool joinCustomValues(
     // compute the resulting range that covers both
     IR::Range rng = join(rng1, rng2);
 
+    const bool widening = !!ctx.thresholds;
+    if (widening) {
+        // we are on a loop-closing edge, sh1 is what the loop has computed so
+        // far, so widen its ranges such that counting loops converge quickly
+        rng = IR::widen(rng1, rng2, *ctx.thresholds);
+        SJ_DEBUG("<-- integral values widened by thresholds "
+                << SJ_VALP(v1, v2));
+    }
+
 #if SE_INT_ARITHMETIC_LIMIT
     const IR::TInt max = std::max(std::abs(rng.lo), std::abs(rng.hi));
-    if (max <= (SE_INT_ARITHMETIC_LIMIT)) {
+    if (!widening && max <= (SE_INT_ARITHMETIC_LIMIT)) {
         SJ_DEBUG("<-- integral values preserved by SE_INT_ARITHMETIC_LIMIT "
                 << SJ_VALP(v1, v2));
 
@@ -1459,7 +1543,7 @@ bool joinCustomValues(
 
 #if !SE_ALLOW_INT_RANGES
     // avoid creation of a CV_INT_RANGE value from two CV_INT values
-    if (isSingular(rng1) && isSingular(rng2)) {
+    if (!widening && isSingular(rng1) && isSingular(rng2)) {
         const TValId vDst = ctx.dst.valCreate(VT_UNKNOWN, VO_UNKNOWN);
         return updateJoinStatus(ctx, JS_THREE_WAY)
             && defineValueMapping(ctx, v1, v2, vDst);
@@ -1468,7 +1552,7 @@ bool joinCustomValues(
 
     // [experimental] widening on intervals
 #if 1 < SE_ALLOW_INT_RANGES
-    if (!isSingular(rng1) && !isSingular(rng2)) {
+    if (!widening && !isSingular(rng1) && !isSingular(rng2)) {
         if (rng.lo == rng1.lo || rng.lo == rng2.lo)
             rng.hi = IR::IntMax;
 #   if 2 < SE_ALLOW_INT_RANGES
@@ -2697,20 +2781,77 @@ bool validateStatus(const SymJoinCtx &ctx) {
     return false;
 }
 
+size_t joinSignature(const SymHeap &sh) {
+    size_t sig = 0;
+
+    // joinReturnAddrs() requires semantically equal types of return value, the
+    // type code and the count of sub-types are preserved by cl_type comparison
+    const TObjType cltRet = sh.valLastKnownTypeOfTarget(VAL_ADDR_OF_RET);
+    if (cltRet) {
+        boost::hash_combine(sig, static_cast<int>(cltRet->code));
+        boost::hash_combine(sig, cltRet->item_cnt);
+
+        // ... and so are the size and signedness of scalar types
+        switch (cltRet->code) {
+            case CL_TYPE_VOID:
+            case CL_TYPE_INT:
+            case CL_TYPE_CHAR:
+            case CL_TYPE_BOOL:
+            case CL_TYPE_REAL:
+            case CL_TYPE_ENUM:
+                boost::hash_combine(sig, cltRet->size);
+                boost::hash_combine(sig, cltRet->is_unsigned);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    // joinCVars() never recovers from an asymmetric join of gl variables
+    TCVarSet glVars;
+    TValList live;
+    sh.gatherRootObjects(live, isProgramVar);
+    BOOST_FOREACH(const TValId root, live) {
+        if (VAL_ADDR_OF_RET == root)
+            continue;
+
+        const CVar cv(sh.cVarByRoot(root));
+        if (/* gl var */ !cv.inst)
+            glVars.insert(cv);
+    }
+
+    // TCVarSet is ordered, so is the sequence of hashed items
+    boost::hash_combine(sig, glVars.size());
+    BOOST_FOREACH(const CVar &cv, glVars)
+        boost::hash_combine(sig, cv.uid);
+
+    return sig;
+}
+
 bool joinSymHeaps(
         EJoinStatus             *pStatus,
         SymHeap                 *pDst,
         const SymHeap           &sh1,
         const SymHeap           &sh2,
-        const bool              allowThreeWay)
+        const bool              allowThreeWay,
+        const IR::TThresholds   *thresholds)
 {
     SJ_DEBUG("--> joinSymHeaps()");
     TStorRef stor = sh1.stor();
     CL_BREAK_IF(&stor != &sh2.stor());
+    if (sh1.sharesDataWith(sh2)) {
+        // the heaps share all their data, so they are trivially isomorphic
+        *pDst = sh1;
+        pDst->traceUpdate(new Trace::TransientNode("joinSymHeaps()"));
+        *pStatus = JS_USE_ANY;
+        return true;
+    }
+
     *pDst = SymHeap(stor, new Trace::TransientNode("joinSymHeaps()"));
 
     // initialize symbolic join ctx
-    SymJoinCtx ctx(*pDst, sh1, sh2, allowThreeWay);
+    SymJoinCtx ctx(*pDst, sh1, sh2, allowThreeWay, thresholds);
 
     CL_BREAK_IF(!protoCheckConsistency(ctx.sh1));
     CL_BREAK_IF(!protoCheckConsistency(ctx.sh2));
@@ -64,13 +64,25 @@ bool joinData(
         const TValId            src,
         const bool              bidir);
 
-/// @todo some dox
+/**
+ * @todo some dox
+ * @param thresholds if not null and not empty, integral ranges of sh1 are
+ * widened towards sh2 using the given thresholds (see the int_widening option)
+ */
 bool joinSymHeaps(
         EJoinStatus             *pStatus,
         SymHeap                 *dst,
         const SymHeap           &sh1,
         const SymHeap           &sh2,
-        const bool              allowThreeWay = true);
+        const bool              allowThreeWay = true,
+        const IR::TThresholds   *thresholds = 0);
+
+/**
+ * cheap signature of the given symbolic heap with respect to joinSymHeaps()
+ * @note joinSymHeaps(sh1, sh2) may succeed only if the signatures of sh1 and
+ * sh2 are equal, so that joinSymHeaps() needs not be called if they differ
+ */
+size_t joinSignature(const SymHeap &sh);
 
 /// enable/disable debugging of symjoin
 void debugSymJoin(const bool enable);
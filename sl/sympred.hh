@@ -39,6 +39,10 @@ class SymPairSet {
             return cont_.empty();
         }
 
+        unsigned size() const {
+            return cont_.size();
+        }
+
         bool chk(TKey k1, TKey k2) const {
             sortValues(k1, k2);
             const TItem item(k1, k2);
@@ -81,6 +85,10 @@ class SymPairMap {
         const_iterator end()   const { return db_.end();   }
 
     public:
+        unsigned size() const {
+            return db_.size();
+        }
+
         void add(TKey k1, TKey k2, TVal val) {
             sortValues(k1, k2);
             const TItem key(k1, k2);
@@ -89,6 +97,12 @@ class SymPairMap {
             db_[key] = val;
         }
 
+        bool del(TKey k1, TKey k2) {
+            sortValues(k1, k2);
+            const TItem key(k1, k2);
+            return !!db_.erase(key);
+        }
+
         bool chk(TVal *pDst, TKey k1, TKey k2) const {
             sortValues(k1, k2);
             const TItem key(k1, k2);
@@ -32,6 +32,7 @@
 #include "symgc.hh"
 #include "symheap.hh"
 #include "symplot.hh"
+#include "symreport.hh"
 #include "symseg.hh"
 #include "symstate.hh"
 #include "symutil.hh"
@@ -40,29 +41,56 @@
 
 #include <stack>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 #include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/tuple/tuple.hpp>
 
 // /////////////////////////////////////////////////////////////////////////////
 // SymProc implementation
+bool SymProc::alreadyReported(EMsgLevel level) const {
+    if (!Report::dedupEnabled())
+        // do not bother with computing the hash of the call stack
+        return false;
+
+    return Report::alreadyReported(lw_, level, msgKind_, bt_->hash());
+}
+
+void SymProc::setMsgKind(const char *srcFile, int srcLine) {
+    size_t kind = boost::hash_value(std::string(srcFile));
+    boost::hash_combine(kind, srcLine);
+    msgKind_ = kind;
+}
+
 void SymProc::printBackTrace(EMsgLevel level, bool forcePtrace) {
     // update trace graph
     Trace::MsgNode *trMsg = new Trace::MsgNode(sh_.traceNode(), level, lw_);
     sh_.traceUpdate(trMsg);
     CL_BREAK_IF(!chkTraceGraphConsistency(trMsg));
 
-    // print the backtrace
-    if (bt_->printBackTrace(forcePtrace))
+    // print the backtrace, unless we have printed exactly the same already
+    const bool isRepeat = Report::dedupEnabled()
+        && Report::recordReport(lw_, level, msgKind_, bt_->hash());
+
+    // the next diagnostic is going to be tagged by its own kind
+    msgKind_ = 0;
+
+    if (!isRepeat && bt_->printBackTrace(forcePtrace))
         printMemUsage("SymBackTrace::printBackTrace");
 
     // dump trace graph, or schedule and endpoint for batch trace graph dump
-#if 2 == SE_DUMP_TRACE_GRAPHS
-    Trace::plotTrace(sh_.traceNode(), "symtrace");
-#elif 1 == SE_DUMP_TRACE_GRAPHS
-    Trace::GraphProxy *glProxy = Trace::Globals::instance()->glProxy();
-    glProxy->insert(sh_.traceNode(), "symtrace");
+#if SE_DUMP_TRACE_GRAPHS
+    const Trace::ETraceLevel tl = Trace::traceLevel();
+    if (Trace::TL_FULL == tl || (Trace::TL_ERRORS == tl && ML_ERROR == level)) {
+#   if 2 == SE_DUMP_TRACE_GRAPHS
+        Trace::plotTrace(sh_.traceNode(), "symtrace");
+#   else
+        Trace::GraphProxy *glProxy = Trace::Globals::instance()->glProxy();
+        glProxy->insert(sh_.traceNode(), "symtrace");
+#   endif
+    }
 #endif
 
     if (ML_ERROR != level)
@@ -128,8 +156,13 @@ TValId SymProc::valFromCst(const struct cl_operand &op) {
 void describeUnknownVal(
         SymProc                         &proc,
         const TValId                     val,
-        const char                      *action)
+        const char                      *action,
+        const EMsgLevel                  level)
 {
+    if (proc.alreadyReported(level))
+        // the diagnostic is going to be suppressed as a repeat
+        return;
+
     const struct cl_loc *loc = proc.lw();
     SymHeap &sh = proc.sh();
 
@@ -187,6 +220,11 @@ void reportDerefOutOfBounds(
         const TValId                    val,
         const TSizeOf                   sizeOfTarget)
 {
+    proc.setMsgKind(__FILE__, __LINE__);
+    if (proc.alreadyReported(ML_ERROR))
+        // the diagnostic is going to be suppressed as a repeat
+        return;
+
     const struct cl_loc *loc = proc.lw();
     SymHeap &sh = proc.sh();
 
@@ -233,13 +271,13 @@ void reportDerefOutOfBounds(
 
 bool SymProc::checkForInvalidDeref(TValId val, const TSizeOf sizeOfTarget) {
     if (VAL_NULL == val) {
-        CL_ERROR_MSG(lw_, "dereference of NULL value");
+        SE_ERROR_MSG(*this, lw_, "dereference of NULL value");
         return true;
     }
 
     if (VAL_NULL == sh_.valRoot(val)) {
         const TOffset off = sh_.valOffset(val);
-        CL_ERROR_MSG(lw_, "dereference of NULL value with offset "
+        SE_ERROR_MSG(*this, lw_, "dereference of NULL value with offset "
                 << off << "B");
 
         return true;
@@ -259,16 +297,18 @@ bool SymProc::checkForInvalidDeref(TValId val, const TSizeOf sizeOfTarget) {
 
         case VT_CUSTOM:
         case VT_UNKNOWN:
-            CL_ERROR_MSG(lw_, "invalid dereference");
-            describeUnknownVal(*this, val, "dereference");
+            SE_ERROR_MSG(*this, lw_, "invalid dereference");
+            describeUnknownVal(*this, val, "dereference", ML_ERROR);
             return true;
 
         case VT_LOST:
-            CL_ERROR_MSG(lw_, "dereference of non-existing non-heap object");
+            SE_ERROR_MSG(*this, lw_,
+                    "dereference of non-existing non-heap object");
             return true;
 
         case VT_DELETED:
-            CL_ERROR_MSG(lw_, "dereference of already deleted heap object");
+            SE_ERROR_MSG(*this, lw_,
+                    "dereference of already deleted heap object");
             return true;
 
         case VT_STATIC:
@@ -576,7 +616,8 @@ void digRootTypeInfo(SymHeap &sh, const ObjHandle &lhs, TValId rhs) {
 void reportMemLeak(SymProc &proc, const EValueTarget code, const char *reason) {
     const struct cl_loc *loc = proc.lw();
     const char *const what = describeRootObj(code);
-    CL_WARN_MSG(loc, "memory leak detected while " << reason << "ing " << what);
+    SE_WARN_MSG(proc, loc,
+            "memory leak detected while " << reason << "ing " << what);
     proc.printBackTrace(ML_WARN);
 }
 
@@ -614,9 +655,9 @@ TValId ptrObjectEncoderCore(
         return val;
 
     const struct cl_loc *loc = proc.lw();
-    CL_ERROR_MSG(loc, "not enough space to store value of a pointer");
-    CL_NOTE_MSG(loc, "dstSize: " << dstSize << " B");
-    CL_NOTE_MSG(loc, "ptrSize: " << ptrSize << " B");
+    SE_ERROR_MSG(proc, loc, "not enough space to store value of a pointer");
+    SE_NOTE_MSG(proc, ML_ERROR, loc, "dstSize: " << dstSize << " B");
+    SE_NOTE_MSG(proc, ML_ERROR, loc, "ptrSize: " << ptrSize << " B");
     proc.printBackTrace(ML_ERROR);
     return sh.valCreate(VT_UNKNOWN, VO_REINTERPRET);
 }
@@ -656,7 +697,8 @@ TValId integralEncoder(
     if (IR::IntMin != rng.lo && rng.lo < IR::Int0) {
         const IR::TInt loLimit = IR::Int1 << limitWidth;
         if (rng.lo < -loLimit) {
-            CL_WARN_MSG(loc, "possible underflow of " << sig << " integer");
+            SE_WARN_MSG(proc, loc,
+                    "possible underflow of " << sig << " integer");
             rng = IR::FullRange;
         }
     }
@@ -664,7 +706,8 @@ TValId integralEncoder(
     if (IR::IntMax != rng.hi) {
         const IR::TInt hiLimit = IR::Int1 << limitWidth;
         if (hiLimit <= rng.hi) {
-            CL_WARN_MSG(loc, "possible overflow of " << sig << " integer");
+            SE_WARN_MSG(proc, loc,
+                    "possible overflow of " << sig << " integer");
             rng = IR::FullRange;
         }
     }
@@ -710,7 +753,7 @@ TValId customValueEncoder(SymProc &proc, const ObjHandle &dst, TValId val) {
 
 void objSetAtomicVal(SymProc &proc, const ObjHandle &lhs, TValId rhs) {
     if (!lhs.isValid()) {
-        CL_ERROR_MSG(proc.lw(), "invalid L-value");
+        SE_ERROR_MSG(proc, proc.lw(), "invalid L-value");
         proc.printBackTrace(ML_ERROR);
         return;
     }
@@ -949,12 +992,12 @@ void executeMemset(
     // how much we are going to write?
     IR::Range sizeRange;
     if (!rngFromVal(&sizeRange, sh, valSize) || sizeRange.lo < 0) {
-        CL_ERROR_MSG(lw, "size arg of memset() is not a known integer");
+        SE_ERROR_MSG(proc, lw, "size arg of memset() is not a known integer");
         proc.printBackTrace(ML_ERROR);
         return;
     }
     if (!sizeRange.hi) {
-        CL_WARN_MSG(lw, "ignoring call of memset() with size == 0");
+        SE_WARN_MSG(proc, lw, "ignoring call of memset() with size == 0");
         proc.printBackTrace(ML_WARN);
         return;
     }
@@ -992,7 +1035,7 @@ void executeMemset(
 
     // check for memory leaks
     if (lm.collectJunkFrom(killedPtrs)) {
-        CL_WARN_MSG(lw, "memory leak detected while executing memset()");
+        SE_WARN_MSG(proc, lw, "memory leak detected while executing memset()");
         proc.printBackTrace(ML_WARN);
     }
 
@@ -1012,12 +1055,13 @@ void executeMemmove(
 
     IR::Range size;
     if (!rngFromVal(&size, sh, valSize) || size.lo < 0) {
-        CL_ERROR_MSG(loc, "size arg of memmove() is not a known integer");
+        SE_ERROR_MSG(proc, loc, "size arg of memmove() is not a known integer");
         proc.printBackTrace(ML_ERROR);
         return;
     }
     if (!size.hi) {
-        CL_WARN_MSG(loc, "ignoring call of memcpy()/memmove() with size == 0");
+        SE_WARN_MSG(proc, loc,
+                "ignoring call of memcpy()/memmove() with size == 0");
         proc.printBackTrace(ML_WARN);
         return;
     }
@@ -1031,7 +1075,8 @@ void executeMemmove(
     }
 
     if (!allowOverlap && checkForOverlap(sh, valDst, valSrc, size.hi)) {
-        CL_ERROR_MSG(loc, "source and destination overlap in call of memcpy()");
+        SE_ERROR_MSG(proc, loc,
+                "source and destination overlap in call of memcpy()");
         proc.printBackTrace(ML_ERROR);
         return;
     }
@@ -1051,7 +1096,8 @@ void executeMemmove(
     }
 
     if (lm.collectJunkFrom(killedPtrs)) {
-        CL_WARN_MSG(loc, "memory leak detected while executing memmove()");
+        SE_WARN_MSG(proc, loc,
+                "memory leak detected while executing memmove()");
         proc.printBackTrace(ML_WARN);
     }
 
@@ -1086,23 +1132,24 @@ void SymExecCore::execFree(TValId val) {
     const EValueTarget code = sh_.valTarget(val);
     switch (code) {
         case VT_DELETED:
-            CL_ERROR_MSG(lw_, "double free()");
+            SE_ERROR_MSG(*this, lw_, "double free()");
             this->printBackTrace(ML_ERROR);
             return;
 
         case VT_LOST:
-            CL_ERROR_MSG(lw_, "attempt to free a non-existing non-heap object");
+            SE_ERROR_MSG(*this, lw_,
+                    "attempt to free a non-existing non-heap object");
             this->printBackTrace(ML_ERROR);
             return;
 
         case VT_STATIC:
         case VT_ON_STACK:
-            CL_ERROR_MSG(lw_, "attempt to free a non-heap object");
+            SE_ERROR_MSG(*this, lw_, "attempt to free a non-heap object");
             this->printBackTrace(ML_ERROR);
             return;
 
         case VT_CUSTOM:
-            CL_ERROR_MSG(lw_, "free() called on non-pointer value");
+            SE_ERROR_MSG(*this, lw_, "free() called on non-pointer value");
             this->printBackTrace(ML_ERROR);
             return;
 
@@ -1120,8 +1167,8 @@ void SymExecCore::execFree(TValId val) {
             if (VO_DEREF_FAILED == sh_.valOrigin(val))
                 return;
 
-            CL_ERROR_MSG(lw_, "invalid free()");
-            describeUnknownVal(*this, val, "free");
+            SE_ERROR_MSG(*this, lw_, "invalid free()");
+            describeUnknownVal(*this, val, "free", ML_ERROR);
             this->printBackTrace(ML_ERROR);
             return;
 
@@ -1131,7 +1178,7 @@ void SymExecCore::execFree(TValId val) {
 
     const TOffset off = sh_.valOffset(val);
     if (off) {
-        CL_ERROR_MSG(lw_, "free() called with offset " << off << "B");
+        SE_ERROR_MSG(*this, lw_, "free() called with offset " << off << "B");
         this->printBackTrace(ML_ERROR);
         return;
     }
@@ -1153,9 +1200,10 @@ void SymExecCore::execHeapAlloc(
         return;
 
     if (!size.hi) {
-        CL_WARN_MSG(lw_, "POSIX says that, given zero size, the behavior of \
+        SE_WARN_MSG(*this, lw_,
+                "POSIX says that, given zero size, the behavior of \
 malloc/calloc is implementation-defined");
-        CL_NOTE_MSG(lw_, "assuming NULL as the result");
+        SE_NOTE_MSG(*this, ML_WARN, lw_, "assuming NULL as the result");
         this->printBackTrace(ML_WARN);
         this->objSetValue(lhs, VAL_NULL);
         this->killInsn(insn);
@@ -1439,7 +1487,8 @@ bool reflectCmpResult(
 
         if (lm.importLeakList(&leakList)) {
             const struct cl_loc *loc = proc.lw();
-            CL_WARN_MSG(loc, "memory leak detected while removing a segment");
+            SE_WARN_MSG(proc, loc,
+                    "memory leak detected while removing a segment");
             proc.printBackTrace(ML_WARN);
         }
 
@@ -1947,7 +1996,7 @@ void SymExecCore::handleLabel(const CodeStorage::Insn &insn) {
         // not an error label
         return;
 
-    CL_ERROR_MSG(lw_, "error label \"" << name << "\" has been reached");
+    SE_ERROR_MSG(*this, lw_, "error label \"" << name << "\" has been reached");
 
     // print the backtrace and leave
     this->printBackTrace(ML_ERROR, /* forcePtrace */ true);
@@ -2042,7 +2091,8 @@ bool SymExecCore::concretizeLoop(
                 concretizeObj(sh, val, todo, &leakList);
 
                 if (lm.importLeakList(&leakList)) {
-                    CL_WARN_MSG(lw_, "memory leak detected while unfolding");
+                    SE_WARN_MSG(*this, lw_,
+                            "memory leak detected while unfolding");
                     this->printBackTrace(ML_WARN);
                 }
 
@@ -93,6 +93,7 @@ class SymProc {
             sh_(heap),
             bt_(bt),
             lw_(0),
+            msgKind_(0),
             errorDetected_(false)
         {
         }
@@ -139,6 +140,22 @@ class SymProc {
         /// print backtrace and update the current error level correspondingly
         void printBackTrace(EMsgLevel level, bool forcePtrace = false);
 
+        /**
+         * cheap check whether a diagnostic of the given level has been already
+         * reported at the current location with the current call stack.  If it
+         * has, printBackTrace() is going to count it as a suppressed repeat and
+         * the caller does not need to build the message at all.
+         */
+        bool alreadyReported(EMsgLevel level) const;
+
+        /**
+         * tag the diagnostic being reported by the place in the source code it
+         * comes from, such that distinct diagnostics bound to the same location
+         * are not suppressed as repeats of each other.  The tag is dropped by
+         * printBackTrace().  SE_ERROR_MSG() and SE_WARN_MSG() set it already.
+         */
+        void setMsgKind(const char *srcFile, int srcLine);
+
         /// if true, the current state is not going to be inserted into dst
         bool hasFatalError() const;
 
@@ -158,14 +175,36 @@ class SymProc {
         SymHeap                     &sh_;
         const SymBackTrace          *bt_;
         const struct cl_loc         *lw_;
+        size_t                       msgKind_;
         bool                         errorDetected_;
 };
 
+/// CL_ERROR_MSG() that keeps silent if SymProc::alreadyReported() says so
+#define SE_ERROR_MSG(proc, loc, what) do {                          \
+    (proc).setMsgKind(__FILE__, __LINE__);                          \
+    if (!(proc).alreadyReported(ML_ERROR))                          \
+        CL_ERROR_MSG(loc, what);                                    \
+} while (0)
+
+/// CL_WARN_MSG() that keeps silent if SymProc::alreadyReported() says so
+#define SE_WARN_MSG(proc, loc, what) do {                           \
+    (proc).setMsgKind(__FILE__, __LINE__);                          \
+    if (!(proc).alreadyReported(ML_WARN))                           \
+        CL_WARN_MSG(loc, what);                                     \
+} while (0)
+
+/// CL_NOTE_MSG() attached to a diagnostic of the given level
+#define SE_NOTE_MSG(proc, level, loc, what) do {                    \
+    if (!(proc).alreadyReported(level))                             \
+        CL_NOTE_MSG(loc, what);                                     \
+} while (0)
+
 /// @todo make the API more generic and better documented
 void describeUnknownVal(
         SymProc                     &proc,
         const TValId                 val,
-        const char                  *action);
+        const char                  *action,
+        const EMsgLevel              level);
 
 void executeMemmove(
         SymProc                     &proc,
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "symreport.hh"
+
+#include <cl/cl_msg.hh>
+#include <cl/code_listener.h>
+
+#include <cstring>
+#include <map>
+
+#include <boost/foreach.hpp>
+
+namespace Report {
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of the report sink
+struct ReportKey {
+    const char                      *file;
+    int                             line;
+    int                             column;
+    EMsgLevel                       level;
+    size_t                          kind;
+    size_t                          btHash;
+
+    ReportKey(
+            const struct cl_loc     *loc,
+            const EMsgLevel         level_,
+            const size_t            kind_,
+            const size_t            btHash_):
+        file((loc) ? loc->file : 0),
+        line((loc) ? loc->line : 0),
+        column((loc) ? loc->column : 0),
+        level(level_),
+        kind(kind_),
+        btHash(btHash_)
+    {
+    }
+};
+
+inline int cmpFileNames(const char *a, const char *b) {
+    if (a == b)
+        return 0;
+
+    if (!a)
+        return -1;
+
+    if (!b)
+        return 1;
+
+    return strcmp(a, b);
+}
+
+/// the cheap fields go first, so that strcmp() is reached only rarely
+bool operator<(const ReportKey &a, const ReportKey &b) {
+    if (a.line != b.line)
+        return (a.line < b.line);
+
+    if (a.column != b.column)
+        return (a.column < b.column);
+
+    if (a.level != b.level)
+        return (a.level < b.level);
+
+    if (a.kind != b.kind)
+        return (a.kind < b.kind);
+
+    if (a.btHash != b.btHash)
+        return (a.btHash < b.btHash);
+
+    return (cmpFileNames(a.file, b.file) < 0);
+}
+
+typedef std::map<ReportKey, unsigned /* cnt of suppressed repeats */> TSink;
+
+static bool globalDedup;
+static TSink globalSink;
+
+void setDedup(const bool enabled) {
+    globalDedup = enabled;
+}
+
+bool dedupEnabled() {
+    return globalDedup;
+}
+
+bool alreadyReported(
+        const struct cl_loc         *loc,
+        const EMsgLevel             level,
+        const size_t                kind,
+        const size_t                btHash)
+{
+    if (!globalDedup)
+        return false;
+
+    const ReportKey key(loc, level, kind, btHash);
+    return (globalSink.end() != globalSink.find(key));
+}
+
+bool recordReport(
+        const struct cl_loc         *loc,
+        const EMsgLevel             level,
+        const size_t                kind,
+        const size_t                btHash)
+{
+    if (!globalDedup)
+        return false;
+
+    const ReportKey key(loc, level, kind, btHash);
+    TSink::iterator it = globalSink.find(key);
+    if (globalSink.end() == it) {
+        // reported for the first time
+        globalSink[key] = 0U;
+        return false;
+    }
+
+    // suppress the repeat
+    ++(it->second);
+    return true;
+}
+
+const char* describeLevel(const EMsgLevel level) {
+    switch (level) {
+        case ML_DEBUG:  return "debug message";
+        case ML_WARN:   return "warning";
+        case ML_ERROR:  return "error";
+    }
+
+    CL_BREAK_IF("invalid call of describeLevel()");
+    return "message";
+}
+
+void printSummary() {
+    if (!globalDedup || globalSink.empty())
+        return;
+
+    // aggregate the repeats over all call stacks, per location and kind
+    typedef std::map<ReportKey, unsigned /* cnt */> TSummary;
+    TSummary summary;
+    unsigned cntTotal = 0U;
+
+    typedef TSink::const_reference TRef;
+    BOOST_FOREACH(TRef item, globalSink) {
+        const unsigned cnt = item.second;
+        if (!cnt)
+            continue;
+
+        ReportKey key(item.first);
+        key.btHash = 0;
+        summary[key] += cnt;
+        cntTotal += cnt;
+    }
+
+    if (!cntTotal)
+        return;
+
+    typedef TSummary::const_reference TSumRef;
+    BOOST_FOREACH(TSumRef item, summary) {
+        const ReportKey &key = item.first;
+
+        struct cl_loc loc;
+        memset(&loc, 0, sizeof loc);
+        loc.file    = key.file;
+        loc.line    = key.line;
+        loc.column  = key.column;
+
+        CL_NOTE_MSG(&loc, item.second << " repeat(s) of this "
+                << describeLevel(key.level) << " suppressed");
+    }
+
+    CL_NOTE("[report] " << globalSink.size()
+            << " distinct diagnostic(s) reported, "
+            << cntTotal << " repeat(s) suppressed");
+}
+
+} // namespace Report
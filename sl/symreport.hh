@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_SYM_REPORT_H
+#define H_GUARD_SYM_REPORT_H
+
+/**
+ * @file symreport.hh
+ * report sink that deduplicates diagnostics, see namespace Report
+ */
+
+#include "config.h"
+
+#include "symbt.hh"                 // needed for EMsgLevel
+
+#include <cstddef>                  // needed for size_t
+
+struct cl_loc;
+
+/**
+ * The same error hit inside a loop or inside a frequently called function is
+ * otherwise reported once per each symbolic heap reaching the location.  If
+ * enabled, the report sink remembers each diagnostic by its location, level,
+ * kind, and call stack hash, such that the repeats can be suppressed and only
+ * counted.  The counts are summarized by printSummary() at the end.
+ */
+namespace Report {
+
+/// enable/disable deduplication of diagnostics (disabled by default)
+void setDedup(bool enabled);
+
+/// true if deduplication of diagnostics is enabled
+bool dedupEnabled();
+
+/**
+ * cheap check whether a diagnostic has been reported already, not recording
+ * anything.  It always returns false if deduplication is disabled.
+ * @param loc location the diagnostic is bound to
+ * @param level level of the diagnostic
+ * @param kind id of the diagnostic, distinct diagnostics at the same location
+ * are never suppressed as repeats of each other
+ * @param btHash hash of the call stack as returned by SymBackTrace::hash()
+ */
+bool alreadyReported(
+        const struct cl_loc         *loc,
+        EMsgLevel                   level,
+        size_t                      kind,
+        size_t                      btHash);
+
+/**
+ * record a diagnostic into the sink, counting a suppressed repeat in case it
+ * has been already reported.  It always returns false if deduplication is
+ * disabled.
+ * @return true if the diagnostic should be suppressed as a repeat
+ */
+bool recordReport(
+        const struct cl_loc         *loc,
+        EMsgLevel                   level,
+        size_t                      kind,
+        size_t                      btHash);
+
+/// stream a compact summary of the suppressed repeats (if there were any)
+void printSummary();
+
+} // namespace Report
+
+#endif /* H_GUARD_SYM_REPORT_H */
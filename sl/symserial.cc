@@ -0,0 +1,870 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "symserial.hh"
+
+#include <cl/cl_msg.hh>
+#include <cl/storage.hh>
+
+#include "symseg.hh"
+#include "symstate.hh"
+#include "symtrace.hh"
+#include "symutil.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <sstream>
+
+#include <boost/foreach.hpp>
+
+// /////////////////////////////////////////////////////////////////////////////
+// primitives of the binary encoding
+namespace {
+    /// magic number at the beginning of the stream ("PSHP")
+    const long long SERIAL_MAGIC = 0x50534850;
+
+    /// upper bound on the length of a string we are willing to decode
+    const long long SERIAL_MAX_STR_LEN = 1L << 20;
+
+    enum ERootKind {
+        RK_VAR,
+        RK_HEAP
+    };
+
+    enum EValueKind {
+        VK_UNKNOWN,
+        VK_GONE,
+        VK_OFFSET,
+        VK_RANGE,
+        VK_CUSTOM
+    };
+
+    /// zig-zag mapping of the sign followed by LEB128 (7 bits per byte)
+    void encodeNum(std::ostream &str, const long long num) {
+        unsigned long long raw = (static_cast<unsigned long long>(num) << 1)
+            ^ static_cast<unsigned long long>(num >> 63);
+
+        while (0x7F < raw) {
+            str.put(static_cast<char>(0x80 | (raw & 0x7F)));
+            raw >>= 7;
+        }
+
+        str.put(static_cast<char>(raw));
+    }
+
+    bool decodeNum(long long *pNum, std::istream &str) {
+        unsigned long long raw = 0ULL;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const int c = str.get();
+            if (EOF == c)
+                return false;
+
+            raw |= static_cast<unsigned long long>(c & 0x7F) << shift;
+            if (c & 0x80)
+                continue;
+
+            *pNum = static_cast<long long>(raw >> 1) ^ -static_cast<long long>(
+                    raw & 1ULL);
+            return true;
+        }
+
+        // more than 10 bytes, this is not a number we have written
+        return false;
+    }
+
+    void encodeStr(std::ostream &str, const std::string &text) {
+        encodeNum(str, text.size());
+        str.write(text.data(), text.size());
+    }
+
+    bool decodeStr(std::string *pText, std::istream &str) {
+        long long len;
+        if (!decodeNum(&len, str) || len < 0 || SERIAL_MAX_STR_LEN < len)
+            return false;
+
+        pText->resize(len);
+        return !len || str.read(&(*pText)[0], len);
+    }
+
+    void encodeRange(std::ostream &str, const IR::Range &rng) {
+        encodeNum(str, rng.lo);
+        encodeNum(str, rng.hi);
+        encodeNum(str, rng.alignment);
+    }
+
+    /// maps IDs of types, variables and functions to the current CodeStorage
+    struct StorIndex {
+        std::map<int, const struct cl_type *>               types;
+        std::map<int, const CodeStorage::Var *>             vars;
+        std::map<int, const CodeStorage::Fnc *>             fncs;
+
+        StorIndex(TStorRef stor) {
+            using namespace CodeStorage;
+            BOOST_FOREACH(const struct cl_type *clt, stor.types)
+                this->types[clt->uid] = clt;
+
+            BOOST_FOREACH(const Var &var, stor.vars)
+                this->vars[var.uid] = &var;
+
+            BOOST_FOREACH(const Fnc *fnc, stor.fncs)
+                this->fncs[uidOf(*fnc)] = fnc;
+        }
+    };
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// encoder of a single SymHeap
+namespace {
+    class HeapWriter {
+        public:
+            HeapWriter(const SymHeap &sh):
+                sh_(const_cast<SymHeap &>(sh)),
+                cntVals_(0)
+            {
+            }
+
+            void write(std::ostream &str);
+
+        private:
+            typedef std::map<TValId, long long>         TIdxMap;
+            typedef std::map<int /* uid */, long long>  TTypeMap;
+
+            SymHeap                     &sh_;
+            TIdxMap                     idxMap_;
+            long long                   cntVals_;
+            std::ostringstream          vals_;
+            TTypeMap                    typeMap_;
+
+            long long refOf(TValId val);
+            void writeType(std::ostream &str, TObjType clt);
+            void writeRoot(std::ostream &str, TValId root);
+            void writeBlocks(std::ostream &str, TValId root);
+    };
+
+    /// special values are encoded as they are, the others by their position
+    long long HeapWriter::refOf(const TValId val) {
+        if (val <= VAL_ADDR_OF_RET)
+            return val;
+
+        const TIdxMap::const_iterator it = idxMap_.find(val);
+        if (idxMap_.end() != it)
+            return /* skip special values */ 2 + it->second;
+
+        const EValueTarget code = sh_.valTarget(val);
+        const TValId root = sh_.valRoot(val);
+
+        // dependencies need to be encoded before the value itself
+        std::ostringstream rec;
+        if (VT_CUSTOM == code) {
+            const CustomValue &cv = sh_.valUnwrapCustom(val);
+            const ECustomValue cCode = cv.code();
+            encodeNum(rec, VK_CUSTOM);
+            encodeNum(rec, cCode);
+
+            switch (cCode) {
+                case CV_FNC:
+                    encodeNum(rec, cv.uid());
+                    encodeStr(rec, nameOf(*sh_.stor().fncs[cv.uid()]));
+                    break;
+
+                case CV_INT_RANGE:
+                    encodeRange(rec, cv.rng());
+                    break;
+
+                case CV_REAL: {
+                    const double fpn = cv.fpn();
+                    long long raw;
+                    memcpy(&raw, &fpn, sizeof raw);
+                    encodeNum(rec, raw);
+                    break;
+                }
+
+                case CV_STRING:
+                    encodeStr(rec, cv.str());
+                    break;
+
+                case CV_INVALID:
+                    CL_BREAK_IF("HeapWriter::refOf() got an invalid custom value");
+                    break;
+            }
+        }
+        else if (VT_RANGE == code) {
+            const long long rootRef = this->refOf(root);
+            encodeNum(rec, VK_RANGE);
+            encodeNum(rec, rootRef);
+            encodeRange(rec, sh_.valOffsetRange(val));
+        }
+        else if (root != val && (VAL_NULL == root
+                    || isAnyDataArea(code) || isGone(code)))
+        {
+            const long long rootRef = this->refOf(root);
+            encodeNum(rec, VK_OFFSET);
+            encodeNum(rec, rootRef);
+            encodeNum(rec, sh_.valOffset(val));
+        }
+        else if (isGone(code)) {
+            encodeNum(rec, VK_GONE);
+            encodeNum(rec, code);
+            encodeNum(rec, sh_.valOrigin(val));
+        }
+        else {
+            // roots of live objects are registered in advance
+            CL_BREAK_IF(isAnyDataArea(code));
+            encodeNum(rec, VK_UNKNOWN);
+            encodeNum(rec, sh_.valOrigin(val));
+        }
+
+        vals_ << rec.str();
+        const long long idx = cntVals_++;
+        idxMap_[val] = idx;
+        return 2 + idx;
+    }
+
+    /// zero for no type, a position in the table, or a new entry of the table
+    void HeapWriter::writeType(std::ostream &str, const TObjType clt) {
+        if (!clt) {
+            encodeNum(str, 0);
+            return;
+        }
+
+        const TTypeMap::const_iterator it = typeMap_.find(clt->uid);
+        if (typeMap_.end() != it) {
+            encodeNum(str, 1 + it->second);
+            return;
+        }
+
+        const long long idx = typeMap_.size();
+        typeMap_[clt->uid] = idx;
+        encodeNum(str, 1 + idx);
+
+        // code and size are used to detect a mismatch of type IDs
+        encodeNum(str, clt->uid);
+        encodeNum(str, clt->code);
+        encodeNum(str, clt->size);
+    }
+
+    void HeapWriter::writeRoot(std::ostream &str, const TValId root) {
+        const EValueTarget code = sh_.valTarget(root);
+        if (isProgramVar(code)) {
+            const CVar cv = sh_.cVarByRoot(root);
+            encodeNum(str, RK_VAR);
+            encodeNum(str, cv.uid);
+            encodeNum(str, cv.inst);
+            encodeStr(str, sh_.stor().vars[cv.uid].name);
+        }
+        else {
+            encodeNum(str, RK_HEAP);
+            encodeRange(str, sh_.valSizeOfTarget(root));
+        }
+
+        this->writeType(str, sh_.valLastKnownTypeOfTarget(root));
+        encodeNum(str, sh_.valTargetProtoLevel(root));
+
+        const EObjKind kind = sh_.valTargetKind(root);
+        encodeNum(str, kind);
+        if (OK_CONCRETE == kind)
+            return;
+
+        const BindingOff &bf = sh_.segBinding(root);
+        encodeNum(str, bf.head);
+        encodeNum(str, bf.next);
+        encodeNum(str, bf.prev);
+        encodeNum(str, objMinLength(sh_, root));
+    }
+
+    void HeapWriter::writeBlocks(std::ostream &str, const TValId root) {
+        TUniBlockMap bMap;
+        sh_.gatherUniformBlocks(bMap, root);
+        encodeNum(str, bMap.size());
+        BOOST_FOREACH(TUniBlockMap::const_reference item, bMap) {
+            const UniformBlock &bl = item.second;
+            encodeNum(str, bl.off);
+            encodeNum(str, bl.size);
+            encodeNum(str, this->refOf(bl.tplValue));
+        }
+
+        ObjList objs;
+        sh_.gatherLiveObjects(objs, root);
+
+        ObjList atomic;
+        BOOST_FOREACH(const ObjHandle &obj, objs)
+            if (!isComposite(obj.objType(), /* includingArray */ false))
+                atomic.push_back(obj);
+
+        encodeNum(str, atomic.size());
+        BOOST_FOREACH(const ObjHandle &obj, atomic) {
+            encodeNum(str, sh_.valOffset(obj.placedAt()));
+            this->writeType(str, obj.objType());
+            encodeNum(str, this->refOf(obj.value()));
+        }
+    }
+
+    void HeapWriter::write(std::ostream &str) {
+        // roots of live objects come first
+        TValList roots;
+        sh_.gatherRootObjects(roots);
+        roots.erase(std::remove(roots.begin(), roots.end(), VAL_ADDR_OF_RET),
+                roots.end());
+
+        std::ostringstream rootStr;
+        encodeNum(rootStr, roots.size());
+        BOOST_FOREACH(const TValId root, roots) {
+            idxMap_[root] = cntVals_++;
+            this->writeRoot(rootStr, root);
+        }
+
+        // VAL_ADDR_OF_RET is not allocated, but it can be destroyed
+        const bool retGone = isGone(sh_.valTarget(VAL_ADDR_OF_RET));
+        encodeNum(rootStr, retGone);
+        this->writeType(rootStr, sh_.valLastKnownTypeOfTarget(VAL_ADDR_OF_RET));
+
+        // objects (the values they refer to are encoded on the way)
+        std::ostringstream blockStr;
+        if (!retGone)
+            this->writeBlocks(blockStr, VAL_ADDR_OF_RET);
+        BOOST_FOREACH(const TValId root, roots)
+            this->writeBlocks(blockStr, root);
+
+        // predicates
+        TValPairList neqs;
+        sh_.gatherNeqPreds(neqs);
+        encodeNum(blockStr, neqs.size());
+        BOOST_FOREACH(const TValPair &neq, neqs) {
+            encodeNum(blockStr, this->refOf(neq.first));
+            encodeNum(blockStr, this->refOf(neq.second));
+        }
+
+        TCoinList coins;
+        sh_.gatherCoincidences(coins);
+        encodeNum(blockStr, coins.size());
+        BOOST_FOREACH(const TCoinList::value_type &coin, coins) {
+            encodeNum(blockStr, this->refOf(coin.first.first));
+            encodeNum(blockStr, this->refOf(coin.first.second));
+            encodeNum(blockStr, this->refOf(coin.second));
+        }
+
+        // types are defined on their first use, so the order matters here
+        str << rootStr.str();
+        encodeNum(str, cntVals_ - roots.size());
+        str << vals_.str();
+        str << blockStr.str();
+    }
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// decoder of a single SymHeap
+namespace {
+    class HeapReader {
+        public:
+            HeapReader(SymHeap &sh, const StorIndex &idx, std::istream &str):
+                sh_(sh),
+                idx_(idx),
+                str_(str),
+                ok_(true)
+            {
+            }
+
+            /// return false if the input is broken or does not fit CodeStorage
+            bool read();
+
+        private:
+            struct AbsRoot {
+                TValId          root;
+                EObjKind        kind;
+                BindingOff      bf;
+                TMinLen         minLength;
+            };
+
+            SymHeap                     &sh_;
+            const StorIndex             &idx_;
+            std::istream                &str_;
+            bool                        ok_;
+            TValList                    vals_;
+            std::vector<TObjType>       types_;
+            std::vector<AbsRoot>        absRoots_;
+
+            long long readNum();
+            std::string readStr();
+            IR::Range readRange();
+            bool readType(TObjType *pClt);
+            TValId valOf(long long ref);
+            void readRoot();
+            void readValue();
+            void readBlocks(TValId root);
+
+            void fail() {
+                ok_ = false;
+            }
+    };
+
+    long long HeapReader::readNum() {
+        long long num = 0LL;
+        if (!decodeNum(&num, str_))
+            this->fail();
+
+        return num;
+    }
+
+    std::string HeapReader::readStr() {
+        std::string text;
+        if (!decodeStr(&text, str_))
+            this->fail();
+
+        return text;
+    }
+
+    IR::Range HeapReader::readRange() {
+        IR::Range rng;
+        rng.lo          = this->readNum();
+        rng.hi          = this->readNum();
+        rng.alignment   = this->readNum();
+        return rng;
+    }
+
+    bool HeapReader::readType(TObjType *pClt) {
+        *pClt = 0;
+
+        const long long ref = this->readNum();
+        if (!ok_ || !ref)
+            return ok_;
+
+        const long long cntTypes = types_.size();
+        if (ref <= cntTypes) {
+            *pClt = types_[ref - 1];
+            return true;
+        }
+
+        if (cntTypes + 1 != ref) {
+            this->fail();
+            return false;
+        }
+
+        const long long uid = this->readNum();
+        const long long code = this->readNum();
+        const long long size = this->readNum();
+
+        typedef std::map<int, const struct cl_type *> TTypes;
+        const TTypes::const_iterator it = idx_.types.find(uid);
+        if (!ok_ || idx_.types.end() == it || it->second->code != code
+                || it->second->size != size)
+        {
+            // the type ID has a different meaning in the current run
+            this->fail();
+            return false;
+        }
+
+        *pClt = it->second;
+        types_.push_back(it->second);
+        return true;
+    }
+
+    TValId HeapReader::valOf(const long long ref) {
+        if (ref <= VAL_ADDR_OF_RET)
+            return static_cast<TValId>(ref);
+
+        const long long idx = ref - 2;
+        if (static_cast<long long>(vals_.size()) <= idx) {
+            this->fail();
+            return VAL_INVALID;
+        }
+
+        return vals_[idx];
+    }
+
+    void HeapReader::readRoot() {
+        TValId root = VAL_INVALID;
+
+        const long long kind = this->readNum();
+        switch (kind) {
+            case RK_VAR: {
+                const int uid = this->readNum();
+                const int inst = this->readNum();
+                const std::string name = this->readStr();
+
+                typedef std::map<int, const CodeStorage::Var *> TVars;
+                const TVars::const_iterator it = idx_.vars.find(uid);
+                if (!ok_ || idx_.vars.end() == it || it->second->name != name) {
+                    this->fail();
+                    return;
+                }
+
+                root = sh_.addrOfVar(CVar(uid, inst), /* createIfNeeded */ true);
+                break;
+            }
+
+            case RK_HEAP: {
+                const TSizeRange size = this->readRange();
+                if (!ok_ || size.lo <= IR::Int0) {
+                    this->fail();
+                    return;
+                }
+
+                root = sh_.heapAlloc(size);
+                break;
+            }
+
+            default:
+                this->fail();
+                return;
+        }
+
+        TObjType clt;
+        if (!this->readType(&clt))
+            return;
+        if (clt)
+            sh_.valSetLastKnownTypeOfTarget(root, clt);
+
+        const TProtoLevel protoLevel = this->readNum();
+        sh_.valTargetSetProtoLevel(root, protoLevel);
+        vals_.push_back(root);
+
+        const EObjKind objKind = static_cast<EObjKind>(this->readNum());
+        if (OK_CONCRETE == objKind)
+            return;
+
+        // abstract objects are created once all the objects are in place
+        AbsRoot ar;
+        ar.root         = root;
+        ar.kind         = objKind;
+        ar.bf.head      = this->readNum();
+        ar.bf.next      = this->readNum();
+        ar.bf.prev      = this->readNum();
+        ar.minLength    = this->readNum();
+        absRoots_.push_back(ar);
+    }
+
+    void HeapReader::readValue() {
+        TValId val = VAL_INVALID;
+
+        const long long kind = this->readNum();
+        switch (kind) {
+            case VK_UNKNOWN: {
+                const EValueOrigin origin = static_cast<EValueOrigin>(
+                        this->readNum());
+                val = sh_.valCreate(VT_UNKNOWN, origin);
+                break;
+            }
+
+            case VK_GONE: {
+                const EValueTarget code = static_cast<EValueTarget>(
+                        this->readNum());
+                const EValueOrigin origin = static_cast<EValueOrigin>(
+                        this->readNum());
+                if (!isGone(code)) {
+                    this->fail();
+                    return;
+                }
+
+                val = sh_.valCreate(code, origin);
+                break;
+            }
+
+            case VK_OFFSET: {
+                const TValId root = this->valOf(this->readNum());
+                const TOffset off = this->readNum();
+                if (!ok_)
+                    return;
+
+                val = sh_.valByOffset(root, off);
+                break;
+            }
+
+            case VK_RANGE: {
+                const TValId root = this->valOf(this->readNum());
+                const IR::Range rng = this->readRange();
+                if (!ok_ || root <= 0)
+                    return this->fail();
+
+                val = sh_.valByRange(root, rng);
+                break;
+            }
+
+            case VK_CUSTOM: {
+                const ECustomValue code = static_cast<ECustomValue>(
+                        this->readNum());
+
+                switch (code) {
+                    case CV_FNC: {
+                        const int uid = this->readNum();
+                        const std::string name = this->readStr();
+
+                        typedef std::map<int, const CodeStorage::Fnc *> TFncs;
+                        const TFncs::const_iterator it = idx_.fncs.find(uid);
+                        if (!ok_ || idx_.fncs.end() == it
+                                || name != nameOf(*it->second))
+                            return this->fail();
+
+                        val = sh_.valWrapCustom(CustomValue(uid));
+                        break;
+                    }
+
+                    case CV_INT_RANGE:
+                        val = sh_.valWrapCustom(CustomValue(this->readRange()));
+                        break;
+
+                    case CV_REAL: {
+                        const long long raw = this->readNum();
+                        double fpn;
+                        memcpy(&fpn, &raw, sizeof fpn);
+                        val = sh_.valWrapCustom(CustomValue(fpn));
+                        break;
+                    }
+
+                    case CV_STRING: {
+                        const std::string text = this->readStr();
+                        val = sh_.valWrapCustom(CustomValue(text.c_str()));
+                        break;
+                    }
+
+                    default:
+                        return this->fail();
+                }
+                break;
+            }
+
+            default:
+                return this->fail();
+        }
+
+        vals_.push_back(val);
+    }
+
+    void HeapReader::readBlocks(const TValId root) {
+        const long long cntBlocks = this->readNum();
+        for (long long i = 0; ok_ && i < cntBlocks; ++i) {
+            const TOffset off = this->readNum();
+            const TSizeOf size = this->readNum();
+            const TValId tpl = this->valOf(this->readNum());
+            if (!ok_)
+                return;
+
+            const TValId addr = sh_.valByOffset(root, off);
+            sh_.writeUniformBlock(addr, tpl, size);
+        }
+
+        const long long cntObjs = this->readNum();
+        for (long long i = 0; ok_ && i < cntObjs; ++i) {
+            const TOffset off = this->readNum();
+            TObjType clt;
+            if (!this->readType(&clt) || !clt)
+                return this->fail();
+
+            const TValId val = this->valOf(this->readNum());
+            if (!ok_)
+                return;
+
+            const TValId addr = sh_.valByOffset(root, off);
+            const ObjHandle obj(sh_, addr, clt);
+            if (!obj.isValid())
+                return this->fail();
+
+            obj.setValue(val);
+        }
+    }
+
+    bool HeapReader::read() {
+        const long long cntRoots = this->readNum();
+        for (long long i = 0; ok_ && i < cntRoots; ++i)
+            this->readRoot();
+
+        const bool retGone = this->readNum();
+        TObjType cltRet;
+        if (!ok_ || !this->readType(&cltRet))
+            return false;
+        if (cltRet)
+            sh_.valSetLastKnownTypeOfTarget(VAL_ADDR_OF_RET, cltRet);
+        if (retGone)
+            sh_.valDestroyTarget(VAL_ADDR_OF_RET);
+
+        const long long cntVals = this->readNum();
+        for (long long i = 0; ok_ && i < cntVals; ++i)
+            this->readValue();
+
+        if (ok_ && !retGone)
+            this->readBlocks(VAL_ADDR_OF_RET);
+        for (long long i = 0; ok_ && i < cntRoots; ++i)
+            this->readBlocks(vals_[i]);
+
+        const long long cntNeqs = this->readNum();
+        for (long long i = 0; ok_ && i < cntNeqs; ++i) {
+            const TValId v1 = this->valOf(this->readNum());
+            const TValId v2 = this->valOf(this->readNum());
+            if (ok_)
+                // bypass SymHeap::neqOp(), which would touch segment lengths
+                sh_.SymHeapCore::neqOp(SymHeapCore::NEQ_ADD, v1, v2);
+        }
+
+        const long long cntCoins = this->readNum();
+        for (long long i = 0; ok_ && i < cntCoins; ++i) {
+            const TValId v1 = this->valOf(this->readNum());
+            const TValId v2 = this->valOf(this->readNum());
+            const TValId sum = this->valOf(this->readNum());
+            if (ok_)
+                sh_.addCoincidence(v1, v2, sum);
+        }
+
+        if (!ok_)
+            return false;
+
+        // both parts of a DLS need to be abstract before we set its length
+        BOOST_FOREACH(const AbsRoot &ar, absRoots_)
+            sh_.valTargetSetAbstract(ar.root, ar.kind, ar.bf);
+
+        BOOST_FOREACH(const AbsRoot &ar, absRoots_)
+            if (OK_SLS == ar.kind || OK_DLS == ar.kind)
+                sh_.segSetMinLength(ar.root, ar.minLength);
+
+        return true;
+    }
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// SymWriter implementation
+struct SymWriter::Private {
+    std::ostream                &str;
+
+    Private(std::ostream &str_):
+        str(str_)
+    {
+    }
+};
+
+SymWriter::SymWriter(std::ostream &str, bool header):
+    d(new Private(str))
+{
+    if (!header)
+        return;
+
+    encodeNum(str, SERIAL_MAGIC);
+    encodeNum(str, SYM_SERIAL_VERSION);
+}
+
+SymWriter::~SymWriter() {
+    delete d;
+}
+
+void SymWriter::writeHeap(const SymHeap &sh) {
+    HeapWriter(sh).write(d->str);
+}
+
+void SymWriter::writeState(const SymState &state) {
+    encodeNum(d->str, state.size());
+    BOOST_FOREACH(const SymHeap *sh, state)
+        this->writeHeap(*sh);
+}
+
+void SymWriter::writeNum(long long num) {
+    encodeNum(d->str, num);
+}
+
+void SymWriter::writeStr(const std::string &text) {
+    encodeStr(d->str, text);
+}
+
+bool SymWriter::ok() const {
+    return !!d->str;
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// SymReader implementation
+struct SymReader::Private {
+    TStorRef                    stor;
+    const StorIndex             idx;
+    std::istream                &str;
+    bool                        ok;
+
+    Private(TStorRef stor_, std::istream &str_):
+        stor(stor_),
+        idx(stor_),
+        str(str_),
+        ok(true)
+    {
+    }
+};
+
+SymReader::SymReader(TStorRef stor, std::istream &str):
+    d(new Private(stor, str))
+{
+    long long magic, version = -1LL;
+    if (!decodeNum(&magic, str) || SERIAL_MAGIC != magic) {
+        CL_DEBUG("SymReader: missing header, the data will be ignored");
+        d->ok = false;
+        return;
+    }
+
+    if (!decodeNum(&version, str) || SYM_SERIAL_VERSION != version) {
+        CL_DEBUG("SymReader: unsupported version of the binary format: "
+                << version);
+        d->ok = false;
+    }
+}
+
+SymReader::~SymReader() {
+    delete d;
+}
+
+bool SymReader::readHeap(SymHeap *pDst) {
+    if (d->ok)
+        d->ok = HeapReader(*pDst, d->idx, d->str).read();
+
+    return d->ok;
+}
+
+bool SymReader::readState(SymState &dst, Trace::Node *trace) {
+    long long cnt;
+    if (!this->readNum(&cnt) || cnt < 0) {
+        d->ok = false;
+        return false;
+    }
+
+    // all the heaps share the trace node (the template keeps it alive)
+    const SymHeap tpl(d->stor, trace);
+    for (long long i = 0; i < cnt; ++i) {
+        SymHeap sh(tpl);
+        if (!this->readHeap(&sh))
+            return false;
+
+        dst.insert(sh);
+    }
+
+    return true;
+}
+
+bool SymReader::readNum(long long *pNum) {
+    if (d->ok)
+        d->ok = decodeNum(pNum, d->str);
+
+    return d->ok;
+}
+
+bool SymReader::readStr(std::string *pText) {
+    if (d->ok)
+        d->ok = decodeStr(pText, d->str);
+
+    return d->ok;
+}
+
+bool SymReader::ok() const {
+    return d->ok;
+}
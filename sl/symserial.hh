@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_SYM_SERIAL_H
+#define H_GUARD_SYM_SERIAL_H
+
+/**
+ * @file symserial.hh
+ * SymWriter/SymReader - compact binary encoding of SymHeap and SymState
+ */
+
+#include "symheap.hh"
+
+#include <iosfwd>
+#include <string>
+
+class SymState;
+
+namespace Trace {
+    class Node;
+}
+
+/// version of the binary format, bump it on any incompatible change
+#define SYM_SERIAL_VERSION 1
+
+/**
+ * streaming writer of symbolic heaps.  The header (magic number and format
+ * version) is written by the constructor, the heaps are then encoded one by
+ * one as they come.  Each heap is encoded independently of the others, types,
+ * variables, and functions are referred to by their IDs in CodeStorage.
+ */
+class SymWriter {
+    public:
+        /**
+         * @param header if false, the header is not written, which allows to
+         * append data to a stream that already starts with the header
+         */
+        SymWriter(std::ostream &str, bool header = true);
+        ~SymWriter();
+
+        /// append the given heap to the stream
+        void writeHeap(const SymHeap &sh);
+
+        /// append the count of heaps in the given state, then the heaps
+        void writeState(const SymState &state);
+
+        /// append a signed number (variable length encoding)
+        void writeNum(long long num);
+
+        /// append a string of the given length
+        void writeStr(const std::string &text);
+
+        /// false if any of the writes has failed
+        bool ok() const;
+
+    private:
+        /// object copying is @b not allowed
+        SymWriter(const SymWriter &);
+
+        /// object copying is @b not allowed
+        SymWriter& operator=(const SymWriter &);
+
+    private:
+        struct Private;
+        Private *d;
+};
+
+/**
+ * streaming reader of symbolic heaps written by SymWriter.  The header is read
+ * and checked by the constructor.  Once a read fails (broken input, version
+ * mismatch, or the heap does not fit the current CodeStorage), ok() returns
+ * false and all subsequent reads fail as well.
+ */
+class SymReader {
+    public:
+        SymReader(TStorRef stor, std::istream &str);
+        ~SymReader();
+
+        /**
+         * decode a heap into the given heap object
+         * @param pDst an empty symbolic heap (as created by its constructor)
+         */
+        bool readHeap(SymHeap *pDst);
+
+        /**
+         * decode a state written by SymWriter::writeState() and insert its
+         * heaps into dst one by one
+         * @param trace trace node to be used by all the decoded heaps
+         */
+        bool readState(SymState &dst, Trace::Node *trace);
+
+        /// decode a signed number written by SymWriter::writeNum()
+        bool readNum(long long *pNum);
+
+        /// decode a string written by SymWriter::writeStr()
+        bool readStr(std::string *pText);
+
+        /// false if the header did not match or any of the reads has failed
+        bool ok() const;
+
+    private:
+        /// object copying is @b not allowed
+        SymReader(const SymReader &);
+
+        /// object copying is @b not allowed
+        SymReader& operator=(const SymReader &);
+
+    private:
+        struct Private;
+        Private *d;
+};
+
+#endif /* H_GUARD_SYM_SERIAL_H */
@@ -32,17 +32,13 @@
 #include "worklist.hh"
 
 #include <algorithm>            // for std::copy_if
+#include <deque>
 #include <iomanip>
 #include <map>
+#include <stack>
 
 #include <boost/foreach.hpp>
 
-#if SE_USE_DFS_SCHEDULER
-#   include <stack>
-#else
-#   include <queue>
-#endif
-
 #define SS_DEBUG(...) do {                                                  \
     if (::debugSymState)                                                    \
         CL_DEBUG("SymState: " << __VA_ARGS__);                              \
@@ -53,6 +49,10 @@ static bool debugSymState = static_cast<bool>(DEBUG_SYMSTATE);
 
 static int cntLookups = -1;
 
+// statistics of SymStateWithJoin, printed out by printJoinStats()
+static long cntJoinsTried;
+static long cntJoinsSkipped;
+
 namespace {
     void debugPlot(const char *name, int idx, const SymHeap &sh) {
 #if DEBUG_SYMJOIN
@@ -68,6 +68,20 @@ namespace {
 
         plotHeap(sh, str.str().c_str());
     }
+
+    size_t fingerprintOf(const SymHeap &sh) {
+        const size_t hash = hashOfHeap(sh);
+
+        // zero is reserved for fingerprints not computed yet
+        return (hash) ? hash : 1;
+    }
+
+    size_t joinSigOfHeap(const SymHeap &sh) {
+        const size_t sig = joinSignature(sh);
+
+        // zero is reserved for signatures not computed yet
+        return (sig) ? sig : 1;
+    }
 }
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -77,6 +91,10 @@ void SymState::clear() {
         delete sh;
 
     heaps_.clear();
+    hashes_.clear();
+    joinSigs_.clear();
+    hashIndex_.clear();
+    joinSigIndex_.clear();
 }
 
 SymState::~SymState() {
@@ -91,6 +109,10 @@ SymState& SymState::operator=(const SymState &ref) {
     BOOST_FOREACH(const SymHeap *sh, ref.heaps_)
         heaps_.push_back(new SymHeap(*sh));
 
+    // the clones are equal to the originals, so are their fingerprints
+    hashes_ = ref.hashes_;
+    joinSigs_ = ref.joinSigs_;
+
     return *this;
 }
 
@@ -107,9 +129,59 @@ void SymState::insertNew(const SymHeap &sh) {
 
     // append the pointer to our container
     heaps_.push_back(dup);
+    hashes_.push_back(/* not computed yet */ 0);
+    joinSigs_.push_back(/* not computed yet */ 0);
+}
+
+size_t SymState::hashOf(int nth) const {
+    size_t &hash = hashes_.at(nth);
+    if (!hash)
+        hash = fingerprintOf(*heaps_[nth]);
+
+    return hash;
+}
+
+size_t SymState::joinSigOf(int nth) const {
+    size_t &sig = joinSigs_.at(nth);
+    if (!sig)
+        sig = joinSigOfHeap(*heaps_[nth]);
+
+    return sig;
 }
 
-bool SymState::insert(const SymHeap &sh, bool /* allowThreeWay */ ) {
+const SymState::TIdxList& SymState::KeyIndex::lookup(
+        const SymState                  &state,
+        TKeyOf                          keyOf,
+        size_t                          key)
+{
+    // index the heaps appended since the last lookup, their indices are
+    // greater than any index already stored, so the lists stay sorted
+    const int cnt = state.size();
+    for (; cntIndexed_ < cnt; ++cntIndexed_) {
+        const size_t keyOfHeap = (state.*keyOf)(cntIndexed_);
+        map_[keyOfHeap].push_back(cntIndexed_);
+    }
+
+    static const TIdxList empty;
+    const std::map<size_t, TIdxList>::const_iterator it = map_.find(key);
+    return (map_.end() == it)
+        ? empty
+        : it->second;
+}
+
+const SymState::TIdxList& SymState::heapsByHash(size_t hash) const {
+    return hashIndex_.lookup(*this, &SymState::hashOf, hash);
+}
+
+const SymState::TIdxList& SymState::heapsByJoinSig(size_t sig) const {
+    return joinSigIndex_.lookup(*this, &SymState::joinSigOf, sig);
+}
+
+bool SymState::insert(
+        const SymHeap                   &sh,
+        bool                            /* allowThreeWay */,
+        const IR::TThresholds           * /* thresholds */)
+{
     if (-1 != this->lookup(sh))
         return false;
 
@@ -131,7 +203,10 @@ int SymHeapUnion::lookup(const SymHeap &lookFor) const {
     SS_DEBUG(">>> lookup() starts, cnt = " << cnt);
     debugPlot("lookup", 0, lookFor);
 
-    for(int idx = 0; idx < cnt; ++idx) {
+    // areEqual() is expensive, run it only if the fingerprints collide
+    const size_t hash = fingerprintOf(lookFor);
+
+    BOOST_FOREACH(const int idx, this->heapsByHash(hash)) {
         const int nth = idx + 1;
         SS_DEBUG("--> lookup() tries sh #" << idx << ", cnt = " << cnt);
 
@@ -156,12 +231,28 @@ void SymStateWithJoin::packSuffix(unsigned idx) {
     const unsigned suffix = idx++;
 
     while (idx < this->size()) {
+        // joinSymHeaps() is expensive, skip the heaps it would fail for anyway
+        const TIdxList &cands = this->heapsByJoinSig(this->joinSigOf(suffix));
+        const TIdxList::const_iterator it =
+            std::lower_bound(cands.begin(), cands.end(), static_cast<int>(idx));
+
+        const unsigned next = (cands.end() == it)
+            ? this->size()
+            : static_cast<unsigned>(*it);
+
+        ::cntJoinsSkipped += next - idx;
+        idx = next;
+        if (this->size() == idx)
+            break;
+
         SymHeap &shNew = const_cast<SymHeap &>(this->operator[](suffix));
         SymHeap &shOld = const_cast<SymHeap &>(this->operator[](idx));
 
         TStorRef stor = shNew.stor();
         CL_BREAK_IF(&stor != &shOld.stor());
 
+        ++::cntJoinsTried;
+
         EJoinStatus     status;
         SymHeap         result(stor, new Trace::TransientNode("packSuffix()"));
         if (!joinSymHeaps(&status, &result, shNew, shOld)) {
@@ -191,7 +282,11 @@ void SymStateWithJoin::packSuffix(unsigned idx) {
     }
 }
 
-bool SymStateWithJoin::insert(const SymHeap &shNew, bool allowThreeWay) {
+bool SymStateWithJoin::insert(
+        const SymHeap                   &shNew,
+        bool                            allowThreeWay,
+        const IR::TThresholds           *thresholds)
+{
     const int cnt = this->size();
     if (!cnt) {
         // no heaps inside, insert the first now
@@ -204,12 +299,23 @@ bool SymStateWithJoin::insert(const SymHeap &shNew, bool allowThreeWay) {
             new Trace::TransientNode("SymStateWithJoin::insert()"));
     int             idx;
 
+    // joinSymHeaps() is expensive, skip the heaps it would fail for anyway
+    const TIdxList &cands = this->heapsByJoinSig(joinSigOfHeap(shNew));
+    ::cntJoinsSkipped += cnt - cands.size();
+
     ++::cntLookups;
-    for(idx = 0; idx < cnt; ++idx) {
-        const SymHeap &shOld = this->operator[](idx);
-        if (joinSymHeaps(&status, &result, shOld, shNew, allowThreeWay))
+    idx = cnt;
+    BOOST_FOREACH(const int candIdx, cands) {
+        ++::cntJoinsTried;
+
+        const SymHeap &shOld = this->operator[](candIdx);
+        if (joinSymHeaps(&status, &result, shOld, shNew, allowThreeWay,
+                    thresholds))
+        {
             // join succeeded
+            idx = candIdx;
             break;
+        }
     }
 
     if (idx == cnt) {
@@ -261,23 +367,233 @@ bool SymStateWithJoin::insert(const SymHeap &shNew, bool allowThreeWay) {
 }
 
 
+void printJoinStats() {
+    const long total = ::cntJoinsTried + ::cntJoinsSkipped;
+    if (!total)
+        return;
+
+    CL_NOTE("___ SymStateWithJoin: " << total << " join(s) requested"
+            ", " << ::cntJoinsSkipped << " skipped by signature"
+            ", " << ::cntJoinsTried << " attempted");
+}
+
+
+// /////////////////////////////////////////////////////////////////////////////
+// weak topological order of basic blocks, driven by the loop-closing edges
+namespace {
+
+typedef BlockScheduler::TBlock                              TBlock;
+typedef std::map<TBlock, unsigned /* pos */>                TBlockPos;
+
+/**
+ * The loop-closing edges found by cl/loopscan.cc are the back edges of a DFS
+ * from the entry, so the CFG without them is acyclic.  The blocks are ordered
+ * by their reverse postorder in that acyclic graph, nested by loops: the key
+ * of a block is the reverse postorder of the heads of all loops it belongs to
+ * (the outermost first), followed by the reverse postorder of the block.  The
+ * blocks of a loop thus get contiguous positions right after the loop head.
+ */
+class WtoBuilder {
+    public:
+        /// assign WTO positions to all blocks reachable from the given one
+        void build(TBlockPos &dst, const TBlock entry);
+
+    private:
+        typedef std::vector<TBlock>                         TBlockList;
+        typedef std::set<TBlock>                            TBlockSet;
+        typedef std::map<TBlock, unsigned /* rpo */>        TRpo;
+        typedef std::map<TBlock, TBlockList>                TPreds;
+        typedef std::map<TBlock /* head */, TBlockSet>      TLoops;
+        typedef std::map<TBlock, TBlock /* head */>         TLoopOf;
+        typedef std::vector<unsigned>                       TKey;
+
+        TRpo                    rpo_;
+        TPreds                  preds_;
+        TLoops                  loops_;
+
+        void dfs(const TBlock entry);
+        void loopBody(TBlockSet &body, const TBlock head);
+        TBlock innermostLoop(const TBlock bb, const TBlock except) const;
+};
+
+bool isLoopClosingTarget(const CodeStorage::Insn *term, const unsigned idx) {
+    BOOST_FOREACH(const unsigned idxTarget, term->loopClosingTargets)
+        if (idxTarget == idx)
+            return true;
+
+    return false;
+}
+
+struct DfsItem {
+    TBlock      bb;
+    unsigned    target;
+
+    DfsItem(const TBlock bb_):
+        bb(bb_),
+        target(0)
+    {
+    }
+};
+
+void WtoBuilder::dfs(const TBlock entry) {
+    TBlockList post;
+    TBlockSet seen;
+    seen.insert(entry);
+
+    std::stack<DfsItem> dfsStack;
+    dfsStack.push(DfsItem(entry));
+
+    while (!dfsStack.empty()) {
+        DfsItem &top = dfsStack.top();
+        const TBlock bb = top.bb;
+
+        const CodeStorage::TTargetList &tlist = bb->targets();
+        if (tlist.size() <= top.target) {
+            // all successors done
+            post.push_back(bb);
+            dfsStack.pop();
+            continue;
+        }
+
+        const unsigned idx = top.target++;
+        const TBlock next = tlist[idx];
+        if (isLoopClosingTarget(bb->back(), idx)) {
+            // remember the latch, do not follow the loop-closing edge
+            loops_[next].insert(bb);
+            continue;
+        }
+
+        preds_[next].push_back(bb);
+        if (insertOnce(seen, next))
+            dfsStack.push(DfsItem(next));
+    }
+
+    const unsigned cnt = post.size();
+    for (unsigned i = 0; i < cnt; ++i)
+        rpo_[post[i]] = cnt - 1 - i;
+}
+
+void WtoBuilder::loopBody(TBlockSet &body, const TBlock head) {
+    // the latches are stored in place of the body by dfs()
+    TBlockList todo(body.begin(), body.end());
+    body.insert(head);
+
+    // go backwards from the latches, stop at the loop head
+    while (!todo.empty()) {
+        const TBlock bb = todo.back();
+        todo.pop_back();
+
+        BOOST_FOREACH(const TBlock pred, preds_[bb])
+            if (insertOnce(body, pred))
+                todo.push_back(pred);
+    }
+}
+
+TBlock WtoBuilder::innermostLoop(const TBlock bb, const TBlock except) const {
+    const unsigned minSize = (except)
+        ? loops_.find(except)->second.size()
+        : 0U;
+
+    TBlock best = 0;
+    unsigned bestSize = 0;
+    BOOST_FOREACH(TLoops::const_reference loop, loops_) {
+        const TBlock head = loop.first;
+        const TBlockSet &body = loop.second;
+        if (head == except || body.size() <= minSize || !hasKey(body, bb))
+            continue;
+
+        if (!best || body.size() < bestSize) {
+            best = head;
+            bestSize = body.size();
+        }
+    }
+
+    return best;
+}
+
+void WtoBuilder::build(TBlockPos &dst, const TBlock entry) {
+    this->dfs(entry);
+
+    TBlockList heads;
+    BOOST_FOREACH(TLoops::reference loop, loops_) {
+        this->loopBody(loop.second, loop.first);
+        heads.push_back(loop.first);
+    }
+
+    // each loop is nested in the smallest loop that contains its head
+    TLoopOf parentOf;
+    BOOST_FOREACH(const TBlock head, heads)
+        parentOf[head] = this->innermostLoop(head, /* except */ head);
+
+    typedef std::pair<TKey, TBlock> TItem;
+    std::vector<TItem> items;
+    BOOST_FOREACH(TRpo::const_reference rpoItem, rpo_) {
+        const TBlock bb = rpoItem.first;
+
+        TKey key(1, rpoItem.second);
+        for (TBlock head = this->innermostLoop(bb, /* except */ 0); head;
+                head = parentOf[head])
+            key.push_back(rpo_[head]);
+
+        std::reverse(key.begin(), key.end());
+        items.push_back(TItem(key, bb));
+    }
+
+    // blocks of an inner loop get contiguous positions after the loop head
+    std::sort(items.begin(), items.end());
+    unsigned pos = dst.size();
+    BOOST_FOREACH(const TItem &item, items)
+        dst[item.second] = pos++;
+}
+
+} // namespace
+
+
 // /////////////////////////////////////////////////////////////////////////////
 // BlockScheduler implementation
 struct BlockScheduler::Private {
-#if SE_USE_DFS_SCHEDULER
-    typedef std::stack<TBlock>                              TSched;
-#else
-    typedef std::queue<TBlock>                              TSched;
-#endif
+    typedef std::deque<TBlock>                              TSched;
+    typedef std::pair<unsigned /* pos */, TBlock>           TPrioItem;
+    typedef std::set<TPrioItem>                             TPrioQueue;
     typedef std::map<TBlock, unsigned /* cnt */>            TDone;
 
-    TBlockSet           todo;
-    TSched              sched;
-    TDone               done;
+    const EBlockSchedOrder  order;
+    TBlockSet               todo;
+    TSched                  sched;
+    TPrioQueue              prio;
+    TBlockPos               wto;
+    TDone                   done;
+
+    Private(const EBlockSchedOrder order_):
+        order(order_)
+    {
+    }
+
+    unsigned wtoPos(const TBlock bb);
 };
 
-BlockScheduler::BlockScheduler():
-    d(new Private)
+unsigned BlockScheduler::Private::wtoPos(const TBlock bb) {
+    TBlockPos::const_iterator it = this->wto.find(bb);
+    if (this->wto.end() != it)
+        return it->second;
+
+    if (bb) {
+        // compute WTO of the whole CFG the block belongs to
+        WtoBuilder builder;
+        builder.build(this->wto, bb->cfg()->entry());
+        it = this->wto.find(bb);
+        if (this->wto.end() != it)
+            return it->second;
+    }
+
+    // the block is not reachable from the entry of its CFG
+    const unsigned pos = this->wto.size();
+    this->wto[bb] = pos;
+    return pos;
+}
+
+BlockScheduler::BlockScheduler(const EBlockSchedOrder order):
+    d(new Private(order))
 {
 }
 
@@ -306,12 +622,29 @@ BlockScheduler::TBlockList BlockScheduler::done() const {
     return dst;
 }
 
+BlockScheduler::TBlockList BlockScheduler::queue() const {
+    if (BSO_WTO != d->order)
+        return TBlockList(d->sched.begin(), d->sched.end());
+
+    TBlockList dst;
+    BOOST_FOREACH(const Private::TPrioItem &item, d->prio)
+        dst.push_back(/* bb */ item.second);
+
+    return dst;
+}
+
 bool BlockScheduler::schedule(const TBlock bb) {
     if (!insertOnce(d->todo, bb))
         // already in the queue
         return false;
 
-    d->sched.push(bb);
+    if (BSO_WTO == d->order) {
+        const Private::TPrioItem item(d->wtoPos(bb), bb);
+        d->prio.insert(item);
+    }
+    else
+        d->sched.push_back(bb);
+
     return true;
 }
 
@@ -320,12 +653,29 @@ bool BlockScheduler::getNext(TBlock *dst) {
         return false;
 
     // take the first block in the queue
-#if SE_USE_DFS_SCHEDULER
-    const TBlock bb = d->sched.top();
-#else
-    const TBlock bb = d->sched.front();
-#endif
-    d->sched.pop();
+    TBlock bb;
+    switch (d->order) {
+        case BSO_FIFO:
+            bb = d->sched.front();
+            d->sched.pop_front();
+            break;
+
+        case BSO_DFS:
+            bb = d->sched.back();
+            d->sched.pop_back();
+            break;
+
+        case BSO_WTO:
+            // the block with the lowest WTO position goes first
+            bb = d->prio.begin()->second;
+            d->prio.erase(d->prio.begin());
+            break;
+
+        default:
+            CL_BREAK_IF("invalid call of BlockScheduler::getNext()");
+            return false;
+    }
+
     if (1 != d->todo.erase(bb))
         CL_BREAK_IF("BlockScheduler malfunction");
 
@@ -392,13 +742,14 @@ bool SymStateMap::insert(
         const CodeStorage::Block        *dst,
         const CodeStorage::Block        *src,
         const SymHeap                   &sh,
-        const bool                      allowThreeWay)
+        const bool                      allowThreeWay,
+        const IR::TThresholds           *thresholds)
 {
     // look for the _target_ block
     Private::BlockState &ref = d->cont[dst];
 
     // insert the given symbolic heap
-    const bool changed = ref.state.insert(sh, allowThreeWay);
+    const bool changed = ref.state.insert(sh, allowThreeWay, thresholds);
 
     if (src)
         // store inbound edge
@@ -417,3 +768,10 @@ void SymStateMap::gatherInboundEdges(TContBlock                  &dst,
     while (shed.getNext(&bb))
         dst.push_back(bb);
 }
+
+void SymStateMap::insertInboundEdge(
+        const CodeStorage::Block        *dst,
+        const CodeStorage::Block        *src)
+{
+    d->cont[dst].inbound.schedule(src);
+}
@@ -25,6 +25,7 @@
  * @todo update dox
  */
 
+#include <map>
 #include <set>
 #include <vector>
 
@@ -42,6 +43,9 @@ class SymState {
         typedef TList::const_iterator           const_iterator;
         typedef TList::iterator                 iterator;
 
+        /// indices of heaps in the ascending order
+        typedef std::vector<int>                TIdxList;
+
     public:
         SymState() { }
         virtual ~SymState();
@@ -53,6 +57,10 @@ class SymState {
 
         virtual void swap(SymState &other) {
             heaps_.swap(other.heaps_);
+            hashes_.swap(other.hashes_);
+            joinSigs_.swap(other.joinSigs_);
+            hashIndex_.swap(other.hashIndex_);
+            joinSigIndex_.swap(other.joinSigIndex_);
         }
 
         /**
@@ -61,8 +69,14 @@ class SymState {
          */
         virtual int lookup(const SymHeap &heap) const = 0;
 
-        /// insert given SymHeap object into the state
-        virtual bool insert(const SymHeap &sh, bool allowThreeWay = true);
+        /**
+         * insert given SymHeap object into the state
+         * @param thresholds widening thresholds, see joinSymHeaps() for details
+         */
+        virtual bool insert(
+                const SymHeap           &sh,
+                bool                    allowThreeWay = true,
+                const IR::TThresholds   *thresholds = 0);
 
         /// return count of object stored in the container
         size_t size()          const { return heaps_.size();  }
@@ -91,18 +105,81 @@ class SymState {
         virtual void eraseExisting(int nth) {
             delete heaps_[nth];
             heaps_.erase(heaps_.begin() + nth);
+            hashes_.erase(hashes_.begin() + nth);
+            joinSigs_.erase(joinSigs_.begin() + nth);
+
+            // the indices of the subsequent heaps have changed
+            hashIndex_.clear();
+            joinSigIndex_.clear();
         }
 
         virtual void swapExisting(int nth, SymHeap &sh) {
             SymHeap &existing = *heaps_.at(nth);
             existing.swap(sh);
+
+            // the fingerprints need to be computed again
+            hashes_[nth] = 0;
+            joinSigs_[nth] = 0;
+            hashIndex_.clear();
+            joinSigIndex_.clear();
         }
 
+        /// return fingerprint of the nth heap (computed on demand, then cached)
+        size_t hashOf(int nth) const;
+
+        /// return joinSignature() of the nth heap (computed on demand, cached)
+        size_t joinSigOf(int nth) const;
+
+        /// return indices of the heaps with the given fingerprint
+        const TIdxList& heapsByHash(size_t hash) const;
+
+        /// return indices of the heaps with the given joinSignature()
+        const TIdxList& heapsByJoinSig(size_t sig) const;
+
         /// lookup/insert optimization in SymCallCache implementation
         friend class PerFncCache;
 
     private:
         TList heaps_;
+
+        /// cached results of hashOfHeap() per each heap, zero if not computed
+        mutable std::vector<size_t> hashes_;
+
+        /// cached results of joinSignature() per each heap, zero if not computed
+        mutable std::vector<size_t> joinSigs_;
+
+        /**
+         * heaps indexed by a key, built on demand and extended as heaps are
+         * appended, rebuilt from scratch once a heap is replaced or removed
+         */
+        class KeyIndex {
+            public:
+                KeyIndex(): cntIndexed_(0) { }
+
+                void clear() {
+                    map_.clear();
+                    cntIndexed_ = 0;
+                }
+
+                void swap(KeyIndex &other) {
+                    map_.swap(other.map_);
+                    std::swap(cntIndexed_, other.cntIndexed_);
+                }
+
+                typedef size_t (SymState::*TKeyOf)(int nth) const;
+
+                const TIdxList& lookup(
+                        const SymState          &state,
+                        TKeyOf                  keyOf,
+                        size_t                  key);
+
+            private:
+                std::map<size_t /* key */, TIdxList>    map_;
+                int                                     cntIndexed_;
+        };
+
+        mutable KeyIndex hashIndex_;
+        mutable KeyIndex joinSigIndex_;
 };
 
 class SymHeapList: public SymState {
@@ -143,7 +220,10 @@ class SymHeapUnion: public SymState {
 
 class SymStateWithJoin: public SymHeapUnion {
     public:
-        virtual bool insert(const SymHeap &sh, bool allowThreeWay = true);
+        virtual bool insert(
+                const SymHeap           &sh,
+                bool                    allowThreeWay = true,
+                const IR::TThresholds   *thresholds = 0);
 
     private:
         void packSuffix(unsigned idx);
@@ -234,11 +314,14 @@ class SymStateMap {
          * zero when inserting an initial state to the entry block
          * @param sh an instance of symbolic heap that should be inserted
          * @param allowThreeWay if true, three-way join is allowed
+         * @param thresholds if not null, integral ranges are widened using the
+         * given thresholds (used on loop-closing edges)
          */
         bool insert(const CodeStorage::Block                *dst,
                     const CodeStorage::Block                *src,
                     const SymHeap                           &sh,
-                    const bool                              allowThreeWay = true
+                    const bool                              allowThreeWay = true,
+                    const IR::TThresholds                   *thresholds = 0
                     );
 
         /**
@@ -253,6 +336,10 @@ class SymStateMap {
                                 const CodeStorage::Block    *ofBlock)
             const;
 
+        /// record an inbound edge of the given block (as insert() would do)
+        void insertInboundEdge(const CodeStorage::Block     *dst,
+                               const CodeStorage::Block     *src);
+
     private:
         /// object copying is @b not allowed
         SymStateMap(const SymStateMap &);
@@ -265,12 +352,29 @@ class SymStateMap {
         Private *d;
 };
 
+/// print statistics of joins attempted and skipped by SymStateWithJoin
+void printJoinStats();
+
 class IStatsProvider {
     public:
         virtual ~IStatsProvider() { }
         virtual void printStats() const = 0;
 };
 
+/// order in which BlockScheduler hands out the scheduled basic blocks
+enum EBlockSchedOrder {
+    BSO_FIFO,               ///< breadth-first, in the order of scheduling
+    BSO_DFS,                ///< depth-first, the last scheduled block goes first
+    BSO_WTO                 ///< weak topological order, inner loops first
+};
+
+/// default order used by BlockScheduler, see SE_USE_DFS_SCHEDULER in config.h
+inline EBlockSchedOrder defaultBlockSchedOrder() {
+    return (SE_USE_DFS_SCHEDULER)
+        ? BSO_DFS
+        : BSO_FIFO;
+}
+
 class BlockScheduler: public IStatsProvider {
     public:
         typedef const CodeStorage::Block       *TBlock;
@@ -278,7 +382,7 @@ class BlockScheduler: public IStatsProvider {
         typedef std::vector<TBlock>             TBlockList;
 
     public:
-        BlockScheduler();
+        BlockScheduler(const EBlockSchedOrder = defaultBlockSchedOrder());
         BlockScheduler(const BlockScheduler &);
         ~BlockScheduler();
 
@@ -286,6 +390,12 @@ class BlockScheduler: public IStatsProvider {
 
         TBlockList done() const;
 
+        /**
+         * blocks waiting in the queue in the order of scheduling, scheduling
+         * them once again into an empty BlockScheduler restores the queue
+         */
+        TBlockList queue() const;
+
         unsigned cntWaiting() const;
 
         bool schedule(const TBlock bb);
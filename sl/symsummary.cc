@@ -0,0 +1,600 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "symsummary.hh"
+
+#include <cl/cl_msg.hh>
+#include <cl/clutil.hh>
+#include <cl/code_listener.h>
+#include <cl/storage.hh>
+
+#include "symserial.hh"
+#include "symstate.hh"
+#include "symtrace.hh"
+#include "symutil.hh"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <boost/foreach.hpp>
+#include <boost/functional/hash.hpp>
+
+// /////////////////////////////////////////////////////////////////////////////
+// journal of messages, used to replay messages of the reused summaries
+namespace {
+    struct cl_init_data     origInitData;
+    TSummaryMsgList         journal;
+    int                     cntJournalUsers;
+
+    void journalWrite(const char kind, const char *msg) {
+        journal.push_back(TSummaryMsg(kind, msg));
+    }
+
+    void journalWarn(const char *msg) {
+        journalWrite('w', msg);
+        origInitData.warn(msg);
+    }
+
+    void journalError(const char *msg) {
+        journalWrite('e', msg);
+        origInitData.error(msg);
+    }
+
+    void journalNote(const char *msg) {
+        journalWrite('n', msg);
+        origInitData.note(msg);
+    }
+
+    void journalEnter() {
+        if (cntJournalUsers++)
+            // already hooked
+            return;
+
+        // chain our call-backs with the ones currently in use
+        cl_global_get_init_data(&origInitData);
+        struct cl_init_data init = origInitData;
+        init.warn   = journalWarn;
+        init.error  = journalError;
+        init.note   = journalNote;
+        cl_global_init(&init);
+    }
+
+    void journalLeave() {
+        CL_BREAK_IF(cntJournalUsers <= 0);
+        if (--cntJournalUsers)
+            // still in use
+            return;
+
+        cl_global_init(&origInitData);
+        journal.clear();
+    }
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// content hash of a function body (independent of the address space layout)
+namespace {
+    void hashLoc(size_t &h, const struct cl_loc &loc) {
+        if (loc.file)
+            boost::hash_combine(h, std::string(loc.file));
+
+        boost::hash_combine(h, loc.line);
+        boost::hash_combine(h, loc.column);
+    }
+
+    /// hash the layout of the given type, targets of pointers only by uid
+    void hashType(size_t &h, const struct cl_type *clt) {
+        if (!clt) {
+            boost::hash_combine(h, -1);
+            return;
+        }
+
+        const enum cl_type_e code = clt->code;
+        boost::hash_combine(h, clt->uid);
+        boost::hash_combine(h, static_cast<int>(code));
+        boost::hash_combine(h, clt->size);
+        boost::hash_combine(h, clt->is_unsigned);
+        if (clt->name)
+            boost::hash_combine(h, std::string(clt->name));
+
+        switch (code) {
+            case CL_TYPE_PTR:
+            case CL_TYPE_FNC: {
+                // a type may point to itself, the layout of the target is
+                // hashed wherever the target is accessed by value
+                boost::hash_combine(h, clt->item_cnt);
+                for (int i = 0; i < clt->item_cnt; ++i) {
+                    const struct cl_type *target = clt->items[i].type;
+                    boost::hash_combine(h, (target) ? target->uid : -1);
+                }
+                return;
+            }
+
+            case CL_TYPE_ARRAY:
+                boost::hash_combine(h, clt->array_size);
+                break;
+
+            default:
+                break;
+        }
+
+        // nested items are contained by value, so the recursion terminates
+        boost::hash_combine(h, clt->item_cnt);
+        for (int i = 0; i < clt->item_cnt; ++i) {
+            const struct cl_type_item *item = &clt->items[i];
+            boost::hash_combine(h, item->offset);
+            if (item->name)
+                boost::hash_combine(h, std::string(item->name));
+
+            hashType(h, item->type);
+        }
+    }
+
+    void hashOperand(size_t &h, const struct cl_operand &op);
+
+    void hashAccessors(size_t &h, const struct cl_accessor *ac) {
+        for (; ac; ac = ac->next) {
+            const enum cl_accessor_e code = ac->code;
+            boost::hash_combine(h, static_cast<int>(code));
+            hashType(h, ac->type);
+
+            switch (code) {
+                case CL_ACCESSOR_DEREF_ARRAY:
+                    hashOperand(h, *ac->data.array.index);
+                    break;
+
+                case CL_ACCESSOR_ITEM:
+                    boost::hash_combine(h, ac->data.item.id);
+                    break;
+
+                case CL_ACCESSOR_OFFSET:
+                    boost::hash_combine(h, ac->data.offset.off);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    void hashCst(size_t &h, const struct cl_cst &cst) {
+        const enum cl_type_e code = cst.code;
+        boost::hash_combine(h, static_cast<int>(code));
+
+        switch (code) {
+            case CL_TYPE_FNC:
+                boost::hash_combine(h, cst.data.cst_fnc.uid);
+                boost::hash_combine(h, std::string(cst.data.cst_fnc.name));
+                break;
+
+            case CL_TYPE_INT:
+                boost::hash_combine(h, cst.data.cst_int.value);
+                break;
+
+            case CL_TYPE_STRING:
+                boost::hash_combine(h, std::string(cst.data.cst_string.value));
+                break;
+
+            case CL_TYPE_REAL:
+                boost::hash_combine(h, cst.data.cst_real.value);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    void hashOperand(size_t &h, const struct cl_operand &op) {
+        const enum cl_operand_e code = op.code;
+        boost::hash_combine(h, static_cast<int>(code));
+        if (CL_OPERAND_VOID == code)
+            return;
+
+        boost::hash_combine(h, static_cast<int>(op.scope));
+        hashType(h, op.type);
+        hashAccessors(h, op.accessor);
+
+        if (CL_OPERAND_CST == code) {
+            hashCst(h, op.data.cst);
+            return;
+        }
+
+        const struct cl_var *var = op.data.var;
+        boost::hash_combine(h, var->uid);
+        if (var->name)
+            boost::hash_combine(h, std::string(var->name));
+    }
+
+    size_t hashFncBody(const CodeStorage::Fnc &fnc) {
+        using namespace CodeStorage;
+        size_t h = 0;
+        boost::hash_combine(h, uidOf(fnc));
+        boost::hash_combine(h, std::string(nameOf(fnc)));
+        if (!isDefined(fnc))
+            // only the name matters for undefined functions
+            return h;
+
+        // messages of the reused summaries carry the original locations
+        hashLoc(h, *locationOf(fnc));
+
+        BOOST_FOREACH(const int arg, fnc.args)
+            boost::hash_combine(h, arg);
+
+        BOOST_FOREACH(const Block *bb, fnc.cfg) {
+            boost::hash_combine(h, bb->name());
+
+            BOOST_FOREACH(const Insn *insn, *bb) {
+                boost::hash_combine(h, static_cast<int>(insn->code));
+                boost::hash_combine(h, insn->subCode);
+                hashLoc(h, insn->loc);
+
+                BOOST_FOREACH(const struct cl_operand &op, insn->operands)
+                    hashOperand(h, op);
+
+                BOOST_FOREACH(const Block *target, insn->targets)
+                    boost::hash_combine(h, target->name());
+            }
+        }
+
+        return h;
+    }
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// access to the summary files, which may be shared by concurrent processes
+namespace {
+    bool lockFile(const int fd, const int op) {
+        int rv;
+        do
+            rv = flock(fd, op);
+        while (rv && EINTR == errno);
+
+        return !rv;
+    }
+
+    bool readFile(std::string &dst, const int fd) {
+        char buf[0x1000];
+        for (;;) {
+            const ssize_t cnt = read(fd, buf, sizeof buf);
+            if (!cnt)
+                return true;
+
+            if (0 < cnt)
+                dst.append(buf, cnt);
+            else if (EINTR != errno)
+                return false;
+        }
+    }
+
+    bool writeFile(const int fd, const std::string &data) {
+        const char *buf = data.data();
+        size_t size = data.size();
+        while (size) {
+            const ssize_t cnt = write(fd, buf, size);
+            if (0 < cnt) {
+                buf += cnt;
+                size -= cnt;
+            }
+            else if (EINTR != errno)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+// /////////////////////////////////////////////////////////////////////////////
+// SymSummaryStore implementation
+struct SymSummaryStore::Private {
+    typedef const CodeStorage::Fnc                     &TFncRef;
+    typedef std::map<int /* uid */, size_t>             TKeyMap;
+    typedef std::map<size_t /* key */, TSummaryList>    TCache;
+
+    TStorRef                    stor;
+    const std::string           dir;
+    const size_t                salt;
+    TKeyMap                     bodyHashes;
+    TKeyMap                     keys;
+    std::set<int /* uid */>     uncacheable;
+    TCache                      cache;
+
+    Private(TStorRef stor_, const std::string &dir_, size_t salt_):
+        stor(stor_),
+        dir(dir_),
+        salt(salt_)
+    {
+    }
+
+    bool keyOf(size_t *pKey, TFncRef fnc);
+    std::string fileOf(size_t key) const;
+    void load(TSummaryList &dst, TFncRef fnc, size_t key);
+};
+
+bool SymSummaryStore::Private::keyOf(size_t *pKey, TFncRef fnc) {
+    using namespace CodeStorage;
+    const int uid = uidOf(fnc);
+    if (hasKey(this->uncacheable, uid))
+        return false;
+
+    const TKeyMap::const_iterator it = this->keys.find(uid);
+    if (this->keys.end() != it) {
+        *pKey = it->second;
+        return true;
+    }
+
+    // collect all functions that may be called from here (recursively)
+    std::set<int> reach;
+    std::vector<int> todo(1, uid);
+    while (!todo.empty()) {
+        const int now = todo.back();
+        todo.pop_back();
+        if (!insertOnce(reach, now))
+            continue;
+
+        const Fnc &fncNow = *this->stor.fncs[now];
+        if (!isDefined(fncNow))
+            continue;
+
+        BOOST_FOREACH(const Block *bb, fncNow.cfg) {
+            BOOST_FOREACH(const Insn *insn, *bb) {
+                if (CL_INSN_CALL != insn->code)
+                    continue;
+
+                int callee;
+                if (!fncUidFromOperand(&callee, &insn->operands[/* fnc */ 1])) {
+                    // indirect call, we cannot tell what is going to be called
+                    this->uncacheable.insert(uid);
+                    return false;
+                }
+
+                todo.push_back(callee);
+            }
+        }
+    }
+
+    // std::set is ordered, so is the sequence of hashed items
+    size_t key = this->salt;
+    BOOST_FOREACH(const int now, reach) {
+        TKeyMap::iterator it = this->bodyHashes.find(now);
+        if (this->bodyHashes.end() == it) {
+            const size_t h = hashFncBody(*this->stor.fncs[now]);
+            it = this->bodyHashes.insert(std::make_pair(now, h)).first;
+        }
+
+        boost::hash_combine(key, it->second);
+    }
+
+    this->keys[uid] = key;
+    *pKey = key;
+    return true;
+}
+
+std::string SymSummaryStore::Private::fileOf(size_t key) const {
+    char name[/* 64bit in hex */ 16 + sizeof ".sum"];
+    sprintf(name, "%016llx.sum", static_cast<unsigned long long>(key));
+    return this->dir + "/" + name;
+}
+
+void SymSummaryStore::Private::load(
+        TSummaryList                &dst,
+        TFncRef                     fnc,
+        const size_t                key)
+{
+    const std::string fileName = this->fileOf(key);
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        // no summaries of this fnc yet
+        return;
+
+    // read the whole file at once, so that no record is half-written
+    std::string data;
+    const bool loaded = lockFile(fd, LOCK_SH) && readFile(data, fd);
+    close(fd);
+    if (!loaded) {
+        CL_WARN("failed to read summary file: " << fileName);
+        return;
+    }
+
+    std::istringstream str(data);
+
+    // the header is written only once at the beginning of the file
+    SymReader rd(this->stor, str);
+
+    const std::string name = nameOf(fnc);
+    while (rd.ok() && EOF != str.peek()) {
+        SymHeap entry(this->stor, new Trace::RootNode(&fnc));
+        bool ok = rd.readHeap(&entry);
+
+        SymSummary *sum = new SymSummary(entry);
+
+        // results
+        long long cnt = 0LL;
+        ok = ok && rd.readNum(&cnt);
+        for (long long i = 0; ok && i < cnt; ++i) {
+            SymHeap sh(this->stor, new Trace::RootNode(&fnc));
+            ok = rd.readHeap(&sh);
+            sum->results.push_back(sh);
+        }
+
+        // messages
+        long long cntMsgs = 0LL;
+        ok = ok && rd.readNum(&cntMsgs);
+        for (long long i = 0; ok && i < cntMsgs; ++i) {
+            long long kind;
+            std::string text;
+            ok = rd.readNum(&kind) && rd.readStr(&text);
+            sum->msgs.push_back(TSummaryMsg(static_cast<char>(kind), text));
+        }
+
+        // the name of fnc closes the record
+        std::string fncName;
+        ok = ok && rd.readStr(&fncName) && (name == fncName);
+
+        if (!ok) {
+            CL_DEBUG("SymSummaryStore: ignoring the rest of " << fileName);
+            delete sum;
+            break;
+        }
+
+        dst.push_back(sum);
+    }
+}
+
+SymSummaryStore::SymSummaryStore(
+        TStorRef                    stor,
+        const std::string           &dir,
+        const size_t                salt):
+    d(new Private(stor, dir, salt))
+{
+    if (mkdir(dir.c_str(), 0777) && EEXIST != errno)
+        CL_WARN("failed to create directory for summaries: " << dir
+                << " (" << strerror(errno) << ")");
+
+    journalEnter();
+}
+
+SymSummaryStore::~SymSummaryStore() {
+    journalLeave();
+
+    BOOST_FOREACH(Private::TCache::const_reference item, d->cache)
+        BOOST_FOREACH(const SymSummary *sum, item.second)
+            delete sum;
+
+    delete d;
+}
+
+const SymSummaryStore::TSummaryList& SymSummaryStore::lookup(
+        const CodeStorage::Fnc      &fnc)
+{
+    static const TSummaryList empty;
+    size_t key;
+    if (!d->keyOf(&key, fnc))
+        return empty;
+
+    Private::TCache::iterator it = d->cache.find(key);
+    if (d->cache.end() == it) {
+        // read the summaries from disk on the first use
+        it = d->cache.insert(std::make_pair(key, TSummaryList())).first;
+        d->load(it->second, fnc, key);
+    }
+
+    return it->second;
+}
+
+void SymSummaryStore::store(
+        const CodeStorage::Fnc      &fnc,
+        const SymHeap               &entry,
+        const SymState              &results,
+        const TSummaryMsgList       &msgs)
+{
+    size_t key;
+    if (!d->keyOf(&key, fnc))
+        return;
+
+    // the lock serializes processes that store summaries of the same fnc
+    const std::string fileName = d->fileOf(key);
+    const int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+    struct stat st;
+    bool ok = (0 <= fd)
+        && lockFile(fd, LOCK_EX)
+        && !fstat(fd, &st);
+
+    if (ok && SE_SUMMARY_FILE_LIMIT < st.st_size) {
+        // start over instead of letting the file grow without bounds
+        CL_DEBUG("SymSummaryStore: summary file too big, truncating "
+                << fileName);
+        ok = !ftruncate(fd, 0);
+        st.st_size = 0;
+    }
+
+    // start a new file with the header, append to an existing one without it
+    const bool header = !ok || !st.st_size;
+
+    // encode the whole record first, so that it is appended at once
+    std::ostringstream rec;
+    SymWriter wr(rec, header);
+    wr.writeHeap(entry);
+    wr.writeState(results);
+
+    wr.writeNum(msgs.size());
+    BOOST_FOREACH(const TSummaryMsg &msg, msgs) {
+        wr.writeNum(msg.first);
+        wr.writeStr(msg.second);
+    }
+
+    // the name of fnc closes the record
+    wr.writeStr(nameOf(fnc));
+
+    ok = ok && writeFile(fd, rec.str());
+    if (!ok)
+        CL_WARN("failed to write summary file: " << fileName);
+
+    if (0 <= fd)
+        // closing the file releases the lock
+        close(fd);
+
+    Private::TCache::iterator it = d->cache.find(key);
+    if (d->cache.end() == it)
+        // not loaded yet, the summary will be read from disk if needed
+        return;
+
+    // make the summary available to lookup() in the current run as well
+    SymSummary *sum = new SymSummary(entry);
+    sum->entry.traceUpdate(new Trace::RootNode(&fnc));
+    BOOST_FOREACH(const SymHeap *res, results) {
+        SymHeap sh(*res);
+        sh.traceUpdate(new Trace::RootNode(&fnc));
+        sum->results.push_back(sh);
+    }
+
+    sum->msgs = msgs;
+    it->second.push_back(sum);
+}
+
+size_t SymSummaryStore::journalSize() const {
+    return journal.size();
+}
+
+void SymSummaryStore::journalSince(TSummaryMsgList &dst, size_t size) const {
+    CL_BREAK_IF(journal.size() < size);
+    dst.insert(dst.end(), journal.begin() + size, journal.end());
+}
+
+void SymSummaryStore::replay(const TSummaryMsgList &msgs) {
+    BOOST_FOREACH(const TSummaryMsg &msg, msgs) {
+        const char *text = msg.second.c_str();
+        switch (msg.first) {
+            case 'w':   cl_warn (text); break;
+            case 'e':   cl_error(text); break;
+            case 'n':   cl_note (text); break;
+            default:
+                CL_BREAK_IF("SymSummaryStore::replay() got garbage on input");
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef H_GUARD_SYM_SUMMARY_H
+#define H_GUARD_SYM_SUMMARY_H
+
+/**
+ * @file symsummary.hh
+ * SymSummaryStore - on-disk store of function summaries, which allows to reuse
+ * results of function calls computed by previous runs of the analyzer
+ */
+
+#include "symheap.hh"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class SymState;
+
+namespace CodeStorage {
+    struct Fnc;
+}
+
+/// message emitted while computing a summary, the kind is 'w', 'e', or 'n'
+typedef std::pair<char /* kind */, std::string /* text */>  TSummaryMsg;
+
+/// list of messages to replay once a summary is used instead of a computation
+typedef std::vector<TSummaryMsg>                            TSummaryMsgList;
+
+/// a single summary of a function: a call entry and the results of the call
+struct SymSummary {
+    SymHeap                     entry;
+    std::vector<SymHeap>        results;
+    TSummaryMsgList             msgs;
+
+    SymSummary(const SymHeap &entry_):
+        entry(entry_)
+    {
+    }
+};
+
+/**
+ * content-addressed store of function summaries.  The summaries of a function
+ * are keyed by a hash of the function body and bodies of all the functions it
+ * may call, so that a change in any of them makes the summaries unreachable.
+ */
+class SymSummaryStore {
+    public:
+        typedef std::vector<const SymSummary *>             TSummaryList;
+
+    public:
+        /**
+         * @param dir directory where the summaries are stored (it is created
+         * if it does not exist yet)
+         * @param salt hash of analysis settings that the results depend on
+         */
+        SymSummaryStore(TStorRef stor, const std::string &dir, size_t salt);
+        ~SymSummaryStore();
+
+        /// return all summaries of the given fnc available in the store
+        const TSummaryList& lookup(const CodeStorage::Fnc &fnc);
+
+        /**
+         * store a summary of the given fnc (does nothing if the results of the
+         * fnc cannot be reliably reused, e.g. because of an indirect call)
+         */
+        void store(
+                const CodeStorage::Fnc      &fnc,
+                const SymHeap               &entry,
+                const SymState              &results,
+                const TSummaryMsgList       &msgs);
+
+        /// count of messages emitted since the store was created
+        size_t journalSize() const;
+
+        /// messages emitted since the journal had the given size
+        void journalSince(TSummaryMsgList &dst, size_t size) const;
+
+        /// emit the given messages again (they will also appear in the journal)
+        static void replay(const TSummaryMsgList &msgs);
+
+    private:
+        /// object copying is @b not allowed
+        SymSummaryStore(const SymSummaryStore &);
+
+        /// object copying is @b not allowed
+        SymSummaryStore& operator=(const SymSummaryStore &);
+
+    private:
+        struct Private;
+        Private *d;
+};
+
+#endif /* H_GUARD_SYM_SUMMARY_H */
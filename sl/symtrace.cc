@@ -23,6 +23,7 @@
 #include <cl/cldebug.hh>
 #include <cl/storage.hh>
 
+#include "memdebug.hh"
 #include "plotenum.hh"
 #include "worklist.hh"
 
@@ -31,42 +32,182 @@
 #include <map>
 #include <set>
 #include <sstream>
+#include <vector>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/foreach.hpp>
 
 namespace Trace {
 
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of Trace::setTraceLevel()
+
+static ETraceLevel globalTraceLevel = TL_FULL;
+
+void setTraceLevel(const ETraceLevel level) {
+    globalTraceLevel = level;
+}
+
+ETraceLevel traceLevel() {
+    return globalTraceLevel;
+}
+
+
+// /////////////////////////////////////////////////////////////////////////////
+// implementation of Trace::NodeArena
+
+/// pool of trace graph nodes with a free list per each size class
+class NodeArena {
+    private:
+        enum {
+            ALIGN           = sizeof(void *),
+            CNT_CLASSES     = 0x10,
+            BLOCK_SIZE      = 0x10000
+        };
+
+        /// chunk of a free list, reuses memory of a released node
+        struct FreeItem {
+            FreeItem                   *next;
+        };
+
+        std::vector<char *>             blocks_;
+        char                           *top_;
+        char                           *end_;
+        FreeItem                       *freeLists_[CNT_CLASSES];
+        size_t                          cntLive_;
+
+        static size_t sizeClassOf(const size_t size) {
+            return (size + ALIGN - 1) / ALIGN - 1;
+        }
+
+    public:
+        NodeArena():
+            top_(0),
+            end_(0),
+            cntLive_(0)
+        {
+            std::fill(freeLists_, freeLists_ + CNT_CLASSES,
+                    static_cast<FreeItem *>(0));
+        }
+
+        void* alloc(const size_t size) {
+            ++cntLive_;
+            const size_t cls = sizeClassOf(size);
+            if (CNT_CLASSES <= cls) {
+                // too big to be pooled
+                memAccountAlloc(MC_TRACE, size);
+                return ::operator new(size);
+            }
+
+            FreeItem *&head = freeLists_[cls];
+            if (head) {
+                // recycle a released node of the same size class
+                FreeItem *item = head;
+                head = item->next;
+                return item;
+            }
+
+            const size_t cb = (cls + 1) * ALIGN;
+            if (end_ < top_ + cb) {
+                // the current block is exhausted, start a new one
+                top_ = new char[BLOCK_SIZE];
+                end_ = top_ + BLOCK_SIZE;
+                blocks_.push_back(top_);
+                memAccountAlloc(MC_TRACE, BLOCK_SIZE);
+            }
+
+            void *ptr = top_;
+            top_ += cb;
+            return ptr;
+        }
+
+        void release(void *ptr, const size_t size) {
+            CL_BREAK_IF(!cntLive_);
+            const size_t cls = sizeClassOf(size);
+            if (CNT_CLASSES <= cls) {
+                memAccountFree(MC_TRACE, size);
+                ::operator delete(ptr);
+            }
+            else {
+                FreeItem *item = static_cast<FreeItem *>(ptr);
+                item->next = freeLists_[cls];
+                freeLists_[cls] = item;
+            }
+
+            if (--cntLive_)
+                return;
+
+            // no node is alive, reclaim all the memory at once
+            BOOST_FOREACH(char *block, blocks_) {
+                memAccountFree(MC_TRACE, BLOCK_SIZE);
+                delete[] block;
+            }
+
+            blocks_.clear();
+            top_ = 0;
+            end_ = 0;
+            std::fill(freeLists_, freeLists_ + CNT_CLASSES,
+                    static_cast<FreeItem *>(0));
+        }
+};
+
+// intentionally never destroyed, heaps in static storage may outlive us
+static NodeArena *nodeArena;
+
+void* NodeBase::operator new(size_t size) {
+    if (!nodeArena)
+        nodeArena = new NodeArena;
+
+    return nodeArena->alloc(size);
+}
+
+void NodeBase::operator delete(void *ptr, size_t size) {
+    nodeArena->release(ptr, size);
+}
+
+
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of Trace::NodeBase
 
 NodeBase::~NodeBase() {
-    BOOST_FOREACH(Node *parent, parents_)
-        parent->notifyDeath(this);
+    BOOST_FOREACH(Node *parent, this->parents())
+        parent->notifyDeath();
 }
 
 Node* NodeBase::parent() const {
-    CL_BREAK_IF(1 != parents_.size());
-    return parents_.front();
+    CL_BREAK_IF(1 != cntParents_);
+    return parents_[0];
 }
 
 
 // /////////////////////////////////////////////////////////////////////////////
 // implementation of Trace::Node
 
-void Node::notifyBirth(NodeBase *child) {
-    children_.push_back(child);
-}
+// nodes waiting for destruction, see Node::notifyDeath()
+static std::vector<Node *> *doomedNodes;
+
+void Node::notifyDeath() {
+    CL_BREAK_IF(!cntChildren_);
+    if (--cntChildren_)
+        // still referenced
+        return;
+
+    if (doomedNodes) {
+        // a destruction is already in progress, avoid a deep recursion
+        doomedNodes->push_back(this);
+        return;
+    }
 
-void Node::notifyDeath(NodeBase *child) {
-    // remove the dead child from the list
-    children_.erase(
-            std::remove(children_.begin(), children_.end(), child),
-            children_.end());
+    // destroy the whole unreachable sub-graph in a loop
+    std::vector<Node *> todo(1, this);
+    doomedNodes = &todo;
+    while (!todo.empty()) {
+        Node *node = todo.back();
+        todo.pop_back();
+        delete node;
+    }
 
-    if (children_.empty())
-        // FIXME: this may cause stack overflow on complex trace graphs
-        delete this;
+    doomedNodes = 0;
 }
 
 
@@ -74,13 +215,13 @@ void Node::notifyDeath(NodeBase *child) {
 // implementation of Trace::NodeHandle
 
 void NodeHandle::reset(Node *node) {
-    // release the old node
-    Node *&ref = parents_.front();
-    ref->notifyDeath(this);
+    // register the new node first, it may be reachable from the old one only
+    node->notifyBirth();
 
-    // register the new node
+    // release the old node
+    Node *&ref = parents_[0];
+    ref->notifyDeath();
     ref = node;
-    ref->notifyBirth(this);
 }
 
 
@@ -30,8 +30,9 @@
 #include "symbt.hh"                 // needed for EMsgLevel
 #include "symheap.hh"               // needed for EObjKind
 
-#include <vector>
+#include <cstddef>
 #include <string>
+#include <utility>
 
 struct cl_loc;
 
@@ -51,21 +52,42 @@ typedef const struct cl_loc                        *TLoc;
 typedef const CodeStorage::Fnc                     *TFnc;
 typedef const CodeStorage::Insn                    *TInsn;
 
-typedef std::vector<Node *>                         TNodeList;
+/// range of parent nodes, usable with BOOST_FOREACH
+typedef std::pair<Node *const *, Node *const *>     TNodeRange;
+
+/// how much of the trace graph is kept in memory
+enum ETraceLevel {
+    TL_NONE,        ///< keep only the nodes referenced by live heaps
+    TL_ERRORS,      ///< keep the nodes needed to reconstruct error traces
+    TL_FULL         ///< keep everything (needed to plot all the warnings)
+};
+
+/// set the trace level for the whole analysis (TL_FULL by default)
+void setTraceLevel(ETraceLevel);
+
+/// return the trace level that is currently in use
+ETraceLevel traceLevel();
 
 /// an abstract base for Node and NodeHandle (externally not much useful)
 class NodeBase {
     protected:
-        /// list of all (0..n) parent nodes
-        TNodeList parents_;
+        /// parent nodes stored inline, there are never more than two of them
+        Node *parents_[2];
+
+        /// count of parent nodes stored in parents_
+        unsigned char cntParents_;
 
         /// this is an abstract class, its instantiation is @b not allowed
-        NodeBase() { }
+        NodeBase():
+            cntParents_(0)
+        {
+        }
 
         /// construct Node with exactly one parent, can be extended later
         NodeBase(Node *node):
-            parents_(1, node)
+            cntParents_(1)
         {
+            parents_[0] = node;
         }
 
     public:
@@ -75,40 +97,55 @@ class NodeBase {
         /// this can be called only on nodes with exactly one parent
         Node* parent() const;
 
-        /// reference to list of parents (containing 0..n pointers)
-        const TNodeList& parents() const { return parents_; }
+        /// range of parents (containing 0..2 pointers)
+        TNodeRange parents() const {
+            return TNodeRange(parents_, parents_ + cntParents_);
+        }
+
+        /// nodes are allocated from a pool that is reclaimed in bulk
+        static void* operator new(size_t size);
+
+        /// nodes are allocated from a pool that is reclaimed in bulk
+        static void operator delete(void *ptr, size_t size);
 };
 
 /// an abstract node of the symbolic execution trace graph
 class Node: public NodeBase {
     private:
         /// birth notification from a child node
-        void notifyBirth(NodeBase *child);
+        void notifyBirth() {
+            ++cntChildren_;
+        }
 
         /// death notification from a child node
-        void notifyDeath(NodeBase *child);
+        void notifyDeath();
 
         friend class NodeBase;
         friend class NodeHandle;
 
     protected:
         /// this is an abstract class, its instantiation is @b not allowed
-        Node() { }
+        Node():
+            cntChildren_(0)
+        {
+        }
 
         /// constructor for nodes with exactly one parent
         Node(Node *ref):
-            NodeBase(ref)
+            NodeBase(ref),
+            cntChildren_(0)
         {
-            ref->notifyBirth(this);
+            ref->notifyBirth();
         }
 
         /// constructor for nodes with exactly two parents
         Node(Node *ref1, Node *ref2):
-            NodeBase(ref1)
+            NodeBase(ref1),
+            cntChildren_(0)
         {
-            parents_.push_back(ref2);
-            ref1->notifyBirth(this);
-            ref2->notifyBirth(this);
+            parents_[cntParents_++] = ref2;
+            ref1->notifyBirth();
+            ref2->notifyBirth();
         }
 
         /// serialize this node to the given plot (externally not much useful)
@@ -117,11 +154,11 @@ class Node: public NodeBase {
         friend void plotTraceCore(TracePlotter &);
 
     public:
-        /// used to store a list of child nodes
-        typedef std::vector<NodeBase *> TBaseList;
+        /// count of child nodes (and handles) referring to this node
+        unsigned cntChildren() const { return cntChildren_; }
 
-        /// reference to list of child nodes (containing 0..n pointers)
-        const TBaseList& children() const { return children_; }
+        /// true if the node is not needed to reconstruct an error trace
+        virtual bool isAuxiliary() const { return false; }
 
     private:
         // copying NOT allowed
@@ -129,7 +166,7 @@ class Node: public NodeBase {
         Node& operator=(const Node &);
 
     private:
-        TBaseList children_;
+        unsigned cntChildren_;
 };
 
 /// useful to prevent a trace sub-graph from being destroyed too early
@@ -139,7 +176,7 @@ class NodeHandle: public NodeBase {
         NodeHandle(Node *ref):
             NodeBase(ref)
         {
-            ref->notifyBirth(this);
+            ref->notifyBirth();
         }
 
         /// return the node stored within this handle
@@ -154,7 +191,7 @@ class NodeHandle: public NodeBase {
         NodeHandle(const NodeHandle &tpl):
             NodeBase(tpl.node())
         {
-            this->parent()->notifyBirth(this);
+            this->parent()->notifyBirth();
         }
 
         /// overridden assignment operator keeping the semantics of a handle
@@ -264,6 +301,8 @@ class AbstractionNode: public Node {
         {
         }
 
+        virtual bool isAuxiliary() const { return true; }
+
     protected:
         void virtual plotNode(TracePlotter &) const;
 };
@@ -284,6 +323,8 @@ class ConcretizationNode: public Node {
         {
         }
 
+        virtual bool isAuxiliary() const { return true; }
+
     protected:
         void virtual plotNode(TracePlotter &) const;
 };
@@ -307,6 +348,8 @@ class SpliceOutNode: public Node {
         {
         }
 
+        virtual bool isAuxiliary() const { return true; }
+
     protected:
         void virtual plotNode(TracePlotter &) const;
 };
@@ -228,9 +228,8 @@ inline void gatherProgramVars(
         TCVarSet                &dst,
         const SymHeap           &sh)
 {
-    typedef std::pair<TCVarSet::iterator, bool> TRet;
-    TRet (TCVarSet::*ins)(const CVar &) = &TCVarSet::insert;
-    gatherProgramVarsCore(dst, sh, ins);
+    // the set is ordered anyway, no need to go through all the roots
+    sh.gatherCVars(dst);
 }
 
 /// take the given visitor through all live pointers
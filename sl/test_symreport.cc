@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file test_symreport.cc
+ * test of the deduplication of diagnostics, two distinct errors bound to the
+ * same location have to be both reported, only the true repeats are suppressed
+ */
+
+#include "config.h"
+
+#include <cl/code_listener.h>
+#include <cl/storage.hh>
+
+#include "symbt.hh"
+#include "symheap.hh"
+#include "symproc.hh"
+#include "symreport.hh"
+#include "symtrace.hh"
+
+#include <cstring>
+#include <iostream>
+
+// the entry point of the plug-in (cl_symexec.cc) is not linked with the test
+void clEasyRun(const CodeStorage::Storage &, const char *) {
+}
+
+namespace {
+
+int cntErrors;
+
+void expect(const char *what, const bool cond) {
+    if (cond)
+        return;
+
+    std::cerr << "failed: " << what << "\n";
+    ++cntErrors;
+}
+
+/// both errors are bound to the same location, level, and call stack
+void reportFirstError(SymProc &proc) {
+    proc.setMsgKind(__FILE__, __LINE__);
+}
+
+void reportSecondError(SymProc &proc) {
+    proc.setMsgKind(__FILE__, __LINE__);
+}
+
+} // namespace
+
+int main() {
+    CodeStorage::Storage stor;
+    CodeStorage::Fnc fnc;
+    SymBackTrace bt(stor);
+    SymHeap sh(stor, new Trace::RootNode(&fnc));
+
+    struct cl_loc loc;
+    memset(&loc, 0, sizeof loc);
+    loc.file = "test.c";
+    loc.line = 7;
+    loc.column = 5;
+
+    SymProc proc(sh, &bt);
+    proc.setLocation(&loc);
+    Report::setDedup(true);
+
+    reportFirstError(proc);
+    expect("the first error is new", !proc.alreadyReported(ML_ERROR));
+    proc.printBackTrace(ML_ERROR);
+
+    reportSecondError(proc);
+    expect("the second error is not a repeat of the first one",
+            !proc.alreadyReported(ML_ERROR));
+    proc.printBackTrace(ML_ERROR);
+
+    reportFirstError(proc);
+    expect("the first error is a repeat", proc.alreadyReported(ML_ERROR));
+    proc.printBackTrace(ML_ERROR);
+
+    reportSecondError(proc);
+    expect("the second error is a repeat", proc.alreadyReported(ML_ERROR));
+    proc.printBackTrace(ML_ERROR);
+
+    // the same kind of diagnostic at another column is a distinct one
+    struct cl_loc next = loc;
+    next.column = 9;
+    proc.setLocation(&next);
+    reportFirstError(proc);
+    expect("the first error at another column is new",
+            !proc.alreadyReported(ML_ERROR));
+
+    // no error is ever suppressed unless deduplication is enabled
+    Report::setDedup(false);
+    proc.setLocation(&loc);
+    reportFirstError(proc);
+    expect("nothing is suppressed if disabled", !proc.alreadyReported(ML_ERROR));
+
+    if (cntErrors)
+        std::cerr << "error: " << cntErrors << " check(s) failed\n";
+
+    return !!cntErrors;
+}
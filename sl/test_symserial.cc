@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file test_symserial.cc
+ * round-trip test of SymWriter/SymReader on heaps with SLS, DLS, and 0+ segments
+ */
+
+#include "config.h"
+
+#include <cl/code_listener.h>
+#include <cl/storage.hh>
+
+#include "symcmp.hh"
+#include "symheap.hh"
+#include "symseg.hh"
+#include "symserial.hh"
+#include "symstate.hh"
+#include "symtrace.hh"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/foreach.hpp>
+
+// the entry point of the plug-in (cl_symexec.cc) is not linked with the test
+void clEasyRun(const CodeStorage::Storage &, const char *) {
+}
+
+namespace {
+
+int cntErrors;
+
+/// offsets of the fields of a list node, the node is made of two pointers
+const TOffset offNext = 0;
+const TOffset offPrev = sizeof(void *);
+
+struct cl_type          ptrType;
+struct cl_type_item     ptrItem;
+
+void initStor(CodeStorage::Storage &stor) {
+    ptrType.uid         = 1;
+    ptrType.code        = CL_TYPE_PTR;
+    ptrType.name        = 0;
+    ptrType.size        = sizeof(void *);
+    ptrType.item_cnt    = 1;
+    ptrType.items       = &ptrItem;
+    ptrItem.type        = &ptrType;
+    ptrItem.name        = 0;
+    ptrItem.offset      = 0;
+    stor.types.insert(&ptrType);
+
+    // gl vars named 'g1' and 'g2', each of them holds a pointer
+    static const char *names[] = { 0, "g1", "g2" };
+    for (int uid = 1; uid <= 2; ++uid) {
+        CodeStorage::Var &var = stor.vars[uid];
+        var.code = CodeStorage::VAR_GL;
+        var.uid  = uid;
+        var.name = names[uid];
+        var.type = &ptrType;
+    }
+}
+
+void setPtrAt(SymHeap &sh, TValId at, TOffset off, TValId val) {
+    ObjHandle(sh, sh.valByOffset(at, off), &ptrType).setValue(val);
+}
+
+TValId allocNode(SymHeap &sh) {
+    return sh.heapAlloc(IR::rngFromNum(2 * sizeof(void *)));
+}
+
+/// g<uid> -> SLS of the given minimal length -> NULL
+void buildSls(SymHeap &sh, int uid, TMinLen len) {
+    const TValId seg = allocNode(sh);
+    setPtrAt(sh, seg, offNext, VAL_NULL);
+    setPtrAt(sh, seg, offPrev, VAL_NULL);
+    setPtrAt(sh, sh.addrOfVar(CVar(uid, 0), true), 0, seg);
+
+    BindingOff bf;
+    bf.head = 0;
+    bf.next = offNext;
+    bf.prev = offNext;
+    sh.valTargetSetAbstract(seg, OK_SLS, bf);
+    sh.segSetMinLength(seg, len);
+}
+
+/// g<uid> -> DLS of the given minimal length -> NULL, NULL <- DLS
+void buildDls(SymHeap &sh, int uid, TMinLen len) {
+    const TValId beg = allocNode(sh);
+    const TValId end = allocNode(sh);
+    setPtrAt(sh, beg, offNext, VAL_NULL);
+    setPtrAt(sh, beg, offPrev, end);
+    setPtrAt(sh, end, offNext, beg);
+    setPtrAt(sh, end, offPrev, VAL_NULL);
+    setPtrAt(sh, sh.addrOfVar(CVar(uid, 0), true), 0, beg);
+
+    // the binding of the peer has the 'next' and 'prev' fields swapped
+    BindingOff bfBeg;
+    bfBeg.head = 0;
+    bfBeg.next = offNext;
+    bfBeg.prev = offPrev;
+
+    BindingOff bfEnd;
+    bfEnd.head = 0;
+    bfEnd.next = offPrev;
+    bfEnd.prev = offNext;
+
+    sh.valTargetSetAbstract(beg, OK_DLS, bfBeg);
+    sh.valTargetSetAbstract(end, OK_DLS, bfEnd);
+    sh.segSetMinLength(beg, len);
+}
+
+/// sum of the minimal lengths of all segments, the peers of DLS included
+TMinLen sumOfMinLengths(const SymHeap &sh) {
+    TValList roots;
+    sh.gatherRootObjects(roots, isAbstract);
+
+    TMinLen sum = 0;
+    BOOST_FOREACH(const TValId root, roots)
+        sum += sh.segMinLength(root);
+
+    return sum;
+}
+
+void check(const char *name, const SymHeap &sh) {
+    std::ostringstream out;
+    {
+        SymWriter wr(out);
+        wr.writeHeap(sh);
+        if (!wr.ok()) {
+            std::cerr << name << ": failed to encode the heap\n";
+            ++cntErrors;
+            return;
+        }
+    }
+
+    std::istringstream in(out.str());
+    SymReader rd(sh.stor(), in);
+    SymHeap dup(sh.stor(), new Trace::TransientNode("test_symserial"));
+    if (!rd.readHeap(&dup)) {
+        std::cerr << name << ": failed to decode the heap\n";
+        ++cntErrors;
+        return;
+    }
+
+    if (!areEqual(sh, dup)) {
+        std::cerr << name << ": decoded heap differs from the original\n";
+        ++cntErrors;
+    }
+
+    if (sumOfMinLengths(sh) != sumOfMinLengths(dup)) {
+        std::cerr << name << ": minimal lengths do not survive the round-trip\n";
+        ++cntErrors;
+    }
+
+    std::cout << name << ": " << out.str().size() << " bytes" << std::endl;
+}
+
+} // namespace
+
+int main() {
+    CodeStorage::Storage stor;
+    initStor(stor);
+
+    for (TMinLen len = 0; len <= 2; ++len) {
+        std::ostringstream name;
+        name << "SLS " << len << "+";
+        SymHeap sh(stor, new Trace::TransientNode("test_symserial"));
+        buildSls(sh, /* g1 */ 1, len);
+        check(name.str().c_str(), sh);
+    }
+
+    for (TMinLen len = 0; len <= 2; ++len) {
+        std::ostringstream name;
+        name << "DLS " << len << "+";
+        SymHeap sh(stor, new Trace::TransientNode("test_symserial"));
+        buildDls(sh, /* g1 */ 1, len);
+        check(name.str().c_str(), sh);
+    }
+
+    // both kinds of segments in a single heap, one of them possibly empty
+    SymHeap sh(stor, new Trace::TransientNode("test_symserial"));
+    buildDls(sh, /* g1 */ 1, 0);
+    buildSls(sh, /* g2 */ 2, 1);
+    check("DLS 0+ and SLS 1+", sh);
+
+    // a state of heaps as used by SymSummaryStore
+    SymHeapUnion state;
+    state.insert(sh);
+    buildSls(sh, /* g1 */ 1, 2);
+    state.insert(sh);
+
+    std::ostringstream out;
+    SymWriter(out).writeState(state);
+    std::istringstream in(out.str());
+    SymHeapList dup;
+    if (!SymReader(stor, in).readState(dup,
+                new Trace::TransientNode("test_symserial"))
+            || dup.size() != state.size()
+            || !areEqual(state[0], dup[0])
+            || !areEqual(state[1], dup[1]))
+    {
+        std::cerr << "state: decoded state differs from the original\n";
+        ++cntErrors;
+    }
+
+    if (cntErrors)
+        std::cerr << "error: " << cntErrors << " mismatch(es) detected\n";
+
+    return !!cntErrors;
+}
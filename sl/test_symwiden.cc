@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2012 Kamil Dudka <kdudka@redhat.com>
+ *
+ * This file is part of predator.
+ *
+ * predator is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * predator is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with predator.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file test_symwiden.cc
+ * end-to-end test of the int_widening option, a counting loop is fed through
+ * the code listener interface the same way as the gcc plug-in would do it:
+ *
+ * @code
+ * int main() {
+ *     int i;
+ *     for (i = 0; i < 1000; ++i)
+ *         ;
+ *
+ *     if (i != 1000)
+ * ERROR:  goto ERROR;
+ *
+ *     return 0;
+ * }
+ * @endcode
+ */
+
+#include <cl/code_listener.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// the gcc part of the plug-in (referenced by cl/easy.hh) is not linked with the
+// test, the program is fed to the code listener directly
+extern "C" int plugin_init(struct plugin_name *, struct plugin_gcc_version *) {
+    return 0;
+}
+
+namespace {
+
+int cntErrors;
+
+/// messages printed by the analysis of the last program
+std::string msgs;
+
+void collectMsg(const char *msg) {
+    msgs += msg;
+    msgs += "\n";
+}
+
+void ignoreMsg(const char *) {
+}
+
+void expect(const char *what, const bool cond) {
+    if (cond)
+        return;
+
+    std::cerr << "failed: " << what << "\n";
+    ++cntErrors;
+}
+
+bool contains(const char *what) {
+    return std::string::npos != msgs.find(what);
+}
+
+struct cl_type          intType;
+struct cl_type          boolType;
+struct cl_type          fncType;
+struct cl_type_item     fncRet;
+
+struct cl_var           varI;
+struct cl_var           varCmp;
+struct cl_var           varNe;
+
+void initTypes() {
+    intType.uid         = 1;
+    intType.code        = CL_TYPE_INT;
+    intType.name        = "int";
+    intType.size        = sizeof(int);
+
+    boolType.uid        = 2;
+    boolType.code       = CL_TYPE_BOOL;
+    boolType.name       = "_Bool";
+    boolType.size       = 1;
+
+    fncType.uid         = 3;
+    fncType.code        = CL_TYPE_FNC;
+    fncType.item_cnt    = 1;
+    fncType.items       = &fncRet;
+    fncRet.type         = &intType;
+}
+
+void initVar(struct cl_var &var, const int uid, const char *name) {
+    var.uid             = uid;
+    var.name            = name;
+    var.loc.file        = "test_symwiden.c";
+    var.loc.line        = 2;
+}
+
+struct cl_operand varOp(struct cl_var &var, struct cl_type &type) {
+    struct cl_operand op;
+    memset(&op, 0, sizeof op);
+    op.code             = CL_OPERAND_VAR;
+    op.scope            = CL_SCOPE_FUNCTION;
+    op.type             = &type;
+    op.data.var         = &var;
+    return op;
+}
+
+struct cl_operand intOp(const int value) {
+    struct cl_operand op;
+    memset(&op, 0, sizeof op);
+    op.code             = CL_OPERAND_CST;
+    op.scope            = CL_SCOPE_GLOBAL;
+    op.type             = &intType;
+    op.data.cst.code    = CL_TYPE_INT;
+    op.data.cst.data.cst_int.value = value;
+    return op;
+}
+
+struct cl_insn newInsn(const enum cl_insn_e code, const int line) {
+    struct cl_insn insn;
+    memset(&insn, 0, sizeof insn);
+    insn.code           = code;
+    insn.loc.file       = "test_symwiden.c";
+    insn.loc.line       = line;
+    return insn;
+}
+
+void emitJmp(struct cl_code_listener *cl, const char *label) {
+    struct cl_insn insn = newInsn(CL_INSN_JMP, -1);
+    insn.loc.file = 0;
+    insn.data.insn_jmp.label = label;
+    cl->insn(cl, &insn);
+}
+
+void emitCond(
+        struct cl_code_listener     *cl,
+        const struct cl_operand     &src,
+        const char                  *thenLabel,
+        const char                  *elseLabel,
+        const int                   line)
+{
+    struct cl_insn insn = newInsn(CL_INSN_COND, line);
+    insn.data.insn_cond.src         = &src;
+    insn.data.insn_cond.then_label  = thenLabel;
+    insn.data.insn_cond.else_label  = elseLabel;
+    cl->insn(cl, &insn);
+}
+
+void emitBinop(
+        struct cl_code_listener     *cl,
+        const enum cl_binop_e       code,
+        const struct cl_operand     &dst,
+        const struct cl_operand     &src1,
+        const struct cl_operand     &src2,
+        const int                   line)
+{
+    struct cl_insn insn = newInsn(CL_INSN_BINOP, line);
+    insn.data.insn_binop.code   = code;
+    insn.data.insn_binop.dst    = &dst;
+    insn.data.insn_binop.src1   = &src1;
+    insn.data.insn_binop.src2   = &src2;
+    cl->insn(cl, &insn);
+}
+
+/// feed the program in the header of this file to the analyzer
+void analyze(const char *args) {
+    msgs.clear();
+
+    std::string config("listener=\"easy\" listener_args=\"");
+    config += args;
+    config += "\"";
+
+    struct cl_code_listener *cl = cl_code_listener_create(config.c_str());
+    if (!cl) {
+        expect("the code listener is created", false);
+        return;
+    }
+
+    struct cl_operand fnc;
+    memset(&fnc, 0, sizeof fnc);
+    fnc.code                            = CL_OPERAND_CST;
+    fnc.scope                           = CL_SCOPE_GLOBAL;
+    fnc.type                            = &fncType;
+    fnc.data.cst.code                   = CL_TYPE_FNC;
+    fnc.data.cst.data.cst_fnc.uid       = 100;
+    fnc.data.cst.data.cst_fnc.name      = "main";
+    fnc.data.cst.data.cst_fnc.loc.file  = "test_symwiden.c";
+    fnc.data.cst.data.cst_fnc.loc.line  = 1;
+
+    const struct cl_operand opI     = varOp(varI,   intType);
+    const struct cl_operand opCmp   = varOp(varCmp, boolType);
+    const struct cl_operand opNe    = varOp(varNe,  boolType);
+    const struct cl_operand opZero  = intOp(0);
+    const struct cl_operand opOne   = intOp(1);
+    const struct cl_operand opLast  = intOp(999);
+    const struct cl_operand opEnd   = intOp(1000);
+
+    cl->file_open(cl, "test_symwiden.c");
+    cl->fnc_open(cl, &fnc);
+    emitJmp(cl, "L1");
+
+    // i = 0;
+    cl->bb_open(cl, "L1");
+    struct cl_insn insn = newInsn(CL_INSN_UNOP, 3);
+    insn.data.insn_unop.code    = CL_UNOP_ASSIGN;
+    insn.data.insn_unop.dst     = &opI;
+    insn.data.insn_unop.src     = &opZero;
+    cl->insn(cl, &insn);
+    emitJmp(cl, "L2");
+
+    // i < 1000
+    cl->bb_open(cl, "L2");
+    emitBinop(cl, CL_BINOP_LE, opCmp, opI, opLast, 3);
+    emitCond(cl, opCmp, "L3", "L4", 3);
+
+    // ++i
+    cl->bb_open(cl, "L3");
+    emitBinop(cl, CL_BINOP_PLUS, opI, opI, opOne, 3);
+    emitJmp(cl, "L2");
+
+    // if (i != 1000)
+    cl->bb_open(cl, "L4");
+    emitBinop(cl, CL_BINOP_NE, opNe, opI, opEnd, 6);
+    emitCond(cl, opNe, "L5", "L6", 6);
+
+    // ERROR: goto ERROR;
+    cl->bb_open(cl, "L5");
+    insn = newInsn(CL_INSN_LABEL, 7);
+    insn.data.insn_label.name = "ERROR";
+    cl->insn(cl, &insn);
+    emitJmp(cl, "L5");
+
+    // return 0;
+    cl->bb_open(cl, "L6");
+    insn = newInsn(CL_INSN_RET, 9);
+    insn.data.insn_ret.src = &opZero;
+    cl->insn(cl, &insn);
+
+    cl->fnc_close(cl);
+    cl->file_close(cl);
+    cl->acknowledge(cl);
+    cl->destroy(cl);
+}
+
+} // namespace
+
+int main() {
+    struct cl_init_data init;
+    memset(&init, 0, sizeof init);
+    init.debug  = ignoreMsg;
+    init.warn   = collectMsg;
+    init.error  = collectMsg;
+    init.note   = collectMsg;
+    init.die    = collectMsg;
+    cl_global_init(&init);
+
+    initTypes();
+    initVar(varI,   10, "i");
+    initVar(varCmp, 11, 0);
+    initVar(varNe,  12, 0);
+
+    // without widening, i is abstracted beyond SE_INT_ARITHMETIC_LIMIT and
+    // the value after the loop is lost
+    analyze("error_label:ERROR");
+    expect("the error label is reached without widening",
+            contains("error label \"ERROR\" has been reached"));
+
+    // with widening, i is widened to the threshold 1000 given by the loop
+    // condition, so the loop converges with i == 1000 on its exit
+    analyze("error_label:ERROR,int_widening");
+    expect("the error label is not reached with widening",
+            !contains("error label"));
+    expect("the analysis is completed with widening",
+            !contains("error:"));
+
+    cl_global_cleanup();
+
+    if (cntErrors) {
+        std::cerr << msgs;
+        std::cerr << "error: " << cntErrors << " check(s) failed\n";
+    }
+
+    return !!cntErrors;
+}